@@ -0,0 +1,160 @@
+#include "led_engine/audio_filterbank.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Hz <-> position on the scale
+float to_scale(AudioScale scale, float hz) {
+  switch (scale) {
+    case AudioScale::Bark:
+      return 26.81f * hz / (1960.0f + hz) - 0.53f;  // Traunmueller
+    case AudioScale::ConstantQ:
+      return log2f(hz);
+    case AudioScale::Mel:
+    default:
+      return 2595.0f * log10f(1.0f + hz / 700.0f);
+  }
+}
+
+float from_scale(AudioScale scale, float value) {
+  switch (scale) {
+    case AudioScale::Bark:
+      return 1960.0f * (value + 0.53f) / (26.28f - value);
+    case AudioScale::ConstantQ:
+      return exp2f(value);
+    case AudioScale::Mel:
+    default:
+      return 700.0f * (powf(10.0f, value / 2595.0f) - 1.0f);
+  }
+}
+
+}  // namespace
+
+size_t audio_filterbank_bands(size_t requested) {
+  size_t bands = kAudioFilterbankMinBands;
+  while (bands < kAudioFilterbankMaxBands && requested >= bands + bands / 2) {
+    bands <<= 1;
+  }
+  return bands;
+}
+
+float audio_filterbank_center(AudioScale scale, size_t bands, int index) {
+  const float low = to_scale(scale, kAudioFilterbankMinHz);
+  const float high = to_scale(scale, kAudioFilterbankMaxHz);
+  const float step = (high - low) / static_cast<float>(bands + 1);
+  return from_scale(scale, low + step * static_cast<float>(index + 1));
+}
+
+void audio_filterbank_range(AudioScale scale, size_t bands, float f_low, float f_high, size_t& first,
+                            size_t& count) {
+  first = bands;
+  count = 0;
+  for (size_t i = 0; i < bands; ++i) {
+    const float center = audio_filterbank_center(scale, bands, static_cast<int>(i));
+    if (center >= f_low && center <= f_high) {
+      first = std::min(first, i);
+      ++count;
+    }
+  }
+  if (count > 0) {
+    return;
+  }
+  // Narrower than a band: the one nearest to the middle of the range
+  const float middle = to_scale(scale, sqrtf(std::max(f_low, 1.0f) * std::max(f_high, 1.0f)));
+  float best = 0.0f;
+  for (size_t i = 0; i < bands; ++i) {
+    const float distance = fabsf(to_scale(scale, audio_filterbank_center(scale, bands, static_cast<int>(i))) - middle);
+    if (count == 0 || distance < best) {
+      best = distance;
+      first = i;
+      count = 1;
+    }
+  }
+}
+
+void AudioFilterbank::configure(AudioScale scale, size_t bands, size_t bins, uint32_t sample_rate) {
+  bands = audio_filterbank_bands(bands);
+  bands_.assign(bands, Band{});
+  weights_.clear();
+  if (bins < 2 || sample_rate == 0) {
+    return;
+  }
+  const float bin_hz = static_cast<float>(sample_rate) / static_cast<float>(bins * 2);
+
+  // Two passes: count the weights, then fill them without reallocating
+  for (int pass = 0; pass < 2; ++pass) {
+    size_t total = 0;
+    for (size_t b = 0; b < bands; ++b) {
+      const float low = audio_filterbank_center(scale, bands, static_cast<int>(b) - 1);
+      const float center = audio_filterbank_center(scale, bands, static_cast<int>(b));
+      const float high = audio_filterbank_center(scale, bands, static_cast<int>(b) + 1);
+      // Bins strictly inside the triangle; fewer than two would collapse the
+      // band onto one bin, so those bands interpolate instead
+      const size_t first = std::max<size_t>(1, static_cast<size_t>(floorf(low / bin_hz)) + 1);
+      const size_t end = std::min(bins, static_cast<size_t>(ceilf(high / bin_hz)));
+      Band band{};
+      band.offset = static_cast<uint32_t>(total);
+      if (center / bin_hz >= static_cast<float>(bins - 1)) {
+        // Above Nyquist: empty
+      } else if (end > first + 1) {
+        band.first = static_cast<uint16_t>(first);
+        band.count = static_cast<uint16_t>(end - first);
+        if (pass == 1) {
+          float sum = 0.0f;
+          for (size_t k = first; k < end; ++k) {
+            const float f = static_cast<float>(k) * bin_hz;
+            const float w = f <= center ? (f - low) / (center - low) : (high - f) / (high - center);
+            weights_[total + k - first] = std::max(0.0f, w);
+            sum += weights_[total + k - first];
+          }
+          for (size_t k = 0; k < band.count; ++k) {
+            weights_[total + k] = sum > 0.0f ? weights_[total + k] / sum : 0.0f;
+          }
+        }
+      } else {
+        // Narrower than two bins: interpolate the two bins around the centre
+        const float position = std::max(1.0f, center / bin_hz);
+        const size_t below = std::min(static_cast<size_t>(position), bins - 2);
+        const float frac = std::clamp(position - static_cast<float>(below), 0.0f, 1.0f);
+        band.first = static_cast<uint16_t>(below);
+        band.count = 2;
+        if (pass == 1) {
+          weights_[total] = 1.0f - frac;
+          weights_[total + 1] = frac;
+        }
+      }
+      total += band.count;
+      if (pass == 1) {
+        bands_[b] = band;
+      }
+    }
+    if (pass == 0) {
+      weights_.assign(total, 0.0f);
+    }
+  }
+}
+
+void AudioFilterbank::set_gain(size_t band, float gain) {
+  if (band >= bands_.size()) {
+    return;
+  }
+  float* w = weights_.data() + bands_[band].offset;
+  for (size_t k = 0; k < bands_[band].count; ++k) {
+    w[k] *= gain;
+  }
+}
+
+void AudioFilterbank::apply(const float* magnitude, float* out) const {
+  const float* w = weights_.data();
+  for (const auto& band : bands_) {
+    const float* m = magnitude + band.first;
+    const float* bw = w + band.offset;
+    float acc = 0.0f;
+    #pragma GCC unroll 4
+    for (size_t k = 0; k < band.count; ++k) {
+      acc += bw[k] * m[k];
+    }
+    *out++ = acc;
+  }
+}
@@ -1,157 +1,292 @@
 #include "led_engine/audio_pipeline.hpp"
+#include "led_engine/seqlock.hpp"
 #include "esp_log.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+namespace {
+
+struct BandName {
+  const char* name;
+  AudioBand band;
+};
+
+constexpr BandName kBandNames[] = {
+    {"sub_bass", AudioBand::SubBass},
+    {"bass_low", AudioBand::BassLow},
+    {"bass_high", AudioBand::BassHigh},
+    {"mid_low", AudioBand::MidLow},
+    {"mid_mid", AudioBand::MidMid},
+    {"mid_high", AudioBand::MidHigh},
+    {"treble_low", AudioBand::TrebleLow},
+    {"treble_mid", AudioBand::TrebleMid},
+    {"treble_high", AudioBand::TrebleHigh},
+    {"bass", AudioBand::Bass},
+    {"mid", AudioBand::Mid},
+    {"treble", AudioBand::Treble},
+    {"energy", AudioBand::Energy},
+    {"beat", AudioBand::Beat},
+    {"tempo_bpm", AudioBand::TempoBpm},
+};
+
+}  // namespace
 
 static const char* TAG = "led-audio";
-static AudioDiagnostics g_diag{};
-static AudioMetrics g_metrics{};
+// The analyzer task writes metrics; effects, LEDFx and the web UI read them
+// from other tasks, so everything shared goes through SeqLocks
+static SeqLock<AudioMetrics> g_metrics;
+static SeqLock<AudioDiagnostics> g_diag;
+// Diagnostics have several writers (config, web, network source): they edit
+// this copy under the mutex and republish it
+static std::mutex g_diag_mutex;
+static AudioDiagnostics g_diag_state{};
+// Envelope specs change with the config and are read by the analyzer, which
+// only takes the mutex when the generation moved
+static std::mutex g_envelope_mutex;
+static AudioEnvelopeSpec g_envelopes[kAudioMaxEnvelopes]{};
+static size_t g_envelope_count = 0;
+static std::atomic<uint32_t> g_envelope_generation{0};
 static bool g_audio_force_disabled = false;  // Allow manual disable even if source is configured
 
+template <typename F>
+static void update_diag(F&& fn) {
+  std::lock_guard<std::mutex> lock(g_diag_mutex);
+  fn(g_diag_state);
+  g_diag.store(g_diag_state);
+}
+
 esp_err_t led_audio_apply_config(const AudioConfig& cfg) {
-  g_diag.source = cfg.source;
-  g_diag.sample_rate = cfg.sample_rate;
-  g_diag.stereo = cfg.stereo;
-  // Only set running if not manually disabled AND source is configured
-  g_diag.running = !g_audio_force_disabled &&
-                   cfg.source != AudioSourceType::None &&
-                   (cfg.source != AudioSourceType::Snapcast || cfg.snapcast.enabled);
+  AudioDiagnostics diag{};
+  update_diag([&](AudioDiagnostics& d) {
+    d.source = cfg.source;
+    d.sample_rate = cfg.sample_rate;
+    d.stereo = cfg.stereo;
+    // Only set running if not manually disabled AND source is configured
+    d.running = !g_audio_force_disabled &&
+                cfg.source != AudioSourceType::None &&
+                (cfg.source != AudioSourceType::Snapcast || cfg.snapcast.enabled);
+    diag = d;
+  });
 
   ESP_LOGI(TAG,
            "Audio pipeline: source=%s sr=%u stereo=%d latency=%u ms",
-           g_diag.source == AudioSourceType::Snapcast
+           diag.source == AudioSourceType::Snapcast
                ? "snapcast"
-               : (g_diag.source == AudioSourceType::LineInput ? "line" : "none"),
-           g_diag.sample_rate,
-           g_diag.stereo,
+               : (diag.source == AudioSourceType::LineInput ? "line" : "none"),
+           diag.sample_rate,
+           diag.stereo,
            cfg.snapcast.latency_ms);
   return ESP_OK;
 }
 
 AudioDiagnostics led_audio_get_diagnostics() {
-  return g_diag;
+  return g_diag.load();
 }
 
 AudioMetrics led_audio_get_metrics() {
-  return g_metrics;
+  AudioMetrics metrics;
+  metrics.sequence = g_metrics.load(metrics);
+  return metrics;
+}
+
+uint32_t led_audio_metrics_sequence() {
+  return g_metrics.version();
+}
+
+void led_audio_set_stream_format(uint32_t sample_rate, bool stereo, const char* codec) {
+  update_diag([&](AudioDiagnostics& d) {
+    d.sample_rate = sample_rate;
+    d.stereo = stereo;
+    d.codec = codec;
+    d.decode_us = 0;
+    d.decode_max_us = 0;
+  });
+}
+
+void led_audio_set_clock_sync(bool synced, int64_t offset_us, uint32_t buffer_ms) {
+  update_diag([&](AudioDiagnostics& d) {
+    d.clock_synced = synced;
+    d.clock_offset_us = offset_us;
+    d.stream_buffer_ms = buffer_ms;
+  });
+}
+
+void led_audio_set_decode_time(uint32_t avg_us, uint32_t max_us) {
+  update_diag([&](AudioDiagnostics& d) {
+    d.decode_us = avg_us;
+    d.decode_max_us = max_us;
+  });
 }
 
 void led_audio_set_metrics(const AudioMetrics& metrics) {
-  g_metrics = metrics;
+  AudioMetrics clamped = metrics;
   // Clamp to sane range
   auto clamp01f = [](float v) { return v < 0.0f ? 0.0f : (v > 1.5f ? 1.5f : v); };
-  g_metrics.energy = clamp01f(g_metrics.energy);
-  g_metrics.energy_left = clamp01f(g_metrics.energy_left);
-  g_metrics.energy_right = clamp01f(g_metrics.energy_right);
-  g_metrics.bass = clamp01f(g_metrics.bass);
-  g_metrics.mid = clamp01f(g_metrics.mid);
-  g_metrics.treble = clamp01f(g_metrics.treble);
-  g_metrics.beat = clamp01f(g_metrics.beat);
-  // Clamp 32-channel GEQ bands
-  for (int i = 0; i < 32; ++i) {
-    g_metrics.geq_bands[i] = clamp01f(g_metrics.geq_bands[i]);
+  clamped.energy = clamp01f(clamped.energy);
+  clamped.energy_left = clamp01f(clamped.energy_left);
+  clamped.energy_right = clamp01f(clamped.energy_right);
+  clamped.bass = clamp01f(clamped.bass);
+  clamped.mid = clamp01f(clamped.mid);
+  clamped.treble = clamp01f(clamped.treble);
+  clamped.beat = clamp01f(clamped.beat);
+  for (size_t i = 0; i < kAudioSubBands; ++i) {
+    clamped.sub_bands[i] = clamp01f(clamped.sub_bands[i]);
+  }
+  // Clamp GEQ bands
+  for (size_t i = 0; i < kAudioGeqBands; ++i) {
+    clamped.geq_bands[i] = clamp01f(clamped.geq_bands[i]);
   }
-  // magnitude_spectrum and sample_rate are stored as-is (no clamping needed)
+  g_metrics.store(clamped);
 }
 
-float led_audio_get_custom_energy(float freq_min, float freq_max) {
-  if (freq_min <= 0.0f || freq_max <= 0.0f || freq_min >= freq_max) {
-    return 0.0f;
+esp_err_t led_audio_set_running(bool running) {
+  AudioDiagnostics diag{};
+  update_diag([&](AudioDiagnostics& d) {
+    g_audio_force_disabled = !running;
+    // Update running state: only true if not force-disabled AND source is configured
+    // Note: snapcast.enabled check is done in led_audio_apply_config, here we just respect the force flag
+    d.running = !g_audio_force_disabled && d.source != AudioSourceType::None;
+    diag = d;
+  });
+  ESP_LOGI(TAG, "Audio running state set to %s (force_disabled=%d, source=%d)", 
+           diag.running ? "true" : "false", 
+           running ? 0 : 1,
+           static_cast<int>(diag.source));
+  return ESP_OK;
+}
+
+bool led_audio_band_from_name(const std::string& name, AudioBand& band) {
+  for (const auto& entry : kBandNames) {
+    if (name == entry.name) {
+      band = entry.band;
+      return true;
+    }
   }
-  if (g_metrics.magnitude_spectrum.empty() || g_metrics.sample_rate == 0) {
-    return 0.0f;
+  // Filterbank bands (geq_0 to geq_63)
+  if (name.size() >= 5 && name.size() <= 6 && name.compare(0, 4, "geq_") == 0) {
+    size_t index = 0;
+    for (size_t i = 4; i < name.size(); ++i) {
+      if (name[i] < '0' || name[i] > '9') {
+        return false;
+      }
+      index = index * 10 + static_cast<size_t>(name[i] - '0');
+    }
+    if (index < kAudioGeqBands) {
+      band = static_cast<AudioBand>(static_cast<size_t>(AudioBand::Geq0) + index);
+      return true;
+    }
   }
-  const size_t fft_size = g_metrics.magnitude_spectrum.size() * 2;  // FFT size (magnitude is half)
-  const float bin_hz = static_cast<float>(g_metrics.sample_rate) / static_cast<float>(fft_size);
-  size_t i_low = static_cast<size_t>(freq_min / bin_hz);
-  size_t i_high = static_cast<size_t>(freq_max / bin_hz);
-  i_low = std::min(i_low, g_metrics.magnitude_spectrum.size() - 1);
-  i_high = std::min(i_high, g_metrics.magnitude_spectrum.size() - 1);
-  if (i_low > i_high) {
-    return 0.0f;
+  return false;
+}
+
+float led_audio_band_value(const AudioMetrics& metrics, AudioBand band) {
+  const size_t index = static_cast<size_t>(band);
+  if (index < kAudioSubBands) {
+    return metrics.sub_bands[index];
   }
-  float acc = 0.0f;
-  size_t n = 0;
-  for (size_t i = i_low; i <= i_high; ++i) {
-    acc += g_metrics.magnitude_spectrum[i];
-    ++n;
+  if (index >= static_cast<size_t>(AudioBand::Geq0)) {
+    const size_t geq = index - static_cast<size_t>(AudioBand::Geq0);
+    return geq < std::min<size_t>(metrics.geq_count, kAudioGeqBands) ? metrics.geq_bands[geq] : 0.0f;
+  }
+  switch (band) {
+    case AudioBand::Bass:
+      return metrics.bass;
+    case AudioBand::Mid:
+      return metrics.mid;
+    case AudioBand::Treble:
+      return metrics.treble;
+    case AudioBand::Energy:
+      return metrics.energy;
+    case AudioBand::Beat:
+      return metrics.beat;
+    case AudioBand::TempoBpm:
+      return metrics.tempo_bpm;
+    default:
+      return 0.0f;
   }
-  return n > 0 ? std::min(1.5f, acc / static_cast<float>(n)) : 0.0f;
 }
 
-esp_err_t led_audio_set_running(bool running) {
-  g_audio_force_disabled = !running;
-  // Update running state: only true if not force-disabled AND source is configured
-  // Note: snapcast.enabled check is done in led_audio_apply_config, here we just respect the force flag
-  g_diag.running = !g_audio_force_disabled && g_diag.source != AudioSourceType::None;
-  ESP_LOGI(TAG, "Audio running state set to %s (force_disabled=%d, source=%d)", 
-           g_diag.running ? "true" : "false", 
-           g_audio_force_disabled ? 1 : 0,
-           static_cast<int>(g_diag.source));
-  return ESP_OK;
+float led_audio_range_value(const AudioMetrics& metrics, size_t first, size_t count) {
+  const size_t end = std::min<size_t>({first + count, metrics.geq_count, kAudioGeqBands});
+  if (first >= end) {
+    return 0.0f;
+  }
+  float sum = 0.0f;
+  for (size_t i = first; i < end; ++i) {
+    sum += metrics.geq_bands[i];
+  }
+  return sum / static_cast<float>(end - first);
 }
 
-float led_audio_get_band_value(const std::string& band_name) {
-  if (g_metrics.magnitude_spectrum.empty() || g_metrics.sample_rate == 0) {
-    return 0.0f;
+float led_audio_selection_level(const AudioMetrics& metrics, const AudioSelection& audio) {
+  float energy = metrics.energy;
+  if (audio.channel == AudioChannel::Left) {
+    energy = metrics.energy_left > 0.0f ? metrics.energy_left : metrics.energy * 0.8f;
+  } else if (audio.channel == AudioChannel::Right) {
+    energy = metrics.energy_right > 0.0f ? metrics.energy_right : metrics.energy * 0.8f;
   }
-  
-  const size_t fft_size = g_metrics.magnitude_spectrum.size() * 2;
-  const float bin_hz = static_cast<float>(g_metrics.sample_rate) / static_cast<float>(fft_size);
-  
-  auto band_energy = [&](float f_low, float f_high) {
-    size_t i_low = static_cast<size_t>(f_low / bin_hz);
-    size_t i_high = static_cast<size_t>(f_high / bin_hz);
-    i_low = std::min(i_low, g_metrics.magnitude_spectrum.size() - 1);
-    i_high = std::min(i_high, g_metrics.magnitude_spectrum.size() - 1);
-    if (i_low > i_high) return 0.0f;
-    float acc = 0.0f;
-    size_t n = 0;
-    for (size_t i = i_low; i <= i_high; ++i) {
-      acc += g_metrics.magnitude_spectrum[i];
-      ++n;
-    }
-    return n > 0 ? acc / static_cast<float>(n) : 0.0f;
-  };
-  
-  // Individual bands
-  if (band_name == "sub_bass") return std::min(1.5f, band_energy(20.0f, 60.0f) * 6.0f);
-  if (band_name == "bass_low") return std::min(1.5f, band_energy(60.0f, 120.0f) * 5.0f);
-  if (band_name == "bass_high") return std::min(1.5f, band_energy(120.0f, 250.0f) * 4.0f);
-  if (band_name == "mid_low") return std::min(1.5f, band_energy(250.0f, 500.0f) * 3.0f);
-  if (band_name == "mid_mid") return std::min(1.5f, band_energy(500.0f, 1000.0f) * 2.8f);
-  if (band_name == "mid_high") return std::min(1.5f, band_energy(1000.0f, 2000.0f) * 2.5f);
-  if (band_name == "treble_low") return std::min(1.5f, band_energy(2000.0f, 4000.0f) * 2.2f);
-  if (band_name == "treble_mid") return std::min(1.5f, band_energy(4000.0f, 8000.0f) * 2.0f);
-  if (band_name == "treble_high") return std::min(1.5f, band_energy(8000.0f, 12000.0f) * 1.8f);
-  
-  // Composite bands
-  if (band_name == "bass") return g_metrics.bass;
-  if (band_name == "mid") return g_metrics.mid;
-  if (band_name == "treble") return g_metrics.treble;
-  
-  // Metrics
-  if (band_name == "energy") return g_metrics.energy;
-  if (band_name == "beat") return g_metrics.beat;
-  if (band_name == "tempo_bpm") return g_metrics.tempo_bpm;
-  
-  // 32-channel GEQ bands (geq_0 to geq_31)
-  if (band_name.size() >= 5 && band_name.substr(0, 4) == "geq_") {
-    int band_idx = -1;
-    // Manual parsing (no exceptions in ESP-IDF)
-    const std::string num_str = band_name.substr(4);
-    if (!num_str.empty()) {
-      band_idx = 0;
-      for (char c : num_str) {
-        if (c >= '0' && c <= '9') {
-          band_idx = band_idx * 10 + (c - '0');
-        } else {
-          return 0.0f;  // Invalid character
-        }
+  float weighted = 0.0f;
+  if (audio.band_count > 0) {
+    // Average of the selected bands that carry signal
+    float sum = 0.0f;
+    size_t count = 0;
+    for (size_t i = 0; i < audio.band_count; ++i) {
+      const float band_val = led_audio_band_value(metrics, audio.bands[i]);
+      if (band_val > 0.0f) {
+        sum += band_val;
+        ++count;
       }
     }
-    if (band_idx >= 0 && band_idx < 32) {
-      return g_metrics.geq_bands[band_idx];
+    weighted = count > 0 ? sum / static_cast<float>(count) : energy * 0.7f;
+  } else if (audio.range_count > 0) {
+    // Custom frequency range, resolved to filterbank bands at config time
+    weighted = led_audio_range_value(metrics, audio.range_first, audio.range_count);
+    if (weighted <= 0.0001f) {
+      weighted = energy * 0.7f;  // Fallback to overall energy
+    }
+  } else {
+    // Default bands (bass, mid, treble) mixed by reactive_mode
+    const float bass = (metrics.bass > 0.0f ? metrics.bass : energy * 0.8f) * audio.gain_low;
+    const float mid = (metrics.mid > 0.0f ? metrics.mid : energy * 0.7f) * audio.gain_mid;
+    const float treble = (metrics.treble > 0.0f ? metrics.treble : energy * 0.6f) * audio.gain_high;
+    switch (audio.mode) {
+      case AudioReactiveMode::Kick:
+        // Sub-bass with emphasis on the beat for kick drum response
+        weighted = bass * 1.2f * 0.7f + metrics.beat * 0.3f;
+        break;
+      case AudioReactiveMode::Bass:
+        weighted = bass;
+        break;
+      case AudioReactiveMode::Mids:
+        weighted = mid;
+        break;
+      case AudioReactiveMode::Treble:
+        weighted = treble;
+        break;
+      default:
+        weighted = energy * 0.4f + mid * 0.25f + bass * 0.2f + treble * 0.15f;
+        break;
     }
   }
-  
-  return 0.0f;
-}
\ No newline at end of file
+  return weighted * (0.6f + metrics.beat * 0.4f);
+}
+
+void led_audio_set_envelopes(const AudioEnvelopeSpec* specs, size_t count) {
+  std::lock_guard<std::mutex> lock(g_envelope_mutex);
+  count = std::min(count, kAudioMaxEnvelopes);
+  std::copy(specs, specs + count, g_envelopes);
+  g_envelope_count = count;
+  g_envelope_generation.fetch_add(1, std::memory_order_release);
+}
+
+bool led_audio_get_envelopes(uint32_t& generation, AudioEnvelopeSpec* specs, size_t& count) {
+  if (g_envelope_generation.load(std::memory_order_acquire) == generation) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(g_envelope_mutex);
+  std::copy(g_envelopes, g_envelopes + g_envelope_count, specs);
+  count = g_envelope_count;
+  generation = g_envelope_generation.load(std::memory_order_relaxed);
+  return true;
+}
@@ -79,4 +79,22 @@ uint8_t chipset_bytes_per_pixel(const std::string& chipset_name) {
   return info->supports_rgbw ? 4 : 3;
 }
 
+uint32_t chipset_frame_time_us(const ChipsetInfo* info, uint16_t led_count) {
+  if (info == nullptr || info->uses_spi) {
+    return 0;
+  }
+  // Every bit is one symbol; take the longer of the two so the bound is never optimistic
+  const uint32_t bit_ticks = std::max<uint32_t>(info->timing.t0h_ticks + info->timing.t0l_ticks,
+                                                info->timing.t1h_ticks + info->timing.t1l_ticks);
+  const uint32_t bits = static_cast<uint32_t>(led_count) * (info->supports_rgbw ? 32u : 24u);
+  const uint64_t ticks = static_cast<uint64_t>(bits) * bit_ticks + info->timing.reset_ticks;
+  return static_cast<uint32_t>((ticks + 9) / 10);  // 100ns ticks -> us, rounded up
+}
 
+uint16_t chipset_max_fps(const ChipsetInfo* info, uint16_t led_count) {
+  const uint32_t frame_us = chipset_frame_time_us(info, led_count);
+  if (frame_us == 0) {
+    return 0;
+  }
+  return static_cast<uint16_t>(std::min<uint32_t>(1000000u / frame_us, 0xFFFF));
+}
@@ -236,3 +236,133 @@ void process_pixel(const uint8_t* src_rgb, uint8_t* dst, const std::string& colo
     convert_color_order(temp, dst, color_order, bytes_per_pixel);
 }
 
+
+namespace {
+
+// Wire position -> channel index for an order string such as "GRB" or "WRGB";
+// false when the string does not name every channel exactly once
+bool parse_color_order(const std::string& order, uint8_t bytes_per_pixel, uint8_t* out) {
+    if (order.size() != bytes_per_pixel) {
+        return false;
+    }
+    bool seen[4] = {false, false, false, false};
+    for (size_t i = 0; i < order.size(); ++i) {
+        uint8_t ch;
+        switch (order[i]) {
+            case 'R': case 'r': ch = 0; break;
+            case 'G': case 'g': ch = 1; break;
+            case 'B': case 'b': ch = 2; break;
+            case 'W': case 'w': ch = 3; break;
+            default: return false;
+        }
+        if (ch >= bytes_per_pixel || seen[ch]) {
+            return false;
+        }
+        seen[ch] = true;
+        out[i] = ch;
+    }
+    return true;
+}
+
+void build_lut(uint16_t* lut, float gamma, bool apply_gamma, float level) {
+    for (int v = 0; v < 256; ++v) {
+        float x = (v / 255.0f) * level;
+        if (apply_gamma && gamma > 0.0f) {
+            x = std::pow(x, gamma);
+        }
+        lut[v] = static_cast<uint16_t>(std::lround(x * (255.0f * 256.0f)));
+    }
+}
+
+}  // namespace
+
+void OutputConverter::configure(const std::string& color_order, uint8_t bpp, float gamma_color,
+                                float gamma_white, bool apply_gamma, uint8_t level, bool dither_on) {
+    bytes_per_pixel = bpp == 4 ? 4 : 3;
+    if (!parse_color_order(color_order, bytes_per_pixel, order)) {
+        // Same default as convert_color_order: GRB / GRBW
+        const uint8_t grbw[4] = {1, 0, 2, 3};
+        std::memcpy(order, grbw, sizeof(order));
+    }
+    dither = dither_on;
+    // Dimming before gamma: the level is part of the table input
+    const float scale = level / 255.0f;
+    build_lut(color_lut, gamma_color, apply_gamma, scale);
+    build_lut(white_lut, gamma_white, apply_gamma, scale);
+}
+
+void OutputConverter::convert_span(PixelFormat format, const uint8_t* px, uint8_t* dst, uint8_t* err,
+                                   size_t count, DirtyRegion* residue, size_t base) const {
+    const size_t in = pixel_format_bytes(format);
+    const size_t bpp = bytes_per_pixel;
+    size_t run = 0;  // residue pixels directly before i, added as one span
+    for (size_t i = 0; i < count; ++i) {
+        if (convert(format, px + i * in, dst + i * bpp, err != nullptr ? err + i * bpp : nullptr)) {
+            ++run;
+        } else if (run > 0) {
+            if (residue != nullptr) {
+                residue->add(base + i - run, run);
+            }
+            run = 0;
+        }
+    }
+    if (run > 0 && residue != nullptr) {
+        residue->add(base + count - run, run);
+    }
+}
+
+void convert_pixels(const uint8_t* src, PixelFormat src_format, uint8_t* dst, PixelFormat dst_format, size_t count) {
+    const size_t in = pixel_format_bytes(src_format);
+    const size_t out = pixel_format_bytes(dst_format);
+    if (src_format == dst_format) {
+        std::memcpy(dst, src, count * in);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i, src += in, dst += out) {
+        // Through 16-bit RGB(W)
+        uint32_t c[4] = {0, 0, 0, 0};
+        switch (src_format) {
+            case PixelFormat::Rgb16:
+                for (int k = 0; k < 3; ++k) {
+                    c[k] = src[k * 2] | (src[k * 2 + 1] << 8);
+                }
+                break;
+            case PixelFormat::Rgbw8888:
+                for (int k = 0; k < 4; ++k) {
+                    c[k] = src[k] * 257u;
+                }
+                break;
+            case PixelFormat::Rgb888:
+            default:
+                for (int k = 0; k < 3; ++k) {
+                    c[k] = src[k] * 257u;
+                }
+                break;
+        }
+        if (dst_format == PixelFormat::Rgbw8888) {
+            if (src_format != PixelFormat::Rgbw8888) {
+                c[3] = std::min(c[0], std::min(c[1], c[2]));
+                c[0] -= c[3];
+                c[1] -= c[3];
+                c[2] -= c[3];
+            }
+            for (int k = 0; k < 4; ++k) {
+                dst[k] = static_cast<uint8_t>((c[k] + 128) / 257);
+            }
+            continue;
+        }
+        for (int k = 0; k < 3; ++k) {
+            c[k] = std::min<uint32_t>(c[k] + c[3], 65535);
+        }
+        if (dst_format == PixelFormat::Rgb16) {
+            for (int k = 0; k < 3; ++k) {
+                dst[k * 2] = static_cast<uint8_t>(c[k]);
+                dst[k * 2 + 1] = static_cast<uint8_t>(c[k] >> 8);
+            }
+        } else {
+            for (int k = 0; k < 3; ++k) {
+                dst[k] = static_cast<uint8_t>((c[k] + 128) / 257);
+            }
+        }
+    }
+}
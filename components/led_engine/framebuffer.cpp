@@ -27,6 +27,10 @@ std::shared_ptr<Framebuffer> FramebufferManager::get_framebuffer(
     
     // Create new framebuffer
     auto fb = std::make_shared<Framebuffer>(width, height);
+    if (!fb->valid()) {
+        ESP_LOGW(TAG, "No pool memory for framebuffer %s (%ux%u)", segment_id.c_str(), width, height);
+        return nullptr;
+    }
     framebuffers_[segment_id] = {fb, width, height};
     
     ESP_LOGI(TAG, "Created framebuffer for %s: %ux%u (%u bytes)",
@@ -40,10 +44,8 @@ void FramebufferManager::release_framebuffer(const std::string& segment_id) {
     
     auto it = framebuffers_.find(segment_id);
     if (it != framebuffers_.end()) {
-        // shared_ptr will automatically clean up when ref count reaches 0
-        // We keep the entry until all references are released
-        // For now, we'll keep it - actual cleanup happens when ref count is 0
-        ESP_LOGD(TAG, "Release requested for framebuffer %s", segment_id.c_str());
+        framebuffers_.erase(it);
+        ESP_LOGD(TAG, "Released framebuffer %s", segment_id.c_str());
     }
 }
 
@@ -0,0 +1,271 @@
+#include "led_engine/framebuffer_pool.hpp"
+#include "led_engine/mem_placement.hpp"
+#include "esp_log.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef ESP_PLATFORM
+#include "esp_memory_utils.h"
+#include "sdkconfig.h"
+#endif
+
+namespace framebuffer {
+
+static const char* TAG = "fb-pool";
+static FramebufferPool s_pool;
+
+namespace {
+
+#if defined(CONFIG_CACHE_L2_CACHE_LINE_SIZE)
+constexpr size_t kAlignment = CONFIG_CACHE_L2_CACHE_LINE_SIZE;
+#else
+constexpr size_t kAlignment = 64;
+#endif
+
+// Small buffers are DMA-capable internal RAM, large ones DMA-capable PSRAM. Neither
+// tag falls back to memory DMA cannot reach, so acquire() fails instead.
+placement::MemTag tag_for(size_t bytes) {
+    return bytes >= kPoolPsramThreshold ? placement::MemTag::DmaBulk : placement::MemTag::Dma;
+}
+
+void* heap_alloc(size_t bytes, size_t alignment, bool prefer_psram, bool* placed_in_psram) {
+    (void)prefer_psram;  // follows from the size, see tag_for()
+    void* mem = placement::alloc(tag_for(bytes), bytes, alignment);
+#ifdef ESP_PLATFORM
+    *placed_in_psram = (mem != nullptr) && esp_ptr_external_ram(mem);
+#else
+    *placed_in_psram = false;
+#endif
+    return mem;
+}
+
+void heap_free(void* ptr, size_t bytes) {
+    placement::release(tag_for(bytes), ptr, bytes);
+}
+
+}  // namespace
+
+size_t FramebufferPool::alignment() {
+    return kAlignment;
+}
+
+int FramebufferPool::size_class_for(size_t bytes) {
+    for (size_t i = 0; i < kPoolSizeClassCount; ++i) {
+        if (bytes <= kPoolSizeClasses[i]) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+PoolHandle FramebufferPool::make_handle(size_t index) const {
+    return (static_cast<uint32_t>(slots_[index].generation) << 16) | static_cast<uint32_t>(index + 1);
+}
+
+FramebufferPool::Slot* FramebufferPool::lookup(PoolHandle handle) {
+    const size_t index = (handle & 0xFFFF);
+    if (index == 0 || index > slots_.size()) {
+        return nullptr;
+    }
+    Slot& slot = slots_[index - 1];
+    if (!slot.in_use || slot.generation != (handle >> 16)) {
+        return nullptr;
+    }
+    return &slot;
+}
+
+const FramebufferPool::Slot* FramebufferPool::lookup(PoolHandle handle) const {
+    return const_cast<FramebufferPool*>(this)->lookup(handle);
+}
+
+void FramebufferPool::free_slot_memory(Slot& slot) {
+    if (slot.mem) {
+        backend_.free(slot.mem, slot.capacity);
+    }
+    slot.mem = nullptr;
+    slot.capacity = 0;
+    slot.psram = false;
+}
+
+PoolHandle FramebufferPool::acquire(size_t bytes) {
+    if (bytes == 0) {
+        return kInvalidPoolHandle;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!backend_set_) {
+        backend_ = PoolBackend{heap_alloc, heap_free};
+        backend_set_ = true;
+    }
+
+    const int cls = size_class_for(bytes);
+    size_t index = 0;
+    bool reused = false;
+
+    if (cls >= 0 && !free_lists_[cls].empty()) {
+        index = free_lists_[cls].back();
+        free_lists_[cls].pop_back();
+        reused = true;
+    } else {
+        const size_t capacity = cls >= 0 ? kPoolSizeClasses[cls] : (bytes + kAlignment - 1) / kAlignment * kAlignment;
+        bool psram = false;
+        void* mem = backend_.alloc(capacity, kAlignment, capacity >= kPoolPsramThreshold, &psram);
+        if (mem == nullptr) {
+            failures_++;
+            ESP_LOGW(TAG, "Allocation of %u bytes failed", static_cast<unsigned>(capacity));
+            return kInvalidPoolHandle;
+        }
+        if (!empty_slots_.empty()) {
+            index = empty_slots_.back();
+            empty_slots_.pop_back();
+        } else {
+            if (slots_.size() >= 0xFFFF) {
+                backend_.free(mem, capacity);
+                failures_++;
+                return kInvalidPoolHandle;
+            }
+            slots_.emplace_back();
+            index = slots_.size() - 1;
+        }
+        Slot& slot = slots_[index];
+        slot.mem = static_cast<uint8_t*>(mem);
+        slot.capacity = capacity;
+        slot.size_class = static_cast<int8_t>(cls);
+        slot.psram = psram;
+        allocations_++;
+    }
+
+    Slot& slot = slots_[index];
+    slot.in_use = true;
+    slot.requested = bytes;
+    std::memset(slot.mem, 0, bytes);
+    if (reused) {
+        reuses_++;
+    }
+
+    size_t reserved = 0;
+    for (const auto& s : slots_) {
+        if (s.in_use) {
+            reserved += s.capacity;
+        }
+    }
+    peak_reserved_ = std::max(peak_reserved_, reserved);
+    return make_handle(index);
+}
+
+void FramebufferPool::release(PoolHandle handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot* slot = lookup(handle);
+    if (slot == nullptr) {
+        ESP_LOGW(TAG, "Release of invalid handle 0x%08x", static_cast<unsigned>(handle));
+        return;
+    }
+    const size_t index = static_cast<size_t>(slot - slots_.data());
+    slot->in_use = false;
+    slot->requested = 0;
+    // Stale copies of the handle stop resolving from here on
+    slot->generation = static_cast<uint16_t>(slot->generation == 0xFFFF ? 1 : slot->generation + 1);
+    if (slot->size_class >= 0) {
+        free_lists_[slot->size_class].push_back(static_cast<uint16_t>(index));
+    } else {
+        free_slot_memory(*slot);
+        empty_slots_.push_back(static_cast<uint16_t>(index));
+    }
+}
+
+uint8_t* FramebufferPool::data(PoolHandle handle) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Slot* slot = lookup(handle);
+    return slot ? slot->mem : nullptr;
+}
+
+size_t FramebufferPool::size(PoolHandle handle) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Slot* slot = lookup(handle);
+    return slot ? slot->requested : 0;
+}
+
+size_t FramebufferPool::capacity(PoolHandle handle) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Slot* slot = lookup(handle);
+    return slot ? slot->capacity : 0;
+}
+
+void FramebufferPool::trim() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& list : free_lists_) {
+        for (uint16_t index : list) {
+            free_slot_memory(slots_[index]);
+            empty_slots_.push_back(index);
+        }
+        list.clear();
+    }
+}
+
+PoolStats FramebufferPool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PoolStats st{};
+    for (size_t i = 0; i < kPoolSizeClassCount; ++i) {
+        st.classes[i].class_bytes = kPoolSizeClasses[i];
+    }
+    for (const auto& slot : slots_) {
+        if (slot.mem == nullptr) {
+            continue;
+        }
+        (slot.psram ? st.psram_bytes : st.internal_bytes) += slot.capacity;
+        if (slot.in_use) {
+            st.requested_bytes += slot.requested;
+            st.reserved_bytes += slot.capacity;
+            if (slot.size_class >= 0) {
+                st.classes[slot.size_class].in_use++;
+            } else {
+                st.oversize_in_use++;
+            }
+        } else {
+            st.cached_bytes += slot.capacity;
+            if (slot.size_class >= 0) {
+                st.classes[slot.size_class].cached++;
+            }
+        }
+    }
+    st.peak_reserved_bytes = peak_reserved_;
+    st.allocations = allocations_;
+    st.reuses = reuses_;
+    st.failures = failures_;
+    st.fragmentation = st.reserved_bytes > 0
+                           ? 1.0f - static_cast<float>(st.requested_bytes) / static_cast<float>(st.reserved_bytes)
+                           : 0.0f;
+    return st;
+}
+
+bool FramebufferPool::set_backend(const PoolBackend& backend) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (backend.alloc == nullptr || backend.free == nullptr) {
+        return false;
+    }
+    for (const auto& slot : slots_) {
+        if (slot.in_use) {
+            return false;
+        }
+    }
+    // Cached buffers belong to the old backend
+    if (backend_set_) {
+        for (auto& slot : slots_) {
+            free_slot_memory(slot);
+        }
+    }
+    slots_.clear();
+    empty_slots_.clear();
+    for (auto& list : free_lists_) {
+        list.clear();
+    }
+    backend_ = backend;
+    backend_set_ = true;
+    return true;
+}
+
+FramebufferPool& get_pool() {
+    return s_pool;
+}
+
+}  // namespace framebuffer
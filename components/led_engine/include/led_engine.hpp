@@ -1,10 +1,22 @@
 #pragma once
 #include "led_engine/pinout.hpp"
 #include "led_engine/types.hpp"
+#include "led_engine/mem_placement.hpp"
+#include "led_engine/triple_buffer.hpp"
+#include "led_engine/dirty_region.hpp"
+#include "led_engine/pixel_view.hpp"
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <vector>
 
+namespace framebuffer {
+struct Framebuffer;
+}
+
 struct LedEngineStatus {
   bool initialized{false};
   uint16_t target_fps{0};
@@ -12,8 +24,30 @@ struct LedEngineStatus {
   uint32_t global_current_ma{0};
   uint8_t global_brightness{255};
   bool enabled{true};
+  bool blackout{false};
+};
+
+// Wire-time limits of one segment
+struct LedSegmentRefresh {
+  std::string id;
+  uint32_t frame_time_us{0};  // data + reset latch on the slowest output
+  uint16_t max_fps{0};        // ceiling from frame_time_us (0 = not limited by the wire)
+  uint16_t effective_fps{0};  // min(max_fps, configured max_fps)
+  uint32_t frames{0};
+  uint32_t skipped{0};        // frames superseded by a newer render before reaching the wire
+  uint32_t not_due{0};        // effect frames not rendered (above effective_fps or wire backed up)
+  uint8_t brightness{255};    // live segment brightness
+  bool enabled{true};
 };
 
+// Rendering and output run on different tasks. render_frame() copies the
+// effect output into a per-segment triple buffer and returns; the output task
+// converts and transmits the newest published frame whenever the wire is free.
+// Config changes swap the whole frame path out and back in on their own slow
+// path, so neither stage ever takes the config lock.
+// Brightness, enable and blackout are live controls: the output task applies
+// them through the driver's output LUT (or stops transmitting after one dark
+// frame) without touching the RMT channels.
 class LedEngineRuntime {
 public:
   esp_err_t init(const LedHardwareConfig& cfg);
@@ -23,18 +57,129 @@ public:
   esp_err_t set_brightness(uint8_t brightness);
   uint8_t brightness() const;
   bool enabled() const;
+  // Dark outputs without losing the enabled state or brightness
+  esp_err_t set_blackout(bool blackout);
+  bool blackout() const;
+  esp_err_t set_segment_brightness(const std::string& segment_id, uint8_t brightness);
+  esp_err_t set_segment_enabled(const std::string& segment_id, bool enabled);
+  std::vector<LedSegmentRefresh> segment_refresh() const;
+  // Paces the effects to a segment's effective fps: true when a new frame is
+  // wanted now, i.e. a frame interval has passed since the last one claimed
+  // and no published frame is still waiting behind a busy wire. A true result
+  // claims the frame, so call it once per segment per effects tick and render
+  // (render_frame/render_view) only when it says so. Unknown segments are
+  // always due, so the render call reports them.
+  bool segment_frame_due(const std::string& segment_id);
+  // rgb holds `format` pixels; anything other than the segment's own format
+  // (segment_pixel_format) is converted on the way in. Without a hint the
+  // frame is compared against the previous one to find what changed; a hint
+  // (segment pixel indices) whose sequence follows the previous hinted frame
+  // is trusted instead and only its spans are copied.
   esp_err_t render_frame(const std::vector<uint8_t>& rgb,
                          const LedSegmentConfig& segment,
                          size_t start,
-                         size_t length);
+                         size_t length,
+                         PixelFormat format = PixelFormat::Rgb888,
+                         const DirtyRegion* hint = nullptr);
+  // Same, reading the pixels straight out of a view into a composed frame
+  // (virtual segment members); the view's length is the pixel count
+  esp_err_t render_view(const PixelView& view,
+                        const LedSegmentConfig& segment,
+                        size_t start,
+                        const DirtyRegion* hint = nullptr);
 
 private:
-  esp_err_t configure_driver(const LedHardwareConfig& cfg);
+  // One physical output of a logical segment; offset is its first LED in the segment
+  struct OutputChunk {
+    LedSegmentConfig output;
+    uint16_t offset{0};
+    bool synced{false};  // in the RMT sync group: transmitted every round, never skipped
+  };
+  struct SegmentOutputs {
+    std::string segment_id;
+    std::vector<OutputChunk> chunks;
+    uint16_t logical_count{0};  // pixels the effect renders
+    PixelFormat format{PixelFormat::Rgb888};  // pixel format of staging and frames
+    bool mapped{false};         // outputs expand logical pixels through an index map
+    bool synced{false};         // some chunk is in the RMT sync group
+    // Matrix canvas reaching the panel through a scale/rotate/mirror job
+    bool transformed{false};
+    uint16_t canvas_width{0};
+    uint16_t canvas_height{0};
+    LedMatrixConfig matrix{};
+    std::shared_ptr<framebuffer::Framebuffer> panel;  // row-major panel raster
+    uint32_t frame_time_us{0};
+    uint16_t max_fps{0};
+    uint16_t effective_fps{0};
+    uint32_t frame_interval_us{0};  // 1 / effective_fps, 0 = unpaced
+    // Effects task only (segment_frame_due)
+    uint32_t next_due_us{0};
+    bool due_started{false};
+    std::atomic<uint32_t> not_due{0};
+    // Frame handoff: staging collects partial renders (producer only), frames
+    // carries complete logical frames and what changed in them to the output task
+    struct Frame {
+      placement::HotVector<uint8_t> pixels;
+      DirtyRegion dirty;  // against the frame published before it
+    };
+    placement::HotVector<uint8_t> staging;
+    TripleBuffer<Frame> frames;
+    bool dither{false};
+    // An output still carries a dither residue, so unchanged frames have to go
+    // out too (written by the output task after each transmit)
+    std::atomic<bool> dithering{false};
+    // Producer only
+    DirtyRegion last_dirty;      // changes carried by the last published frame
+    bool published{false};
+    bool hint_ok{false};         // staging matches the last hinted frame
+    uint32_t hint_sequence{0};
+    // Output task only
+    bool primed{false};          // the driver holds an encoded frame
+    std::atomic<uint32_t> sent{0};
+    std::atomic<uint32_t> skipped{0};
+    // Live controls, combined with the global ones by output_level()
+    std::atomic<uint8_t> brightness{255};
+    std::atomic<bool> enabled{true};
+    uint8_t level_sent{255};  // output task only: level of the frame on the LEDs
+  };
+  // Segment topology the frame path reads; never modified while published
+  struct FramePath {
+    LedDriverType driver{LedDriverType::EspRmt};
+    std::vector<std::unique_ptr<SegmentOutputs>> segments;
+  };
+  // Keeps the published frame path alive while a stage uses it
+  class PathRef {
+  public:
+    explicit PathRef(const LedEngineRuntime& rt);
+    ~PathRef();
+    PathRef(const PathRef&) = delete;
+    PathRef& operator=(const PathRef&) = delete;
+    FramePath* get() const { return path_; }
+
+  private:
+    const LedEngineRuntime& rt_;
+    FramePath* path_{nullptr};
+  };
+
+  esp_err_t configure_driver(const LedHardwareConfig& cfg, bool reinit_channels);
+  void apply_controls(const LedHardwareConfig& cfg);
+  uint8_t output_level(const SegmentOutputs& entry) const;
+  void wake_output();
+  std::unique_ptr<FramePath> retire_path();
+  void transmit(SegmentOutputs& entry, const SegmentOutputs::Frame& frame, uint8_t level, bool full);
+  void output_loop();
+  static void output_task_entry(void* arg);
   void log_segment(const LedSegmentConfig& seg) const;
 
+  // Config slow path, guarded by mutex_
   LedHardwareConfig cfg_{};
-  bool initialized_{false};
-  bool enabled_{true};
-  uint8_t brightness_{255};
+  // Frame path
+  std::atomic<FramePath*> path_{nullptr};
+  mutable std::atomic<uint32_t> path_users_{0};
+  TaskHandle_t output_task_{nullptr};
+  std::atomic<bool> initialized_{false};
+  std::atomic<bool> enabled_{true};
+  std::atomic<uint8_t> brightness_{255};
+  std::atomic<bool> blackout_{false};
   mutable std::mutex mutex_;
 };
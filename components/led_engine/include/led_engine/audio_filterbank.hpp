@@ -0,0 +1,50 @@
+#pragma once
+#include "led_engine/mem_placement.hpp"
+#include "led_engine/types.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Perceptual filterbank over a magnitude spectrum
+// Band centres are spaced evenly on the chosen scale between
+// kAudioFilterbankMinHz and kAudioFilterbankMaxHz, and each band is a
+// triangle reaching from its lower to its upper neighbour's centre. The
+// geometry depends only on scale and band count, so config code can map
+// frequencies to bands without knowing the FFT. configure() samples the
+// triangles at the bin frequencies into a sparse weight table; a band
+// narrower than a bin interpolates between the two bins around its centre
+// instead of collapsing onto one. apply() is one multiply-add per non-zero
+// weight.
+
+constexpr float kAudioFilterbankMinHz = 20.0f;
+constexpr float kAudioFilterbankMaxHz = 16000.0f;
+constexpr size_t kAudioFilterbankMinBands = 8;
+constexpr size_t kAudioFilterbankMaxBands = 64;
+
+// Nearest supported band count (8, 16, 32 or 64)
+size_t audio_filterbank_bands(size_t requested);
+// Centre of band `index`; -1 and `bands` give the outer triangle edges
+float audio_filterbank_center(AudioScale scale, size_t bands, int index);
+// Bands whose centres fall in [f_low, f_high], or else the band nearest to it
+void audio_filterbank_range(AudioScale scale, size_t bands, float f_low, float f_high, size_t& first,
+                            size_t& count);
+
+class AudioFilterbank {
+public:
+  // bins: magnitude bins (fft_size / 2). The only call that allocates.
+  void configure(AudioScale scale, size_t bands, size_t bins, uint32_t sample_rate);
+  size_t bands() const { return bands_.size(); }
+  // Multiply a band's weights (at configure time); weights start at unit sum
+  void set_gain(size_t band, float gain);
+  // out[bands()]: weighted mean magnitude per band, 0 above Nyquist
+  void apply(const float* magnitude, float* out) const;
+
+private:
+  struct Band {
+    uint16_t first{0};
+    uint16_t count{0};
+    uint32_t offset{0};  // into weights_
+  };
+
+  placement::HotVector<Band> bands_;
+  placement::HotVector<float> weights_;
+};
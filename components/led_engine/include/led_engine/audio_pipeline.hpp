@@ -7,9 +7,24 @@ struct AudioDiagnostics {
   uint32_t sample_rate{0};
   bool stereo{false};
   bool running{false};
+  // Network stream clock (Snapcast): server time = local time + offset
+  bool clock_synced{false};
+  int64_t clock_offset_us{0};
+  uint32_t stream_buffer_ms{0};  // server buffer minus client latency
+  const char* codec{"none"};     // static string
+  uint32_t decode_us{0};         // per chunk, running average
+  uint32_t decode_max_us{0};
 };
 
+// Published as a fixed-size POD snapshot: readers copy it without allocating
+// and `sequence` tells them whether a new frame arrived since the last read
+constexpr size_t kAudioSubBands = 9;   // sub_bass .. treble_high
+constexpr size_t kAudioGeqBands = 64;  // filterbank bands at most
+constexpr size_t kAudioBandCount = static_cast<size_t>(AudioBand::Geq0) + kAudioGeqBands;
+constexpr size_t kAudioMaxEnvelopes = 32;
+
 struct AudioMetrics {
+  uint32_t sequence{0};    // frames published so far
   float energy{0.0f};      // overall normalized 0..1
   float energy_left{0.0f};
   float energy_right{0.0f};
@@ -17,30 +32,56 @@ struct AudioMetrics {
   float mid{0.0f};
   float treble{0.0f};
   float beat{0.0f};        // 0..1 envelope
-  float tempo_bpm{0.0f};   // estimated tempo
-  // 32-channel GEQ (Graphic Equalizer) - precise frequency bands
-  // Bands are logarithmically spaced from 20Hz to 20kHz
-  float geq_bands[32]{0.0f};  // 32 frequency bands for high-precision audio analysis
-  // FFT magnitude spectrum for custom frequency range calculation
-  // Stored as vector of magnitude values (one per FFT bin, up to Nyquist frequency)
-  std::vector<float> magnitude_spectrum{};  // magnitude spectrum for custom frequency calculations
+  float tempo_bpm{0.0f};   // estimated tempo, 0 until one is found
+  float tempo_confidence{0.0f};  // 0..1
+  float beat_phase{0.0f};  // 0 on a beat rising to 1 just before the next
+  // Octave-ish bands from 20 Hz to 12 kHz in AudioBand order (before the limiter)
+  float sub_bands[kAudioSubBands]{};
+  // GEQ (Graphic Equalizer): the configured mel/Bark/constant-Q filterbank
+  // from 20 Hz to 16 kHz, low to high; geq_count of them are in use
+  float geq_bands[kAudioGeqBands]{0.0f};
+  uint32_t geq_count{0};
+  // Attack/release followers of the registered AudioEnvelopeSpecs, advanced
+  // once per analysis frame; envelope_count of them are valid
+  float envelopes[kAudioMaxEnvelopes]{};
+  uint32_t envelope_count{0};
   uint32_t sample_rate{0};  // sample rate used for FFT
   // Synchronization timestamp (microseconds since epoch or relative to Snapcast server)
   // Used to synchronize LED effects with audio playback on other Snapcast clients
   uint64_t timestamp_us{0};  // Timestamp when this audio frame should be played (for sync)
   uint64_t processed_us{0};  // When this frame was processed (esp_timer_get_time())
+  uint64_t next_beat_us{0};  // predicted play time of the next beat, same clock as timestamp_us
 };
 
 esp_err_t led_audio_apply_config(const AudioConfig& cfg);
 AudioDiagnostics led_audio_get_diagnostics();
+
+// Consistent snapshot of the newest frame; safe from any task
 AudioMetrics led_audio_get_metrics();
+// Frames published so far; cheap check before taking a snapshot
+uint32_t led_audio_metrics_sequence();
+// Analyzer side (single writer): publish the metrics of a frame
 void led_audio_set_metrics(const AudioMetrics& metrics);
+// Stream format and clock state reported by the network source
+void led_audio_set_stream_format(uint32_t sample_rate, bool stereo, const char* codec);
+void led_audio_set_clock_sync(bool synced, int64_t offset_us, uint32_t buffer_ms);
+void led_audio_set_decode_time(uint32_t avg_us, uint32_t max_us);
 // Control audio running state independently from source configuration
 esp_err_t led_audio_set_running(bool running);
-// Calculate energy from custom frequency range (Hz)
-// Returns energy from freq_min to freq_max, or 0.0f if range is invalid or spectrum not available
-float led_audio_get_custom_energy(float freq_min, float freq_max);// Get value for a specific frequency band or metric
-// Available bands: "sub_bass", "bass_low", "bass_high", "mid_low", "mid_mid", "mid_high",
-//                  "treble_low", "treble_mid", "treble_high", "bass", "mid", "treble",
-//                  "energy", "beat", "tempo_bpm"
-float led_audio_get_band_value(const std::string& band_name);
\ No newline at end of file
+// Resolve a band name to its ID; for config decoding, not per frame
+// Names: "sub_bass", "bass_low", "bass_high", "mid_low", "mid_mid", "mid_high",
+//        "treble_low", "treble_mid", "treble_high", "bass", "mid", "treble",
+//        "energy", "beat", "tempo_bpm", "geq_0" .. "geq_63" (filterbank bands)
+bool led_audio_band_from_name(const std::string& name, AudioBand& band);
+// Value of a band in a metrics snapshot
+float led_audio_band_value(const AudioMetrics& metrics, AudioBand band);
+// Mean of filterbank bands [first, first + count) in a metrics snapshot
+float led_audio_range_value(const AudioMetrics& metrics, size_t first, size_t count);
+// Level of a compiled selection in a metrics snapshot: its bands, range or
+// reactive_mode mix, lifted by the beat. What the envelopes follow.
+float led_audio_selection_level(const AudioMetrics& metrics, const AudioSelection& audio);
+// Replace the envelopes the analyzer runs; specs past kAudioMaxEnvelopes are dropped
+void led_audio_set_envelopes(const AudioEnvelopeSpec* specs, size_t count);
+// Analyzer side: copy the envelopes into specs[kAudioMaxEnvelopes] if they
+// changed since `generation` (updated); false, without locking, otherwise
+bool led_audio_get_envelopes(uint32_t& generation, AudioEnvelopeSpec* specs, size_t& count);
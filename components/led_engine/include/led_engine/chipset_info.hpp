@@ -42,4 +42,9 @@ bool chipset_supports_rgbw(const std::string& chipset_name);
 // Get bytes per pixel (3 for RGB, 4 for RGBW)
 uint8_t chipset_bytes_per_pixel(const std::string& chipset_name);
 
+// Time to shift out `led_count` pixels plus the reset latch, in microseconds
+// (0 for SPI chipsets, whose clock is not fixed by the protocol)
+uint32_t chipset_frame_time_us(const ChipsetInfo* info, uint16_t led_count);
 
+// Highest refresh rate the wire allows for `led_count` pixels (0 = no limit)
+uint16_t chipset_max_fps(const ChipsetInfo* info, uint16_t led_count);
@@ -1,7 +1,11 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 #include <string>
+#include "led_engine/dirty_region.hpp"
+#include "led_engine/types.hpp"
 
 // Gamma correction lookup table (256 entries)
 extern const uint8_t gamma_table_22[256];
@@ -30,3 +34,118 @@ void convert_color_order(const uint8_t* src, uint8_t* dst, const std::string& or
 void process_pixel(const uint8_t* src_rgb, uint8_t* dst, const std::string& color_order, 
                    uint8_t bytes_per_pixel, float gamma_color, float gamma_brightness, bool apply_gamma);
 
+// Fused output conversion: effect pixels in, wire bytes out in one pass
+// (white handling, gamma, output level, color order). Gamma and level are
+// folded into 16-bit tables so dim output keeps its precision; with dithering
+// the low byte of every channel is carried over to the next frame through a
+// per-channel error accumulator instead of being rounded away. Only channels
+// whose table value has a fractional part move from frame to frame; a pixel
+// at whole-byte levels settles like an undithered one.
+// Inputs: RGB888 (white extracted on RGBW wires), RGBW8888 (native white,
+// folded into RGB on RGB wires) and RGB16 (tables interpolated).
+struct OutputConverter {
+    uint8_t bytes_per_pixel = 3;
+    uint8_t order[4] = {1, 0, 2, 3};  // wire byte i takes channel order[i] (R=0, G=1, B=2, W=3)
+    bool dither = false;
+    uint16_t color_lut[256] = {};     // 8.8 fixed point, at most 255 << 8
+    uint16_t white_lut[256] = {};
+
+    void configure(const std::string& color_order, uint8_t bytes_per_pixel, float gamma_color,
+                   float gamma_white, bool apply_gamma, uint8_t level, bool dither);
+
+    // err holds bytes_per_pixel accumulators and must persist across frames;
+    // it is ignored when dithering is off. Returns true when the pixel left a
+    // dither residue, i.e. the same input converts differently next frame.
+    inline bool convert(PixelFormat format, const uint8_t* px, uint8_t* dst, uint8_t* err) const {
+        uint16_t ch[4];
+        switch (format) {
+            case PixelFormat::Rgbw8888:
+                if (bytes_per_pixel == 4) {
+                    ch[0] = color_lut[px[0]];
+                    ch[1] = color_lut[px[1]];
+                    ch[2] = color_lut[px[2]];
+                    ch[3] = white_lut[px[3]];
+                } else {
+                    ch[0] = color_lut[std::min(255, px[0] + px[3])];
+                    ch[1] = color_lut[std::min(255, px[1] + px[3])];
+                    ch[2] = color_lut[std::min(255, px[2] + px[3])];
+                }
+                break;
+            case PixelFormat::Rgb16: {
+                uint32_t c[3];
+                for (int i = 0; i < 3; ++i) {
+                    // 0..65535 -> 8.8 table coordinates 0..255.0
+                    c[i] = ((px[i * 2] | (px[i * 2 + 1] << 8)) * 255u + 128u) >> 8;
+                }
+                if (bytes_per_pixel == 4) {
+                    const uint32_t w = std::min(c[0], std::min(c[1], c[2]));
+                    ch[0] = lookup(color_lut, c[0] - w);
+                    ch[1] = lookup(color_lut, c[1] - w);
+                    ch[2] = lookup(color_lut, c[2] - w);
+                    ch[3] = lookup(white_lut, w);
+                } else {
+                    ch[0] = lookup(color_lut, c[0]);
+                    ch[1] = lookup(color_lut, c[1]);
+                    ch[2] = lookup(color_lut, c[2]);
+                }
+                break;
+            }
+            case PixelFormat::Rgb888:
+            default:
+                if (bytes_per_pixel == 4) {
+                    const uint8_t w = std::min(px[0], std::min(px[1], px[2]));
+                    ch[0] = color_lut[px[0] - w];
+                    ch[1] = color_lut[px[1] - w];
+                    ch[2] = color_lut[px[2] - w];
+                    ch[3] = white_lut[w];
+                } else {
+                    ch[0] = color_lut[px[0]];
+                    ch[1] = color_lut[px[1]];
+                    ch[2] = color_lut[px[2]];
+                }
+                break;
+        }
+        if (dither) {
+            uint32_t fraction = 0;
+            for (uint8_t i = 0; i < bytes_per_pixel; ++i) {
+                const uint32_t v = ch[order[i]] + err[i];
+                err[i] = static_cast<uint8_t>(v);
+                dst[i] = static_cast<uint8_t>(v >> 8);
+                fraction |= ch[order[i]] & 0xFFu;
+            }
+            return fraction != 0;
+        }
+        for (uint8_t i = 0; i < bytes_per_pixel; ++i) {
+            dst[i] = static_cast<uint8_t>((ch[order[i]] + 0x80u) >> 8);
+        }
+        return false;
+    }
+
+    // Pixels that left a dither residue are added to residue (when given) as
+    // base + their index in the span
+    void convert_span(PixelFormat format, const uint8_t* px, uint8_t* dst, uint8_t* err, size_t count,
+                      DirtyRegion* residue = nullptr, size_t base = 0) const;
+
+private:
+    // Linear interpolation between table entries; pos is 8.8 fixed point
+    static inline uint16_t lookup(const uint16_t* lut, uint32_t pos) {
+        const uint32_t i = pos >> 8;
+        const uint32_t frac = pos & 0xFF;
+        if (frac == 0 || i >= 255) {
+            return lut[std::min<uint32_t>(i, 255)];
+        }
+        return static_cast<uint16_t>(lut[i] + (((static_cast<int32_t>(lut[i + 1]) - lut[i]) * static_cast<int32_t>(frac)) >> 8));
+    }
+};
+
+// Pixels an output has to convert for its next frame: what the effect changed
+// plus the pixels still carrying a dither residue from the last conversion
+inline DirtyRegion pending_conversion(const DirtyRegion& changed, const DirtyRegion& residue) {
+    DirtyRegion out = changed;
+    out.merge(residue);
+    return out;
+}
+
+// Plain format conversion between effect frame formats (no gamma); RGBW
+// sources fold white into RGB, RGBW targets extract it with min()
+void convert_pixels(const uint8_t* src, PixelFormat src_format, uint8_t* dst, PixelFormat dst_format, size_t count);
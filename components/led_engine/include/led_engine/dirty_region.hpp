@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Dirty pixel tracking
+// A frame that changes only a few pixels is described by a short sorted list
+// of pixel spans. Spans closer than kMergeGap are joined, and when the list is
+// full the two closest spans are merged, so the region only ever grows
+// conservatively; a region covering everything is kept as a flag.
+
+struct PixelSpan {
+    uint16_t start;
+    uint16_t length;
+};
+
+class DirtyRegion {
+public:
+    static constexpr size_t kMaxSpans = 16;
+    static constexpr size_t kMergeGap = 4;  // pixels; a short clean gap is cheaper to convert than to split
+
+    // Producer's frame counter; a hint is only valid against the frame directly
+    // before it (see LedEngineRuntime::render_frame)
+    uint32_t sequence{0};
+
+    void clear() {
+        count_ = 0;
+        all_ = false;
+    }
+    void mark_all() {
+        count_ = 0;
+        all_ = true;
+    }
+    bool all() const { return all_; }
+    bool empty() const { return !all_ && count_ == 0; }
+    size_t size() const { return count_; }
+    const PixelSpan* begin() const { return spans_; }
+    const PixelSpan* end() const { return spans_ + count_; }
+
+    size_t pixel_count(size_t total) const {
+        if (all_) {
+            return total;
+        }
+        size_t n = 0;
+        for (size_t i = 0; i < count_; ++i) {
+            n += spans_[i].length;
+        }
+        return n;
+    }
+
+    void add(size_t start, size_t length) {
+        if (all_ || length == 0) {
+            return;
+        }
+        size_t end = std::min<size_t>(start + length, UINT16_MAX);
+        if (start >= end) {
+            return;
+        }
+        // Absorb every span that overlaps or nearly touches [start, end)
+        size_t i = 0;
+        while (i < count_ && span_end(spans_[i]) + kMergeGap < start) {
+            ++i;
+        }
+        size_t j = i;
+        while (j < count_ && spans_[j].start <= end + kMergeGap) {
+            start = std::min<size_t>(start, spans_[j].start);
+            end = std::max<size_t>(end, span_end(spans_[j]));
+            ++j;
+        }
+        if (j == i) {
+            // Nothing absorbed: new span, collapsing the closest pair when full
+            insert_at(i, start, end);
+            if (count_ > kMaxSpans) {
+                merge_closest();
+            }
+            return;
+        }
+        // Replace spans [i, j) with the joined one
+        spans_[i] = PixelSpan{static_cast<uint16_t>(start), static_cast<uint16_t>(end - start)};
+        std::memmove(spans_ + i + 1, spans_ + j, (count_ - j) * sizeof(PixelSpan));
+        count_ -= static_cast<uint8_t>(j - i - 1);
+    }
+
+    // Rectangle of a row-major raster `row_width` pixels wide
+    void add_rect(size_t x, size_t y, size_t w, size_t h, size_t row_width) {
+        if (w >= row_width) {
+            add(y * row_width, h * row_width);
+            return;
+        }
+        for (size_t row = y; row < y + h; ++row) {
+            add(row * row_width + x, w);
+        }
+    }
+
+    void merge(const DirtyRegion& other) {
+        if (other.all_) {
+            mark_all();
+            return;
+        }
+        for (size_t i = 0; i < other.count_; ++i) {
+            add(other.spans_[i].start, other.spans_[i].length);
+        }
+    }
+
+    // The part inside [from, to), rebased so `from` becomes pixel 0
+    DirtyRegion slice(size_t from, size_t to) const {
+        DirtyRegion out;
+        out.sequence = sequence;
+        if (all_) {
+            out.mark_all();
+            return out;
+        }
+        for (size_t i = 0; i < count_; ++i) {
+            const size_t s = std::max<size_t>(spans_[i].start, from);
+            const size_t e = std::min<size_t>(span_end(spans_[i]), to);
+            if (s < e) {
+                out.add(s - from, e - s);
+            }
+        }
+        return out;
+    }
+
+private:
+    static size_t span_end(const PixelSpan& s) { return static_cast<size_t>(s.start) + s.length; }
+
+    void insert_at(size_t i, size_t start, size_t end) {
+        std::memmove(spans_ + i + 1, spans_ + i, (count_ - i) * sizeof(PixelSpan));
+        spans_[i] = PixelSpan{static_cast<uint16_t>(start), static_cast<uint16_t>(end - start)};
+        ++count_;
+    }
+
+    void merge_closest() {
+        size_t best = 0;
+        size_t best_gap = SIZE_MAX;
+        for (size_t i = 0; i + 1 < count_; ++i) {
+            const size_t gap = spans_[i + 1].start - span_end(spans_[i]);
+            if (gap < best_gap) {
+                best_gap = gap;
+                best = i;
+            }
+        }
+        spans_[best].length = static_cast<uint16_t>(span_end(spans_[best + 1]) - spans_[best].start);
+        std::memmove(spans_ + best + 1, spans_ + best + 2, (count_ - best - 2) * sizeof(PixelSpan));
+        --count_;
+    }
+
+    PixelSpan spans_[kMaxSpans + 1]{};  // one spare slot for insert-then-merge
+    uint8_t count_{0};
+    bool all_{false};
+};
+
+// Compare `count` pixels of `bpp` bytes and add the blocks that differ to out;
+// base is the pixel index of prev[0]/next[0] in the region's coordinates.
+// Returns true when anything differed.
+inline bool diff_pixels(const uint8_t* prev, const uint8_t* next, size_t count, size_t bpp, size_t base,
+                        DirtyRegion& out) {
+    constexpr size_t kBlock = 8;  // pixels per compare
+    bool changed = false;
+    for (size_t i = 0; i < count; i += kBlock) {
+        const size_t n = std::min(kBlock, count - i);
+        if (std::memcmp(prev + i * bpp, next + i * bpp, n * bpp) != 0) {
+            out.add(base + i, n);
+            changed = true;
+        }
+    }
+    return changed;
+}
@@ -7,6 +7,7 @@
 #include <string>
 #include <unordered_map>
 #include <cstring>
+#include "led_engine/framebuffer_pool.hpp"
 
 // Framebuffer for LED effects - allows multi-pass rendering
 // Provides off-screen rendering buffer for effects that need multiple passes
@@ -15,53 +16,79 @@
 namespace framebuffer {
 
 struct Framebuffer {
-    std::vector<uint8_t> data;  // RGB888 format (3 bytes per pixel)
     uint16_t width;
     uint16_t height;
     uint32_t size_bytes;
-    
-    Framebuffer(uint16_t w, uint16_t h) 
-        : width(w), height(h), size_bytes(w * h * 3) {
-        data.resize(size_bytes, 0);
+    PoolHandle handle;  // RGB888 pixels (3 bytes per pixel) in the framebuffer pool
+
+    Framebuffer(uint16_t w, uint16_t h)
+        : width(w), height(h), size_bytes(w * h * 3),
+          handle(get_pool().acquire(size_bytes)),
+          pixels_(get_pool().data(handle)) {
+        if (pixels_ == nullptr) {
+            size_bytes = 0;  // allocation failed, behave as an empty buffer
+        }
     }
-    
+
+    ~Framebuffer() {
+        if (handle != kInvalidPoolHandle) {
+            get_pool().release(handle);
+        }
+    }
+
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    uint8_t* data() { return pixels_; }
+    const uint8_t* data() const { return pixels_; }
+    bool valid() const { return pixels_ != nullptr; }
+    // Padded pool capacity, what the PPA may write to (0 when invalid)
+    size_t capacity() const { return valid() ? get_pool().capacity(handle) : 0; }
+
     // Get pixel at (x, y) - returns pointer to RGB bytes
     uint8_t* pixel(uint16_t x, uint16_t y) {
-        if (x >= width || y >= height) return nullptr;
-        return data.data() + (y * width + x) * 3;
+        if (!pixels_ || x >= width || y >= height) return nullptr;
+        return pixels_ + (y * width + x) * 3;
     }
     
     const uint8_t* pixel(uint16_t x, uint16_t y) const {
-        if (x >= width || y >= height) return nullptr;
-        return data.data() + (y * width + x) * 3;
+        if (!pixels_ || x >= width || y >= height) return nullptr;
+        return pixels_ + (y * width + x) * 3;
     }
     
     // Clear framebuffer (fill with black)
     void clear() {
-        std::memset(data.data(), 0, size_bytes);
+        if (pixels_) {
+            std::memset(pixels_, 0, size_bytes);
+        }
     }
     
     // Clear with color
     void clear(uint8_t r, uint8_t g, uint8_t b) {
-        for (size_t i = 0; i < data.size(); i += 3) {
-            data[i] = r;
-            data[i + 1] = g;
-            data[i + 2] = b;
+        for (size_t i = 0; i + 2 < size_bytes; i += 3) {
+            pixels_[i] = r;
+            pixels_[i + 1] = g;
+            pixels_[i + 2] = b;
         }
     }
     
     // Copy from another framebuffer
     void copy_from(const Framebuffer& other) {
-        if (width == other.width && height == other.height) {
-            std::memcpy(data.data(), other.data.data(), size_bytes);
+        if (width == other.width && height == other.height && size_bytes == other.size_bytes && size_bytes > 0) {
+            std::memcpy(pixels_, other.pixels_, size_bytes);
         }
     }
     
     // Copy to RGB buffer (for rendering to LED)
     void copy_to(std::vector<uint8_t>& out) const {
         out.resize(size_bytes);
-        std::memcpy(out.data(), data.data(), size_bytes);
+        if (size_bytes > 0) {
+            std::memcpy(out.data(), pixels_, size_bytes);
+        }
     }
+
+private:
+    uint8_t* pixels_;
 };
 
 // Framebuffer manager - manages multiple framebuffers for multi-pass effects
@@ -72,7 +99,8 @@ public:
     std::shared_ptr<Framebuffer> get_framebuffer(const std::string& segment_id, 
                                                   uint16_t width, uint16_t height);
     
-    // Release framebuffer (decrements ref count)
+    // Drop the manager's reference; memory returns to the pool once the
+    // last holder lets go of the shared_ptr
     void release_framebuffer(const std::string& segment_id);
     
     // Clear all framebuffers
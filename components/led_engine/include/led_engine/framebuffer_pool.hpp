@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Pooled framebuffer memory for effects, PPA and RMT
+// Buffers come from fixed size classes, are cache-line aligned and DMA-capable,
+// and are addressed by integer handle. Released buffers stay cached in their
+// class for reuse until trim() hands them back to the heap.
+
+namespace framebuffer {
+
+using PoolHandle = uint32_t;
+constexpr PoolHandle kInvalidPoolHandle = 0;
+
+// Size classes in bytes; larger requests get a dedicated allocation
+constexpr size_t kPoolSizeClasses[] = {1024, 4096, 16384, 65536, 262144};
+constexpr size_t kPoolSizeClassCount = sizeof(kPoolSizeClasses) / sizeof(kPoolSizeClasses[0]);
+
+// Requests at or above this size prefer PSRAM, smaller ones internal RAM
+constexpr size_t kPoolPsramThreshold = 16384;
+
+// Allocation backend; swapped for a plain aligned allocator in host builds/tests
+struct PoolBackend {
+    void* (*alloc)(size_t bytes, size_t alignment, bool prefer_psram, bool* placed_in_psram);
+    void (*free)(void* ptr, size_t bytes);
+};
+
+struct PoolClassStats {
+    size_t class_bytes;
+    uint32_t in_use;
+    uint32_t cached;  // released, kept for reuse
+};
+
+struct PoolStats {
+    PoolClassStats classes[kPoolSizeClassCount];
+    uint32_t oversize_in_use;
+    size_t requested_bytes;  // sum of sizes asked for by live buffers
+    size_t reserved_bytes;   // capacity backing live buffers
+    size_t cached_bytes;     // capacity held by released buffers
+    size_t internal_bytes;   // live + cached, internal RAM
+    size_t psram_bytes;      // live + cached, PSRAM
+    size_t peak_reserved_bytes;
+    uint32_t allocations;    // heap allocations performed
+    uint32_t reuses;         // acquires served from the cache
+    uint32_t failures;
+    // Share of reserved memory not requested by callers (size-class rounding), 0..1
+    float fragmentation;
+};
+
+class FramebufferPool {
+public:
+    // Acquire a zeroed buffer of at least `bytes`; kInvalidPoolHandle on failure
+    PoolHandle acquire(size_t bytes);
+
+    // Return a buffer to its class; the handle becomes invalid
+    void release(PoolHandle handle);
+
+    uint8_t* data(PoolHandle handle) const;
+    size_t size(PoolHandle handle) const;
+    // Bytes usable at data(): the size class, or the size rounded to alignment()
+    size_t capacity(PoolHandle handle) const;
+
+    // Free cached (released) buffers back to the heap
+    void trim();
+
+    PoolStats stats() const;
+
+    // Replace the allocation backend; only valid while no buffers are live
+    bool set_backend(const PoolBackend& backend);
+
+    static size_t alignment();
+
+private:
+    struct Slot {
+        uint8_t* mem{nullptr};
+        size_t capacity{0};
+        size_t requested{0};
+        int8_t size_class{-1};  // -1 = oversize
+        bool in_use{false};
+        bool psram{false};
+        uint16_t generation{1};
+    };
+
+    static int size_class_for(size_t bytes);
+    Slot* lookup(PoolHandle handle);
+    const Slot* lookup(PoolHandle handle) const;
+    PoolHandle make_handle(size_t index) const;
+    void free_slot_memory(Slot& slot);
+
+    mutable std::mutex mutex_;
+    std::vector<Slot> slots_;
+    std::vector<uint16_t> free_lists_[kPoolSizeClassCount];  // cached slots per class
+    std::vector<uint16_t> empty_slots_;                      // slots without memory
+    PoolBackend backend_{};
+    bool backend_set_{false};
+    size_t peak_reserved_{0};
+    uint32_t allocations_{0};
+    uint32_t reuses_{0};
+    uint32_t failures_{0};
+};
+
+// Global pool instance
+FramebufferPool& get_pool();
+
+}  // namespace framebuffer
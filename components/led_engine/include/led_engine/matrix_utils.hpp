@@ -15,4 +15,11 @@ bool matrix_config_valid(const LedMatrixConfig& matrix);
 // Get total LED count for matrix
 uint16_t matrix_total_leds(const LedMatrixConfig& matrix);
 
+// Size of the canvas effects render for the matrix (render_width/height, or the
+// panel size seen through the rotation when unset)
+void matrix_canvas_size(const LedMatrixConfig& matrix, uint16_t* width_out, uint16_t* height_out);
+
+// True when the canvas needs scaling, rotation or mirroring to reach the panel
+bool matrix_has_transform(const LedMatrixConfig& matrix);
+
 
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <new>
+#include <vector>
+
+// Memory placement policy
+// Every long-lived buffer is allocated under one of a few tags that say where
+// it should live; each tag has a preferred heap region and a fallback, and
+// usage is accounted per tag so /api/info can show where memory went.
+
+namespace placement {
+
+enum class MemTag : uint8_t {
+    HotInternal,  // touched every frame by the CPU: internal SRAM, PSRAM only as fallback
+    Dma,          // read/written by RMT/PPA DMA: DMA-capable internal RAM, DMA-capable PSRAM as fallback
+    PsramBulk,    // large sequential buffers (frame caches, audio history): PSRAM first
+    Cold,         // rarely touched (logs, diagnostics): PSRAM first
+    DmaBulk,      // large buffers DMA reads (pooled framebuffers): DMA-capable PSRAM, then
+                  // DMA-capable internal RAM; fails rather than land outside DMA reach
+};
+
+constexpr size_t kMemTagCount = 5;
+
+struct TagStats {
+    size_t bytes_in_use;
+    size_t peak_bytes;
+    uint32_t allocations;  // live allocations
+    uint32_t failures;
+    uint32_t fallbacks;    // allocations that landed outside the preferred region
+};
+
+const char* tag_name(MemTag tag);
+
+// Allocate `bytes` under `tag`; align 0 = natural malloc alignment. nullptr on failure.
+void* alloc(MemTag tag, size_t bytes, size_t align = 0);
+
+// Release memory from alloc(); tag and size must match the allocation
+void release(MemTag tag, void* ptr, size_t bytes);
+
+TagStats stats(MemTag tag);
+
+// Free bytes in the internal and PSRAM heaps
+size_t free_internal_bytes();
+size_t free_psram_bytes();
+
+// Standard allocator adaptor so containers can carry a placement tag
+template <typename T, MemTag Tag>
+struct TaggedAllocator {
+    using value_type = T;
+
+    TaggedAllocator() noexcept = default;
+    template <typename U>
+    TaggedAllocator(const TaggedAllocator<U, Tag>&) noexcept {}
+
+    template <typename U>
+    struct rebind {
+        using other = TaggedAllocator<U, Tag>;
+    };
+
+    T* allocate(size_t n) {
+        void* mem = alloc(Tag, n * sizeof(T), alignof(T));
+        if (mem == nullptr) {
+#if defined(__cpp_exceptions)
+            throw std::bad_alloc();
+#else
+            abort();
+#endif
+        }
+        return static_cast<T*>(mem);
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept { release(Tag, ptr, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const TaggedAllocator<U, Tag>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const TaggedAllocator<U, Tag>&) const noexcept { return false; }
+};
+
+template <typename T>
+using HotVector = std::vector<T, TaggedAllocator<T, MemTag::HotInternal>>;
+template <typename T>
+using DmaVector = std::vector<T, TaggedAllocator<T, MemTag::Dma>>;
+template <typename T>
+using BulkVector = std::vector<T, TaggedAllocator<T, MemTag::PsramBulk>>;
+template <typename T>
+using BulkDeque = std::deque<T, TaggedAllocator<T, MemTag::PsramBulk>>;
+template <typename T>
+using ColdDeque = std::deque<T, TaggedAllocator<T, MemTag::Cold>>;
+
+}  // namespace placement
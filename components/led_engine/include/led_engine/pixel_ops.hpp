@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Software pixel kernels for RGB888 buffers (3 bytes per pixel)
+// Integer-only, blending four bytes per step when the buffers are word
+// aligned; used below the calibrated PPA crossover and as the software
+// backend of the PPA job queue.
+
+namespace pixel_ops {
+
+// Fill `count` pixels with one color
+void fill_rgb(uint8_t* dst, size_t count, uint8_t r, uint8_t g, uint8_t b);
+
+// out = fg * alpha + bg * (255 - alpha), alpha 0-255; out may alias fg or bg
+void blend_rgb(const uint8_t* fg, const uint8_t* bg, uint8_t* out, size_t count, uint8_t alpha);
+
+// Same as blend_rgb with one alpha byte per pixel
+void blend_rgb_alpha(const uint8_t* fg, const uint8_t* bg, uint8_t* out, const uint8_t* alpha, size_t count);
+
+// Dim `count` pixels in place to level/255
+void scale_rgb(uint8_t* px, size_t count, uint8_t level);
+
+// Nearest-neighbour scale of an in_w x in_h raster to out_w x out_h, then rotate
+// counter-clockwise by rotation_deg (0/90/180/270) and mirror, in the order the
+// PPA SRM engine applies them. For 90/270 the scaled image is out_h x out_w.
+// in and out must not overlap.
+void scale_rotate_mirror_rgb(const uint8_t* in, uint16_t in_w, uint16_t in_h,
+                             uint8_t* out, uint16_t out_w, uint16_t out_h,
+                             uint16_t rotation_deg, bool mirror_x, bool mirror_y);
+
+}  // namespace pixel_ops
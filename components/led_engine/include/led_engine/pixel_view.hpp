@@ -0,0 +1,39 @@
+#pragma once
+
+#include "led_engine/types.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Non-owning view of `length` pixels inside a larger composed frame
+// View pixel i sits at frame pixel offset + i * stride (counted from the end
+// of the view when reversed), so a member of a virtual segment can be handed
+// to an output without copying its part of the frame out first.
+
+struct PixelView {
+    const uint8_t* base{nullptr};  // composed frame
+    size_t offset{0};              // frame pixel of the first pixel in storage order
+    size_t length{0};
+    size_t stride{1};              // frame pixels between consecutive view pixels
+    bool reverse{false};           // view pixel 0 is the last one in storage order
+    PixelFormat format{PixelFormat::Rgb888};
+
+    static PixelView contiguous(const uint8_t* data, size_t length, PixelFormat format = PixelFormat::Rgb888) {
+        PixelView view;
+        view.base = data;
+        view.length = length;
+        view.format = format;
+        return view;
+    }
+
+    bool is_contiguous() const { return stride == 1 && !reverse; }
+
+    // Frame pixels from the first to the last pixel of the view
+    size_t extent() const { return length == 0 ? 0 : (length - 1) * stride + 1; }
+
+    size_t frame_index(size_t i) const { return offset + (reverse ? length - 1 - i : i) * stride; }
+
+    const uint8_t* pixel(size_t i) const { return base + frame_index(i) * pixel_format_bytes(format); }
+
+    // First pixel in storage order; the whole view for contiguous ones
+    const uint8_t* data() const { return base + offset * pixel_format_bytes(format); }
+};
@@ -1,17 +1,17 @@
 #pragma once
 
 #include "esp_err.h"
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
-#ifdef CONFIG_IDF_TARGET_ESP32P4
-#include "driver/ppa.h"
-
 // PPA (Pixel Processing Accelerator) wrapper for ESP32-P4
 // Provides hardware-accelerated pixel operations:
 // - Blending (alpha blending, color mixing)
 // - Fill (solid color fill)
 // - Scale-Rotate-Mirror (for matrix effects)
+// On other targets the hardware entry points return ESP_ERR_NOT_SUPPORTED
+// and the job queue runs on the software backend.
 
 namespace ppa_accel {
 
@@ -21,17 +21,25 @@ esp_err_t init_blend_client();
 // Initialize PPA client for fill operations
 esp_err_t init_fill_client();
 
+// Initialize PPA client for scale-rotate-mirror operations
+esp_err_t init_srm_client();
+
 // Deinitialize PPA clients
 void deinit();
 
+// Output buffers: the PPA writes whole cache lines, so the driver only takes
+// an output that starts on a cache line and whose capacity is a multiple of
+// one (see hardware_target). Framebuffer pool buffers qualify; out_capacity
+// is the bytes available at out, 0 meaning exactly width * height * 3.
+
 // Blend two RGB buffers with alpha blending (hardware accelerated)
 // dst = src * alpha + dst * (1 - alpha)
 // All buffers must be RGB888 format (3 bytes per pixel)
-// Returns ESP_OK on success
+// Returns ESP_OK on success, ESP_ERR_INVALID_ARG for an output the PPA cannot take
 esp_err_t blend_rgb(const uint8_t* src, const uint8_t* dst, uint8_t* out,
-                    uint16_t width, uint16_t height, float alpha);
+                    uint16_t width, uint16_t height, float alpha, size_t out_capacity = 0);
 
-// Blend two RGB buffers with per-pixel alpha (hardware accelerated)
+// Blend two RGB buffers with per-pixel alpha
 // dst = src * src_alpha + dst * (1 - src_alpha)
 // src_alpha_buffer: per-pixel alpha values (0-255)
 // Returns ESP_OK on success
@@ -40,34 +48,119 @@ esp_err_t blend_rgb_per_pixel_alpha(const uint8_t* src, const uint8_t* dst, uint
                                     uint16_t width, uint16_t height);
 
 // Fill RGB buffer with solid color (hardware accelerated)
-// Returns ESP_OK on success
+// Returns ESP_OK on success, ESP_ERR_INVALID_ARG for an output the PPA cannot take
 esp_err_t fill_rgb(uint8_t* buffer, uint16_t width, uint16_t height,
-                   uint8_t r, uint8_t g, uint8_t b);
+                   uint8_t r, uint8_t g, uint8_t b, size_t out_capacity = 0);
 
-// Check if PPA is available (ESP32-P4 only)
-bool is_available();
+// Cache line size the PPA output rules refer to
+size_t buffer_alignment();
 
-}  // namespace ppa_accel
-
-#else
+// True when `capacity` bytes at `out` (0 = exactly `bytes`) can take a
+// `bytes`-byte PPA result
+bool hardware_target(const void* out, size_t capacity, size_t bytes);
 
-// Stub implementation for non-ESP32-P4 platforms
-namespace ppa_accel {
+// Check if PPA is available (ESP32-P4 only)
+bool is_available();
 
-inline esp_err_t init_blend_client() { return ESP_ERR_NOT_SUPPORTED; }
-inline esp_err_t init_fill_client() { return ESP_ERR_NOT_SUPPORTED; }
-inline void deinit() {}
-inline esp_err_t blend_rgb(const uint8_t* src, const uint8_t* dst, uint8_t* out,
-                          uint16_t, uint16_t, float) { return ESP_ERR_NOT_SUPPORTED; }
-inline esp_err_t blend_rgb_per_pixel_alpha(const uint8_t*, const uint8_t*, uint8_t*,
-                                          const uint8_t*, uint16_t, uint16_t) { 
-  return ESP_ERR_NOT_SUPPORTED; 
-}
-inline esp_err_t fill_rgb(uint8_t*, uint16_t, uint16_t, uint8_t, uint8_t, uint8_t) { 
-  return ESP_ERR_NOT_SUPPORTED; 
-}
-inline bool is_available() { return false; }
+// ---------------------------------------------------------------------------
+// CPU/PPA crossover
+// The PPA pays a fixed cost per transaction (descriptor setup, cache sync,
+// interrupt) that the CPU kernels do not. calibrate() times both at two frame
+// sizes at boot and derives the pixel count above which the PPA wins.
+
+enum class Op : uint8_t {
+    Fill,
+    Blend,
+};
+
+struct Calibration {
+    bool calibrated;
+    uint32_t fill_crossover;   // pixels; UINT32_MAX = CPU always faster
+    uint32_t blend_crossover;
+    uint32_t fill_cpu_us;      // cost of one 64x64 frame
+    uint32_t fill_ppa_us;
+    uint32_t blend_cpu_us;
+    uint32_t blend_ppa_us;
+};
+
+// Measure CPU vs PPA cost; ESP_ERR_NOT_SUPPORTED without a PPA
+esp_err_t calibrate();
+
+// True when the PPA is expected to beat the CPU kernels for `pixels` written
+// to `out` (out_capacity as for fill_rgb); false for outputs it cannot take
+bool prefer_hardware(Op op, size_t pixels, const void* out, size_t out_capacity = 0);
+
+Calibration calibration();
+
+// ---------------------------------------------------------------------------
+// Asynchronous jobs
+// Jobs are queued without blocking the caller. The hardware backend runs them
+// on the PPA in non-blocking mode; the software backend runs the same
+// operations on the CPU when the caller polls or waits, in submission order.
+// Buffers must stay valid until the job is done. A job whose output the PPA
+// cannot take (see hardware_target) is queued for the CPU from the start,
+// behind the hardware jobs submitted before it.
+
+using JobId = uint32_t;
+constexpr JobId kInvalidJob = 0;
+
+// Completion callback; runs in ISR context for hardware jobs, keep it short
+using JobCallback = void (*)(JobId id, esp_err_t result, void* user_ctx);
+
+enum class JobBackend : uint8_t {
+    Hardware,
+    Software,
+};
+
+struct JobStats {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t failed;
+    uint32_t software_runs;  // jobs executed on the CPU (software backend or hardware fallback)
+    uint32_t queue_full;     // submissions rejected because all slots were busy
+    uint32_t cpu_routed;     // jobs sent to the CPU because their output is no PPA target
+};
+
+// Select the backend; Hardware falls back to Software when the PPA is missing
+esp_err_t jobs_init(JobBackend preferred);
+JobBackend jobs_backend();
+
+// Queue a fill; kInvalidJob if the queue is full
+JobId submit_fill(uint8_t* buffer, uint16_t width, uint16_t height,
+                  uint8_t r, uint8_t g, uint8_t b,
+                  JobCallback cb = nullptr, void* user_ctx = nullptr, size_t out_capacity = 0);
+
+// Queue out = fg * alpha + bg * (255 - alpha); kInvalidJob if the queue is full
+JobId submit_blend(const uint8_t* fg, const uint8_t* bg, uint8_t* out,
+                   uint16_t width, uint16_t height, uint8_t alpha,
+                   JobCallback cb = nullptr, void* user_ctx = nullptr, size_t out_capacity = 0);
+
+// Queue a scale-rotate-mirror of an in_w x in_h raster onto out_w x out_h.
+// Rotation is counter-clockwise (0/90/180/270) and mirroring follows it, as on
+// the PPA; scale factors are derived from the sizes (swapped for 90/270).
+// kInvalidJob if the queue is full
+JobId submit_srm(const uint8_t* in, uint16_t in_w, uint16_t in_h,
+                 uint8_t* out, uint16_t out_w, uint16_t out_h,
+                 uint16_t rotation_deg, bool mirror_x, bool mirror_y,
+                 JobCallback cb = nullptr, void* user_ctx = nullptr, size_t out_capacity = 0);
+
+// Non-blocking completion check
+bool job_done(JobId id);
+
+// Let the software backend run one queued job (no-op for hardware)
+void poll_jobs();
+
+// Block until the job (and, for software, every job queued before it) is done
+esp_err_t wait_job(JobId id, uint32_t timeout_ms);
+
+// Like wait_job, but a job still running after expected_ms is waited out
+// (with a warning) instead of abandoned, so its buffers are free on return.
+// Returns the job's result
+esp_err_t settle_job(JobId id, uint32_t expected_ms);
+
+// Block until every queued job is done
+esp_err_t wait_all_jobs(uint32_t timeout_ms);
+
+JobStats job_stats();
 
 }  // namespace ppa_accel
-
-#endif  // CONFIG_IDF_TARGET_ESP32P4
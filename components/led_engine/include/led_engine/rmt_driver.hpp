@@ -1,31 +1,44 @@
 #pragma once
 
 #include "led_engine/types.hpp"
+#include "led_engine/dirty_region.hpp"
 #include "esp_err.h"
 #include <vector>
 #include <mutex>
 
-// Request for parallel rendering
-struct ParallelRenderRequest {
-    const LedSegmentConfig* segment;
-    const std::vector<uint8_t>& rgb;
-    size_t start;
-    size_t length;
-};
-
 // Initialize RMT driver for a segment
 esp_err_t rmt_driver_init_segment(const LedSegmentConfig& seg, bool enable_dma);
 
 // Render RGB data to segment via RMT
 esp_err_t rmt_driver_render(const LedSegmentConfig& seg, const std::vector<uint8_t>& rgb, size_t start, size_t length);
 
+// Render `length` pixels starting at LED `start`; rgb points at the first of them and
+// holds `format` pixels (RGB888, RGBW8888 with native white, or 16-bit RGB).
+// Outputs with an index map take a logical span and expand it to the physical LEDs.
+// level (0-255) dims the pixels inside the fused conversion without touching the
+// channel; 0 sends black. Segments with dither set carry the sub-8-bit part of
+// every channel over to the next frame. dirty (relative to rgb[0]) lists the pixels
+// that changed since the previous call; the rest keep their encoded bytes, except
+// dithered LEDs that left a residue, which are converted again.
+// Call from one task per output.
+esp_err_t rmt_driver_render_pixels(const LedSegmentConfig& seg, const uint8_t* rgb, size_t start, size_t length,
+                                   uint8_t level = 255, PixelFormat format = PixelFormat::Rgb888,
+                                   const DirtyRegion* dirty = nullptr);
+
+// Install the physical -> logical pixel map of an output (empty = 1:1)
+esp_err_t rmt_driver_set_index_map(const LedSegmentConfig& seg, std::vector<uint16_t> index_map);
+
 // Initialize parallel IO mode - creates sync manager for simultaneous transmission
 // segments: vector of segment configs to sync (1-4 segments, ESP32-P4 has 4 TX channels)
+// A member only starts once every member has a transaction queued, so each
+// round has to call rmt_driver_sync_reset() and then transmit on all of them.
 esp_err_t rmt_driver_init_parallel_mode(const std::vector<const LedSegmentConfig*>& segments);
 
-// Render to multiple segments in parallel (simultaneous transmission)
-// All segments in requests must be initialized and part of the sync manager
-esp_err_t rmt_driver_render_parallel(const std::vector<ParallelRenderRequest>& requests);
+// True when the output belongs to the sync group
+bool rmt_driver_in_sync_group(int gpio, uint8_t rmt_channel);
+
+// Start a new synchronized round; ESP_ERR_INVALID_STATE without a sync group
+esp_err_t rmt_driver_sync_reset();
 
 // Deinitialize RMT driver for a segment
 esp_err_t rmt_driver_deinit_segment(int gpio, uint8_t rmt_channel);
@@ -33,6 +46,29 @@ esp_err_t rmt_driver_deinit_segment(int gpio, uint8_t rmt_channel);
 // Deinitialize all RMT drivers
 void rmt_driver_deinit_all();
 
+// Per-output encoder counters
+struct RmtDriverStats {
+    int gpio;
+    uint8_t rmt_channel;
+    bool symbol_lut;          // true when the output uses pre-encoded symbols
+    uint32_t frames;
+    uint64_t symbols;         // RMT symbols emitted by the encoder callback
+    uint64_t isr_encode_us;   // time spent in the encoder callback (ISR context)
+    uint64_t preencode_us;    // time spent expanding bytes through the LUT (task context)
+    uint64_t isr_saved_us;    // estimated ISR time saved vs. the bytes encoder
+    uint32_t busy_skips;      // frames not transmitted because the wire was still busy
+};
+
+// True while a previously queued frame is still being shifted out
+bool rmt_driver_output_busy(int gpio, uint8_t rmt_channel);
+
+// True when no LED of the output carries a dither residue, so an unchanged
+// frame would go out exactly as the last one
+bool rmt_driver_dither_settled(int gpio, uint8_t rmt_channel);
+
+// Snapshot encoder counters of all initialized outputs
+void rmt_driver_get_stats(std::vector<RmtDriverStats>& out);
+
 
 
 
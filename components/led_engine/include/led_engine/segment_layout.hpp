@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "led_engine/types.hpp"
+
+// Physical LED that shows no logical pixel (spacing gap)
+constexpr uint16_t kLayoutDarkPixel = 0xFFFF;
+
+// True when the segment's matrix canvas reaches the panel through a
+// scale/rotate/mirror pass; grouping, spacing, mirror and reverse are then ignored
+bool segment_uses_matrix_transform(const LedSegmentConfig& seg);
+
+// Frame format effects should render for the segment. Transformed matrices
+// stay RGB888 because the scale/rotate/mirror pass works on RGB888.
+PixelFormat segment_pixel_format(const LedSegmentConfig& seg);
+
+// True when grouping/spacing/mirror/reverse leave the segment 1:1
+bool segment_layout_is_identity(const LedSegmentConfig& seg);
+
+// Number of pixels an effect renders for the segment (after grouping, spacing and
+// mirror, or the matrix canvas size)
+uint16_t segment_logical_count(const LedSegmentConfig& seg);
+
+// Map physical LED -> logical pixel (kLayoutDarkPixel for gaps); empty for identity layouts.
+// For transformed matrices the logical pixel is the row-major panel raster index.
+std::vector<uint16_t> segment_build_index_map(const LedSegmentConfig& seg);
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer / multi-reader sequence lock around a trivially copyable value
+// The writer bumps the sequence to odd, copies the value in and bumps it back
+// to even; a reader copies the value out and retries when the sequence was odd
+// or moved meanwhile. Neither side allocates or takes a lock, and any number
+// of readers on any core get a consistent snapshot. The writer never waits.
+// A reader only spins while a store is in flight (a memcpy), so it must not
+// outrank the writer on the writer's core or it could spin forever.
+// Concurrent writers must be serialized by the caller.
+
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable value");
+
+public:
+    SeqLock() = default;
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    // Writer side
+    void store(const T& value) {
+        const uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&value_, &value, sizeof(T));
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Update the value in place; for large values of which only part changes
+    template <typename F>
+    void write(F&& fn) {
+        const uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        fn(value_);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Reader side: copy into `out`; returns the number of stores it reflects
+    uint32_t load(T& out) const {
+        for (;;) {
+            const uint32_t before = seq_.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            std::memcpy(&out, &value_, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == before) {
+                return before / 2;
+            }
+        }
+    }
+
+    T load() const {
+        T out;
+        load(out);
+        return out;
+    }
+
+    // Evaluate `fn(const T&)` in place instead of copying a large value. fn
+    // may see a torn value and run again, so it must stay in bounds whatever
+    // the fields hold and must have no side effects.
+    template <typename F>
+    auto read(F&& fn) const -> decltype(fn(std::declval<const T&>())) {
+        for (;;) {
+            const uint32_t before = seq_.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            auto result = fn(value_);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == before) {
+                return result;
+            }
+        }
+    }
+
+    // Stores so far; cheap check for a new value
+    uint32_t version() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+private:
+    std::atomic<uint32_t> seq_{0};
+    T value_{};
+};
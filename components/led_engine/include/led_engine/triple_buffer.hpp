@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Wait-free single-producer / single-consumer triple buffer
+// The producer owns one slot, the consumer owns another and the third sits in
+// the middle. publish() swaps the producer slot into the middle and takes the
+// old middle back; acquire() swaps the consumer slot with the middle when it
+// holds a frame that was not read yet. Neither side ever waits for the other:
+// the consumer always sees the newest completed frame and frames published
+// faster than they are read are simply superseded.
+
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Direct slot access for sizing before either side starts
+    T& slot(size_t index) { return slots_[index]; }
+
+    // Producer side
+    T& write_buffer() { return slots_[back_]; }
+
+    // Hand the write buffer to the consumer; false when the previously
+    // published frame was never acquired (it is superseded by this one)
+    bool publish() {
+        const uint8_t prev = middle_.exchange(static_cast<uint8_t>(back_ | kFresh), std::memory_order_acq_rel);
+        back_ = prev & kIndexMask;
+        return (prev & kFresh) == 0;
+    }
+
+    // Consumer side
+    bool pending() const { return (middle_.load(std::memory_order_acquire) & kFresh) != 0; }
+
+    // Take the newest published frame; false when nothing new was published
+    bool acquire() {
+        if (!pending()) {
+            return false;
+        }
+        const uint8_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & kIndexMask;
+        return true;
+    }
+
+    const T& read_buffer() const { return slots_[front_]; }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x03;
+    static constexpr uint8_t kFresh = 0x04;
+
+    T slots_[3]{};
+    uint8_t back_{0};                 // producer only
+    uint8_t front_{1};                // consumer only
+    std::atomic<uint8_t> middle_{2};  // slot index | kFresh
+};
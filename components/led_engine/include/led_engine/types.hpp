@@ -1,8 +1,20 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
 
+// Pixel layout of frames handed to the LED engine
+enum class PixelFormat : uint8_t {
+  Rgb888,    // 3 bytes per pixel
+  Rgbw8888,  // 4 bytes per pixel, native white channel
+  Rgb16,     // 3 little-endian 16-bit channels per pixel
+};
+
+constexpr uint8_t pixel_format_bytes(PixelFormat format) {
+  return format == PixelFormat::Rgb16 ? 6 : (format == PixelFormat::Rgbw8888 ? 4 : 3);
+}
+
 enum class LedDriverType {
   EspRmt,
   NeoPixelBus,
@@ -15,11 +27,26 @@ enum class AudioSourceType {
   LineInput,
 };
 
+// Frequency scale of the spectrum filterbank (AudioMetrics::geq_bands)
+enum class AudioScale : uint8_t {
+  Mel,
+  Bark,
+  ConstantQ,  // log-spaced, constant bandwidth per octave
+};
+
 struct LedMatrixConfig {
   uint16_t width{0};
   uint16_t height{0};
   bool serpentine{true};
   bool vertical{false};
+  // Effect canvas; 0 = panel size. Smaller canvases are upscaled to the panel
+  uint16_t render_width{0};
+  uint16_t render_height{0};
+  // Panel orientation applied to the canvas: counter-clockwise degrees
+  // (0/90/180/270), then mirroring
+  uint16_t rotation{0};
+  bool mirror_x{false};
+  bool mirror_y{false};
 };
 
 struct LedSegmentAudioConfig {
@@ -32,6 +59,13 @@ struct LedSegmentAudioConfig {
   std::vector<float> per_led_sensitivity{};
 };
 
+// Extra physical output driving a chunk of a logical segment
+struct LedOutputChunk {
+  int gpio{-1};
+  uint8_t rmt_channel{0};
+  uint16_t led_count{0};  // 0 = split remaining LEDs evenly
+};
+
 struct LedSegmentConfig {
   std::string id{"segment-1"};
   std::string name{"Segment"};
@@ -43,6 +77,15 @@ struct LedSegmentConfig {
   uint8_t rmt_channel{0};
   std::string chipset{"ws2812b"};
   std::string color_order{"GRB"};
+  // RMT output encoding: "bytes" runs the bytes encoder inside the RMT ISR,
+  // "lut" pre-expands every byte into RMT symbols so the ISR only copies memory
+  std::string rmt_encoding{"bytes"};
+  // Effect output format: "auto" (RGBW8888 on RGBW chipsets, else RGB888),
+  // "rgb888", "rgbw8888" or "rgb16"
+  std::string pixel_format{"auto"};
+  // Additional outputs: when set, the segment is split into 1 + outputs.size()
+  // chunks transmitted in parallel; chunk 0 stays on gpio/rmt_channel
+  std::vector<LedOutputChunk> outputs{};
   std::string effect_source{"local"};
   bool enabled{true};
   bool reverse{false};
@@ -59,6 +102,9 @@ struct LedSegmentConfig {
   float gamma_color{2.2f};
   float gamma_brightness{2.2f};
   bool apply_gamma{true};
+  // Temporal dithering: keep 16-bit post-gamma values and carry the low bits
+  // over to the next frame, so low brightness keeps smooth gradients
+  bool dither{true};
 };
 
 struct SnapcastConfig {
@@ -74,11 +120,79 @@ struct AudioConfig {
   uint32_t sample_rate{48000};
   uint16_t frame_ms{20};
   uint16_t fft_size{1024};
+  AudioScale filterbank{AudioScale::Mel};
+  uint8_t filterbank_bands{32};  // 8, 16, 32 or 64
   bool stereo{true};
   float sensitivity{1.0f};
   SnapcastConfig snapcast{};
 };
 
+// Values an effect can react to; index into AudioMetrics via led_audio_band_value()
+enum class AudioBand : uint8_t {
+  SubBass,
+  BassLow,
+  BassHigh,
+  MidLow,
+  MidMid,
+  MidHigh,
+  TrebleLow,
+  TrebleMid,
+  TrebleHigh,
+  Bass,
+  Mid,
+  Treble,
+  Energy,
+  Beat,
+  TempoBpm,
+  Geq0,  // Geq0 + n for filterbank band n (0..63)
+};
+
+enum class AudioReactiveMode : uint8_t {
+  Full,
+  Kick,
+  Bass,
+  Mids,
+  Treble,
+};
+
+enum class AudioChannel : uint8_t {
+  Mix,
+  Left,
+  Right,
+};
+
+// Audio inputs of an assignment compiled from reactive_mode, selected_bands,
+// freq_min/freq_max, band gains and audio_profile when the config is decoded
+// (against the configured filterbank), so the render loop reads values by
+// index instead of matching names every frame
+struct AudioSelection {
+  static constexpr size_t kMaxBands = 8;
+  static constexpr uint8_t kNoEnvelope = 0xFF;
+  AudioReactiveMode mode{AudioReactiveMode::Full};
+  AudioChannel channel{AudioChannel::Mix};
+  uint8_t band_count{0};
+  AudioBand bands[kMaxBands]{};
+  uint8_t range_first{0};  // filterbank bands covering freq_min..freq_max
+  uint8_t range_count{0};  // 0 = no custom range
+  float gain_low{1.0f};    // band_gain_low/mid/high, for the reactive_mode mix
+  float gain_mid{1.0f};
+  float gain_high{1.0f};
+  float profile_gain{1.0f};
+  // Slot in AudioMetrics::envelopes following this input with the
+  // assignment's attack/release, or kNoEnvelope
+  uint8_t envelope{kNoEnvelope};
+
+  bool operator==(const AudioSelection&) const = default;
+};
+
+// Attack/release follower the audio analysis task runs over one selection;
+// assignments with the same input and times share one
+struct AudioEnvelopeSpec {
+  AudioSelection input{};  // envelope field unused
+  uint16_t attack_ms{0};
+  uint16_t release_ms{0};
+};
+
 struct EffectAssignment {
   std::string segment_id{"segment-1"};
   std::string engine{"wled"};
@@ -122,6 +236,7 @@ struct EffectAssignment {
   // Selected frequency bands for audio reactivity
   // Empty = use reactive_mode, otherwise use selected bands
   std::vector<std::string> selected_bands{};  // e.g. ["bass", "mid_low", "treble_high", "energy", "beat"]
+  AudioSelection audio{};  // derived from the fields above, never encoded
 };
 
 struct VirtualSegmentMember {
@@ -130,6 +245,10 @@ struct VirtualSegmentMember {
   uint16_t segment_index{0};
   uint16_t start{0};
   uint16_t length{0};
+  // Where the member reads the composed frame: pixel i is at offset + i * stride
+  int32_t offset{-1};    // -1 = right after the previous member
+  uint16_t stride{1};
+  bool reverse{false};   // member pixel 0 takes the last pixel of its view
 };
 
 struct VirtualSegmentConfig {
@@ -159,4 +278,7 @@ struct LedHardwareConfig {
   std::vector<VirtualSegmentConfig> virtual_segments{};
   AudioConfig audio{};
   EffectsConfig effects{};
+  // Compiled from the audio settings of every effect when the config is
+  // decoded; published to the analyzer, not persisted
+  std::vector<AudioEnvelopeSpec> audio_envelopes{};
 };
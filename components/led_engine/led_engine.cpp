@@ -2,8 +2,18 @@
 #include "led_engine/audio_pipeline.hpp"
 #include "led_engine/pinout.hpp"
 #include "led_engine/rmt_driver.hpp"
+#include "led_engine/chipset_info.hpp"
+#include "led_engine/color_processing.hpp"
+#include "led_engine/segment_layout.hpp"
+#include "led_engine/matrix_utils.hpp"
+#include "led_engine/framebuffer.hpp"
+#include "led_engine/ppa_accelerator.hpp"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <algorithm>
+#include <cstring>
+
+static const char* TAG = "led-engine";
 
 namespace {
 
@@ -19,29 +29,160 @@ const char* driver_name(LedDriverType type) {
   return "esp_rmt";
 }
 
+// Split a logical segment into its physical outputs. Chunks without an explicit
+// LED count share whatever the sized chunks leave over; sized chunks that
+// would run past led_count are cut short, and chunks left without LEDs
+// (chunk 0 included) get no output.
+std::vector<LedSegmentConfig> split_segment_outputs(const LedSegmentConfig& seg) {
+  std::vector<LedSegmentConfig> chunks;
+  chunks.push_back(seg);
+  chunks.front().outputs.clear();
+  if (seg.outputs.empty()) {
+    return chunks;
+  }
+  for (const auto& out : seg.outputs) {
+    LedSegmentConfig chunk = chunks.front();
+    chunk.gpio = out.gpio;
+    chunk.rmt_channel = out.rmt_channel;
+    chunk.led_count = out.led_count;
+    chunks.push_back(std::move(chunk));
+  }
+  chunks.front().led_count = 0;
+
+  // Chunk 0 and the outputs without a count share the remainder
+  std::vector<bool> shares(chunks.size(), false);
+  shares[0] = true;
+  size_t sized = 0;
+  size_t unsized = 1;
+  for (size_t i = 1; i < chunks.size(); ++i) {
+    if (chunks[i].led_count == 0) {
+      shares[i] = true;
+      ++unsized;
+      continue;
+    }
+    const size_t available = seg.led_count > sized ? seg.led_count - sized : 0;
+    if (chunks[i].led_count > available) {
+      ESP_LOGW(TAG, "Segment %s: output on GPIO %d asks for %u LEDs, only %u left of %u", seg.name.c_str(),
+               chunks[i].gpio, chunks[i].led_count, static_cast<unsigned>(available), seg.led_count);
+      chunks[i].led_count = static_cast<uint16_t>(available);
+    }
+    sized += chunks[i].led_count;
+  }
+  const size_t remaining = seg.led_count > sized ? seg.led_count - sized : 0;
+  size_t share_index = 0;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    if (!shares[i]) {
+      continue;
+    }
+    // Spread the remainder over the first chunks so lengths differ by at most one
+    const size_t share = remaining / unsized + (share_index < remaining % unsized ? 1 : 0);
+    chunks[i].led_count = static_cast<uint16_t>(share);
+    ++share_index;
+  }
+
+  chunks.erase(std::remove_if(chunks.begin(), chunks.end(),
+                              [](const LedSegmentConfig& c) { return c.led_count == 0; }),
+               chunks.end());
+  return chunks;
+}
+
+bool same_matrix(const LedMatrixConfig& a, const LedMatrixConfig& b) {
+  return a.width == b.width && a.height == b.height && a.serpentine == b.serpentine &&
+         a.vertical == b.vertical && a.render_width == b.render_width && a.render_height == b.render_height &&
+         a.rotation == b.rotation && a.mirror_x == b.mirror_x && a.mirror_y == b.mirror_y;
+}
+
+// Everything the RMT channels are built from; a change here needs them rebuilt
+bool same_channels(const LedHardwareConfig& a, const LedHardwareConfig& b) {
+  if (a.driver != b.driver || a.enable_dma != b.enable_dma || a.parallel_outputs != b.parallel_outputs ||
+      a.segments.size() != b.segments.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.segments.size(); ++i) {
+    const LedSegmentConfig& x = a.segments[i];
+    const LedSegmentConfig& y = b.segments[i];
+    if (x.id != y.id || x.gpio != y.gpio || x.rmt_channel != y.rmt_channel || x.led_count != y.led_count ||
+        x.chipset != y.chipset || x.color_order != y.color_order || x.rmt_encoding != y.rmt_encoding ||
+        x.outputs.size() != y.outputs.size()) {
+      return false;
+    }
+    for (size_t j = 0; j < x.outputs.size(); ++j) {
+      if (x.outputs[j].gpio != y.outputs[j].gpio || x.outputs[j].rmt_channel != y.outputs[j].rmt_channel ||
+          x.outputs[j].led_count != y.outputs[j].led_count) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Everything else the frame path is built from (layout, color conversion);
+// only meaningful when same_channels() holds
+bool same_layout(const LedHardwareConfig& a, const LedHardwareConfig& b) {
+  for (size_t i = 0; i < a.segments.size(); ++i) {
+    const LedSegmentConfig& x = a.segments[i];
+    const LedSegmentConfig& y = b.segments[i];
+    if (x.start_index != y.start_index || x.stop_index != y.stop_index || x.reverse != y.reverse ||
+        x.mirror != y.mirror || x.grouping != y.grouping || x.spacing != y.spacing ||
+        x.matrix_enabled != y.matrix_enabled || !same_matrix(x.matrix, y.matrix) ||
+        x.gamma_color != y.gamma_color || x.gamma_brightness != y.gamma_brightness ||
+        x.apply_gamma != y.apply_gamma || x.dither != y.dither || x.pixel_format != y.pixel_format) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
-static const char* TAG = "led-engine";
+LedEngineRuntime::PathRef::PathRef(const LedEngineRuntime& rt) : rt_(rt) {
+  // Announce the reader before looking at the pointer; retire_path() swaps
+  // first and then waits for the count to drain
+  rt_.path_users_.fetch_add(1);
+  path_ = rt_.path_.load();
+}
+
+LedEngineRuntime::PathRef::~PathRef() {
+  rt_.path_users_.fetch_sub(1);
+}
 
 esp_err_t LedEngineRuntime::init(const LedHardwareConfig& cfg) {
   std::lock_guard<std::mutex> lock(mutex_);
   cfg_ = cfg;
-  brightness_ = std::clamp<int>(cfg_.global_brightness, 0, 255);
-  cfg_.global_brightness = brightness_;
+  cfg_.global_brightness = std::clamp<int>(cfg_.global_brightness, 0, 255);
+  brightness_ = cfg_.global_brightness;
   enabled_ = true;
   ESP_ERROR_CHECK_WITHOUT_ABORT(led_audio_apply_config(cfg.audio));
-  const esp_err_t err = configure_driver(cfg_);
+  const esp_err_t err = configure_driver(cfg_, true);
   initialized_ = (err == ESP_OK);
+  if (!output_task_) {
+    // Output stage on core 0 so conversion and transmission overlap the
+    // effects task rendering the next frame on core 1
+    const BaseType_t res = xTaskCreatePinnedToCore(output_task_entry, "led_out", 4096, this, 9, &output_task_, 0);
+    if (res != pdPASS) {
+      output_task_ = nullptr;
+      ESP_LOGE(TAG, "Failed to start LED output task");
+      return ESP_FAIL;
+    }
+  }
   return err;
 }
 
 esp_err_t LedEngineRuntime::update_config(const LedHardwareConfig& cfg) {
   std::lock_guard<std::mutex> lock(mutex_);
+  // Channels are only rebuilt when the wiring changes; layout changes rebuild
+  // the frame path on the existing channels, anything else is a live control
+  const bool rewire = !initialized_ || !same_channels(cfg_, cfg);
+  const bool rebuild = rewire || !same_layout(cfg_, cfg);
   cfg_ = cfg;
-  brightness_ = std::clamp<int>(cfg_.global_brightness, 0, 255);
-  cfg_.global_brightness = brightness_;
+  cfg_.global_brightness = std::clamp<int>(cfg_.global_brightness, 0, 255);
+  brightness_ = cfg_.global_brightness;
   ESP_ERROR_CHECK_WITHOUT_ABORT(led_audio_apply_config(cfg.audio));
-  const esp_err_t err = configure_driver(cfg_);
+  if (!rebuild) {
+    apply_controls(cfg_);
+    return ESP_OK;
+  }
+  const esp_err_t err = configure_driver(cfg_, rewire);
   initialized_ = (err == ESP_OK);
   return err;
 }
@@ -55,48 +196,132 @@ LedEngineStatus LedEngineRuntime::status() const {
   st.global_current_ma = cfg_.global_current_limit_ma;
   st.global_brightness = brightness_;
   st.enabled = enabled_;
+  st.blackout = blackout_;
   return st;
 }
 
-esp_err_t LedEngineRuntime::configure_driver(const LedHardwareConfig& cfg) {
+std::unique_ptr<LedEngineRuntime::FramePath> LedEngineRuntime::retire_path() {
+  FramePath* old = path_.exchange(nullptr);
+  // Stages that picked the old path up before the swap finish their frame first;
+  // later ones see no path and skip
+  while (path_users_.load() != 0) {
+    vTaskDelay(1);
+  }
+  return std::unique_ptr<FramePath>(old);
+}
+
+esp_err_t LedEngineRuntime::configure_driver(const LedHardwareConfig& cfg, bool reinit_channels) {
   esp_err_t status = ESP_OK;
   ESP_LOGI(TAG,
-           "Configuring LED driver=%s fps=%u outputs=%u dma=%d",
+           "Configuring LED driver=%s fps=%u outputs=%u dma=%d channels=%s",
            driver_name(cfg.driver),
            cfg.max_fps,
            cfg.parallel_outputs,
-           cfg.enable_dma);
+           cfg.enable_dma,
+           reinit_channels ? "rebuilt" : "kept");
 
-  // Deinitialize old segments first
-  rmt_driver_deinit_all();
+  // Take the frame path down before its channels are touched
+  std::unique_ptr<FramePath> old = retire_path();
+  if (reinit_channels) {
+    rmt_driver_deinit_all();
+  }
+  old.reset();
+
+  auto path = std::make_unique<FramePath>();
+  path->driver = cfg.driver;
 
-  // Initialize RMT driver for each segment
+  // Initialize RMT driver for each physical output of each segment
   for (const auto& seg : cfg.segments) {
-    if (!led_pin_is_allowed(seg.gpio)) {
-      ESP_LOGW(TAG, "Segment %s pin %d nie moze byc uzyty", seg.name.c_str(), seg.gpio);
-      status = ESP_ERR_INVALID_ARG;
-      continue;
+    auto entry = std::make_unique<SegmentOutputs>();
+    entry->segment_id = seg.id;
+    entry->logical_count = segment_logical_count(seg);
+    entry->brightness = seg.segment_brightness;
+    entry->enabled = seg.enabled;
+    entry->format = segment_pixel_format(seg);
+    const size_t frame_bytes = static_cast<size_t>(entry->logical_count) * pixel_format_bytes(entry->format);
+    entry->dither = seg.dither;
+    entry->staging.assign(frame_bytes, 0);
+    for (size_t i = 0; i < 3; ++i) {
+      entry->frames.slot(i).pixels.assign(frame_bytes, 0);
     }
-    
-    if (cfg.driver == LedDriverType::EspRmt) {
-      const esp_err_t rmt_err = rmt_driver_init_segment(seg, cfg.enable_dma);
-      if (rmt_err != ESP_OK) {
-        ESP_LOGW(TAG, "RMT init failed for segment %s: %s", seg.name.c_str(), esp_err_to_name(rmt_err));
-        status = rmt_err;
+    const std::vector<uint16_t> index_map = segment_build_index_map(seg);
+    entry->mapped = !index_map.empty();
+    if (segment_uses_matrix_transform(seg)) {
+      entry->transformed = true;
+      entry->matrix = seg.matrix;
+      matrix_canvas_size(seg.matrix, &entry->canvas_width, &entry->canvas_height);
+      entry->panel = std::make_shared<framebuffer::Framebuffer>(seg.matrix.width, seg.matrix.height);
+      if (!entry->panel->valid()) {
+        ESP_LOGW(TAG, "Segment %s: no memory for %ux%u panel raster", seg.name.c_str(),
+                 seg.matrix.width, seg.matrix.height);
+        status = ESP_ERR_NO_MEM;
       }
+      ESP_LOGI(TAG, "Segment %s renders %ux%u, panel %ux%u rot=%u mirror=%d/%d", seg.name.c_str(),
+               entry->canvas_width, entry->canvas_height, seg.matrix.width, seg.matrix.height,
+               seg.matrix.rotation, seg.matrix.mirror_x, seg.matrix.mirror_y);
     }
-    
-    log_segment(seg);
-  }
-  
-  // Initialize parallel IO mode if parallel_outputs > 1 and we have multiple segments
-  if (cfg.driver == LedDriverType::EspRmt && cfg.parallel_outputs > 1 && cfg.segments.size() > 1) {
-    // Collect segments for parallel mode (up to parallel_outputs or 4, whichever is smaller)
-    const size_t max_parallel = std::min(static_cast<size_t>(cfg.parallel_outputs), 
-                                         std::min(cfg.segments.size(), static_cast<size_t>(4)));
+    uint16_t offset = 0;
+    for (auto& chunk : split_segment_outputs(seg)) {
+      const uint16_t chunk_offset = offset;
+      offset = static_cast<uint16_t>(offset + chunk.led_count);
+      if (!led_pin_is_allowed(chunk.gpio)) {
+        ESP_LOGW(TAG, "Segment %s pin %d nie moze byc uzyty", seg.name.c_str(), chunk.gpio);
+        status = ESP_ERR_INVALID_ARG;
+        continue;
+      }
+
+      if (cfg.driver == LedDriverType::EspRmt) {
+        if (reinit_channels) {
+          const esp_err_t rmt_err = rmt_driver_init_segment(chunk, cfg.enable_dma);
+          if (rmt_err != ESP_OK) {
+            ESP_LOGW(TAG, "RMT init failed for segment %s: %s", seg.name.c_str(), esp_err_to_name(rmt_err));
+            status = rmt_err;
+            continue;
+          }
+        }
+        if (entry->mapped) {
+          const auto first = index_map.begin() + chunk_offset;
+          rmt_driver_set_index_map(chunk, std::vector<uint16_t>(first, first + chunk.led_count));
+        } else if (!reinit_channels) {
+          rmt_driver_set_index_map(chunk, {});
+        }
+      }
+      log_segment(chunk);
+      // The slowest output bounds the refresh rate of the whole segment
+      const uint32_t frame_us = chipset_frame_time_us(get_chipset_info(chunk.chipset), chunk.led_count);
+      entry->frame_time_us = std::max(entry->frame_time_us, frame_us);
+      entry->chunks.push_back(OutputChunk{std::move(chunk), chunk_offset});
+    }
+    entry->max_fps = entry->frame_time_us > 0
+                         ? static_cast<uint16_t>(std::min<uint32_t>(1000000u / entry->frame_time_us, 0xFFFF))
+                         : 0;
+    entry->effective_fps = entry->max_fps > 0 && (cfg.max_fps == 0 || entry->max_fps < cfg.max_fps)
+                               ? entry->max_fps
+                               : cfg.max_fps;
+    entry->frame_interval_us = entry->effective_fps > 0 ? 1000000u / entry->effective_fps : 0;
+    if (entry->max_fps > 0 && cfg.max_fps > entry->max_fps) {
+      ESP_LOGI(TAG, "Segment %s limited to %u fps by wire time (%u us)",
+               seg.name.c_str(), entry->max_fps, static_cast<unsigned>(entry->frame_time_us));
+    }
+    path->segments.push_back(std::move(entry));
+  }
+
+  // Parallel IO mode: the chunks of one segment start together. A sync group
+  // only starts once all its members have a transaction, so it never spans
+  // segments (they render at their own pace) and its chunks are sent every round.
+  SegmentOutputs* chunked = nullptr;
+  for (const auto& entry : path->segments) {
+    if (entry->chunks.size() > 1 && (chunked == nullptr || entry->chunks.size() > chunked->chunks.size())) {
+      chunked = entry.get();
+    }
+  }
+  if (reinit_channels && cfg.driver == LedDriverType::EspRmt && cfg.parallel_outputs > 1 && chunked != nullptr) {
+    // Up to parallel_outputs or 4 chunks, whichever is smaller
+    const size_t max_parallel = std::min(static_cast<size_t>(cfg.parallel_outputs),
+                                         std::min(chunked->chunks.size(), static_cast<size_t>(4)));
     std::vector<const LedSegmentConfig*> parallel_segments;
-    for (size_t i = 0; i < max_parallel && i < cfg.segments.size(); ++i) {
-      parallel_segments.push_back(&cfg.segments[i]);
+    for (size_t i = 0; i < max_parallel; ++i) {
+      parallel_segments.push_back(&chunked->chunks[i].output);
     }
     
     if (parallel_segments.size() > 1) {
@@ -109,40 +334,186 @@ esp_err_t LedEngineRuntime::configure_driver(const LedHardwareConfig& cfg) {
       }
     }
   }
-  
+
+  for (auto& entry : path->segments) {
+    for (auto& chunk : entry->chunks) {
+      chunk.synced = rmt_driver_in_sync_group(chunk.output.gpio, chunk.output.rmt_channel);
+      entry->synced = entry->synced || chunk.synced;
+    }
+  }
+
+  path_.store(path.release());
+  wake_output();
   return status;
 }
 
+void LedEngineRuntime::apply_controls(const LedHardwareConfig& cfg) {
+  // Caller holds mutex_, which keeps the published path alive
+  FramePath* path = path_.load();
+  if (path != nullptr) {
+    for (auto& entry : path->segments) {
+      const auto seg = std::find_if(cfg.segments.begin(), cfg.segments.end(),
+                                    [&](const LedSegmentConfig& s) { return s.id == entry->segment_id; });
+      if (seg != cfg.segments.end()) {
+        entry->brightness = seg->segment_brightness;
+        entry->enabled = seg->enabled;
+      }
+    }
+  }
+  wake_output();
+}
+
+uint8_t LedEngineRuntime::output_level(const SegmentOutputs& entry) const {
+  if (!enabled_ || blackout_ || !entry.enabled) {
+    return 0;
+  }
+  return static_cast<uint8_t>((static_cast<uint32_t>(brightness_) * entry.brightness + 127) / 255);
+}
+
+void LedEngineRuntime::wake_output() {
+  if (output_task_) {
+    xTaskNotifyGive(output_task_);
+  }
+}
+
 esp_err_t LedEngineRuntime::set_enabled(bool enabled) {
-  std::lock_guard<std::mutex> lock(mutex_);
   enabled_ = enabled;
-  // TODO: wire with real driver when rendering core is implemented
+  wake_output();
   return ESP_OK;
 }
 
 bool LedEngineRuntime::enabled() const {
-  std::lock_guard<std::mutex> lock(mutex_);
   return enabled_;
 }
 
 esp_err_t LedEngineRuntime::set_brightness(uint8_t brightness) {
   std::lock_guard<std::mutex> lock(mutex_);
-  brightness_ = std::clamp<int>(brightness, 0, 255);
-  cfg_.global_brightness = brightness_;
-  // TODO: push brightness to rendering backend when available
+  brightness_ = brightness;
+  cfg_.global_brightness = brightness;
+  wake_output();
   return ESP_OK;
 }
 
-uint8_t LedEngineRuntime::brightness() const {
+esp_err_t LedEngineRuntime::set_blackout(bool blackout) {
+  blackout_ = blackout;
+  wake_output();
+  return ESP_OK;
+}
+
+bool LedEngineRuntime::blackout() const {
+  return blackout_;
+}
+
+esp_err_t LedEngineRuntime::set_segment_brightness(const std::string& segment_id, uint8_t brightness) {
   std::lock_guard<std::mutex> lock(mutex_);
+  const auto seg = std::find_if(cfg_.segments.begin(), cfg_.segments.end(),
+                                [&](const LedSegmentConfig& s) { return s.id == segment_id; });
+  if (seg == cfg_.segments.end()) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  seg->segment_brightness = brightness;
+  apply_controls(cfg_);
+  return ESP_OK;
+}
+
+esp_err_t LedEngineRuntime::set_segment_enabled(const std::string& segment_id, bool enabled) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto seg = std::find_if(cfg_.segments.begin(), cfg_.segments.end(),
+                                [&](const LedSegmentConfig& s) { return s.id == segment_id; });
+  if (seg == cfg_.segments.end()) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  seg->enabled = enabled;
+  apply_controls(cfg_);
+  return ESP_OK;
+}
+
+std::vector<LedSegmentRefresh> LedEngineRuntime::segment_refresh() const {
+  // Holding the config lock keeps the published path from being retired
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<LedSegmentRefresh> out;
+  const FramePath* path = path_.load();
+  if (path == nullptr) {
+    return out;
+  }
+  out.reserve(path->segments.size());
+  for (const auto& entry : path->segments) {
+    LedSegmentRefresh r{};
+    r.id = entry->segment_id;
+    r.frame_time_us = entry->frame_time_us;
+    r.max_fps = entry->max_fps;
+    r.effective_fps = entry->effective_fps;
+    r.frames = entry->sent.load(std::memory_order_relaxed);
+    r.skipped = entry->skipped.load(std::memory_order_relaxed);
+    r.not_due = entry->not_due.load(std::memory_order_relaxed);
+    r.brightness = entry->brightness;
+    r.enabled = entry->enabled;
+    out.push_back(std::move(r));
+  }
+  return out;
+}
+
+bool LedEngineRuntime::segment_frame_due(const std::string& segment_id) {
+  PathRef ref(*this);
+  FramePath* path = ref.get();
+  if (path == nullptr || path->driver != LedDriverType::EspRmt) {
+    return true;
+  }
+  const auto it = std::find_if(path->segments.begin(), path->segments.end(),
+                               [&](const std::unique_ptr<SegmentOutputs>& e) { return e->segment_id == segment_id; });
+  if (it == path->segments.end()) {
+    return true;
+  }
+  SegmentOutputs& entry = **it;
+  // 32-bit microseconds: differences stay correct across the wrap
+  const uint32_t now_us = static_cast<uint32_t>(esp_timer_get_time());
+  if (entry.frame_interval_us > 0 && entry.due_started &&
+      static_cast<int32_t>(now_us - entry.next_due_us) < 0) {
+    entry.not_due.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  // A frame already waiting for the wire would only be superseded
+  if (entry.frames.pending() && std::any_of(entry.chunks.begin(), entry.chunks.end(), [](const OutputChunk& c) {
+        return rmt_driver_output_busy(c.output.gpio, c.output.rmt_channel);
+      })) {
+    entry.not_due.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  // Keep the cadence when on time; restart it after a stall instead of bursting
+  const bool late = !entry.due_started || static_cast<int32_t>(now_us - entry.next_due_us) >
+                                              static_cast<int32_t>(entry.frame_interval_us);
+  entry.next_due_us = (late ? now_us : entry.next_due_us) + entry.frame_interval_us;
+  entry.due_started = true;
+  return true;
+}
+
+uint8_t LedEngineRuntime::brightness() const {
   return brightness_;
 }
 
 esp_err_t LedEngineRuntime::render_frame(const std::vector<uint8_t>& rgb,
                                          const LedSegmentConfig& segment,
                                          size_t start,
-                                         size_t length) {
-  std::lock_guard<std::mutex> lock(mutex_);
+                                         size_t length,
+                                         PixelFormat format,
+                                         const DirtyRegion* hint) {
+  const size_t in_bpp = pixel_format_bytes(format);
+  const size_t pixels = length == 0 ? rgb.size() / in_bpp : length;
+  if (rgb.size() < pixels * in_bpp) {
+    ESP_LOGW(TAG,
+             "Render ignored: frame too small (%u bytes, need %u) for segment %s",
+             static_cast<unsigned>(rgb.size()),
+             static_cast<unsigned>(pixels * in_bpp),
+             segment.id.c_str());
+    return ESP_ERR_INVALID_SIZE;
+  }
+  return render_view(PixelView::contiguous(rgb.data(), pixels, format), segment, start, hint);
+}
+
+esp_err_t LedEngineRuntime::render_view(const PixelView& view,
+                                        const LedSegmentConfig& segment,
+                                        size_t start,
+                                        const DirtyRegion* hint) {
   if (!initialized_) {
     ESP_LOGW(TAG, "Render ignored: engine not initialized");
     return ESP_ERR_INVALID_STATE;
@@ -151,7 +522,21 @@ esp_err_t LedEngineRuntime::render_frame(const std::vector<uint8_t>& rgb,
     ESP_LOGD(TAG, "Render ignored: engine disabled");
     return ESP_OK;
   }
-  const size_t max_leds = segment.led_count;
+  PathRef ref(*this);
+  FramePath* path = ref.get();
+  if (path == nullptr) {
+    ESP_LOGD(TAG, "Render ignored: outputs are being reconfigured");
+    return ESP_OK;
+  }
+  const auto it = std::find_if(path->segments.begin(), path->segments.end(),
+                               [&](const std::unique_ptr<SegmentOutputs>& e) { return e->segment_id == segment.id; });
+  if (it == path->segments.end()) {
+    ESP_LOGW(TAG, "Render ignored: segment %s has no outputs", segment.id.c_str());
+    return ESP_ERR_NOT_FOUND;
+  }
+  SegmentOutputs& entry = **it;
+  // Effects render at the logical resolution; outputs expand it to physical LEDs
+  const size_t max_leds = entry.logical_count;
   if (start >= max_leds) {
     ESP_LOGW(TAG,
              "Render ignored: segment %s start %u beyond length %u",
@@ -160,38 +545,204 @@ esp_err_t LedEngineRuntime::render_frame(const std::vector<uint8_t>& rgb,
              static_cast<unsigned>(max_leds));
     return ESP_ERR_INVALID_ARG;
   }
-  const size_t pixels = std::min(length == 0 ? max_leds - start : length, max_leds - start);
-  const size_t expected_bytes = pixels * 3;
-  if (rgb.size() < expected_bytes) {
-    ESP_LOGW(TAG,
-             "Render ignored: frame too small (%u bytes, need %u) for segment %s",
-             static_cast<unsigned>(rgb.size()),
-             static_cast<unsigned>(expected_bytes),
-             segment.id.c_str());
-    return ESP_ERR_INVALID_SIZE;
+  const size_t pixels = std::min(view.length, max_leds - start);
+
+  if (path->driver != LedDriverType::EspRmt) {
+    // Fallback: log if driver not implemented
+    ESP_LOGD(TAG,
+             "Render hook segment=%s start=%u len=%u - driver %s not implemented",
+             segment.id.c_str(),
+             static_cast<unsigned>(start),
+             static_cast<unsigned>(pixels),
+             driver_name(path->driver));
+    return ESP_OK;
+  }
+  if (entry.transformed && (start != 0 || pixels != max_leds)) {
+    ESP_LOGW(TAG, "Render ignored: segment %s needs a full %ux%u canvas",
+             segment.id.c_str(), entry.canvas_width, entry.canvas_height);
+    return ESP_ERR_INVALID_ARG;
   }
 
-  // Render via RMT driver if configured
-  if (cfg_.driver == LedDriverType::EspRmt) {
-    const esp_err_t rmt_err = rmt_driver_render(segment, rgb, start, pixels);
-    if (rmt_err != ESP_OK) {
-      ESP_LOGW(TAG, "RMT render failed for segment %s: %s", segment.id.c_str(), esp_err_to_name(rmt_err));
-      return rmt_err;
+  // The view holds the pixels of [start, start + pixels). Slices land in staging
+  // so every published frame is complete; the output task picks up the newest one.
+  const size_t bpp = pixel_format_bytes(entry.format);
+  uint8_t* slot = entry.staging.data() + start * bpp;
+  DirtyRegion dirty;
+  const bool trust_hint = hint != nullptr && entry.hint_ok && hint->sequence == entry.hint_sequence + 1;
+  if (!view.is_contiguous()) {
+    // Strided or reversed member of a composed frame: gather it pixel by pixel
+    for (size_t i = 0; i < pixels; ++i) {
+      uint8_t* dst = slot + i * bpp;
+      if (view.format != entry.format) {
+        convert_pixels(view.pixel(i), view.format, dst, entry.format, 1);
+        dirty.add(start + i, 1);
+      } else if (std::memcmp(dst, view.pixel(i), bpp) != 0) {
+        std::memcpy(dst, view.pixel(i), bpp);
+        dirty.add(start + i, 1);
+      }
+    }
+    if (entry.transformed) {
+      dirty.mark_all();
     }
+  } else if (entry.transformed) {
+    // The SRM job redraws the whole panel anyway
+    convert_pixels(view.data(), view.format, slot, entry.format, pixels);
+    dirty.mark_all();
+  } else if (view.format != entry.format) {
+    convert_pixels(view.data(), view.format, slot, entry.format, pixels);
+    dirty.add(start, pixels);
+  } else if (trust_hint && !hint->all()) {
+    // The effect knows what it touched: copy just that
+    for (const PixelSpan& span : hint->slice(start, start + pixels)) {
+      std::memcpy(slot + span.start * bpp, view.data() + span.start * bpp, span.length * bpp);
+      dirty.add(start + span.start, span.length);
+    }
+  } else {
+    diff_pixels(slot, view.data(), pixels, bpp, start, dirty);
+    std::memcpy(slot, view.data(), pixels * bpp);
+  }
+  entry.hint_ok = hint != nullptr;
+  entry.hint_sequence = hint != nullptr ? hint->sequence : 0;
+  if (dirty.empty() && entry.published && !entry.dithering.load(std::memory_order_relaxed)) {
+    // Same frame as before and settled dithering: nothing to convert or send
     return ESP_OK;
   }
 
-  // Fallback: log if driver not implemented
-  ESP_LOGD(TAG,
-           "Render hook segment=%s start=%u len=%u (bytes=%u) - driver %s not implemented",
-           segment.id.c_str(),
-           static_cast<unsigned>(start),
-           static_cast<unsigned>(pixels),
-           static_cast<unsigned>(expected_bytes),
-           driver_name(cfg_.driver));
+  SegmentOutputs::Frame& out = entry.frames.write_buffer();
+  std::memcpy(out.pixels.data(), entry.staging.data(), entry.staging.size());
+  out.dirty = dirty;
+  if (entry.frames.pending()) {
+    // The unread frame is about to be superseded; its changes ride along
+    out.dirty.merge(entry.last_dirty);
+  }
+  entry.last_dirty = out.dirty;
+  entry.published = true;
+  if (!entry.frames.publish()) {
+    entry.skipped.fetch_add(1, std::memory_order_relaxed);
+  }
+  wake_output();
   return ESP_OK;
 }
 
+void LedEngineRuntime::output_task_entry(void* arg) {
+  auto* self = reinterpret_cast<LedEngineRuntime*>(arg);
+  if (self) {
+    self->output_loop();
+  }
+  vTaskDelete(nullptr);
+}
+
+void LedEngineRuntime::output_loop() {
+  bool waiting_for_wire = false;
+  while (true) {
+    // Renders notify after publishing; a frame held back by a busy wire is retried next tick
+    ulTaskNotifyTake(pdTRUE, waiting_for_wire ? 1 : pdMS_TO_TICKS(100));
+    waiting_for_wire = false;
+    PathRef ref(*this);
+    FramePath* path = ref.get();
+    if (path == nullptr || path->driver != LedDriverType::EspRmt) {
+      continue;
+    }
+    for (auto& entry : path->segments) {
+      // A control change re-sends the last frame at the new level even when
+      // nothing new was rendered
+      const uint8_t level = output_level(*entry);
+      const bool relevel = level != entry->level_sent;
+      if (!entry->frames.pending() && !relevel) {
+        continue;
+      }
+      if (level == 0 && !relevel) {
+        // Dark output: one black frame went out, transmission stays gated
+        entry->frames.acquire();
+        continue;
+      }
+      // Converting while the previous frame is still shifting out would only queue
+      // behind it; leave the frame published so a newer render can replace it
+      const bool busy = std::any_of(entry->chunks.begin(), entry->chunks.end(), [](const OutputChunk& c) {
+        return rmt_driver_output_busy(c.output.gpio, c.output.rmt_channel);
+      });
+      if (busy) {
+        waiting_for_wire = true;
+        continue;
+      }
+      entry->frames.acquire();
+      // A new level re-converts every pixel, so does the first frame after a rebuild
+      transmit(*entry, entry->frames.read_buffer(), level, relevel || !entry->primed);
+      entry->level_sent = level;
+      entry->primed = true;
+    }
+  }
+}
+
+void LedEngineRuntime::transmit(SegmentOutputs& entry, const SegmentOutputs::Frame& frame, uint8_t level, bool full) {
+  // Chunked segments hand each output its part; rmt_transmit only queues the
+  // frame, so the outputs shift their chunks out concurrently
+  const uint8_t* pixels = frame.pixels.data();
+  const uint8_t* src = pixels;
+  const DirtyRegion* dirty = (full || entry.transformed) ? nullptr : &frame.dirty;
+  const size_t bytes_per_pixel = pixel_format_bytes(entry.format);
+  size_t src_pixels = entry.logical_count;
+  if (entry.transformed) {
+    // Orientation and upscaling run as one SRM job; the outputs then only
+    // undo the wiring order
+    if (!entry.panel || !entry.panel->valid()) {
+      return;
+    }
+    const ppa_accel::JobId job = ppa_accel::submit_srm(
+        pixels, entry.canvas_width, entry.canvas_height,
+        entry.panel->data(), entry.matrix.width, entry.matrix.height,
+        entry.matrix.rotation, entry.matrix.mirror_x, entry.matrix.mirror_y,
+        nullptr, nullptr, entry.panel->capacity());
+    const esp_err_t srm_err = job == ppa_accel::kInvalidJob ? ESP_ERR_NO_MEM : ppa_accel::settle_job(job, 20);
+    if (srm_err != ESP_OK) {
+      ESP_LOGW(TAG, "Matrix transform failed for segment %s: %s", entry.segment_id.c_str(), esp_err_to_name(srm_err));
+      return;
+    }
+    src = entry.panel->data();
+    src_pixels = static_cast<size_t>(entry.matrix.width) * entry.matrix.height;
+  }
+  if (entry.synced) {
+    // A new round of the sync group: all its chunks are transmitted below
+    const esp_err_t sync_err = rmt_driver_sync_reset();
+    if (sync_err != ESP_OK) {
+      ESP_LOGW(TAG, "RMT sync reset failed for segment %s: %s", entry.segment_id.c_str(), esp_err_to_name(sync_err));
+    }
+  }
+  for (const auto& chunk : entry.chunks) {
+    esp_err_t rmt_err;
+    if (entry.mapped) {
+      // Mirror/reverse scatter logical pixels over every chunk, each map picks its own
+      rmt_err = rmt_driver_render_pixels(chunk.output, src, 0, src_pixels, level, entry.format, dirty);
+    } else {
+      const size_t from = chunk.offset;
+      const size_t to = std::min(src_pixels, from + chunk.output.led_count);
+      if (from >= to) {
+        continue;
+      }
+      DirtyRegion part;
+      if (dirty != nullptr) {
+        part = dirty->slice(from, to);
+        if (part.empty() && !chunk.synced && rmt_driver_dither_settled(chunk.output.gpio, chunk.output.rmt_channel)) {
+          continue;  // nothing changed and nothing left to dither: its LEDs keep the last frame
+        }
+      }
+      rmt_err = rmt_driver_render_pixels(chunk.output, src + from * bytes_per_pixel, 0, to - from, level,
+                                         entry.format, dirty != nullptr ? &part : nullptr);
+    }
+    if (rmt_err != ESP_OK) {
+      ESP_LOGW(TAG, "RMT render failed for segment %s gpio %d: %s",
+               entry.segment_id.c_str(), chunk.output.gpio, esp_err_to_name(rmt_err));
+    }
+  }
+  if (entry.dither) {
+    const bool dithering = std::any_of(entry.chunks.begin(), entry.chunks.end(), [](const OutputChunk& c) {
+      return !rmt_driver_dither_settled(c.output.gpio, c.output.rmt_channel);
+    });
+    entry.dithering.store(dithering, std::memory_order_relaxed);
+  }
+  entry.sent.fetch_add(1, std::memory_order_relaxed);
+}
+
 void LedEngineRuntime::log_segment(const LedSegmentConfig& seg) const {
   ESP_LOGI(TAG,
            "Segment %s leds=%u gpio=%d rmt=%u matrix=%d current=%u mA",
@@ -70,4 +70,21 @@ uint16_t matrix_total_leds(const LedMatrixConfig& matrix) {
     return matrix.width * matrix.height;
 }
 
+void matrix_canvas_size(const LedMatrixConfig& matrix, uint16_t* width_out, uint16_t* height_out) {
+    const bool quarter_turn = (matrix.rotation / 90) % 2 == 1;
+    const uint16_t native_w = quarter_turn ? matrix.height : matrix.width;
+    const uint16_t native_h = quarter_turn ? matrix.width : matrix.height;
+    *width_out = matrix.render_width > 0 ? matrix.render_width : native_w;
+    *height_out = matrix.render_height > 0 ? matrix.render_height : native_h;
+}
 
+bool matrix_has_transform(const LedMatrixConfig& matrix) {
+    if (!matrix_config_valid(matrix)) {
+        return false;
+    }
+    uint16_t canvas_w = 0;
+    uint16_t canvas_h = 0;
+    matrix_canvas_size(matrix, &canvas_w, &canvas_h);
+    return (matrix.rotation % 360) != 0 || matrix.mirror_x || matrix.mirror_y ||
+           canvas_w != matrix.width || canvas_h != matrix.height;
+}
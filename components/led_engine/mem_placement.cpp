@@ -0,0 +1,171 @@
+#include "led_engine/mem_placement.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+#include "soc/soc_caps.h"
+#endif
+
+namespace placement {
+
+namespace {
+
+struct TagCounters {
+    std::atomic<size_t> bytes_in_use{0};
+    std::atomic<size_t> peak_bytes{0};
+    std::atomic<uint32_t> allocations{0};
+    std::atomic<uint32_t> failures{0};
+    std::atomic<uint32_t> fallbacks{0};
+};
+
+TagCounters s_counters[kMemTagCount];
+
+TagCounters& counters(MemTag tag) {
+    return s_counters[static_cast<size_t>(tag)];
+}
+
+#ifdef ESP_PLATFORM
+
+constexpr uint32_t kInternal = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+#if CONFIG_SPIRAM
+constexpr uint32_t kPsram = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+#if SOC_PSRAM_DMA_CAPABLE
+constexpr uint32_t kPsramDma = MALLOC_CAP_SPIRAM | MALLOC_CAP_DMA | MALLOC_CAP_8BIT;
+#else
+constexpr uint32_t kPsramDma = 0;  // PSRAM not reachable by DMA on this target
+#endif
+#else
+constexpr uint32_t kPsram = 0;
+constexpr uint32_t kPsramDma = 0;
+#endif
+
+// Preferred and fallback caps per tag (0 = no fallback)
+struct TagCaps {
+    uint32_t preferred;
+    uint32_t fallback;
+};
+
+TagCaps caps_for(MemTag tag) {
+    switch (tag) {
+        case MemTag::HotInternal:
+            return {kInternal, kPsram};
+        case MemTag::Dma:
+            return {MALLOC_CAP_DMA | kInternal, kPsramDma};
+        case MemTag::PsramBulk:
+        case MemTag::Cold:
+            return kPsram != 0 ? TagCaps{kPsram, kInternal} : TagCaps{kInternal, 0};
+        case MemTag::DmaBulk:
+            // Both regions DMA-capable: a buffer the PPA or RMT cannot reach is a failure
+            return kPsramDma != 0 ? TagCaps{kPsramDma, MALLOC_CAP_DMA | kInternal}
+                                  : TagCaps{MALLOC_CAP_DMA | kInternal, 0};
+    }
+    return {kInternal, 0};
+}
+
+void* heap_alloc(uint32_t caps, size_t bytes, size_t align) {
+    return align > 0 ? heap_caps_aligned_alloc(align, bytes, caps) : heap_caps_malloc(bytes, caps);
+}
+
+#endif  // ESP_PLATFORM
+
+}  // namespace
+
+const char* tag_name(MemTag tag) {
+    switch (tag) {
+        case MemTag::HotInternal:
+            return "hot_internal";
+        case MemTag::Dma:
+            return "dma";
+        case MemTag::PsramBulk:
+            return "psram_bulk";
+        case MemTag::Cold:
+            return "cold";
+        case MemTag::DmaBulk:
+            return "dma_bulk";
+    }
+    return "unknown";
+}
+
+void* alloc(MemTag tag, size_t bytes, size_t align) {
+    if (bytes == 0) {
+        bytes = 1;
+    }
+    // heap_caps_aligned_alloc wants at least pointer alignment
+    if (align > 0) {
+        align = std::max(align, sizeof(void*));
+    }
+    TagCounters& c = counters(tag);
+#ifdef ESP_PLATFORM
+    const TagCaps caps = caps_for(tag);
+    void* mem = heap_alloc(caps.preferred, bytes, align);
+    if (mem == nullptr && caps.fallback != 0) {
+        mem = heap_alloc(caps.fallback, bytes, align);
+        if (mem != nullptr) {
+            c.fallbacks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+#else
+    // Host builds: plain heap
+    void* mem = align > 0 ? std::aligned_alloc(align, (bytes + align - 1) / align * align) : std::malloc(bytes);
+#endif
+    if (mem == nullptr) {
+        // No logging here: the log hook itself allocates under the cold tag
+        c.failures.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    const size_t in_use = c.bytes_in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = c.peak_bytes.load(std::memory_order_relaxed);
+    while (in_use > peak && !c.peak_bytes.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {
+    }
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    return mem;
+}
+
+void release(MemTag tag, void* ptr, size_t bytes) {
+    if (ptr == nullptr) {
+        return;
+    }
+    if (bytes == 0) {
+        bytes = 1;
+    }
+#ifdef ESP_PLATFORM
+    heap_caps_free(ptr);
+#else
+    std::free(ptr);
+#endif
+    TagCounters& c = counters(tag);
+    c.bytes_in_use.fetch_sub(bytes, std::memory_order_relaxed);
+    c.allocations.fetch_sub(1, std::memory_order_relaxed);
+}
+
+TagStats stats(MemTag tag) {
+    const TagCounters& c = counters(tag);
+    TagStats st{};
+    st.bytes_in_use = c.bytes_in_use.load(std::memory_order_relaxed);
+    st.peak_bytes = c.peak_bytes.load(std::memory_order_relaxed);
+    st.allocations = c.allocations.load(std::memory_order_relaxed);
+    st.failures = c.failures.load(std::memory_order_relaxed);
+    st.fallbacks = c.fallbacks.load(std::memory_order_relaxed);
+    return st;
+}
+
+size_t free_internal_bytes() {
+#ifdef ESP_PLATFORM
+    return heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+    return 0;
+#endif
+}
+
+size_t free_psram_bytes() {
+#if defined(ESP_PLATFORM) && CONFIG_SPIRAM
+    return heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+#else
+    return 0;
+#endif
+}
+
+}  // namespace placement
@@ -0,0 +1,171 @@
+#include "led_engine/pixel_ops.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace pixel_ops {
+
+namespace {
+
+constexpr uint32_t kLaneMask = 0x00FF00FF;
+
+// Exact t / 255 (rounded) for t = x * a + y * (255 - a) + 128, without a division
+inline uint8_t div255(uint32_t t) {
+    return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+inline uint8_t mix8(uint32_t fg, uint32_t bg, uint32_t alpha) {
+    return div255(fg * alpha + bg * (255 - alpha) + 128);
+}
+
+// mix8 on four bytes at once: two 16-bit lanes per half-word mask, products
+// stay below 2^16 so lanes never carry into each other
+inline uint32_t mix_word(uint32_t fg, uint32_t bg, uint32_t alpha, uint32_t inv_alpha) {
+    uint32_t lo = (fg & kLaneMask) * alpha + (bg & kLaneMask) * inv_alpha + 0x00800080;
+    uint32_t hi = ((fg >> 8) & kLaneMask) * alpha + ((bg >> 8) & kLaneMask) * inv_alpha + 0x00800080;
+    lo = ((lo + ((lo >> 8) & kLaneMask)) >> 8) & kLaneMask;
+    hi = (hi + ((hi >> 8) & kLaneMask)) & ~kLaneMask;
+    return lo | hi;
+}
+
+inline bool word_aligned(const void* p) {
+    return (reinterpret_cast<uintptr_t>(p) & 3) == 0;
+}
+
+}  // namespace
+
+void fill_rgb(uint8_t* dst, size_t count, uint8_t r, uint8_t g, uint8_t b) {
+    if (count == 0) {
+        return;
+    }
+    // Seed one pixel, then double the filled span with memcpy (word/burst copies)
+    dst[0] = r;
+    dst[1] = g;
+    dst[2] = b;
+    const size_t total = count * 3;
+    size_t filled = 3;
+    while (filled < total) {
+        const size_t chunk = std::min(filled, total - filled);
+        std::memcpy(dst + filled, dst, chunk);
+        filled += chunk;
+    }
+}
+
+void blend_rgb(const uint8_t* fg, const uint8_t* bg, uint8_t* out, size_t count, uint8_t alpha) {
+    const size_t bytes = count * 3;
+    size_t i = 0;
+    if (alpha == 255 || alpha == 0) {
+        const uint8_t* src = alpha == 255 ? fg : bg;
+        if (src != out) {
+            std::memmove(out, src, bytes);
+        }
+        return;
+    }
+    // Channels are independent, so RGB888 can be blended as a flat byte stream
+    if (word_aligned(fg) && word_aligned(bg) && word_aligned(out)) {
+        const uint32_t a = alpha;
+        const uint32_t ia = 255u - alpha;
+        for (; i + 4 <= bytes; i += 4) {
+            uint32_t f;
+            uint32_t bk;
+            std::memcpy(&f, fg + i, 4);
+            std::memcpy(&bk, bg + i, 4);
+            const uint32_t o = mix_word(f, bk, a, ia);
+            std::memcpy(out + i, &o, 4);
+        }
+    }
+    for (; i < bytes; ++i) {
+        out[i] = mix8(fg[i], bg[i], alpha);
+    }
+}
+
+void blend_rgb_alpha(const uint8_t* fg, const uint8_t* bg, uint8_t* out, const uint8_t* alpha, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t a = alpha[i];
+        const size_t o = i * 3;
+        if (a == 255) {
+            out[o + 0] = fg[o + 0];
+            out[o + 1] = fg[o + 1];
+            out[o + 2] = fg[o + 2];
+        } else if (a == 0) {
+            out[o + 0] = bg[o + 0];
+            out[o + 1] = bg[o + 1];
+            out[o + 2] = bg[o + 2];
+        } else {
+            out[o + 0] = mix8(fg[o + 0], bg[o + 0], a);
+            out[o + 1] = mix8(fg[o + 1], bg[o + 1], a);
+            out[o + 2] = mix8(fg[o + 2], bg[o + 2], a);
+        }
+    }
+}
+
+void scale_rgb(uint8_t* px, size_t count, uint8_t level) {
+    const size_t bytes = count * 3;
+    if (level == 255) {
+        return;
+    }
+    if (level == 0) {
+        std::memset(px, 0, bytes);
+        return;
+    }
+    // Blend against black: the background lanes drop out of mix_word
+    size_t i = 0;
+    if (word_aligned(px)) {
+        for (; i + 4 <= bytes; i += 4) {
+            uint32_t v;
+            std::memcpy(&v, px + i, 4);
+            v = mix_word(v, 0, level, 255u - level);
+            std::memcpy(px + i, &v, 4);
+        }
+    }
+    for (; i < bytes; ++i) {
+        px[i] = mix8(px[i], 0, level);
+    }
+}
+
+void scale_rotate_mirror_rgb(const uint8_t* in, uint16_t in_w, uint16_t in_h,
+                             uint8_t* out, uint16_t out_w, uint16_t out_h,
+                             uint16_t rotation_deg, bool mirror_x, bool mirror_y) {
+    if (in_w == 0 || in_h == 0 || out_w == 0 || out_h == 0) {
+        return;
+    }
+    const uint16_t quarter = static_cast<uint16_t>((rotation_deg / 90) % 4);
+    const bool swap = (quarter & 1) != 0;
+    // Size of the scaled image before rotation
+    const uint32_t sw = swap ? out_h : out_w;
+    const uint32_t sh = swap ? out_w : out_h;
+
+    for (uint32_t oy = 0; oy < out_h; ++oy) {
+        const uint32_t ry = mirror_y ? out_h - 1 - oy : oy;
+        for (uint32_t ox = 0; ox < out_w; ++ox) {
+            const uint32_t rx = mirror_x ? out_w - 1 - ox : ox;
+            // Undo the counter-clockwise rotation
+            uint32_t sx = rx;
+            uint32_t sy = ry;
+            switch (quarter) {
+                case 1:
+                    sx = sw - 1 - ry;
+                    sy = rx;
+                    break;
+                case 2:
+                    sx = sw - 1 - rx;
+                    sy = sh - 1 - ry;
+                    break;
+                case 3:
+                    sx = ry;
+                    sy = sh - 1 - rx;
+                    break;
+                default:
+                    break;
+            }
+            const uint32_t ix = sx * in_w / sw;
+            const uint32_t iy = sy * in_h / sh;
+            const uint8_t* src = in + (iy * in_w + ix) * 3;
+            uint8_t* dst = out + (oy * out_w + ox) * 3;
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+}
+
+}  // namespace pixel_ops
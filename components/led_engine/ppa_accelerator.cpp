@@ -1,60 +1,418 @@
-#ifdef CONFIG_IDF_TARGET_ESP32P4
-
 #include "led_engine/ppa_accelerator.hpp"
+#include "led_engine/pixel_ops.hpp"
+#include "led_engine/framebuffer.hpp"
 #include "esp_log.h"
-#include <cstring>
+#include "esp_timer.h"
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+#ifdef CONFIG_IDF_TARGET_ESP32P4
+#include "driver/ppa.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#endif
 
 namespace ppa_accel {
 
 static const char* TAG = "ppa-accel";
-static ppa_client_handle_t s_blend_client = nullptr;
-static ppa_client_handle_t s_fill_client = nullptr;
-static bool s_initialized = false;
 
-esp_err_t init_blend_client() {
-    if (s_blend_client) {
-        return ESP_OK;  // Already initialized
+namespace {
+
+enum class JobType : uint8_t {
+    Fill,
+    Blend,
+    Srm,
+};
+
+enum JobState : uint8_t {
+    kSlotFree,
+    kSlotQueued,   // waiting for the CPU: software backend, or no PPA target
+    kSlotRunning,  // hardware backend: handed to the PPA
+    kSlotDone,
+};
+
+struct JobSlot {
+    std::atomic<uint8_t> state{kSlotFree};
+    JobId id{kInvalidJob};
+    JobType type{JobType::Fill};
+    esp_err_t result{ESP_OK};
+    const uint8_t* fg{nullptr};
+    const uint8_t* bg{nullptr};
+    uint8_t* out{nullptr};
+    size_t out_capacity{0};  // 0 = exactly the output size
+    uint16_t width{0};   // input size for SRM
+    uint16_t height{0};
+    uint16_t out_width{0};
+    uint16_t out_height{0};
+    uint16_t rotation{0};
+    bool mirror_x{false};
+    bool mirror_y{false};
+    uint8_t alpha{255};
+    uint8_t r{0};
+    uint8_t g{0};
+    uint8_t b{0};
+    JobCallback cb{nullptr};
+    void* user_ctx{nullptr};
+};
+
+// Slot = id % kMaxJobs, so a slot is reused only after the job 16 ids back is done
+constexpr size_t kMaxJobs = 16;
+JobSlot s_jobs[kMaxJobs];
+std::mutex s_jobs_mutex;
+JobId s_next_id = 1;
+JobBackend s_backend = JobBackend::Software;
+
+std::atomic<uint32_t> s_submitted{0};
+std::atomic<uint32_t> s_completed{0};
+std::atomic<uint32_t> s_failed{0};
+std::atomic<uint32_t> s_software_runs{0};
+std::atomic<uint32_t> s_queue_full{0};
+std::atomic<uint32_t> s_cpu_routed{0};
+
+constexpr uint32_t kNeverFaster = UINT32_MAX;
+// Conservative defaults until calibrate() has run
+Calibration s_calibration{false, 300, 200, 0, 0, 0, 0};
+
+void finish_job(JobSlot& slot, esp_err_t result) {
+    slot.result = result;
+    const JobId id = slot.id;
+    JobCallback cb = slot.cb;
+    void* ctx = slot.user_ctx;
+    slot.state.store(kSlotDone, std::memory_order_release);
+    s_completed.fetch_add(1, std::memory_order_relaxed);
+    if (result != ESP_OK) {
+        s_failed.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (cb) {
+        cb(id, result, ctx);
+    }
+}
+
+void run_on_cpu(JobSlot& slot) {
+    const size_t count = static_cast<size_t>(slot.width) * slot.height;
+    switch (slot.type) {
+        case JobType::Fill:
+            pixel_ops::fill_rgb(slot.out, count, slot.r, slot.g, slot.b);
+            break;
+        case JobType::Blend:
+            pixel_ops::blend_rgb(slot.fg, slot.bg, slot.out, count, slot.alpha);
+            break;
+        case JobType::Srm:
+            pixel_ops::scale_rotate_mirror_rgb(slot.fg, slot.width, slot.height, slot.out,
+                                               slot.out_width, slot.out_height,
+                                               slot.rotation, slot.mirror_x, slot.mirror_y);
+            break;
+    }
+    s_software_runs.fetch_add(1, std::memory_order_relaxed);
+    finish_job(slot, ESP_OK);
+}
+
+size_t output_bytes(const JobSlot& slot) {
+    if (slot.type == JobType::Srm) {
+        return static_cast<size_t>(slot.out_width) * slot.out_height * 3;
+    }
+    return static_cast<size_t>(slot.width) * slot.height * 3;
+}
+
+// Oldest queued software job, or nullptr. A job the PPA could not take waits
+// for the hardware jobs submitted before it, which may produce its inputs.
+JobSlot* oldest_queued() {
+    JobSlot* oldest = nullptr;
+    JobId oldest_running = kInvalidJob;
+    for (auto& slot : s_jobs) {
+        const uint8_t state = slot.state.load(std::memory_order_acquire);
+        if (state == kSlotQueued && (oldest == nullptr || slot.id < oldest->id)) {
+            oldest = &slot;
+        } else if (state == kSlotRunning && (oldest_running == kInvalidJob || slot.id < oldest_running)) {
+            oldest_running = slot.id;
+        }
+    }
+    if (oldest != nullptr && oldest_running != kInvalidJob && oldest_running < oldest->id) {
+        return nullptr;
+    }
+    return oldest;
+}
+
+bool slot_done(const JobSlot& slot, JobId id) {
+    // A recycled slot means the job finished long ago
+    return slot.id != id || slot.state.load(std::memory_order_acquire) == kSlotDone;
+}
+
+#ifdef CONFIG_IDF_TARGET_ESP32P4
+
+ppa_client_handle_t s_blend_client = nullptr;
+ppa_client_handle_t s_fill_client = nullptr;
+ppa_client_handle_t s_srm_client = nullptr;
+SemaphoreHandle_t s_done_sem = nullptr;
+
+bool on_trans_done(ppa_client_handle_t, ppa_event_data_t*, void* user_data) {
+    if (user_data == nullptr) {
+        return false;  // blocking transaction
     }
-    
+    finish_job(*static_cast<JobSlot*>(user_data), ESP_OK);
+    BaseType_t woken = pdFALSE;
+    if (s_done_sem) {
+        xSemaphoreGiveFromISR(s_done_sem, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+esp_err_t register_client(ppa_operation_t oper, ppa_client_handle_t* client, const char* name) {
     ppa_client_config_t client_cfg = {};
-    client_cfg.oper_type = PPA_OPERATION_BLEND;
-    client_cfg.max_pending_trans_num = 4;
+    client_cfg.oper_type = oper;
+    client_cfg.max_pending_trans_num = kMaxJobs;
     client_cfg.data_burst_length = PPA_DATA_BURST_LENGTH_128;
-    
-    esp_err_t err = ppa_register_client(&client_cfg, &s_blend_client);
+
+    esp_err_t err = ppa_register_client(&client_cfg, client);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register PPA %s client: %s", name, esp_err_to_name(err));
+        return err;
+    }
+    ppa_event_callbacks_t cbs = {};
+    cbs.on_trans_done = on_trans_done;
+    err = ppa_client_register_event_callbacks(*client, &cbs);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to register PPA blend client: %s", esp_err_to_name(err));
+        ESP_LOGW(TAG, "Failed to register PPA %s callbacks: %s", name, esp_err_to_name(err));
+        ppa_unregister_client(*client);
+        *client = nullptr;
         return err;
     }
-    
-    s_initialized = true;
-    ESP_LOGI(TAG, "PPA blend client initialized");
+    ESP_LOGI(TAG, "PPA %s client initialized", name);
     return ESP_OK;
 }
 
+uint32_t out_buffer_size(size_t capacity, uint16_t width, uint16_t height) {
+    return static_cast<uint32_t>(capacity != 0 ? capacity : static_cast<size_t>(width) * height * 3);
+}
+
+ppa_blend_oper_config_t make_blend_config(const uint8_t* fg, const uint8_t* bg, uint8_t* out, size_t out_capacity,
+                                          uint16_t width, uint16_t height, uint8_t alpha) {
+    ppa_blend_oper_config_t cfg = {};
+    cfg.in_bg.buffer = bg;
+    cfg.in_bg.pic_w = width;
+    cfg.in_bg.pic_h = height;
+    cfg.in_bg.block_w = width;
+    cfg.in_bg.block_h = height;
+    cfg.in_bg.blend_cm = PPA_BLEND_COLOR_MODE_RGB888;
+
+    cfg.in_fg.buffer = fg;
+    cfg.in_fg.pic_w = width;
+    cfg.in_fg.pic_h = height;
+    cfg.in_fg.block_w = width;
+    cfg.in_fg.block_h = height;
+    cfg.in_fg.blend_cm = PPA_BLEND_COLOR_MODE_RGB888;
+
+    cfg.out.buffer = out;
+    cfg.out.buffer_size = out_buffer_size(out_capacity, width, height);
+    cfg.out.pic_w = width;
+    cfg.out.pic_h = height;
+    cfg.out.blend_cm = PPA_BLEND_COLOR_MODE_RGB888;
+
+    // RGB888 carries no alpha: background opaque, foreground weighted by the fixed alpha
+    cfg.bg_alpha_update_mode = PPA_ALPHA_FIX_VALUE;
+    cfg.bg_alpha_fix_val = 255;
+    cfg.fg_alpha_update_mode = PPA_ALPHA_FIX_VALUE;
+    cfg.fg_alpha_fix_val = alpha;
+    cfg.bg_ck_en = false;
+    cfg.fg_ck_en = false;
+    return cfg;
+}
+
+ppa_fill_oper_config_t make_fill_config(uint8_t* buffer, size_t capacity, uint16_t width, uint16_t height,
+                                        uint8_t r, uint8_t g, uint8_t b) {
+    ppa_fill_oper_config_t cfg = {};
+    cfg.out.buffer = buffer;
+    cfg.out.buffer_size = out_buffer_size(capacity, width, height);
+    cfg.out.pic_w = width;
+    cfg.out.pic_h = height;
+    cfg.out.fill_cm = PPA_FILL_COLOR_MODE_RGB888;
+    cfg.fill_block_w = width;
+    cfg.fill_block_h = height;
+    cfg.fill_argb_color.a = 255;
+    cfg.fill_argb_color.r = r;
+    cfg.fill_argb_color.g = g;
+    cfg.fill_argb_color.b = b;
+    return cfg;
+}
+
+ppa_srm_oper_config_t make_srm_config(const JobSlot& slot) {
+    const uint16_t quarter = static_cast<uint16_t>((slot.rotation / 90) % 4);
+    const bool swap = (quarter & 1) != 0;
+    ppa_srm_oper_config_t cfg = {};
+    cfg.in.buffer = slot.fg;
+    cfg.in.pic_w = slot.width;
+    cfg.in.pic_h = slot.height;
+    cfg.in.block_w = slot.width;
+    cfg.in.block_h = slot.height;
+    cfg.in.srm_cm = PPA_SRM_COLOR_MODE_RGB888;
+
+    cfg.out.buffer = slot.out;
+    cfg.out.buffer_size = out_buffer_size(slot.out_capacity, slot.out_width, slot.out_height);
+    cfg.out.pic_w = slot.out_width;
+    cfg.out.pic_h = slot.out_height;
+    cfg.out.srm_cm = PPA_SRM_COLOR_MODE_RGB888;
+
+    static constexpr ppa_srm_rotation_angle_t kAngles[] = {
+        PPA_SRM_ROTATION_ANGLE_0, PPA_SRM_ROTATION_ANGLE_90,
+        PPA_SRM_ROTATION_ANGLE_180, PPA_SRM_ROTATION_ANGLE_270,
+    };
+    cfg.rotation_angle = kAngles[quarter];
+    // The engine scales before rotating
+    cfg.scale_x = static_cast<float>(swap ? slot.out_height : slot.out_width) / slot.width;
+    cfg.scale_y = static_cast<float>(swap ? slot.out_width : slot.out_height) / slot.height;
+    cfg.mirror_x = slot.mirror_x;
+    cfg.mirror_y = slot.mirror_y;
+    return cfg;
+}
+
+// Hand a job to the PPA; the driver syncs caches for the buffers it touches
+esp_err_t start_on_ppa(JobSlot& slot) {
+    switch (slot.type) {
+        case JobType::Fill: {
+            if (!s_fill_client) {
+                return ESP_ERR_INVALID_STATE;
+            }
+            ppa_fill_oper_config_t cfg = make_fill_config(slot.out, slot.out_capacity, slot.width, slot.height, slot.r, slot.g, slot.b);
+            cfg.mode = PPA_TRANS_MODE_NON_BLOCKING;
+            cfg.user_data = &slot;
+            return ppa_do_fill(s_fill_client, &cfg);
+        }
+        case JobType::Blend: {
+            if (!s_blend_client) {
+                return ESP_ERR_INVALID_STATE;
+            }
+            ppa_blend_oper_config_t cfg =
+                make_blend_config(slot.fg, slot.bg, slot.out, slot.out_capacity, slot.width, slot.height, slot.alpha);
+            cfg.mode = PPA_TRANS_MODE_NON_BLOCKING;
+            cfg.user_data = &slot;
+            return ppa_do_blend(s_blend_client, &cfg);
+        }
+        case JobType::Srm: {
+            if (!s_srm_client) {
+                return ESP_ERR_INVALID_STATE;
+            }
+            ppa_srm_oper_config_t cfg = make_srm_config(slot);
+            cfg.mode = PPA_TRANS_MODE_NON_BLOCKING;
+            cfg.user_data = &slot;
+            return ppa_do_scale_rotate_mirror(s_srm_client, &cfg);
+        }
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+#endif  // CONFIG_IDF_TARGET_ESP32P4
+
+JobId submit(JobSlot&& desc) {
+    std::lock_guard<std::mutex> lock(s_jobs_mutex);
+    const JobId id = s_next_id;
+    JobSlot& slot = s_jobs[id % kMaxJobs];
+    const uint8_t state = slot.state.load(std::memory_order_acquire);
+    if (state != kSlotFree && state != kSlotDone) {
+        s_queue_full.fetch_add(1, std::memory_order_relaxed);
+        return kInvalidJob;
+    }
+    s_next_id = (s_next_id == UINT32_MAX) ? 1 : s_next_id + 1;
+
+    slot.id = id;
+    slot.type = desc.type;
+    slot.result = ESP_OK;
+    slot.fg = desc.fg;
+    slot.bg = desc.bg;
+    slot.out = desc.out;
+    slot.out_capacity = desc.out_capacity;
+    slot.width = desc.width;
+    slot.height = desc.height;
+    slot.out_width = desc.out_width;
+    slot.out_height = desc.out_height;
+    slot.rotation = desc.rotation;
+    slot.mirror_x = desc.mirror_x;
+    slot.mirror_y = desc.mirror_y;
+    slot.alpha = desc.alpha;
+    slot.r = desc.r;
+    slot.g = desc.g;
+    slot.b = desc.b;
+    slot.cb = desc.cb;
+    slot.user_ctx = desc.user_ctx;
+    s_submitted.fetch_add(1, std::memory_order_relaxed);
+
+    // Decided here rather than by a refused transaction: the driver rejects
+    // outputs that are not whole cache lines
+    const bool ppa_target = hardware_target(slot.out, slot.out_capacity, output_bytes(slot));
+    if (!ppa_target) {
+        s_cpu_routed.fetch_add(1, std::memory_order_relaxed);
+    }
+#ifdef CONFIG_IDF_TARGET_ESP32P4
+    if (s_backend == JobBackend::Hardware && ppa_target) {
+        slot.state.store(kSlotRunning, std::memory_order_release);
+        const esp_err_t err = start_on_ppa(slot);
+        if (err == ESP_OK) {
+            return id;
+        }
+        // PPA refused the transaction: same result, computed on the CPU
+        ESP_LOGD(TAG, "PPA submit failed (%s), running job %u on CPU", esp_err_to_name(err),
+                 static_cast<unsigned>(id));
+        run_on_cpu(slot);
+        return id;
+    }
+#endif
+    slot.state.store(kSlotQueued, std::memory_order_release);
+    return id;
+}
+
+int64_t deadline_us(uint32_t timeout_ms) {
+    return esp_timer_get_time() + static_cast<int64_t>(timeout_ms) * 1000;
+}
+
+// Wait for hardware completions; false on timeout
+bool wait_for_completion(int64_t deadline) {
+#ifdef CONFIG_IDF_TARGET_ESP32P4
+    const int64_t remaining_us = deadline - esp_timer_get_time();
+    if (remaining_us <= 0 || s_done_sem == nullptr) {
+        return false;
+    }
+    const TickType_t ticks = std::max<TickType_t>(1, pdMS_TO_TICKS((remaining_us + 999) / 1000));
+    xSemaphoreTake(s_done_sem, ticks);
+    return true;
+#else
+    (void)deadline;
+    return false;
+#endif
+}
+
+}  // namespace
+
+#ifdef CONFIG_IDF_TARGET_ESP32P4
+
+esp_err_t init_blend_client() {
+    if (s_blend_client) {
+        return ESP_OK;  // Already initialized
+    }
+    return register_client(PPA_OPERATION_BLEND, &s_blend_client, "blend");
+}
+
 esp_err_t init_fill_client() {
     if (s_fill_client) {
         return ESP_OK;  // Already initialized
     }
-    
-    ppa_client_config_t client_cfg = {};
-    client_cfg.oper_type = PPA_OPERATION_FILL;
-    client_cfg.max_pending_trans_num = 4;
-    client_cfg.data_burst_length = PPA_DATA_BURST_LENGTH_128;
-    
-    esp_err_t err = ppa_register_client(&client_cfg, &s_fill_client);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to register PPA fill client: %s", esp_err_to_name(err));
-        return err;
+    return register_client(PPA_OPERATION_FILL, &s_fill_client, "fill");
+}
+
+esp_err_t init_srm_client() {
+    if (s_srm_client) {
+        return ESP_OK;  // Already initialized
     }
-    
-    s_initialized = true;
-    ESP_LOGI(TAG, "PPA fill client initialized");
-    return ESP_OK;
+    return register_client(PPA_OPERATION_SRM, &s_srm_client, "srm");
 }
 
 void deinit() {
+    // Transactions in flight reference the clients
+    wait_all_jobs(100);
+    {
+        std::lock_guard<std::mutex> lock(s_jobs_mutex);
+        s_backend = JobBackend::Software;
+    }
     if (s_blend_client) {
         ppa_unregister_client(s_blend_client);
         s_blend_client = nullptr;
@@ -63,161 +421,385 @@ void deinit() {
         ppa_unregister_client(s_fill_client);
         s_fill_client = nullptr;
     }
-    s_initialized = false;
+    if (s_srm_client) {
+        ppa_unregister_client(s_srm_client);
+        s_srm_client = nullptr;
+    }
     ESP_LOGI(TAG, "PPA clients deinitialized");
 }
 
 esp_err_t blend_rgb(const uint8_t* src, const uint8_t* dst, uint8_t* out,
-                    uint16_t width, uint16_t height, float alpha) {
+                    uint16_t width, uint16_t height, float alpha, size_t out_capacity) {
+    if (!hardware_target(out, out_capacity, static_cast<size_t>(width) * height * 3)) {
+        return ESP_ERR_INVALID_ARG;
+    }
     if (!s_blend_client) {
         esp_err_t err = init_blend_client();
         if (err != ESP_OK) {
             return err;
         }
     }
-    
+
     // Clamp alpha to 0.0-1.0
     alpha = std::clamp(alpha, 0.0f, 1.0f);
-    
-    // PPA requires buffers to be aligned and in specific format
-    // For simplicity, we'll use RGB888 format
-    // Note: PPA works on blocks, so we need to configure input/output blocks
-    
-    ppa_blend_oper_config_t blend_cfg = {};
-    
-    // Foreground (source) block
-    blend_cfg.fg_pic_blk.pic_buffer = const_cast<uint8_t*>(src);
-    blend_cfg.fg_pic_blk.pic_width = width;
-    blend_cfg.fg_pic_blk.pic_height = height;
-    blend_cfg.fg_pic_blk.blk_offset_x = 0;
-    blend_cfg.fg_pic_blk.blk_offset_y = 0;
-    blend_cfg.fg_pic_blk.blk_width = width;
-    blend_cfg.fg_pic_blk.blk_height = height;
-    blend_cfg.fg_pic_blk.color_mode = PPA_BLEND_COLOR_MODE_RGB888;
-    
-    // Background (destination) block
-    blend_cfg.bg_pic_blk.pic_buffer = const_cast<uint8_t*>(dst);
-    blend_cfg.bg_pic_blk.pic_width = width;
-    blend_cfg.bg_pic_blk.pic_height = height;
-    blend_cfg.bg_pic_blk.blk_offset_x = 0;
-    blend_cfg.bg_pic_blk.blk_offset_y = 0;
-    blend_cfg.bg_pic_blk.blk_width = width;
-    blend_cfg.bg_pic_blk.blk_height = height;
-    blend_cfg.bg_pic_blk.color_mode = PPA_BLEND_COLOR_MODE_RGB888;
-    
-    // Output block
-    blend_cfg.out_pic_blk.pic_buffer = out;
-    blend_cfg.out_pic_blk.pic_width = width;
-    blend_cfg.out_pic_blk.pic_height = height;
-    blend_cfg.out_pic_blk.blk_offset_x = 0;
-    blend_cfg.out_pic_blk.blk_offset_y = 0;
-    blend_cfg.out_pic_blk.blk_width = width;
-    blend_cfg.out_pic_blk.blk_height = height;
-    blend_cfg.out_pic_blk.color_mode = PPA_BLEND_COLOR_MODE_RGB888;
-    
-    // Alpha configuration - use fixed alpha value
-    blend_cfg.alpha_mode = PPA_ALPHA_SCALE;
-    blend_cfg.alpha_scale = static_cast<uint8_t>(alpha * 255.0f);
-    
-    // No color keying
-    blend_cfg.color_key_enable = false;
-    
-    // Blocking mode for simplicity
-    esp_err_t err = ppa_do_blend(s_blend_client, &blend_cfg, PPA_TRANS_MODE_BLOCKING);
+    ppa_blend_oper_config_t blend_cfg =
+        make_blend_config(src, dst, out, out_capacity, width, height, static_cast<uint8_t>(alpha * 255.0f + 0.5f));
+    blend_cfg.mode = PPA_TRANS_MODE_BLOCKING;
+    esp_err_t err = ppa_do_blend(s_blend_client, &blend_cfg);
     if (err != ESP_OK) {
         ESP_LOGW(TAG, "PPA blend failed: %s", esp_err_to_name(err));
         return err;
     }
-    
-    return ESP_OK;
-}
 
-esp_err_t blend_rgb_per_pixel_alpha(const uint8_t* src, const uint8_t* dst, uint8_t* out,
-                                    const uint8_t* src_alpha_buffer,
-                                    uint16_t width, uint16_t height) {
-    // PPA doesn't directly support per-pixel alpha in blend mode
-    // We'll need to fall back to software blending for this
-    // TODO: Could use PPA for chunks with same alpha, but complexity may not be worth it
-    ESP_LOGW(TAG, "Per-pixel alpha blending not fully supported by PPA, using software fallback");
-    
-    // Software fallback
-    for (uint32_t i = 0; i < static_cast<uint32_t>(width) * height; ++i) {
-        const float alpha = src_alpha_buffer[i] / 255.0f;
-        const float inv_alpha = 1.0f - alpha;
-        out[i * 3 + 0] = static_cast<uint8_t>(src[i * 3 + 0] * alpha + dst[i * 3 + 0] * inv_alpha);
-        out[i * 3 + 1] = static_cast<uint8_t>(src[i * 3 + 1] * alpha + dst[i * 3 + 1] * inv_alpha);
-        out[i * 3 + 2] = static_cast<uint8_t>(src[i * 3 + 2] * alpha + dst[i * 3 + 2] * inv_alpha);
-    }
-    
     return ESP_OK;
 }
 
 esp_err_t fill_rgb(uint8_t* buffer, uint16_t width, uint16_t height,
-                   uint8_t r, uint8_t g, uint8_t b) {
+                   uint8_t r, uint8_t g, uint8_t b, size_t out_capacity) {
+    if (!hardware_target(buffer, out_capacity, static_cast<size_t>(width) * height * 3)) {
+        return ESP_ERR_INVALID_ARG;
+    }
     if (!s_fill_client) {
         esp_err_t err = init_fill_client();
         if (err != ESP_OK) {
             return err;
         }
     }
-    
-    ppa_fill_oper_config_t fill_cfg = {};
-    
-    // Output block
-    fill_cfg.out_pic_blk.pic_buffer = buffer;
-    fill_cfg.out_pic_blk.pic_width = width;
-    fill_cfg.out_pic_blk.pic_height = height;
-    fill_cfg.out_pic_blk.blk_offset_x = 0;
-    fill_cfg.out_pic_blk.blk_offset_y = 0;
-    fill_cfg.out_pic_blk.blk_width = width;
-    fill_cfg.out_pic_blk.blk_height = height;
-    fill_cfg.out_pic_blk.color_mode = PPA_FILL_COLOR_MODE_RGB888;
-    
-    // Fill color (ARGB format, but we only use RGB)
-    fill_cfg.fill_color_mode = PPA_FILL_COLOR_MODE_RGB888;
-    fill_cfg.fill_color.rgb888.r = r;
-    fill_cfg.fill_color.rgb888.g = g;
-    fill_cfg.fill_color.rgb888.b = b;
-    
-    // Blocking mode
-    esp_err_t err = ppa_do_fill(s_fill_client, &fill_cfg, PPA_TRANS_MODE_BLOCKING);
+
+    ppa_fill_oper_config_t fill_cfg = make_fill_config(buffer, out_capacity, width, height, r, g, b);
+    fill_cfg.mode = PPA_TRANS_MODE_BLOCKING;
+    esp_err_t err = ppa_do_fill(s_fill_client, &fill_cfg);
     if (err != ESP_OK) {
         ESP_LOGW(TAG, "PPA fill failed: %s", esp_err_to_name(err));
         return err;
     }
-    
+
     return ESP_OK;
 }
 
 bool is_available() {
-    return s_initialized && (s_blend_client != nullptr || s_fill_client != nullptr);
+    return s_blend_client != nullptr || s_fill_client != nullptr || s_srm_client != nullptr;
 }
 
-}  // namespace ppa_accel
+esp_err_t jobs_init(JobBackend preferred) {
+    if (s_done_sem == nullptr) {
+        s_done_sem = xSemaphoreCreateBinary();
+        if (s_done_sem == nullptr) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    JobBackend backend = JobBackend::Software;
+    if (preferred == JobBackend::Hardware && init_fill_client() == ESP_OK && init_blend_client() == ESP_OK) {
+        backend = JobBackend::Hardware;
+        // Optional: SRM jobs run on the CPU without it
+        init_srm_client();
+    }
+    wait_all_jobs(100);
+    std::lock_guard<std::mutex> lock(s_jobs_mutex);
+    s_backend = backend;
+    ESP_LOGI(TAG, "PPA job backend: %s", backend == JobBackend::Hardware ? "hardware" : "software");
+    return ESP_OK;
+}
 
-#else  // CONFIG_IDF_TARGET_ESP32P4
+namespace {
 
-// Stub implementations for non-ESP32P4 platforms
-#include "led_engine/ppa_accelerator.hpp"
+// Best of a few runs; the first call also pays for cache misses
+template <typename Fn>
+int64_t time_best_us(Fn&& fn) {
+    int64_t best = INT64_MAX;
+    for (int run = 0; run < 4; ++run) {
+        const int64_t t0 = esp_timer_get_time();
+        fn();
+        best = std::min(best, esp_timer_get_time() - t0);
+    }
+    return best;
+}
 
-namespace ppa_accel {
+// Fit cost = fixed + per_pixel * n for both paths and intersect the lines
+uint32_t crossover_pixels(int64_t cpu_small, int64_t cpu_large, int64_t ppa_small, int64_t ppa_large,
+                          uint32_t n_small, uint32_t n_large) {
+    const float dn = static_cast<float>(n_large - n_small);
+    const float cpu_per = static_cast<float>(cpu_large - cpu_small) / dn;
+    const float ppa_per = static_cast<float>(ppa_large - ppa_small) / dn;
+    if (ppa_per >= cpu_per) {
+        return kNeverFaster;
+    }
+    const float cpu_fixed = static_cast<float>(cpu_small) - cpu_per * n_small;
+    const float ppa_fixed = static_cast<float>(ppa_small) - ppa_per * n_small;
+    const float n = (ppa_fixed - cpu_fixed) / (cpu_per - ppa_per);
+    if (n <= 0.0f) {
+        return 0;
+    }
+    return n >= static_cast<float>(kNeverFaster) ? kNeverFaster : static_cast<uint32_t>(n + 0.5f);
+}
+
+}  // namespace
+
+esp_err_t calibrate() {
+    if (init_fill_client() != ESP_OK || init_blend_client() != ESP_OK) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    constexpr uint16_t kSmall = 8;   // 64 pixels
+    constexpr uint16_t kLarge = 64;  // 4096 pixels
+    framebuffer::Framebuffer fg(kLarge, kLarge);
+    framebuffer::Framebuffer bg(kLarge, kLarge);
+    framebuffer::Framebuffer out(kLarge, kLarge);
+    if (!fg.valid() || !bg.valid() || !out.valid()) {
+        return ESP_ERR_NO_MEM;
+    }
+    fg.clear(200, 100, 50);
+    bg.clear(10, 20, 30);
+
+    auto cpu_fill = [&](uint16_t side) {
+        return time_best_us([&] { pixel_ops::fill_rgb(out.data(), side * side, 1, 2, 3); });
+    };
+    auto ppa_fill = [&](uint16_t side) {
+        return time_best_us([&] { fill_rgb(out.data(), side, side, 1, 2, 3, out.capacity()); });
+    };
+    auto cpu_blend = [&](uint16_t side) {
+        return time_best_us([&] { pixel_ops::blend_rgb(fg.data(), bg.data(), out.data(), side * side, 128); });
+    };
+    auto ppa_blend = [&](uint16_t side) {
+        return time_best_us([&] { blend_rgb(fg.data(), bg.data(), out.data(), side, side, 0.5f, out.capacity()); });
+    };
+
+    const int64_t fill_cpu_small = cpu_fill(kSmall);
+    const int64_t fill_cpu_large = cpu_fill(kLarge);
+    const int64_t fill_ppa_small = ppa_fill(kSmall);
+    const int64_t fill_ppa_large = ppa_fill(kLarge);
+    const int64_t blend_cpu_small = cpu_blend(kSmall);
+    const int64_t blend_cpu_large = cpu_blend(kLarge);
+    const int64_t blend_ppa_small = ppa_blend(kSmall);
+    const int64_t blend_ppa_large = ppa_blend(kLarge);
+
+    Calibration cal{};
+    cal.calibrated = true;
+    cal.fill_crossover = crossover_pixels(fill_cpu_small, fill_cpu_large, fill_ppa_small, fill_ppa_large,
+                                          kSmall * kSmall, kLarge * kLarge);
+    cal.blend_crossover = crossover_pixels(blend_cpu_small, blend_cpu_large, blend_ppa_small, blend_ppa_large,
+                                           kSmall * kSmall, kLarge * kLarge);
+    cal.fill_cpu_us = static_cast<uint32_t>(fill_cpu_large);
+    cal.fill_ppa_us = static_cast<uint32_t>(fill_ppa_large);
+    cal.blend_cpu_us = static_cast<uint32_t>(blend_cpu_large);
+    cal.blend_ppa_us = static_cast<uint32_t>(blend_ppa_large);
+    {
+        std::lock_guard<std::mutex> lock(s_jobs_mutex);
+        s_calibration = cal;
+    }
+    ESP_LOGI(TAG, "PPA crossover: fill %u px (cpu %u us / ppa %u us @4096), blend %u px (cpu %u us / ppa %u us)",
+             static_cast<unsigned>(cal.fill_crossover), static_cast<unsigned>(cal.fill_cpu_us),
+             static_cast<unsigned>(cal.fill_ppa_us), static_cast<unsigned>(cal.blend_crossover),
+             static_cast<unsigned>(cal.blend_cpu_us), static_cast<unsigned>(cal.blend_ppa_us));
+    return ESP_OK;
+}
+
+#else  // CONFIG_IDF_TARGET_ESP32P4
 
-// These are already defined as inline in the header, but we provide
-// non-inline versions here to satisfy the linker in case they're not inlined
 esp_err_t init_blend_client() { return ESP_ERR_NOT_SUPPORTED; }
 esp_err_t init_fill_client() { return ESP_ERR_NOT_SUPPORTED; }
-void deinit() {}
+esp_err_t init_srm_client() { return ESP_ERR_NOT_SUPPORTED; }
+void deinit() { wait_all_jobs(100); }
 esp_err_t blend_rgb(const uint8_t*, const uint8_t*, uint8_t*,
-                    uint16_t, uint16_t, float) { return ESP_ERR_NOT_SUPPORTED; }
-esp_err_t blend_rgb_per_pixel_alpha(const uint8_t*, const uint8_t*, uint8_t*,
-                                    const uint8_t*, uint16_t, uint16_t) { 
-  return ESP_ERR_NOT_SUPPORTED; 
-}
-esp_err_t fill_rgb(uint8_t*, uint16_t, uint16_t, uint8_t, uint8_t, uint8_t) { 
-  return ESP_ERR_NOT_SUPPORTED; 
-}
+                    uint16_t, uint16_t, float, size_t) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t fill_rgb(uint8_t*, uint16_t, uint16_t, uint8_t, uint8_t, uint8_t, size_t) { return ESP_ERR_NOT_SUPPORTED; }
 bool is_available() { return false; }
+esp_err_t calibrate() { return ESP_ERR_NOT_SUPPORTED; }
 
-}  // namespace ppa_accel
+esp_err_t jobs_init(JobBackend) {
+    wait_all_jobs(100);
+    std::lock_guard<std::mutex> lock(s_jobs_mutex);
+    s_backend = JobBackend::Software;
+    return ESP_OK;
+}
 
 #endif  // CONFIG_IDF_TARGET_ESP32P4
+
+esp_err_t blend_rgb_per_pixel_alpha(const uint8_t* src, const uint8_t* dst, uint8_t* out,
+                                    const uint8_t* src_alpha_buffer,
+                                    uint16_t width, uint16_t height) {
+    // The PPA has no per-pixel alpha for RGB888 inputs, so this always runs on the CPU
+    pixel_ops::blend_rgb_alpha(src, dst, out, src_alpha_buffer, static_cast<size_t>(width) * height);
+    return ESP_OK;
+}
+
+size_t buffer_alignment() {
+    return framebuffer::FramebufferPool::alignment();
+}
+
+bool hardware_target(const void* out, size_t capacity, size_t bytes) {
+    const size_t align = buffer_alignment();
+    if (capacity == 0) {
+        capacity = bytes;
+    }
+    return out != nullptr && reinterpret_cast<uintptr_t>(out) % align == 0 &&
+           capacity % align == 0 && capacity >= bytes;
+}
+
+bool prefer_hardware(Op op, size_t pixels, const void* out, size_t out_capacity) {
+    if (!is_available() || !hardware_target(out, out_capacity, pixels * 3)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(s_jobs_mutex);
+    const uint32_t crossover = op == Op::Fill ? s_calibration.fill_crossover : s_calibration.blend_crossover;
+    return crossover != kNeverFaster && pixels >= crossover;
+}
+
+Calibration calibration() {
+    std::lock_guard<std::mutex> lock(s_jobs_mutex);
+    return s_calibration;
+}
+
+JobBackend jobs_backend() {
+    std::lock_guard<std::mutex> lock(s_jobs_mutex);
+    return s_backend;
+}
+
+JobId submit_fill(uint8_t* buffer, uint16_t width, uint16_t height,
+                  uint8_t r, uint8_t g, uint8_t b,
+                  JobCallback cb, void* user_ctx, size_t out_capacity) {
+    if (buffer == nullptr || width == 0 || height == 0) {
+        return kInvalidJob;
+    }
+    JobSlot desc;
+    desc.type = JobType::Fill;
+    desc.out = buffer;
+    desc.out_capacity = out_capacity;
+    desc.width = width;
+    desc.height = height;
+    desc.r = r;
+    desc.g = g;
+    desc.b = b;
+    desc.cb = cb;
+    desc.user_ctx = user_ctx;
+    return submit(std::move(desc));
+}
+
+JobId submit_blend(const uint8_t* fg, const uint8_t* bg, uint8_t* out,
+                   uint16_t width, uint16_t height, uint8_t alpha,
+                   JobCallback cb, void* user_ctx, size_t out_capacity) {
+    if (fg == nullptr || bg == nullptr || out == nullptr || width == 0 || height == 0) {
+        return kInvalidJob;
+    }
+    JobSlot desc;
+    desc.type = JobType::Blend;
+    desc.fg = fg;
+    desc.bg = bg;
+    desc.out = out;
+    desc.out_capacity = out_capacity;
+    desc.width = width;
+    desc.height = height;
+    desc.alpha = alpha;
+    desc.cb = cb;
+    desc.user_ctx = user_ctx;
+    return submit(std::move(desc));
+}
+
+JobId submit_srm(const uint8_t* in, uint16_t in_w, uint16_t in_h,
+                 uint8_t* out, uint16_t out_w, uint16_t out_h,
+                 uint16_t rotation_deg, bool mirror_x, bool mirror_y,
+                 JobCallback cb, void* user_ctx, size_t out_capacity) {
+    if (in == nullptr || out == nullptr || in_w == 0 || in_h == 0 || out_w == 0 || out_h == 0) {
+        return kInvalidJob;
+    }
+    JobSlot desc;
+    desc.type = JobType::Srm;
+    desc.fg = in;
+    desc.out = out;
+    desc.out_capacity = out_capacity;
+    desc.width = in_w;
+    desc.height = in_h;
+    desc.out_width = out_w;
+    desc.out_height = out_h;
+    desc.rotation = rotation_deg;
+    desc.mirror_x = mirror_x;
+    desc.mirror_y = mirror_y;
+    desc.cb = cb;
+    desc.user_ctx = user_ctx;
+    return submit(std::move(desc));
+}
+
+bool job_done(JobId id) {
+    if (id == kInvalidJob) {
+        return true;
+    }
+    return slot_done(s_jobs[id % kMaxJobs], id);
+}
+
+void poll_jobs() {
+    std::lock_guard<std::mutex> lock(s_jobs_mutex);
+    if (JobSlot* slot = oldest_queued()) {
+        run_on_cpu(*slot);
+    }
+}
+
+esp_err_t wait_job(JobId id, uint32_t timeout_ms) {
+    if (id == kInvalidJob) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const JobSlot& slot = s_jobs[id % kMaxJobs];
+    const int64_t deadline = deadline_us(timeout_ms);
+    while (!slot_done(slot, id)) {
+        {
+            // Software jobs run here, oldest first, so ordering matches the hardware queue
+            std::lock_guard<std::mutex> lock(s_jobs_mutex);
+            if (JobSlot* queued = oldest_queued(); queued && queued->id <= id) {
+                run_on_cpu(*queued);
+                continue;
+            }
+        }
+        if (!wait_for_completion(deadline)) {
+            return slot_done(slot, id) ? ESP_OK : ESP_ERR_TIMEOUT;
+        }
+    }
+    return slot.id == id ? slot.result : ESP_OK;
+}
+
+esp_err_t settle_job(JobId id, uint32_t expected_ms) {
+    esp_err_t err = wait_job(id, expected_ms);
+    while (err == ESP_ERR_TIMEOUT) {
+        // The PPA still owns the buffers; returning now would free them under the DMA
+        ESP_LOGW(TAG, "PPA job %u overran %u ms, still waiting", static_cast<unsigned>(id),
+                 static_cast<unsigned>(expected_ms));
+        err = wait_job(id, 1000);
+    }
+    return err;
+}
+
+esp_err_t wait_all_jobs(uint32_t timeout_ms) {
+    const int64_t deadline = deadline_us(timeout_ms);
+    while (true) {
+        bool pending = false;
+        {
+            std::lock_guard<std::mutex> lock(s_jobs_mutex);
+            if (JobSlot* queued = oldest_queued()) {
+                run_on_cpu(*queued);
+                continue;
+            }
+            for (const auto& slot : s_jobs) {
+                if (slot.state.load(std::memory_order_acquire) == kSlotRunning) {
+                    pending = true;
+                    break;
+                }
+            }
+        }
+        if (!pending) {
+            return ESP_OK;
+        }
+        if (!wait_for_completion(deadline)) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+}
+
+JobStats job_stats() {
+    JobStats st{};
+    st.submitted = s_submitted.load(std::memory_order_relaxed);
+    st.completed = s_completed.load(std::memory_order_relaxed);
+    st.failed = s_failed.load(std::memory_order_relaxed);
+    st.software_runs = s_software_runs.load(std::memory_order_relaxed);
+    st.queue_full = s_queue_full.load(std::memory_order_relaxed);
+    st.cpu_routed = s_cpu_routed.load(std::memory_order_relaxed);
+    return st;
+}
+
+}  // namespace ppa_accel
@@ -1,14 +1,23 @@
 #include "led_engine/rmt_driver.hpp"
 #include "led_engine/chipset_info.hpp"
 #include "led_engine/color_processing.hpp"
+#include "led_engine/dirty_region.hpp"
+#include "led_engine/segment_layout.hpp"
+#include "led_engine/mem_placement.hpp"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
 #include "driver/rmt_tx.h"
 #include "driver/rmt_encoder.h"
 #include "driver/gpio.h"
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <stddef.h>
 #include <cmath>
+#include <memory>
 #include <vector>
 
 #ifndef __containerof
@@ -32,12 +41,25 @@ static const char* TAG = "rmt-driver";
 
 struct ws2812_encoder_t {
     rmt_encoder_t base;
-    rmt_encoder_t* bytes_encoder;
+    rmt_encoder_t* bytes_encoder;  // bytes encoder, or a copy encoder when data is pre-encoded symbols
     rmt_encoder_t* copy_encoder;
     int state;
     rmt_symbol_word_t reset_symbol;
+    // Encoder cost counters, updated from the RMT ISR. 64-bit values tear on
+    // a 32-bit core, so both sides touch them under stats_lock.
+    portMUX_TYPE stats_lock;
+    uint64_t isr_us;
+    uint64_t isr_symbols;
 };
 
+// Consistent copy of an encoder's cost counters, from task context
+void read_encoder_stats(ws2812_encoder_t* encoder, uint64_t& isr_us, uint64_t& isr_symbols) {
+    portENTER_CRITICAL(&encoder->stats_lock);
+    isr_us = encoder->isr_us;
+    isr_symbols = encoder->isr_symbols;
+    portEXIT_CRITICAL(&encoder->stats_lock);
+}
+
 size_t ws2812_encode(rmt_encoder_t* encoder, rmt_channel_handle_t channel, const void* primary_data, size_t data_size, rmt_encode_state_t* ret_state) {
     ws2812_encoder_t* ws2812 = __containerof(encoder, ws2812_encoder_t, base);
     rmt_encoder_handle_t bytes_encoder = ws2812->bytes_encoder;
@@ -45,6 +67,7 @@ size_t ws2812_encode(rmt_encoder_t* encoder, rmt_channel_handle_t channel, const
     rmt_encode_state_t session_state = RMT_ENCODING_RESET;
     rmt_encode_state_t state = RMT_ENCODING_RESET;
     size_t encoded_symbols = 0;
+    const int64_t started_us = esp_timer_get_time();
     switch (ws2812->state) {
         case 0: // send RGB data
             encoded_symbols += bytes_encoder->encode(bytes_encoder, channel, primary_data, data_size, &session_state);
@@ -69,6 +92,12 @@ size_t ws2812_encode(rmt_encoder_t* encoder, rmt_channel_handle_t channel, const
             }
     }
 out:
+    // Called from the ISR and, for the first fill, from rmt_transmit()
+    const uint64_t spent_us = static_cast<uint64_t>(esp_timer_get_time() - started_us);
+    portENTER_CRITICAL_SAFE(&ws2812->stats_lock);
+    ws2812->isr_us += spent_us;
+    ws2812->isr_symbols += encoded_symbols;
+    portEXIT_CRITICAL_SAFE(&ws2812->stats_lock);
     *ret_state = state;
     return encoded_symbols;
 }
@@ -89,8 +118,48 @@ esp_err_t ws2812_reset(rmt_encoder_t* encoder) {
     return ESP_OK;
 }
 
+// Every byte value expanded to its 8 RMT symbols (MSB first) for one chipset timing
+struct SymbolLut {
+    uint32_t timing_key;
+    rmt_symbol_word_t symbols[256][8];
+};
+
+uint32_t make_timing_key(const ChipsetTiming& t) {
+    return (static_cast<uint32_t>(t.t0h_ticks) << 24) | (static_cast<uint32_t>(t.t0l_ticks) << 16) |
+           (static_cast<uint32_t>(t.t1h_ticks) << 8) | t.t1l_ticks;
+}
+
+struct DmaDeleter {
+    size_t bytes{0};
+    void operator()(void* ptr) const { placement::release(placement::MemTag::Dma, ptr, bytes); }
+};
+
+// Transfers queued on a channel and not yet done; heap-allocated so the ISR
+// context pointer survives moves of the owning segment
+struct TxState {
+    std::atomic<uint32_t> pending{0};
+
+    void queued() { pending.fetch_add(1, std::memory_order_relaxed); }
+    void dropped() { pending.fetch_sub(1, std::memory_order_relaxed); }
+};
+
+bool IRAM_ATTR on_tx_done(rmt_channel_handle_t, const rmt_tx_done_event_data_t*, void* user_ctx) {
+    static_cast<TxState*>(user_ctx)->pending.fetch_sub(1, std::memory_order_release);
+    return false;
+}
+
 }  // namespace
 
+// Inputs the fused converter was built from
+struct ConverterKey {
+    bool valid;
+    float gamma_color;
+    float gamma_white;
+    bool apply_gamma;
+    bool dither;
+    uint8_t level;
+};
+
 struct RmtDriverSegment {
     rmt_channel_handle_t channel;
     rmt_encoder_handle_t encoder;
@@ -101,20 +170,147 @@ struct RmtDriverSegment {
     bool supports_rgbw;
     uint8_t bytes_per_pixel;
     bool initialized;
-    std::vector<uint8_t> buffer;
+    placement::HotVector<uint8_t> buffer;
+    placement::HotVector<uint8_t> scratch;  // converted span before it is copied under the lock
+    // Pre-encoded symbol output (rmt_encoding == "lut")
+    bool symbol_lut;
+    std::shared_ptr<const SymbolLut> lut;
+    std::unique_ptr<rmt_symbol_word_t, DmaDeleter> symbols;
+    size_t symbol_capacity;
+    uint32_t frames;
+    uint64_t preencode_us;
+    std::unique_ptr<TxState> tx_state;
+    uint32_t busy_skips;
+    // Physical LED -> logical pixel; empty when the output is driven 1:1
+    std::vector<uint16_t> index_map;
+    // Fused conversion, rebuilt by the rendering task when its inputs change
+    OutputConverter converter;
+    ConverterKey converter_key;
+    placement::HotVector<uint8_t> dither_error;  // one accumulator per wire byte, kept across frames
+    DirtyRegion dither_residue;  // LEDs whose output keeps moving under dithering
+    // Incremental updates: buffer holds the last converted frame, symbols the
+    // expansion of the buffer; both drop back to a full pass when invalidated
+    bool encoded;
+    bool symbols_encoded;
+    bool synced;  // member of the sync group
 };
 
 static std::vector<RmtDriverSegment> s_segments;
 static std::mutex s_mutex;
 static rmt_sync_manager_handle_t s_sync_manager = nullptr;
 static bool s_parallel_mode_enabled = false;
+static std::vector<std::weak_ptr<const SymbolLut>> s_symbol_luts;
+// Last measured ISR cost of the bytes encoder, reference for the LUT savings estimate
+static float s_bytes_ns_per_symbol = 0.0f;
+
+static bool wants_symbol_lut(const LedSegmentConfig& seg, const ChipsetInfo* info) {
+    return !info->uses_spi && (seg.rmt_encoding == "lut" || seg.rmt_encoding == "LUT");
+}
+
+// Build the byte -> symbols table for a timing, shared by all outputs using it
+static std::shared_ptr<const SymbolLut> get_symbol_lut(const ChipsetTiming& timing) {
+    const uint32_t key = make_timing_key(timing);
+    for (auto it = s_symbol_luts.begin(); it != s_symbol_luts.end();) {
+        auto existing = it->lock();
+        if (!existing) {
+            it = s_symbol_luts.erase(it);
+            continue;
+        }
+        if (existing->timing_key == key) {
+            return existing;
+        }
+        ++it;
+    }
+
+    auto lut = std::make_shared<SymbolLut>();
+    lut->timing_key = key;
+    rmt_symbol_word_t bit0 = {};
+    bit0.duration0 = timing.t0h_ticks;
+    bit0.level0 = 1;
+    bit0.duration1 = timing.t0l_ticks;
+    bit0.level1 = 0;
+    rmt_symbol_word_t bit1 = {};
+    bit1.duration0 = timing.t1h_ticks;
+    bit1.level0 = 1;
+    bit1.duration1 = timing.t1l_ticks;
+    bit1.level1 = 0;
+    for (int value = 0; value < 256; ++value) {
+        for (int bit = 0; bit < 8; ++bit) {
+            lut->symbols[value][bit] = (value & (0x80 >> bit)) ? bit1 : bit0;
+        }
+    }
+    s_symbol_luts.push_back(lut);
+    return lut;
+}
+
+static bool ensure_symbol_buffer(RmtDriverSegment& seg, size_t symbol_count) {
+    if (seg.symbols && seg.symbol_capacity >= symbol_count) {
+        return true;
+    }
+    // Cache-line aligned, DMA-capable memory so the RMT DMA can stream it as-is
+    const size_t bytes = symbol_count * sizeof(rmt_symbol_word_t);
+    void* mem = placement::alloc(placement::MemTag::Dma, bytes, 64);
+    if (mem == nullptr) {
+        ESP_LOGE(TAG, "No memory for %u RMT symbols on GPIO %d", static_cast<unsigned>(symbol_count), seg.gpio);
+        seg.symbols.reset();
+        seg.symbol_capacity = 0;
+        return false;
+    }
+    std::memset(mem, 0, bytes);
+    seg.symbols = std::unique_ptr<rmt_symbol_word_t, DmaDeleter>(static_cast<rmt_symbol_word_t*>(mem), DmaDeleter{bytes});
+    seg.symbol_capacity = symbol_count;
+    return true;
+}
+
+// Payload handed to rmt_transmit: the byte buffer for the bytes encoder,
+// or the byte buffer expanded through the symbol LUT. Only the LEDs in
+// `changed` are expanded again while the symbols still match the buffer.
+static bool prepare_payload(RmtDriverSegment& seg, size_t buffer_size, const DirtyRegion& changed,
+                            const void** payload, size_t* payload_size) {
+    seg.frames++;
+    if (!seg.symbol_lut || !seg.lut) {
+        *payload = seg.buffer.data();
+        *payload_size = buffer_size;
+        return true;
+    }
+    const size_t symbol_count = buffer_size * 8;
+    if (!seg.symbols || seg.symbol_capacity < symbol_count) {
+        seg.symbols_encoded = false;
+    }
+    if (!ensure_symbol_buffer(seg, symbol_count)) {
+        return false;
+    }
+    const int64_t started_us = esp_timer_get_time();
+    auto expand = [&](size_t from, size_t to) {
+        const uint8_t* src = seg.buffer.data();
+        rmt_symbol_word_t* dst = seg.symbols.get() + from * 8;
+        for (size_t i = from; i < to; ++i) {
+            std::memcpy(dst, seg.lut->symbols[src[i]], sizeof(seg.lut->symbols[0]));
+            dst += 8;
+        }
+    };
+    if (seg.symbols_encoded && !changed.all()) {
+        const size_t bpp = seg.bytes_per_pixel;
+        for (const PixelSpan& span : changed) {
+            expand(std::min(buffer_size, span.start * bpp), std::min(buffer_size, (span.start + span.length) * bpp));
+        }
+    } else {
+        expand(0, buffer_size);
+    }
+    seg.symbols_encoded = true;
+    seg.preencode_us += static_cast<uint64_t>(esp_timer_get_time() - started_us);
+    *payload = seg.symbols.get();
+    *payload_size = symbol_count * sizeof(rmt_symbol_word_t);
+    return true;
+}
 
-static rmt_tx_channel_config_t make_channel_config(int gpio, bool enable_dma) {
+static rmt_tx_channel_config_t make_channel_config(int gpio, bool enable_dma, bool symbol_lut) {
     rmt_tx_channel_config_t tx_chan_config = {};
     tx_chan_config.gpio_num = static_cast<gpio_num_t>(gpio);
     tx_chan_config.clk_src = RMT_CLK_SRC_DEFAULT;
     tx_chan_config.resolution_hz = 10'000'000;  // 10MHz = 100ns per tick
-    tx_chan_config.mem_block_symbols = 64;
+    // Pre-encoded symbols are only copied, so a large DMA block cuts refill interrupts
+    tx_chan_config.mem_block_symbols = (enable_dma && symbol_lut) ? 1024 : 64;
     tx_chan_config.trans_queue_depth = 4;
     tx_chan_config.flags.with_dma = enable_dma;  // Use DMA if enabled in config
     tx_chan_config.flags.invert_out = false;
@@ -158,23 +354,30 @@ static rmt_bytes_encoder_config_t make_bytes_encoder_config(const ChipsetInfo* i
     return bytes_encoder_config;
 }
 
-static esp_err_t create_led_encoder(rmt_encoder_handle_t* ret_encoder, const ChipsetInfo* chipset_info) {
+static esp_err_t create_led_encoder(rmt_encoder_handle_t* ret_encoder, const ChipsetInfo* chipset_info, bool symbol_lut) {
     ws2812_encoder_t* encoder = (ws2812_encoder_t*)calloc(1, sizeof(ws2812_encoder_t));
     if (encoder == nullptr) {
         return ESP_ERR_NO_MEM;
     }
+    portMUX_INITIALIZE(&encoder->stats_lock);
     encoder->base.encode = ws2812_encode;
     encoder->base.del = ws2812_del;
     encoder->base.reset = ws2812_reset;
 
-    rmt_bytes_encoder_config_t bytes_encoder_config = make_bytes_encoder_config(chipset_info);
-    esp_err_t err = rmt_new_bytes_encoder(&bytes_encoder_config, &encoder->bytes_encoder);
+    esp_err_t err;
+    rmt_copy_encoder_config_t copy_encoder_config = {};
+    if (symbol_lut) {
+        // Data is already RMT symbols, the ISR only has to copy it
+        err = rmt_new_copy_encoder(&copy_encoder_config, &encoder->bytes_encoder);
+    } else {
+        rmt_bytes_encoder_config_t bytes_encoder_config = make_bytes_encoder_config(chipset_info);
+        err = rmt_new_bytes_encoder(&bytes_encoder_config, &encoder->bytes_encoder);
+    }
     if (err != ESP_OK) {
         free(encoder);
         return err;
     }
 
-    rmt_copy_encoder_config_t copy_encoder_config = {};
     err = rmt_new_copy_encoder(&copy_encoder_config, &encoder->copy_encoder);
     if (err != ESP_OK) {
         rmt_del_encoder(encoder->bytes_encoder);
@@ -194,6 +397,20 @@ static esp_err_t create_led_encoder(rmt_encoder_handle_t* ret_encoder, const Chi
     return ESP_OK;
 }
 
+// True when the converter had to be rebuilt (every pixel needs converting again)
+static bool update_converter(RmtDriverSegment& seg, float gamma_color, float gamma_white, bool apply_gamma,
+                             uint8_t level, bool dither) {
+    const ConverterKey key{true, gamma_color, gamma_white, apply_gamma, dither, level};
+    const ConverterKey& cur = seg.converter_key;
+    if (cur.valid && cur.gamma_color == key.gamma_color && cur.gamma_white == key.gamma_white &&
+        cur.apply_gamma == key.apply_gamma && cur.dither == key.dither && cur.level == key.level) {
+        return false;
+    }
+    seg.converter.configure(seg.color_order, seg.bytes_per_pixel, gamma_color, gamma_white, apply_gamma, level, dither);
+    seg.converter_key = key;
+    return true;
+}
+
 esp_err_t rmt_driver_init_segment(const LedSegmentConfig& seg, bool enable_dma) {
     std::lock_guard<std::mutex> lock(s_mutex);
     
@@ -218,9 +435,15 @@ esp_err_t rmt_driver_init_segment(const LedSegmentConfig& seg, bool enable_dma)
     // Use chipset default color order if not specified
     driver_seg.color_order = seg.color_order.empty() ? chipset_info->default_color_order : seg.color_order;
     driver_seg.initialized = false;
+    driver_seg.symbol_lut = wants_symbol_lut(seg, chipset_info);
+    driver_seg.tx_state = std::make_unique<TxState>();
+    driver_seg.converter_key.valid = false;
+    driver_seg.encoded = false;
+    driver_seg.symbols_encoded = false;
+    driver_seg.synced = false;
 
     // Create RMT channel (ESP-IDF 5.x doesn't use channel numbers, each channel is independent)
-    rmt_tx_channel_config_t tx_chan_config = make_channel_config(seg.gpio, enable_dma);
+    rmt_tx_channel_config_t tx_chan_config = make_channel_config(seg.gpio, enable_dma, driver_seg.symbol_lut);
     esp_err_t err = rmt_new_tx_channel(&tx_chan_config, &driver_seg.channel);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to create RMT channel for GPIO %d: %s", seg.gpio, esp_err_to_name(err));
@@ -228,13 +451,26 @@ esp_err_t rmt_driver_init_segment(const LedSegmentConfig& seg, bool enable_dma)
     }
 
     // Create encoder with chipset-specific timing
-    err = create_led_encoder(&driver_seg.encoder, chipset_info);
+    err = create_led_encoder(&driver_seg.encoder, chipset_info, driver_seg.symbol_lut);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to create encoder for GPIO %d: %s", seg.gpio, esp_err_to_name(err));
         rmt_del_channel(driver_seg.channel);
         return err;
     }
 
+    // Track transfers in flight. Without it the busy check would always pass
+    // and the next frame could rewrite the symbol buffer under the DMA, so an
+    // output that cannot report completions is not brought up
+    rmt_tx_event_callbacks_t tx_callbacks = {};
+    tx_callbacks.on_trans_done = on_tx_done;
+    err = rmt_tx_register_event_callbacks(driver_seg.channel, &tx_callbacks, driver_seg.tx_state.get());
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register TX callback for GPIO %d: %s", seg.gpio, esp_err_to_name(err));
+        rmt_del_encoder(driver_seg.encoder);
+        rmt_del_channel(driver_seg.channel);
+        return err;
+    }
+
     // Enable channel
     err = rmt_enable(driver_seg.channel);
     if (err != ESP_OK) {
@@ -246,20 +482,34 @@ esp_err_t rmt_driver_init_segment(const LedSegmentConfig& seg, bool enable_dma)
 
     // Allocate buffer for full segment (RGB or RGBW)
     driver_seg.buffer.resize(seg.led_count * driver_seg.bytes_per_pixel);
+    if (driver_seg.symbol_lut) {
+        driver_seg.lut = get_symbol_lut(chipset_info->timing);
+        ensure_symbol_buffer(driver_seg, driver_seg.buffer.size() * 8);
+    }
     driver_seg.initialized = true;
 
+    ESP_LOGI(TAG, "RMT driver initialized: GPIO %d, chipset %s, color_order %s, LEDs %u, encoding %s",
+             seg.gpio, driver_seg.chipset.c_str(), driver_seg.color_order.c_str(), seg.led_count,
+             driver_seg.symbol_lut ? "lut" : "bytes");
+
     if (it != s_segments.end()) {
-        *it = driver_seg;
+        *it = std::move(driver_seg);
     } else {
-        s_segments.push_back(driver_seg);
+        s_segments.push_back(std::move(driver_seg));
     }
-
-    ESP_LOGI(TAG, "RMT driver initialized: GPIO %d, chipset %s, color_order %s, LEDs %u",
-             seg.gpio, driver_seg.chipset.c_str(), driver_seg.color_order.c_str(), seg.led_count);
     return ESP_OK;
 }
 
 esp_err_t rmt_driver_render(const LedSegmentConfig& seg, const std::vector<uint8_t>& rgb, size_t start, size_t length) {
+    // Input is always RGB (3 bytes per pixel)
+    if (rgb.size() < (start + length) * 3) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return rmt_driver_render_pixels(seg, rgb.data() + start * 3, start, length);
+}
+
+esp_err_t rmt_driver_render_pixels(const LedSegmentConfig& seg, const uint8_t* rgb, size_t start, size_t length,
+                                   uint8_t level, PixelFormat format, const DirtyRegion* dirty) {
     // Minimize mutex lock time - only for lookup
     RmtDriverSegment* driver_seg = nullptr;
     {
@@ -272,10 +522,9 @@ esp_err_t rmt_driver_render(const LedSegmentConfig& seg, const std::vector<uint8
         driver_seg = &(*it);  // Store pointer, mutex released after this block
     }
     
-    // Input is always RGB (3 bytes per pixel)
-    const uint8_t input_bytes_per_pixel = 3;
-    if (rgb.size() < (start + length) * input_bytes_per_pixel) {
-        return ESP_ERR_INVALID_SIZE;
+    const uint8_t input_bytes_per_pixel = pixel_format_bytes(format);
+    if (rgb == nullptr || (driver_seg->index_map.empty() && start >= seg.led_count)) {
+        return ESP_ERR_INVALID_ARG;
     }
 
     // Ensure buffer is large enough for full segment (RGB or RGBW)
@@ -285,44 +534,120 @@ esp_err_t rmt_driver_render(const LedSegmentConfig& seg, const std::vector<uint8
         if (driver_seg->buffer.size() < buffer_size) {
             driver_seg->buffer.resize(buffer_size, 0);
         }
+        if (seg.dither && driver_seg->dither_error.size() < buffer_size) {
+            driver_seg->dither_error.resize(buffer_size, 0);
+        }
+        if (driver_seg->index_map.empty()) {
+            driver_seg->scratch.resize(std::min(length, seg.led_count - start) * driver_seg->bytes_per_pixel);
+        }
     }
 
     // Process pixels with color processing pipeline (outside mutex for performance)
     const size_t pixel_count = std::min(length, seg.led_count - start);
-    const uint8_t* src = rgb.data() + start * input_bytes_per_pixel;
+    const uint8_t* src = rgb;
     
     // Get gamma values from segment config (default to 2.2 if not set)
-    float gamma_color = seg.gamma_color > 0.0f ? seg.gamma_color : 2.2f;
-    float gamma_brightness = seg.gamma_brightness > 0.0f ? seg.gamma_brightness : 2.2f;
-    bool apply_gamma_flag = seg.apply_gamma;
-    
-    // Process pixels to temporary buffer (no mutex needed)
-    std::vector<uint8_t> temp_buffer(pixel_count * driver_seg->bytes_per_pixel);
-    for (size_t i = 0; i < pixel_count; ++i) {
-        process_pixel(src + i * input_bytes_per_pixel, 
-                     temp_buffer.data() + i * driver_seg->bytes_per_pixel,
-                     driver_seg->color_order,
-                     driver_seg->bytes_per_pixel,
-                     gamma_color,
-                     gamma_brightness,
-                     apply_gamma_flag);
+    const float gamma_color = seg.gamma_color > 0.0f ? seg.gamma_color : 2.2f;
+    const float gamma_brightness = seg.gamma_brightness > 0.0f ? seg.gamma_brightness : 2.2f;
+    const bool rebuilt = update_converter(*driver_seg, gamma_color, gamma_brightness, seg.apply_gamma, level, seg.dither);
+    const OutputConverter& converter = driver_seg->converter;
+    uint8_t* error = converter.dither ? driver_seg->dither_error.data() : nullptr;
+    // Untouched spans keep their encoded bytes from the previous frame, unless the
+    // converter changed or the output is mapped; dithered LEDs that left a
+    // residue are converted again with the changed spans
+    const bool incremental = dirty != nullptr && !dirty->all() && !rebuilt && driver_seg->encoded &&
+                             driver_seg->index_map.empty();
+    const size_t end = start + pixel_count;
+    DirtyRegion changed;
+    if (incremental) {
+        // dirty is relative to rgb[0]; changed is in buffer LEDs
+        DirtyRegion moving;
+        for (const PixelSpan& span : driver_seg->dither_residue.slice(start, end)) {
+            moving.add(start + span.start, span.length);
+        }
+        for (const PixelSpan& span : dirty->slice(0, pixel_count)) {
+            changed.add(start + span.start, span.length);
+        }
+        changed = pending_conversion(changed, moving);
+    } else {
+        changed.mark_all();
+    }
+    // Residue outside this call's range stands; inside it is found again below
+    DirtyRegion residue;
+    if (converter.dither) {
+        for (const PixelSpan& span : driver_seg->dither_residue.slice(0, start)) {
+            residue.add(span.start, span.length);
+        }
+        for (const PixelSpan& span : driver_seg->dither_residue.slice(end, UINT16_MAX)) {
+            residue.add(end + span.start, span.length);
+        }
     }
     
-    // Copy to segment buffer and send (minimal mutex time)
-    {
+    if (incremental) {
+        // Convert only the dirty spans into their place in scratch, then copy them over
+        const size_t bpp = driver_seg->bytes_per_pixel;
+        auto& temp_buffer = driver_seg->scratch;
+        for (const PixelSpan& span : changed) {
+            const size_t rel = span.start - start;
+            converter.convert_span(format, src + rel * input_bytes_per_pixel, temp_buffer.data() + rel * bpp,
+                                   error != nullptr ? error + span.start * bpp : nullptr, span.length, &residue,
+                                   span.start);
+        }
         std::lock_guard<std::mutex> lock(s_mutex);
-        // Verify segment still exists and is initialized
         auto it = std::find_if(s_segments.begin(), s_segments.end(),
                               [&](const RmtDriverSegment& s) { return s.gpio == seg.gpio && s.rmt_channel == seg.rmt_channel; });
         if (it == s_segments.end() || !it->initialized) {
             return ESP_ERR_INVALID_STATE;
         }
+        for (const PixelSpan& span : changed) {
+            const size_t rel = span.start - start;
+            std::memcpy(it->buffer.data() + span.start * bpp, temp_buffer.data() + rel * bpp, span.length * bpp);
+        }
+    } else if (!driver_seg->index_map.empty()) {
+        // Logical span: expand through the layout map straight into the output buffer
+        const size_t logical_end = start + length;
+        const size_t bpp = driver_seg->bytes_per_pixel;
+        const size_t leds = std::min(driver_seg->index_map.size(), static_cast<size_t>(seg.led_count));
+        uint8_t* dst = driver_seg->buffer.data();
+        for (size_t led = 0; led < leds; ++led) {
+            const uint16_t logical = driver_seg->index_map[led];
+            if (logical == kLayoutDarkPixel) {
+                std::memset(dst + led * bpp, 0, bpp);
+                continue;
+            }
+            if (logical < start || logical >= logical_end) {
+                continue;
+            }
+            if (converter.convert(format, src + (logical - start) * input_bytes_per_pixel, dst + led * bpp,
+                                  error != nullptr ? error + led * bpp : nullptr)) {
+                residue.add(led, 1);
+            }
+        }
+    } else {
+        // Process pixels to temporary buffer (no mutex needed)
+        auto& temp_buffer = driver_seg->scratch;
+        converter.convert_span(format, src, temp_buffer.data(),
+                               error != nullptr ? error + start * driver_seg->bytes_per_pixel : nullptr,
+                               pixel_count, &residue, start);
+    
+        // Copy to segment buffer and send (minimal mutex time)
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            // Verify segment still exists and is initialized
+            auto it = std::find_if(s_segments.begin(), s_segments.end(),
+                                  [&](const RmtDriverSegment& s) { return s.gpio == seg.gpio && s.rmt_channel == seg.rmt_channel; });
+            if (it == s_segments.end() || !it->initialized) {
+                return ESP_ERR_INVALID_STATE;
+            }
         
-        // Copy processed pixels to segment buffer
-        std::memcpy(it->buffer.data() + start * it->bytes_per_pixel, 
-                   temp_buffer.data(), 
-                   temp_buffer.size());
+            // Copy processed pixels to segment buffer
+            std::memcpy(it->buffer.data() + start * it->bytes_per_pixel, 
+                       temp_buffer.data(), 
+                       temp_buffer.size());
+        }
     }
+    driver_seg->encoded = true;
+    driver_seg->dither_residue = residue;
     
     // Send via RMT (non-blocking, doesn't need mutex)
     rmt_transmit_config_t tx_config = {};
@@ -332,7 +657,9 @@ esp_err_t rmt_driver_render(const LedSegmentConfig& seg, const std::vector<uint8
     // Need to get channel/encoder pointer (minimal lock)
     rmt_channel_handle_t channel;
     rmt_encoder_handle_t encoder;
-    uint8_t* buffer_ptr;
+    TxState* tx_state;
+    const void* payload = nullptr;
+    size_t payload_size = 0;
     {
         std::lock_guard<std::mutex> lock(s_mutex);
         auto it = std::find_if(s_segments.begin(), s_segments.end(),
@@ -340,13 +667,24 @@ esp_err_t rmt_driver_render(const LedSegmentConfig& seg, const std::vector<uint8
         if (it == s_segments.end() || !it->initialized) {
             return ESP_ERR_INVALID_STATE;
         }
+        // Previous frame still on the wire: keep the pixels, the next frame sends them
+        if (it->tx_state->pending.load(std::memory_order_acquire) > 0) {
+            it->busy_skips++;
+            it->symbols_encoded = false;  // buffer moved on without its symbols
+            return ESP_OK;
+        }
+        if (!prepare_payload(*it, buffer_size, changed, &payload, &payload_size)) {
+            return ESP_ERR_NO_MEM;
+        }
         channel = it->channel;
         encoder = it->encoder;
-        buffer_ptr = it->buffer.data();
+        tx_state = it->tx_state.get();
     }
 
-    esp_err_t err = rmt_transmit(channel, encoder, buffer_ptr, buffer_size, &tx_config);
+    tx_state->queued();
+    esp_err_t err = rmt_transmit(channel, encoder, payload, payload_size, &tx_config);
     if (err != ESP_OK) {
+        tx_state->dropped();
         ESP_LOGW(TAG, "RMT transmit failed for GPIO %d: %s", seg.gpio, esp_err_to_name(err));
         return err;
     }
@@ -366,6 +704,8 @@ esp_err_t rmt_driver_deinit_segment(int gpio, uint8_t rmt_channel) {
     rmt_disable(it->channel);
     rmt_del_encoder(it->encoder);
     rmt_del_channel(it->channel);
+    it->symbols.reset();
+    it->symbol_capacity = 0;
     it->initialized = false;
 
     ESP_LOGI(TAG, "RMT driver deinitialized: GPIO %d", gpio);
@@ -409,6 +749,7 @@ esp_err_t rmt_driver_init_parallel_mode(const std::vector<const LedSegmentConfig
     
     // Collect channels for sync manager
     std::vector<rmt_channel_handle_t> channels;
+    std::vector<RmtDriverSegment*> members;
     for (const auto* seg : segments) {
         auto it = std::find_if(s_segments.begin(), s_segments.end(),
                               [&](const RmtDriverSegment& s) { 
@@ -419,6 +760,7 @@ esp_err_t rmt_driver_init_parallel_mode(const std::vector<const LedSegmentConfig
             return ESP_ERR_INVALID_STATE;
         }
         channels.push_back(it->channel);
+        members.push_back(&(*it));
     }
     
     // Create sync manager
@@ -432,91 +774,99 @@ esp_err_t rmt_driver_init_parallel_mode(const std::vector<const LedSegmentConfig
         return err;
     }
     
+    for (RmtDriverSegment* member : members) {
+        member->synced = true;
+    }
     s_parallel_mode_enabled = true;
     ESP_LOGI(TAG, "Parallel IO mode initialized with %zu channels", channels.size());
     return ESP_OK;
 }
 
-// Render to multiple segments in parallel (simultaneous transmission)
-esp_err_t rmt_driver_render_parallel(const std::vector<ParallelRenderRequest>& requests) {
-    if (!s_parallel_mode_enabled || !s_sync_manager) {
-        return ESP_ERR_INVALID_STATE;
+void rmt_driver_get_stats(std::vector<RmtDriverStats>& out) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    out.clear();
+
+    // Reference ISR cost per symbol from outputs still running the bytes encoder
+    uint64_t bytes_isr_us = 0;
+    uint64_t bytes_symbols = 0;
+    for (const auto& seg : s_segments) {
+        if (seg.initialized && !seg.symbol_lut) {
+            uint64_t isr_us = 0;
+            uint64_t isr_symbols = 0;
+            read_encoder_stats(__containerof(seg.encoder, ws2812_encoder_t, base), isr_us, isr_symbols);
+            bytes_isr_us += isr_us;
+            bytes_symbols += isr_symbols;
+        }
     }
-    
-    if (requests.empty() || requests.size() > 4) {
-        return ESP_ERR_INVALID_ARG;
+    if (bytes_symbols > 0) {
+        s_bytes_ns_per_symbol = static_cast<float>(bytes_isr_us) * 1000.0f / static_cast<float>(bytes_symbols);
     }
-    
-    // Prepare all channels first (outside sync)
-    std::vector<rmt_channel_handle_t> channels;
-    std::vector<rmt_encoder_handle_t> encoders;
-    std::vector<uint8_t*> buffers;
-    std::vector<size_t> buffer_sizes;
-    
-    {
-        std::lock_guard<std::mutex> lock(s_mutex);
-        for (const auto& req : requests) {
-            auto it = std::find_if(s_segments.begin(), s_segments.end(),
-                                  [&](const RmtDriverSegment& s) { 
-                                      return s.gpio == req.segment->gpio && 
-                                             s.rmt_channel == req.segment->rmt_channel; 
-                                  });
-            if (it == s_segments.end() || !it->initialized) {
-                ESP_LOGE(TAG, "Segment GPIO %d not found for parallel render", req.segment->gpio);
-                return ESP_ERR_INVALID_STATE;
-            }
-            
-            // Process pixels (same as single render)
-            const size_t pixel_count = std::min(req.length, req.segment->led_count - req.start);
-            const uint8_t input_bytes_per_pixel = 3;
-            const uint8_t* src = req.rgb.data() + req.start * input_bytes_per_pixel;
-            
-            float gamma_color = req.segment->gamma_color > 0.0f ? req.segment->gamma_color : 2.2f;
-            float gamma_brightness = req.segment->gamma_brightness > 0.0f ? req.segment->gamma_brightness : 2.2f;
-            bool apply_gamma_flag = req.segment->apply_gamma;
-            
-            const size_t buffer_size = req.segment->led_count * it->bytes_per_pixel;
-            if (it->buffer.size() < buffer_size) {
-                it->buffer.resize(buffer_size, 0);
-            }
-            
-            // Process pixels to segment buffer
-            for (size_t i = 0; i < pixel_count; ++i) {
-                process_pixel(src + i * input_bytes_per_pixel,
-                             it->buffer.data() + (req.start + i) * it->bytes_per_pixel,
-                             it->color_order,
-                             it->bytes_per_pixel,
-                             gamma_color,
-                             gamma_brightness,
-                             apply_gamma_flag);
-            }
-            
-            channels.push_back(it->channel);
-            encoders.push_back(it->encoder);
-            buffers.push_back(it->buffer.data());
-            buffer_sizes.push_back(buffer_size);
+
+    for (const auto& seg : s_segments) {
+        if (!seg.initialized) {
+            continue;
+        }
+        RmtDriverStats stats{};
+        read_encoder_stats(__containerof(seg.encoder, ws2812_encoder_t, base), stats.isr_encode_us, stats.symbols);
+        stats.gpio = seg.gpio;
+        stats.rmt_channel = seg.rmt_channel;
+        stats.symbol_lut = seg.symbol_lut;
+        stats.frames = seg.frames;
+        stats.preencode_us = seg.preencode_us;
+        stats.busy_skips = seg.busy_skips;
+        if (seg.symbol_lut && s_bytes_ns_per_symbol > 0.0f) {
+            const double bytes_cost_us = static_cast<double>(stats.symbols) * s_bytes_ns_per_symbol / 1000.0;
+            stats.isr_saved_us = bytes_cost_us > stats.isr_encode_us
+                                     ? static_cast<uint64_t>(bytes_cost_us) - stats.isr_encode_us
+                                     : 0;
         }
+        out.push_back(stats);
     }
-    
-    // Reset sync manager before parallel transmission
-    esp_err_t err = rmt_sync_reset(s_sync_manager);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Sync reset failed: %s", esp_err_to_name(err));
+}
+
+bool rmt_driver_output_busy(int gpio, uint8_t rmt_channel) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = std::find_if(s_segments.begin(), s_segments.end(),
+                          [&](const RmtDriverSegment& s) { return s.gpio == gpio && s.rmt_channel == rmt_channel; });
+    if (it == s_segments.end() || !it->initialized) {
+        return false;
     }
-    
-    // Transmit on all channels (they will sync automatically)
-    rmt_transmit_config_t tx_config = {};
-    tx_config.loop_count = 0;
-    tx_config.flags.eot_level = 0;
-    
-    for (size_t i = 0; i < channels.size(); ++i) {
-        err = rmt_transmit(channels[i], encoders[i], buffers[i], buffer_sizes[i], &tx_config);
-        if (err != ESP_OK) {
-            ESP_LOGW(TAG, "Parallel RMT transmit failed for channel %zu: %s", i, esp_err_to_name(err));
-            // Continue with other channels
-        }
+    return it->tx_state->pending.load(std::memory_order_acquire) > 0;
+}
+
+bool rmt_driver_dither_settled(int gpio, uint8_t rmt_channel) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = std::find_if(s_segments.begin(), s_segments.end(),
+                          [&](const RmtDriverSegment& s) { return s.gpio == gpio && s.rmt_channel == rmt_channel; });
+    if (it == s_segments.end() || !it->initialized) {
+        return true;
     }
-    
-    return ESP_OK;
+    return it->dither_residue.empty();
 }
 
+bool rmt_driver_in_sync_group(int gpio, uint8_t rmt_channel) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = std::find_if(s_segments.begin(), s_segments.end(),
+                          [&](const RmtDriverSegment& s) { return s.gpio == gpio && s.rmt_channel == rmt_channel; });
+    return it != s_segments.end() && it->initialized && it->synced;
+}
+
+esp_err_t rmt_driver_sync_reset() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (!s_sync_manager) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return rmt_sync_reset(s_sync_manager);
+}
+
+esp_err_t rmt_driver_set_index_map(const LedSegmentConfig& seg, std::vector<uint16_t> index_map) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = std::find_if(s_segments.begin(), s_segments.end(),
+                          [&](const RmtDriverSegment& s) { return s.gpio == seg.gpio && s.rmt_channel == seg.rmt_channel; });
+    if (it == s_segments.end() || !it->initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    it->index_map = std::move(index_map);
+    it->encoded = false;
+    return ESP_OK;
+}
@@ -0,0 +1,108 @@
+#include "led_engine/segment_layout.hpp"
+#include "led_engine/matrix_utils.hpp"
+#include "led_engine/chipset_info.hpp"
+#include <algorithm>
+
+namespace {
+
+uint16_t group_period(const LedSegmentConfig& seg) {
+    return static_cast<uint16_t>(std::max<uint16_t>(seg.grouping, 1) + seg.spacing);
+}
+
+// LEDs the effect spans before grouping: mirrored segments repeat the first half
+uint16_t mirrored_span(const LedSegmentConfig& seg) {
+    return seg.mirror ? static_cast<uint16_t>((seg.led_count + 1) / 2) : seg.led_count;
+}
+
+// Serpentine/vertical wiring order -> row-major panel raster
+std::vector<uint16_t> build_matrix_map(const LedSegmentConfig& seg) {
+    std::vector<uint16_t> map;
+    const LedMatrixConfig& matrix = seg.matrix;
+    if (!matrix.serpentine && !matrix.vertical) {
+        return map;  // wiring already row-major
+    }
+    const uint16_t panel = matrix_total_leds(matrix);
+    map.resize(seg.led_count, kLayoutDarkPixel);
+    for (uint16_t led = 0; led < seg.led_count && led < panel; ++led) {
+        uint16_t x = 0;
+        uint16_t y = 0;
+        matrix_index_to_coords(led, &x, &y, matrix);
+        map[led] = static_cast<uint16_t>(y * matrix.width + x);
+    }
+    return map;
+}
+
+}  // namespace
+
+bool segment_uses_matrix_transform(const LedSegmentConfig& seg) {
+    return seg.matrix_enabled && matrix_has_transform(seg.matrix);
+}
+
+PixelFormat segment_pixel_format(const LedSegmentConfig& seg) {
+    if (segment_uses_matrix_transform(seg)) {
+        return PixelFormat::Rgb888;
+    }
+    if (seg.pixel_format == "rgb888") {
+        return PixelFormat::Rgb888;
+    }
+    if (seg.pixel_format == "rgbw8888") {
+        return PixelFormat::Rgbw8888;
+    }
+    if (seg.pixel_format == "rgb16") {
+        return PixelFormat::Rgb16;
+    }
+    return chipset_supports_rgbw(seg.chipset) ? PixelFormat::Rgbw8888 : PixelFormat::Rgb888;
+}
+
+bool segment_layout_is_identity(const LedSegmentConfig& seg) {
+    if (segment_uses_matrix_transform(seg)) {
+        return false;
+    }
+    return seg.grouping <= 1 && seg.spacing == 0 && !seg.mirror && !seg.reverse;
+}
+
+uint16_t segment_logical_count(const LedSegmentConfig& seg) {
+    if (segment_uses_matrix_transform(seg)) {
+        uint16_t canvas_w = 0;
+        uint16_t canvas_h = 0;
+        matrix_canvas_size(seg.matrix, &canvas_w, &canvas_h);
+        return static_cast<uint16_t>(canvas_w * canvas_h);
+    }
+    const uint16_t span = mirrored_span(seg);
+    if (span == 0) {
+        return 0;
+    }
+    const uint16_t period = group_period(seg);
+    return static_cast<uint16_t>((span + period - 1) / period);
+}
+
+std::vector<uint16_t> segment_build_index_map(const LedSegmentConfig& seg) {
+    if (segment_uses_matrix_transform(seg)) {
+        return build_matrix_map(seg);
+    }
+    std::vector<uint16_t> map;
+    if (segment_layout_is_identity(seg)) {
+        return map;
+    }
+
+    const uint16_t count = seg.led_count;
+    const uint16_t span = mirrored_span(seg);
+    const uint16_t period = group_period(seg);
+    const uint16_t grouping = std::max<uint16_t>(seg.grouping, 1);
+    const uint16_t logical = segment_logical_count(seg);
+
+    map.resize(count, kLayoutDarkPixel);
+    for (uint16_t led = 0; led < count; ++led) {
+        // Fold the second half back onto the first for mirrored segments
+        const uint16_t pos = (seg.mirror && led >= span) ? static_cast<uint16_t>(count - 1 - led) : led;
+        if (pos % period >= grouping) {
+            continue;  // spacing LED stays dark
+        }
+        uint16_t index = static_cast<uint16_t>(pos / period);
+        if (seg.reverse) {
+            index = static_cast<uint16_t>(logical - 1 - index);
+        }
+        map[led] = index;
+    }
+    return map;
+}
@@ -0,0 +1,333 @@
+#include "audio_analyzer.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "dsps_fft2r.h"
+#include "dsps_wind.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+static const char* TAG = "audio-analyzer";
+
+struct BandSpec {
+  float f_low;
+  float f_high;
+  float gain;  // lower bands carry less energy per bin
+};
+
+// Published as AudioMetrics::sub_bands, in AudioBand order
+constexpr BandSpec kSubBandSpecs[AudioAnalyzer::kSubBands] = {
+    {20.0f, 60.0f, 6.0f},      {60.0f, 120.0f, 5.0f},     {120.0f, 250.0f, 4.0f},
+    {250.0f, 500.0f, 3.0f},    {500.0f, 1000.0f, 2.8f},   {1000.0f, 2000.0f, 2.5f},
+    {2000.0f, 4000.0f, 2.2f},  {4000.0f, 8000.0f, 2.0f},  {8000.0f, 12000.0f, 1.8f},
+};
+
+constexpr float kTwoPi = 6.28318530718f;
+
+// Dynamic limiter
+constexpr float kLimiterThreshold = 0.85f;  // level above which to compress
+constexpr float kLimiterRatio = 4.0f;       // 4:1
+constexpr float kLimiterAttack = 0.95f;     // fast response to peaks
+constexpr float kLimiterRelease = 0.98f;    // slow recovery
+
+// Mono mix, windowed, packed as N/2 complex points (even samples real, odd
+// imaginary) for the half-size FFT. Processing 4-8 samples per iteration lets
+// the compiler pack the int16 -> float conversion and the multiplies into
+// Xai/SIMD operations.
+size_t load_windowed(const int16_t* pcm, size_t samples, bool stereo, const float* window, float* fft,
+                     size_t fft_size) {
+  const float scale = 1.0f / 32768.0f;
+  size_t count = 0;
+  if (stereo) {
+    const size_t frames = std::min(samples / 2, fft_size);
+    const float half_scale = scale * 0.5f;
+    for (; count + 4 <= frames; count += 4) {
+      #pragma GCC unroll 4
+      for (size_t j = 0; j < 4; ++j) {
+        const size_t idx = count + j;
+        const float mono = static_cast<float>(pcm[idx * 2] + pcm[idx * 2 + 1]) * half_scale;
+        fft[idx] = mono * window[idx];
+      }
+    }
+    for (; count < frames; ++count) {
+      fft[count] = static_cast<float>(pcm[count * 2] + pcm[count * 2 + 1]) * half_scale * window[count];
+    }
+  } else {
+    const size_t frames = std::min(samples, fft_size);
+    for (; count + 8 <= frames; count += 8) {
+      #pragma GCC unroll 8
+      for (size_t j = 0; j < 8; ++j) {
+        const size_t idx = count + j;
+        fft[idx] = static_cast<float>(pcm[idx]) * scale * window[idx];
+      }
+    }
+    for (; count < frames; ++count) {
+      fft[count] = static_cast<float>(pcm[count]) * scale * window[count];
+    }
+  }
+  // Zero-pad a short frame
+  std::fill(fft + count, fft + fft_size, 0.0f);
+  return count;
+}
+
+// Mean square per channel over `frames` frames
+void channel_energy(const int16_t* pcm, size_t frames, bool stereo, float& energy_l, float& energy_r) {
+  const float scale = 1.0f / 32768.0f;
+  float acc_l = 0.0f;
+  float acc_r = 0.0f;
+  if (stereo) {
+    #pragma GCC unroll 4
+    for (size_t i = 0; i < frames; ++i) {
+      const float l = static_cast<float>(pcm[i * 2]) * scale;
+      const float r = static_cast<float>(pcm[i * 2 + 1]) * scale;
+      acc_l += l * l;
+      acc_r += r * r;
+    }
+  } else {
+    #pragma GCC unroll 8
+    for (size_t i = 0; i < frames; ++i) {
+      const float sample = static_cast<float>(pcm[i]) * scale;
+      acc_l += sample * sample;
+    }
+    acc_r = acc_l;
+  }
+  const float n = static_cast<float>(std::max<size_t>(1, frames));
+  energy_l = acc_l / n;
+  energy_r = acc_r / n;
+}
+
+}  // namespace
+
+void AudioAnalyzer::configure(size_t fft_size, size_t hop, uint32_t sample_rate, AudioScale scale,
+                              size_t bands) {
+  size_t n = kMinFftSize;
+  while (n * 2 <= std::min(fft_size, kMaxFftSize)) {
+    n <<= 1;
+  }
+  const size_t previous_hop = hop_;
+  hop_ = std::clamp<size_t>(hop, 1, n);
+  bands = audio_filterbank_bands(bands);
+  const bool filterbank_changed = scale != scale_ || bands != bands_;
+  scale_ = scale;
+  bands_ = bands;
+  if (sample_rate == 0) {
+    return;
+  }
+  if (n == fft_size_ && sample_rate == sample_rate_) {
+    // Same transform; the beat tracker counts in hops
+    if (hop_ != previous_hop) {
+      beat_.configure(n / 2, sample_rate, hop_);
+    }
+    if (filterbank_changed) {
+      configure_filterbank();
+    }
+    return;
+  }
+  const size_t half = n / 2;
+
+  window_.resize(n);
+  dsps_wind_hann_f32(window_.data(), static_cast<int>(n));
+  fft_.assign(n, 0.0f);
+  magnitude_.assign(half, 0.0f);
+
+  // Split twiddles e^(-2 pi i k / N) that turn the N/2-point transform of the
+  // packed input into bins 0..N/2-1 of the real N-point transform
+  split_.resize(n);
+  for (size_t k = 0; k < half; ++k) {
+    const float phase = kTwoPi * static_cast<float>(k) / static_cast<float>(n);
+    split_[k * 2] = cosf(phase);
+    split_[k * 2 + 1] = sinf(phase);
+  }
+
+  // esp-dsp keeps a single global twiddle table; point it at ours
+  twiddles_.resize(half);
+  dsps_fft2r_deinit_fc32();
+  if (dsps_fft2r_init_fc32(twiddles_.data(), static_cast<int>(half)) != ESP_OK) {
+    ESP_LOGE(TAG, "FFT init failed (size %u)", static_cast<unsigned>(n));
+    fft_size_ = 0;
+    return;
+  }
+  fft_size_ = n;
+  sample_rate_ = sample_rate;
+
+  for (size_t i = 0; i < kSubBands; ++i) {
+    sub_bands_[i] = make_range(kSubBandSpecs[i].f_low, kSubBandSpecs[i].f_high, kSubBandSpecs[i].gain);
+  }
+
+  configure_filterbank();
+  beat_.configure(half, sample_rate, hop_);
+
+  ESP_LOGI(TAG, "Analyzer configured: FFT %u @ %u Hz (%.1f Hz/bin), hop %u", static_cast<unsigned>(n),
+           static_cast<unsigned>(sample_rate), static_cast<double>(sample_rate) / static_cast<double>(n),
+           static_cast<unsigned>(hop_));
+}
+
+// GEQ filterbank on the current bins; lower bands carry less energy per bin,
+// so their weights are boosted
+void AudioAnalyzer::configure_filterbank() {
+  filterbank_.configure(scale_, bands_, magnitude_.size(), sample_rate_);
+  for (size_t i = 0; i < filterbank_.bands(); ++i) {
+    const float center = audio_filterbank_center(scale_, filterbank_.bands(), static_cast<int>(i));
+    filterbank_.set_gain(i, 1.0f + (center < 200.0f ? 4.0f : (center < 1000.0f ? 2.0f : 1.0f)));
+  }
+}
+
+AudioAnalyzer::BandRange AudioAnalyzer::make_range(float f_low, float f_high, float gain) const {
+  const float bin_hz = static_cast<float>(sample_rate_) / static_cast<float>(fft_size_);
+  const size_t last = magnitude_.size() - 1;
+  const size_t i_low = std::min(static_cast<size_t>(f_low / bin_hz), last);
+  const size_t i_high = std::min(static_cast<size_t>(f_high / bin_hz), last);
+  BandRange band{};
+  // A band that resolves to the DC bin alone stays empty
+  if (i_low <= i_high && i_high > 0) {
+    band.first = static_cast<uint16_t>(i_low);
+    band.count = static_cast<uint16_t>(i_high - i_low + 1);
+    band.scale = gain / static_cast<float>(band.count);
+  }
+  return band;
+}
+
+// Unrolled so the compiler can keep several partial sums in SIMD lanes
+float AudioAnalyzer::accumulate(const BandRange& band) const {
+  const float* magnitude = magnitude_.data() + band.first;
+  float acc = 0.0f;
+  size_t i = 0;
+  for (; i + 8 <= band.count; i += 8) {
+    #pragma GCC unroll 8
+    for (size_t j = 0; j < 8; ++j) {
+      acc += magnitude[i + j];
+    }
+  }
+  for (; i < band.count; ++i) {
+    acc += magnitude[i];
+  }
+  return acc * band.scale;
+}
+
+void AudioAnalyzer::process(const int16_t* pcm, size_t samples, bool stereo, uint64_t play_us) {
+  if (!configured() || !pcm || samples == 0) {
+    return;
+  }
+  const size_t n = fft_size_;
+  const size_t half = n / 2;
+  const size_t count = load_windowed(pcm, samples, stereo, window_.data(), fft_.data(), n);
+
+  dsps_fft2r_fc32(fft_.data(), static_cast<int>(half));
+  dsps_bit_rev_fc32(fft_.data(), static_cast<int>(half));
+
+  // Split: with Z the packed transform, E = Z[k] + conj(Z[N/2-k]) and
+  // O = -i (Z[k] - conj(Z[N/2-k])) are twice the even/odd half transforms, so
+  // E + W^k O is 2 X[k]; 2/N is the single-sided amplitude scale.
+  const float norm = 1.0f / static_cast<float>(n);
+  const float* z = fft_.data();
+  const float* w = split_.data();
+  float* magnitude = magnitude_.data();
+  #pragma GCC unroll 4
+  for (size_t k = 0; k < half; ++k) {
+    const size_t m = (half - k) & (half - 1);
+    const float ar = z[k * 2];
+    const float ai = z[k * 2 + 1];
+    const float br = z[m * 2];
+    const float bi = z[m * 2 + 1];
+    const float er = ar + br;
+    const float ei = ai - bi;
+    const float orr = ai + bi;
+    const float oi = br - ar;
+    const float c = w[k * 2];
+    const float s = w[k * 2 + 1];
+    const float xr = er + c * orr + s * oi;
+    const float xi = ei + c * oi - s * orr;
+    magnitude[k] = sqrtf(xr * xr + xi * xi) * norm;
+  }
+
+  // Levels follow the newest hop only, so they react at the analysis rate
+  // whatever the window length
+  const size_t fresh = std::min(hop_, count);
+  const size_t channels = stereo ? 2 : 1;
+  float energy_l = 0.0f;
+  float energy_r = 0.0f;
+  channel_energy(pcm + (count - fresh) * channels, fresh, stereo, energy_l, energy_r);
+
+  AudioMetrics metrics{};
+  metrics.energy = std::min(1.0f, sqrtf(energy_l + energy_r));
+  metrics.energy_left = std::min(1.0f, sqrtf(energy_l));
+  metrics.energy_right = std::min(1.0f, sqrtf(energy_r));
+
+  float sub[kSubBands];
+  for (size_t i = 0; i < kSubBands; ++i) {
+    sub[i] = accumulate(sub_bands_[i]);
+    metrics.sub_bands[i] = sub[i];
+  }
+  metrics.bass = std::min(1.5f, (sub[0] + sub[1] + sub[2]) / 3.0f);
+  metrics.mid = std::min(1.5f, (sub[3] + sub[4] + sub[5]) / 3.0f);
+  metrics.treble = std::min(1.5f, (sub[6] + sub[7] + sub[8]) / 3.0f);
+
+  beat_.process(magnitude, play_us, metrics);
+
+  filterbank_.apply(magnitude, metrics.geq_bands);
+  metrics.geq_count = static_cast<uint32_t>(filterbank_.bands());
+  for (size_t i = 0; i < metrics.geq_count; ++i) {
+    metrics.geq_bands[i] = std::min(1.5f, metrics.geq_bands[i]);
+  }
+  apply_limiter(metrics);
+  update_envelopes(metrics);
+
+  metrics.sample_rate = sample_rate_;
+  // Local time at which this frame leaves the speakers of the synced Snapcast
+  // clients; effects wait for it before showing the frame
+  metrics.timestamp_us = play_us;
+  metrics.processed_us = esp_timer_get_time();
+
+  led_audio_set_metrics(metrics);
+}
+
+// Compress the dynamic range so loud passages do not pin every band at the top
+void AudioAnalyzer::apply_limiter(AudioMetrics& metrics) {
+  float peak_level = metrics.energy;
+  for (size_t i = 0; i < metrics.geq_count; ++i) {
+    peak_level = std::max(peak_level, metrics.geq_bands[i]);
+  }
+  float target_gain = 1.0f;
+  if (peak_level > kLimiterThreshold) {
+    const float reduction = (peak_level - kLimiterThreshold) / kLimiterRatio;
+    target_gain = kLimiterThreshold / (kLimiterThreshold + reduction);
+  }
+  const float coeff = target_gain < limiter_gain_ ? kLimiterAttack : kLimiterRelease;
+  limiter_gain_ = limiter_gain_ * coeff + target_gain * (1.0f - coeff);
+
+  for (size_t i = 0; i < metrics.geq_count; ++i) {
+    metrics.geq_bands[i] *= limiter_gain_;
+  }
+  metrics.energy *= limiter_gain_;
+  metrics.bass *= limiter_gain_;
+  metrics.mid *= limiter_gain_;
+  metrics.treble *= limiter_gain_;
+}
+
+// One-pole followers over the registered selections. Coefficients come from
+// the hop duration, so a time constant means the same at any analysis rate.
+void AudioAnalyzer::update_envelopes(AudioMetrics& metrics) {
+  const float hop_ms = 1000.0f * static_cast<float>(hop_) / static_cast<float>(sample_rate_);
+  const bool specs_changed = led_audio_get_envelopes(envelope_generation_, envelope_specs_, envelope_count_);
+  if (specs_changed || hop_ms != envelope_hop_ms_) {
+    envelope_hop_ms_ = hop_ms;
+    auto coefficient = [&](uint16_t time_ms) {
+      return time_ms == 0 ? 1.0f : 1.0f - expf(-hop_ms / static_cast<float>(time_ms));
+    };
+    for (size_t i = 0; i < envelope_count_; ++i) {
+      envelopes_[i].attack = coefficient(envelope_specs_[i].attack_ms);
+      envelopes_[i].release = coefficient(envelope_specs_[i].release_ms);
+      if (specs_changed) {
+        envelopes_[i].level = 0.0f;
+      }
+    }
+  }
+  for (size_t i = 0; i < envelope_count_; ++i) {
+    Envelope& env = envelopes_[i];
+    const float input = led_audio_selection_level(metrics, envelope_specs_[i].input);
+    env.level += (input - env.level) * (input > env.level ? env.attack : env.release);
+    metrics.envelopes[i] = env.level;
+  }
+  metrics.envelope_count = static_cast<uint32_t>(envelope_count_);
+}
@@ -0,0 +1,369 @@
+#include "beat_tracker.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Flux band edges (Hz): kick, bass, low mids, mids, presence, hats
+constexpr float kBandEdges[] = {30.0f, 120.0f, 300.0f, 800.0f, 2000.0f, 5000.0f, 12000.0f};
+
+constexpr float kFluxMeanSeconds = 2.0f;   // band normalization time constant
+constexpr float kMinFlux = 1e-3f;          // keeps silence from normalizing noise up
+constexpr float kThresholdSeconds = 0.3f;  // novelty averaged for the threshold
+constexpr float kThresholdScale = 1.5f;
+constexpr float kThresholdFloor = 0.4f;
+constexpr float kMinOnsetGapSeconds = 0.1f;
+
+constexpr float kHistorySeconds = 6.0f;
+constexpr size_t kMaxHistory = 2048;
+constexpr float kMinBpm = 60.0f;
+constexpr float kMaxBpm = 200.0f;
+constexpr float kBpmStep = 1.0f;
+constexpr size_t kCombMultiples = 3;       // a period is scored at 1x, 2x and 3x its lag
+constexpr float kPriorBpm = 120.0f;
+constexpr float kPriorOctaves = 1.0f;      // width of the log-normal tempo prior
+constexpr float kTempoSeconds = 0.5f;      // between tempo estimates
+constexpr float kTempoTolerance = 0.05f;   // relative; closer estimates are smoothed in
+constexpr float kMinConfidence = 0.1f;
+
+constexpr float kLockConfidence = 0.2f;    // predicted beats drive the output above this
+constexpr float kPhaseWindow = 0.2f;       // of a period; onsets closer nudge the beat clock
+constexpr float kPhaseGain = 0.2f;
+constexpr float kPhaseBlend = 0.5f;        // share of the comb phase taken per estimate
+constexpr float kIdleBeats = 4.0f;         // predicted beats stop this long after the last onset
+constexpr float kBeatDecaySeconds = 0.15f;
+
+// Wrap x into (-period / 2, period / 2]
+float wrap_half(float x, float period) {
+  while (x > period * 0.5f) {
+    x -= period;
+  }
+  while (x <= -period * 0.5f) {
+    x += period;
+  }
+  return x;
+}
+
+}  // namespace
+
+void BeatTracker::configure(size_t bins, uint32_t sample_rate, size_t hop) {
+  frame_rate_ = 0.0f;
+  if (bins < 2 || sample_rate == 0 || hop == 0) {
+    return;
+  }
+  const float frame_rate = static_cast<float>(sample_rate) / static_cast<float>(hop);
+  auto frames = [&](float seconds) { return std::max<size_t>(1, static_cast<size_t>(seconds * frame_rate + 0.5f)); };
+
+  frame_us_ = 1e6f / frame_rate;
+  mean_alpha_ = 1.0f - expf(-1.0f / (kFluxMeanSeconds * frame_rate));
+  beat_decay_ = expf(-1.0f / (kBeatDecaySeconds * frame_rate));
+  threshold_frames_ = std::max<size_t>(3, frames(kThresholdSeconds));
+  min_onset_gap_ = frames(kMinOnsetGapSeconds);
+  tempo_interval_ = frames(kTempoSeconds);
+
+  const float bin_hz = static_cast<float>(sample_rate) / static_cast<float>(bins * 2);
+  flux_bins_ = 0;
+  for (size_t b = 0; b < kBands; ++b) {
+    const size_t first = std::clamp<size_t>(static_cast<size_t>(kBandEdges[b] / bin_hz), 1, bins);
+    const size_t end = std::clamp<size_t>(static_cast<size_t>(kBandEdges[b + 1] / bin_hz), first, bins);
+    bands_[b] = FluxBand{static_cast<uint16_t>(first), static_cast<uint16_t>(end - first), 0.0f};
+    flux_bins_ = std::max(flux_bins_, end);
+  }
+  previous_.assign(flux_bins_, 0.0f);
+
+  // Candidate periods and their prior; the history holds the comb of the
+  // slowest tempo with room to spare
+  const size_t candidates = static_cast<size_t>((kMaxBpm - kMinBpm) / kBpmStep) + 1;
+  periods_.resize(candidates);
+  prior_.resize(candidates);
+  for (size_t c = 0; c < candidates; ++c) {
+    const float bpm = kMinBpm + kBpmStep * static_cast<float>(c);
+    const float octaves = log2f(bpm / kPriorBpm) / kPriorOctaves;
+    periods_[c] = 60.0f * frame_rate / bpm;
+    prior_[c] = expf(-0.5f * octaves * octaves);
+  }
+  const size_t max_lag = static_cast<size_t>(periods_[0] * kCombMultiples) + 2;
+  size_t history = 1;
+  while (history < std::max(frames(kHistorySeconds), max_lag * 2) && history < kMaxHistory) {
+    history <<= 1;
+  }
+  history_mask_ = history - 1;
+  novelty_.assign(history, 0.0f);
+  centered_.assign(history, 0.0f);
+  acf_.assign(std::min(max_lag, history / 2) + 1, 0.0f);
+
+  written_ = 0;
+  since_onset_ = min_onset_gap_;
+  since_tempo_ = 0;
+  period_ = 0.0f;
+  confidence_ = 0.0f;
+  candidate_period_ = 0.0f;
+  countdown_ = 0.0f;
+  beat_envelope_ = 0.0f;
+  frame_rate_ = frame_rate;
+}
+
+float BeatTracker::novelty_at(size_t age) const {
+  return novelty_[(written_ - 1 - age) & history_mask_];
+}
+
+void BeatTracker::process(const float* magnitude, uint64_t play_us, AudioMetrics& metrics) {
+  if (!configured() || !magnitude) {
+    return;
+  }
+
+  // Band-normalized spectral flux
+  float novelty = 0.0f;
+  size_t active = 0;
+  for (auto& band : bands_) {
+    if (band.count == 0) {
+      continue;
+    }
+    float* previous = previous_.data() + band.first;
+    const float* current = magnitude + band.first;
+    float flux = 0.0f;
+    #pragma GCC unroll 4
+    for (size_t i = 0; i < band.count; ++i) {
+      const float compressed = sqrtf(current[i]);
+      flux += std::max(0.0f, compressed - previous[i]);
+      previous[i] = compressed;
+    }
+    flux /= static_cast<float>(band.count);
+    if (written_ == 0) {
+      band.mean = flux;  // first frame has no predecessor: seed, no onset
+    } else {
+      band.mean += mean_alpha_ * (flux - band.mean);
+      novelty += flux / std::max(band.mean, kMinFlux);
+    }
+    ++active;
+  }
+  novelty = active > 0 ? novelty / static_cast<float>(active) : 0.0f;
+  novelty_[written_ & history_mask_] = novelty;
+  ++written_;
+
+  float strength = 0.0f;
+  const bool onset = pick_onset(strength);
+  ++since_onset_;
+  if (onset) {
+    since_onset_ = 1;  // the peak was the previous frame
+  }
+
+  beat_envelope_ *= beat_decay_;
+  advance(onset, strength);
+  if (++since_tempo_ >= tempo_interval_) {
+    since_tempo_ = 0;
+    update_tempo();
+  }
+
+  metrics.beat = std::min(1.0f, beat_envelope_);
+  if (period_ > 0.0f) {
+    metrics.tempo_bpm = 60.0f * frame_rate_ / period_;
+    metrics.tempo_confidence = confidence_;
+    metrics.beat_phase = std::clamp(1.0f - countdown_ / period_, 0.0f, 1.0f);
+    metrics.next_beat_us = play_us + static_cast<uint64_t>(std::max(0.0f, countdown_) * frame_us_);
+  } else {
+    metrics.tempo_bpm = 0.0f;
+    metrics.tempo_confidence = 0.0f;
+    metrics.beat_phase = 0.0f;
+    metrics.next_beat_us = 0;
+  }
+}
+
+// The previous frame is an onset when it is a local maximum of the novelty
+// curve above the scaled mean of the frames before it
+bool BeatTracker::pick_onset(float& strength) const {
+  if (written_ < threshold_frames_ + 3 || since_onset_ < min_onset_gap_) {
+    return false;
+  }
+  const float peak = novelty_at(1);
+  if (peak <= novelty_at(2) || peak < novelty_at(0)) {
+    return false;
+  }
+  float mean = 0.0f;
+  for (size_t age = 2; age < threshold_frames_ + 2; ++age) {
+    mean += novelty_at(age);
+  }
+  mean /= static_cast<float>(threshold_frames_);
+  const float threshold = mean * kThresholdScale + kThresholdFloor;
+  if (peak <= threshold) {
+    return false;
+  }
+  strength = 1.0f - threshold / peak;
+  return true;
+}
+
+// Advance the beat clock one frame and nudge it towards onsets near a beat
+void BeatTracker::advance(bool onset, float strength) {
+  if (period_ <= 0.0f) {
+    if (onset) {
+      beat_envelope_ = std::max(beat_envelope_, 0.5f + 0.5f * strength);
+    }
+    return;
+  }
+
+  countdown_ -= 1.0f;
+  bool beat = false;
+  while (countdown_ <= 0.0f) {
+    countdown_ += period_;
+    beat = true;
+  }
+
+  if (onset) {
+    // The onset peaked one frame ago: how far from the nearest predicted beat
+    const float error = wrap_half(-1.0f - countdown_, period_);
+    if (fabsf(error) < kPhaseWindow * period_) {
+      countdown_ += kPhaseGain * strength * error;
+    }
+  }
+
+  // Only a confident tempo with recent onsets drives the beat: silence or a
+  // break must not keep pulsing
+  if (confidence_ >= kLockConfidence && static_cast<float>(since_onset_) < kIdleBeats * period_) {
+    if (beat) {
+      beat_envelope_ = 1.0f;
+    }
+  } else if (onset) {
+    beat_envelope_ = std::max(beat_envelope_, 0.5f + 0.5f * strength);
+  }
+}
+
+// Autocorrelate the mean-removed novelty history, score every candidate
+// period as a comb over it and keep the best one, interpolated between
+// candidates; then re-align the beat clock
+void BeatTracker::update_tempo() {
+  const size_t count = std::min(written_, history_mask_ + 1);
+  const size_t lags = acf_.size();
+  if (count < lags + static_cast<size_t>(periods_[0])) {
+    return;
+  }
+  float mean = 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    mean += novelty_at(i);
+  }
+  mean /= static_cast<float>(count);
+  float* x = centered_.data();
+  float energy = 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    x[i] = novelty_at(count - 1 - i) - mean;
+    energy += x[i] * x[i];
+  }
+  energy /= static_cast<float>(count);
+  if (energy <= 1e-9f) {
+    confidence_ = 0.0f;
+    return;
+  }
+
+  for (size_t lag = 1; lag < lags; ++lag) {
+    float acc = 0.0f;
+    #pragma GCC unroll 4
+    for (size_t i = 0; i + lag < count; ++i) {
+      acc += x[i] * x[i + lag];
+    }
+    acf_[lag] = acc / (static_cast<float>(count - lag) * energy);
+  }
+  // Onsets land on whole frames, so a period between two lags splits its
+  // peak; a [1 2 1] smoothing puts it back together
+  float previous = acf_[1];
+  for (size_t lag = 1; lag + 1 < lags; ++lag) {
+    const float current = acf_[lag];
+    acf_[lag] = 0.25f * previous + 0.5f * current + 0.25f * acf_[lag + 1];
+    previous = current;
+  }
+  auto acf_at = [&](float lag) {
+    const size_t i = std::min(static_cast<size_t>(lag), lags - 2);
+    const float frac = std::min(1.0f, lag - static_cast<float>(i));
+    return acf_[i] + frac * (acf_[i + 1] - acf_[i]);
+  };
+  auto score = [&](size_t c) {
+    float sum = 0.0f;
+    for (size_t k = 1; k <= kCombMultiples; ++k) {
+      sum += acf_at(periods_[c] * static_cast<float>(k)) / static_cast<float>(k);
+    }
+    return sum * prior_[c];
+  };
+
+  const size_t candidates = periods_.size();
+  size_t best = 0;
+  float best_score = score(0);
+  for (size_t c = 1; c < candidates; ++c) {
+    const float s = score(c);
+    if (s > best_score) {
+      best_score = s;
+      best = c;
+    }
+  }
+  // Normalized correlation at the period; the smoothing roughly halves a peak
+  const float confidence = std::clamp(2.0f * acf_at(periods_[best]), 0.0f, 1.0f);
+  confidence_ = confidence;
+  if (confidence < kMinConfidence) {
+    return;
+  }
+  float offset = 0.0f;
+  if (best > 0 && best + 1 < candidates) {
+    const float left = score(best - 1);
+    const float right = score(best + 1);
+    const float curvature = left - 2.0f * best_score + right;
+    if (curvature < 0.0f) {
+      offset = std::clamp(0.5f * (left - right) / curvature, -0.5f, 0.5f);
+    }
+  }
+  const float bpm = kMinBpm + kBpmStep * (static_cast<float>(best) + offset);
+  const float estimate = 60.0f * frame_rate_ / bpm;
+
+  auto close = [](float a, float b) { return fabsf(a / b - 1.0f) < kTempoTolerance; };
+  bool fresh = false;
+  if (period_ <= 0.0f) {
+    period_ = estimate;
+    fresh = true;
+  } else if (close(estimate, period_)) {
+    period_ += 0.25f * (estimate - period_);
+    candidate_period_ = 0.0f;
+  } else if (candidate_period_ > 0.0f && close(estimate, candidate_period_)) {
+    // Two estimates in a row agree on a new tempo: switch
+    period_ = estimate;
+    candidate_period_ = 0.0f;
+    fresh = true;
+  } else {
+    candidate_period_ = estimate;
+  }
+  if (fresh) {
+    countdown_ = 0.0f;
+  }
+  align_phase(count);
+}
+
+// Offset of the comb of beats at the current period that collects the most
+// novelty; the beat clock moves towards it (or jumps there after a tempo change)
+void BeatTracker::align_phase(size_t count) {
+  const float* x = centered_.data();  // oldest first
+  const size_t steps = static_cast<size_t>(period_);
+  float best_sum = -1e30f;
+  float best_age = 0.0f;
+  for (size_t age = 0; age < steps; ++age) {
+    float sum = 0.0f;
+    size_t n = 0;
+    // Rounded ages stay below count, so the comb never wraps onto the newest frame
+    for (float at = static_cast<float>(age); at + 0.5f < static_cast<float>(count); at += period_) {
+      sum += x[count - 1 - static_cast<size_t>(at + 0.5f)];
+      ++n;
+    }
+    sum /= static_cast<float>(std::max<size_t>(1, n));
+    if (sum > best_sum) {
+      best_sum = sum;
+      best_age = static_cast<float>(age);
+    }
+  }
+  // The last beat was best_age frames ago
+  const float target = period_ - best_age;
+  if (countdown_ <= 0.0f) {
+    countdown_ = target;
+  } else {
+    countdown_ += kPhaseBlend * wrap_half(target - countdown_, period_);
+  }
+  while (countdown_ <= 0.0f) {
+    countdown_ += period_;
+  }
+  while (countdown_ > period_) {
+    countdown_ -= period_;
+  }
+}
@@ -0,0 +1,479 @@
+#include "flac_decoder.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// MSB-first bit reader over one frame. Reads past the end return zeros and
+// are caught by overrun(), which the frame decoder turns into "incomplete".
+class BitReader {
+public:
+  BitReader(const uint8_t* data, size_t len) : data_(data), len_(len) {}
+
+  uint32_t read(unsigned n) {
+    if (n == 0) {
+      return 0;
+    }
+    refill();
+    const uint32_t v = static_cast<uint32_t>(cache_ >> (64 - n));
+    drop(n);
+    return v;
+  }
+
+  int32_t read_signed(unsigned n) {
+    if (n == 0) {
+      return 0;
+    }
+    const uint32_t v = read(n);
+    const uint32_t sign = 1u << (n - 1);
+    return static_cast<int32_t>((v ^ sign) - sign);
+  }
+
+  // Zeros before the next one bit
+  uint32_t read_unary() {
+    uint32_t q = 0;
+    for (;;) {
+      refill();
+      if (cache_ == 0) {
+        q += count_;
+        drop(count_);
+        if (overrun()) {
+          return 0;
+        }
+        continue;
+      }
+      const unsigned lz = static_cast<unsigned>(__builtin_clzll(cache_));
+      drop(lz + 1);
+      return q + lz;
+    }
+  }
+
+  int32_t read_rice(unsigned k) {
+    const uint32_t v = (read_unary() << k) | read(k);
+    return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+  }
+
+  void align() {
+    if (consumed_ & 7) {
+      read(8 - (consumed_ & 7));
+    }
+  }
+
+  size_t byte_pos() const { return consumed_ >> 3; }
+  bool overrun() const { return consumed_ > len_ * 8; }
+
+private:
+  void refill() {
+    while (count_ <= 56) {
+      const uint64_t byte = pos_ < len_ ? data_[pos_] : 0;
+      cache_ |= byte << (56 - count_);
+      count_ += 8;
+      ++pos_;
+    }
+  }
+
+  void drop(unsigned n) {
+    cache_ = n >= 64 ? 0 : cache_ << n;
+    count_ -= n;
+    consumed_ += n;
+  }
+
+  const uint8_t* data_;
+  size_t len_;
+  size_t pos_{0};
+  uint64_t cache_{0};
+  unsigned count_{0};
+  size_t consumed_{0};
+};
+
+uint8_t crc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; ++b) {
+      crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+    }
+  }
+  return crc;
+}
+
+struct Crc16Table {
+  uint16_t t[256];
+  constexpr Crc16Table() : t{} {
+    for (int i = 0; i < 256; ++i) {
+      uint16_t crc = static_cast<uint16_t>(i << 8);
+      for (int b = 0; b < 8; ++b) {
+        crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1);
+      }
+      t[i] = crc;
+    }
+  }
+};
+
+constexpr Crc16Table kCrc16{};
+
+uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < len; ++i) {
+    crc = static_cast<uint16_t>((crc << 8) ^ kCrc16.t[(crc >> 8) ^ data[i]]);
+  }
+  return crc;
+}
+
+bool is_sync(const uint8_t* p) {
+  return p[0] == 0xFF && (p[1] & 0xFE) == 0xF8;
+}
+
+// Residual of one subframe added on top of nothing (predictors run after)
+bool decode_residual(BitReader& br, int32_t* out, uint32_t block_size, unsigned order) {
+  const uint32_t method = br.read(2);
+  if (method > 1) {
+    return false;
+  }
+  const unsigned param_bits = method == 0 ? 4 : 5;
+  const uint32_t escape = method == 0 ? 0xF : 0x1F;
+  const unsigned partition_order = br.read(4);
+  const uint32_t partitions = 1u << partition_order;
+  const uint32_t per_partition = block_size >> partition_order;
+  if ((per_partition << partition_order) != block_size || per_partition < order) {
+    return false;
+  }
+  uint32_t i = order;
+  for (uint32_t p = 0; p < partitions; ++p) {
+    const uint32_t end = (p + 1) * per_partition;
+    const uint32_t k = br.read(param_bits);
+    if (k == escape) {
+      const unsigned raw_bits = br.read(5);
+      for (; i < end; ++i) {
+        out[i] = br.read_signed(raw_bits);
+      }
+    } else {
+      for (; i < end; ++i) {
+        out[i] = br.read_rice(k);
+      }
+    }
+    if (br.overrun()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Prediction and residual are summed in 64 bits: a 24-bit side channel times
+// the predictor gain, or a corrupt residual, does not fit int32
+void restore_fixed(int32_t* s, uint32_t n, unsigned order) {
+  switch (order) {
+    case 1:
+      for (uint32_t i = 1; i < n; ++i) s[i] = static_cast<int32_t>(int64_t{s[i]} + s[i - 1]);
+      break;
+    case 2:
+      for (uint32_t i = 2; i < n; ++i) {
+        s[i] = static_cast<int32_t>(int64_t{s[i]} + 2 * int64_t{s[i - 1]} - s[i - 2]);
+      }
+      break;
+    case 3:
+      for (uint32_t i = 3; i < n; ++i) {
+        s[i] = static_cast<int32_t>(int64_t{s[i]} + 3 * (int64_t{s[i - 1]} - s[i - 2]) + s[i - 3]);
+      }
+      break;
+    case 4:
+      for (uint32_t i = 4; i < n; ++i) {
+        s[i] = static_cast<int32_t>(int64_t{s[i]} + 4 * (int64_t{s[i - 1]} + s[i - 3]) - 6 * int64_t{s[i - 2]} -
+                                    s[i - 4]);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void restore_lpc(int32_t* s, uint32_t n, const int32_t* coefs, unsigned order, int shift) {
+  for (uint32_t i = order; i < n; ++i) {
+    int64_t sum = 0;
+    for (unsigned j = 0; j < order; ++j) {
+      sum += static_cast<int64_t>(coefs[j]) * s[i - 1 - j];
+    }
+    s[i] = static_cast<int32_t>(s[i] + (sum >> shift));
+  }
+}
+
+bool decode_subframe(BitReader& br, int32_t* s, uint32_t block_size, unsigned bps) {
+  if (br.read(1) != 0) {
+    return false;
+  }
+  const uint32_t type = br.read(6);
+  unsigned wasted = 0;
+  if (br.read(1)) {
+    wasted = br.read_unary() + 1;
+    if (wasted >= bps) {
+      return false;
+    }
+    bps -= wasted;
+  }
+  if (type == 0) {
+    const int32_t v = br.read_signed(bps);
+    std::fill(s, s + block_size, v);
+  } else if (type == 1) {
+    for (uint32_t i = 0; i < block_size; ++i) {
+      s[i] = br.read_signed(bps);
+    }
+  } else if (type >= 8 && type <= 12) {
+    const unsigned order = type - 8;
+    if (order > block_size) {
+      return false;
+    }
+    for (unsigned i = 0; i < order; ++i) {
+      s[i] = br.read_signed(bps);
+    }
+    if (!decode_residual(br, s, block_size, order)) {
+      return false;
+    }
+    restore_fixed(s, block_size, order);
+  } else if (type >= 32) {
+    const unsigned order = type - 31;
+    if (order > block_size) {
+      return false;
+    }
+    for (unsigned i = 0; i < order; ++i) {
+      s[i] = br.read_signed(bps);
+    }
+    const unsigned precision = br.read(4) + 1;
+    const int shift = br.read_signed(5);
+    if (precision == 16 || shift < 0) {
+      return false;
+    }
+    int32_t coefs[32];
+    for (unsigned j = 0; j < order; ++j) {
+      coefs[j] = br.read_signed(precision);
+    }
+    if (!decode_residual(br, s, block_size, order)) {
+      return false;
+    }
+    restore_lpc(s, block_size, coefs, order, shift);
+  } else {
+    return false;
+  }
+  if (wasted > 0) {
+    for (uint32_t i = 0; i < block_size; ++i) {
+      s[i] = static_cast<int32_t>(static_cast<uint32_t>(s[i]) << wasted);
+    }
+  }
+  return !br.overrun();
+}
+
+}  // namespace
+
+bool FlacDecoder::init(const uint8_t* header, size_t len) {
+  info_ = StreamInfo{};
+  pending_.clear();
+  if (len < 4 + 4 + 34 || std::memcmp(header, "fLaC", 4) != 0) {
+    return false;
+  }
+  // STREAMINFO is always the first metadata block
+  const uint8_t* block = header + 4;
+  if ((block[0] & 0x7F) != 0) {
+    return false;
+  }
+  const uint8_t* si = block + 4;
+  info_.max_block = static_cast<uint16_t>((si[2] << 8) | si[3]);
+  info_.sample_rate = (static_cast<uint32_t>(si[10]) << 12) | (si[11] << 4) | (si[12] >> 4);
+  info_.channels = static_cast<uint16_t>(((si[12] >> 1) & 0x07) + 1);
+  info_.bits = static_cast<uint16_t>((((si[12] & 0x01) << 4) | (si[13] >> 4)) + 1);
+  if (info_.sample_rate == 0 || info_.channels > kMaxChannels || info_.bits > kMaxBitsPerSample ||
+      info_.bits < 8 || info_.max_block > kMaxBlockSize) {
+    return false;
+  }
+  samples_.resize(static_cast<size_t>(kMaxChannels) * kMaxBlockSize);
+  // Room for a worst-case (verbatim) frame plus the next chunk's head
+  pending_.reserve(static_cast<size_t>(kMaxBlockSize) * kMaxChannels * 4 + 64);
+  return true;
+}
+
+int FlacDecoder::decode_frame(const uint8_t* data, size_t len, uint32_t& block_size, uint16_t& channels) {
+  BitReader br(data, len);
+  br.read(16);  // sync + reserved + blocking strategy
+  const uint32_t bs_code = br.read(4);
+  const uint32_t sr_code = br.read(4);
+  const uint32_t assignment = br.read(4);
+  const uint32_t size_code = br.read(3);
+  const uint32_t reserved = br.read(1);
+  // Zeros read past a cut header would look corrupt rather than incomplete
+  if (br.overrun()) {
+    return 0;
+  }
+  if (reserved != 0 || bs_code == 0 || sr_code == 15 || assignment > 10 || size_code == 3 || size_code == 7) {
+    return -1;
+  }
+  // UTF-8 style frame / sample number; only its length matters here.
+  // 0xFE opens the longest (7 byte) form, 0xFF is never a lead byte
+  const uint32_t lead = br.read(8);
+  unsigned extra = 0;
+  while (extra < 7 && (lead & (0x80u >> extra))) {
+    ++extra;
+  }
+  if (extra == 1 || lead == 0xFF) {
+    return -1;
+  }
+  for (unsigned i = 1; i < extra; ++i) {
+    const uint32_t next = br.read(8);
+    if (br.overrun()) {
+      return 0;
+    }
+    if (next >> 6 != 0x2) {
+      return -1;
+    }
+  }
+  if (bs_code == 1) {
+    block_size = 192;
+  } else if (bs_code <= 5) {
+    block_size = 576u << (bs_code - 2);
+  } else if (bs_code == 6) {
+    block_size = br.read(8) + 1;
+  } else if (bs_code == 7) {
+    block_size = br.read(16) + 1;
+  } else {
+    block_size = 256u << (bs_code - 8);
+  }
+  if (sr_code == 12) {
+    br.read(8);
+  } else if (sr_code == 13 || sr_code == 14) {
+    br.read(16);
+  }
+  if (br.overrun()) {
+    return 0;
+  }
+  const size_t header_len = br.byte_pos();
+  if (header_len >= len) {
+    return 0;
+  }
+  if (crc8(data, header_len) != data[header_len]) {
+    return -1;
+  }
+  br.read(8);
+  if (block_size > kMaxBlockSize) {
+    return -1;
+  }
+  static constexpr uint8_t kBits[8] = {0, 8, 12, 0, 16, 20, 24, 0};
+  const unsigned bps = size_code == 0 ? info_.bits : kBits[size_code];
+  channels = static_cast<uint16_t>(assignment <= 7 ? assignment + 1 : 2);
+  if (channels != info_.channels || bps > kMaxBitsPerSample) {
+    return -1;
+  }
+
+  int32_t* ch[kMaxChannels] = {samples_.data(), samples_.data() + kMaxBlockSize};
+  for (unsigned c = 0; c < channels; ++c) {
+    // The side channel carries one extra bit
+    const bool side = (assignment == 8 && c == 1) || (assignment == 9 && c == 0) || (assignment == 10 && c == 1);
+    if (!decode_subframe(br, ch[c], block_size, bps + (side ? 1 : 0))) {
+      return br.overrun() ? 0 : -1;
+    }
+  }
+  br.align();
+  const size_t body_len = br.byte_pos();
+  if (body_len + 2 > len) {
+    return 0;
+  }
+  const uint16_t crc = static_cast<uint16_t>((data[body_len] << 8) | data[body_len + 1]);
+  if (crc16(data, body_len) != crc) {
+    return -1;
+  }
+
+  int32_t* a = ch[0];
+  int32_t* b = ch[1];
+  switch (assignment) {
+    case 8:  // left / side
+      for (uint32_t i = 0; i < block_size; ++i) b[i] = static_cast<int32_t>(int64_t{a[i]} - b[i]);
+      break;
+    case 9:  // side / right
+      for (uint32_t i = 0; i < block_size; ++i) a[i] = static_cast<int32_t>(int64_t{a[i]} + b[i]);
+      break;
+    case 10:  // mid / side
+      for (uint32_t i = 0; i < block_size; ++i) {
+        const int64_t side = b[i];
+        const int64_t mid = int64_t{a[i]} * 2 + (side & 1);
+        a[i] = static_cast<int32_t>((mid + side) >> 1);
+        b[i] = static_cast<int32_t>((mid - side) >> 1);
+      }
+      break;
+    default:
+      break;
+  }
+  // Down to 16 bit
+  if (bps != 16) {
+    for (unsigned c = 0; c < channels; ++c) {
+      int32_t* s = ch[c];
+      if (bps > 16) {
+        for (uint32_t i = 0; i < block_size; ++i) s[i] >>= (bps - 16);
+      } else {
+        for (uint32_t i = 0; i < block_size; ++i) s[i] = static_cast<int32_t>(static_cast<uint32_t>(s[i]) << (16 - bps));
+      }
+    }
+  }
+  return static_cast<int>(body_len + 2);
+}
+
+size_t FlacDecoder::decode(const uint8_t* data, size_t len, int16_t* out, size_t out_capacity, bool& error) {
+  error = false;
+  if (info_.sample_rate == 0) {
+    return 0;
+  }
+  const uint8_t* buf = data;
+  size_t n = len;
+  if (!pending_.empty()) {
+    if (pending_.size() + len > pending_.capacity()) {
+      // Never completed: drop it rather than grow
+      pending_.clear();
+      error = true;
+    } else {
+      pending_.insert(pending_.end(), data, data + len);
+      buf = pending_.data();
+      n = pending_.size();
+    }
+  }
+
+  size_t written = 0;
+  size_t pos = 0;
+  // Stop while a whole block still fits; the rest waits in pending_
+  while (n - pos >= 2 && written + static_cast<size_t>(kMaxBlockSize) * info_.channels <= out_capacity) {
+    if (!is_sync(buf + pos)) {
+      error = true;
+      ++pos;
+      continue;
+    }
+    uint32_t block_size = 0;
+    uint16_t channels = 0;
+    const int used = decode_frame(buf + pos, n - pos, block_size, channels);
+    if (used == 0) {
+      break;
+    }
+    if (used < 0) {
+      error = true;
+      ++pos;
+      continue;
+    }
+    pos += static_cast<size_t>(used);
+    const int32_t* l = samples_.data();
+    const int32_t* r = samples_.data() + kMaxBlockSize;
+    if (channels == 2) {
+      for (uint32_t i = 0; i < block_size; ++i) {
+        out[written++] = static_cast<int16_t>(l[i]);
+        out[written++] = static_cast<int16_t>(r[i]);
+      }
+    } else {
+      for (uint32_t i = 0; i < block_size; ++i) {
+        out[written++] = static_cast<int16_t>(l[i]);
+      }
+    }
+  }
+
+  // Keep the unfinished tail for the next chunk
+  const size_t rest = n - pos;
+  if (buf == pending_.data()) {
+    pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(pos));
+  } else if (rest > 0 && rest <= pending_.capacity()) {
+    pending_.assign(buf + pos, buf + n);
+  } else if (rest > 0) {
+    error = true;
+  }
+  return written;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "beat_tracker.hpp"
+#include "led_engine/audio_filterbank.hpp"
+#include "led_engine/audio_pipeline.hpp"
+#include "led_engine/mem_placement.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Spectrum analysis of the PCM stream feeding the LED effects
+// configure() sizes every buffer (window, FFT work area, twiddles, spectrum)
+// and resolves every band to a bin range with its weight folded in, so
+// process() is one windowed FFT plus table-driven accumulation: no heap
+// traffic and no transcendental calls per frame. The GEQ bands are an
+// AudioFilterbank (mel, Bark or constant-Q, 8..64 bands) with the per-band
+// gain folded into its weights.
+// The input is real, so an N-point window is transformed as N/2 complex
+// points and split afterwards, half the work of a zero-imaginary N-point FFT.
+// Windows advance by `hop` frames and overlap when hop < N: the FFT size sets
+// frequency resolution, the hop sets the analysis rate.
+// Beat, tempo and beat phase come from a BeatTracker fed the same spectrum.
+// The attack/release envelopes effects ask for (led_audio_set_envelopes) are
+// advanced here once per hop, so their response does not depend on the
+// render rate.
+
+class AudioAnalyzer {
+public:
+  static constexpr size_t kMinFftSize = 256;
+  static constexpr size_t kMaxFftSize = 4096;
+  static constexpr size_t kSubBands = kAudioSubBands;
+
+  // fft_size is rounded down to a power of two in range, hop (frames) is
+  // clamped to 1..fft_size, bands is rounded to a supported filterbank size.
+  // The only call that allocates.
+  void configure(size_t fft_size, size_t hop, uint32_t sample_rate, AudioScale scale = AudioScale::Mel,
+                 size_t bands = 32);
+  bool configured() const { return fft_size_ != 0; }
+  size_t fft_size() const { return fft_size_; }
+  size_t hop() const { return hop_; }
+  uint32_t sample_rate() const { return sample_rate_; }
+
+  // Analyze one window of up to fft_size() frames of interleaved PCM
+  // (zero-padded when shorter) and publish the metrics for playout at play_us
+  void process(const int16_t* pcm, size_t samples, bool stereo, uint64_t play_us);
+
+private:
+  // Bins [first, first + count) averaged and scaled by gain: scale = gain / count
+  struct BandRange {
+    uint16_t first{0};
+    uint16_t count{0};
+    float scale{0.0f};
+  };
+
+  BandRange make_range(float f_low, float f_high, float gain) const;
+  float accumulate(const BandRange& band) const;
+  void configure_filterbank();
+  void apply_limiter(AudioMetrics& metrics);
+  void update_envelopes(AudioMetrics& metrics);
+
+  size_t fft_size_{0};
+  size_t hop_{0};
+  uint32_t sample_rate_{0};
+  placement::HotVector<float> window_;     // Hann, fft_size
+  placement::HotVector<float> fft_;        // fft_size / 2 interleaved complex points
+  placement::HotVector<float> twiddles_;   // radix-2 table handed to esp-dsp, fft_size / 2
+  placement::HotVector<float> split_;      // cos/sin pairs for the real split, fft_size
+  placement::HotVector<float> magnitude_;  // fft_size / 2
+  BandRange sub_bands_[kSubBands]{};
+  AudioScale scale_{AudioScale::Mel};
+  size_t bands_{0};
+  AudioFilterbank filterbank_;
+
+  BeatTracker beat_;
+
+  float limiter_gain_{1.0f};
+
+  struct Envelope {
+    float attack{1.0f};   // per-hop smoothing coefficients
+    float release{1.0f};
+    float level{0.0f};
+  };
+  AudioEnvelopeSpec envelope_specs_[kAudioMaxEnvelopes]{};
+  Envelope envelopes_[kAudioMaxEnvelopes]{};
+  size_t envelope_count_{0};
+  uint32_t envelope_generation_{0};
+  float envelope_hop_ms_{0.0f};  // hop the coefficients were computed for
+};
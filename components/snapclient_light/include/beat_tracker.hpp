@@ -0,0 +1,74 @@
+#pragma once
+
+#include "led_engine/audio_pipeline.hpp"
+#include "led_engine/mem_placement.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Onset detection and tempo/beat-phase tracking on the analyzer's spectrum
+// Onsets: half-wave rectified spectral flux of root-compressed magnitudes in
+// a few log-spaced bands, each normalized by its own running mean so a loud
+// bass line does not drown hi-hats, then peak-picked against an adaptive
+// threshold (scaled local mean of the novelty curve).
+// Tempo: the novelty curve of the last few seconds is autocorrelated twice a
+// second and a comb of candidate periods (60..200 BPM in 1 BPM steps) is
+// scored on it, each period together with its multiples and weighted by a
+// log-normal prior around 120 BPM to avoid octave errors.
+// Phase: the comb offset that best matches the novelty history sets a beat
+// clock running at the tracked period; onsets near a predicted beat nudge it
+// in between. Beats are therefore known ahead of time (next_beat_us) instead
+// of after the kick was heard.
+// All state lives in the object; configure() is the only call that allocates.
+
+class BeatTracker {
+public:
+  // bins: magnitude bins per frame (fft_size / 2); hop: frames between calls
+  void configure(size_t bins, uint32_t sample_rate, size_t hop);
+  bool configured() const { return frame_rate_ > 0.0f; }
+
+  // One analysis frame; fills beat, tempo_bpm, tempo_confidence, beat_phase
+  // and next_beat_us. play_us is when this frame is heard.
+  void process(const float* magnitude, uint64_t play_us, AudioMetrics& metrics);
+
+private:
+  static constexpr size_t kBands = 6;
+
+  struct FluxBand {
+    uint16_t first{0};
+    uint16_t count{0};
+    float mean{0.0f};  // running mean flux, for normalization
+  };
+
+  float novelty_at(size_t age) const;  // 0 = newest
+  bool pick_onset(float& strength) const;
+  void advance(bool onset, float strength);
+  void update_tempo();
+  void align_phase(size_t count);
+
+  float frame_rate_{0.0f};  // analysis frames per second
+  float frame_us_{0.0f};
+  float mean_alpha_{0.0f};
+  float beat_decay_{0.0f};
+  size_t threshold_frames_{0};
+  size_t min_onset_gap_{0};
+  size_t tempo_interval_{0};
+
+  FluxBand bands_[kBands]{};
+  size_t flux_bins_{0};                    // bins up to the top band edge
+  placement::HotVector<float> previous_;   // compressed magnitudes of the last frame
+  placement::HotVector<float> novelty_;    // ring, power-of-two length
+  placement::HotVector<float> centered_;   // mean-removed history, oldest first
+  placement::HotVector<float> acf_;        // autocorrelation by lag
+  placement::HotVector<float> periods_;    // candidate beat periods (frames)
+  placement::HotVector<float> prior_;      // tempo prior per candidate
+  size_t history_mask_{0};
+  size_t written_{0};                      // frames written into novelty_
+
+  size_t since_onset_{0};
+  size_t since_tempo_{0};
+  float period_{0.0f};       // frames per beat, 0 until a tempo is found
+  float confidence_{0.0f};
+  float candidate_period_{0.0f};
+  float countdown_{0.0f};    // frames until the next predicted beat
+  float beat_envelope_{0.0f};
+};
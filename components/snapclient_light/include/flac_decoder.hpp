@@ -0,0 +1,50 @@
+#pragma once
+
+#include "led_engine/mem_placement.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Minimal FLAC frame decoder for Snapcast streams
+// The codec header carries "fLaC" and the STREAMINFO block; every WireChunk
+// then holds whole encoded frames. Work per frame is bounded by the block size
+// limit below (the FLAC streamable subset) and all buffers are sized once in
+// init(), so decoding a chunk never allocates. Output is interleaved 16-bit.
+// The working buffers (~72 KB) are PSRAM bulk; only the caller's output block
+// needs to be in internal RAM.
+
+class FlacDecoder {
+public:
+  static constexpr uint32_t kMaxBlockSize = 4608;  // streamable subset limit up to 48 kHz
+  static constexpr uint32_t kMaxChannels = 2;
+  static constexpr uint32_t kMaxBitsPerSample = 24;
+
+  struct StreamInfo {
+    uint32_t sample_rate{0};
+    uint16_t channels{0};
+    uint16_t bits{0};
+    uint16_t max_block{0};
+  };
+
+  // Parse the codec header; false for streams outside the limits above
+  bool init(const uint8_t* header, size_t len);
+  const StreamInfo& info() const { return info_; }
+
+  // Decode the complete frames in `data` into `out` as interleaved samples.
+  // Decoding stops once another block might not fit in out_capacity. Frames left
+  // over, and a frame cut at the end of `data`, are kept for the next call.
+  // Call again with no data until it returns 0. Returns the number of samples
+  // written and sets `error` when a corrupt frame was skipped.
+  size_t decode(const uint8_t* data, size_t len, int16_t* out, size_t out_capacity, bool& error);
+  // One block; callers drain decode() in a loop
+  size_t max_samples() const { return static_cast<size_t>(kMaxBlockSize) * kMaxChannels; }
+
+  void reset() { pending_.clear(); }
+
+private:
+  // Decodes one frame at data; 0 when incomplete, -1 when corrupt, else its size in bytes
+  int decode_frame(const uint8_t* data, size_t len, uint32_t& block_size, uint16_t& channels);
+
+  StreamInfo info_{};
+  placement::BulkVector<int32_t> samples_;  // kMaxChannels * kMaxBlockSize
+  placement::BulkVector<uint8_t> pending_;  // frames carried to the next call
+};
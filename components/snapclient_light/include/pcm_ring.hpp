@@ -0,0 +1,103 @@
+#pragma once
+
+#include "led_engine/mem_placement.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Single-producer / single-consumer ring of interleaved PCM samples
+// Capacity is a power of two fixed by reset(); nothing allocates afterwards.
+// Positions are free-running 32-bit sample counters (they wrap after ~12 h at
+// 96 k samples/s; all arithmetic is modular), published with release/acquire
+// so the network side and the analysis side never take a lock.
+// The first `window` samples of storage are mirrored past its end, so any
+// window of up to that many samples can be peeked as one contiguous span
+// without copying, wherever it falls in the ring.
+
+class PcmRing {
+public:
+  // Empties the ring; only while neither side is running
+  void reset(size_t min_capacity, size_t window) {
+    size_t capacity = 1;
+    while (capacity < std::max(min_capacity, window)) {
+      capacity <<= 1;
+    }
+    window_ = window;
+    mask_ = capacity - 1;
+    storage_.assign(capacity + window, 0);
+    write_.store(0, std::memory_order_relaxed);
+    read_.store(0, std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+  size_t window() const { return window_; }
+
+  // Either side
+  size_t size() const {
+    return write_.load(std::memory_order_acquire) - read_.load(std::memory_order_acquire);
+  }
+
+  // Producer side
+  size_t free_space() const { return capacity() - size(); }
+  uint32_t write_position() const { return write_.load(std::memory_order_relaxed); }
+
+  // Appends up to `count` samples; returns how many fit
+  size_t write(const int16_t* src, size_t count) {
+    const uint32_t w = write_.load(std::memory_order_relaxed);
+    count = std::min(count, capacity() - static_cast<size_t>(w - read_.load(std::memory_order_acquire)));
+    size_t done = 0;
+    while (done < count) {
+      const size_t at = (w + done) & mask_;
+      const size_t n = std::min(count - done, capacity() - at);
+      std::memcpy(storage_.data() + at, src + done, n * sizeof(int16_t));
+      if (at < window_) {
+        std::memcpy(storage_.data() + capacity() + at, src + done, std::min(n, window_ - at) * sizeof(int16_t));
+      }
+      done += n;
+    }
+    write_.store(w + static_cast<uint32_t>(count), std::memory_order_release);
+    return count;
+  }
+
+  // Consumer side
+  uint32_t read_position() const { return read_.load(std::memory_order_relaxed); }
+
+  // `count` (<= window()) samples starting `offset` after the read position,
+  // or nullptr when they are not all written yet
+  const int16_t* peek(size_t offset, size_t count) const {
+    if (count > window_ || offset + count > size()) {
+      return nullptr;
+    }
+    return storage_.data() + ((read_.load(std::memory_order_relaxed) + offset) & mask_);
+  }
+
+  // Copies up to `count` samples out and consumes them; returns how many
+  size_t read(int16_t* dst, size_t count) {
+    const uint32_t r = read_.load(std::memory_order_relaxed);
+    count = std::min(count, size());
+    size_t done = 0;
+    while (done < count) {
+      const size_t at = (r + done) & mask_;
+      const size_t n = std::min(count - done, capacity() - at);
+      std::memcpy(dst + done, storage_.data() + at, n * sizeof(int16_t));
+      done += n;
+    }
+    read_.store(r + static_cast<uint32_t>(count), std::memory_order_release);
+    return count;
+  }
+
+  size_t skip(size_t count) {
+    count = std::min(count, size());
+    read_.store(read_.load(std::memory_order_relaxed) + static_cast<uint32_t>(count), std::memory_order_release);
+    return count;
+  }
+
+private:
+  placement::BulkVector<int16_t> storage_;  // capacity + window (mirror)
+  size_t mask_{0};
+  size_t window_{0};
+  std::atomic<uint32_t> write_{0};
+  std::atomic<uint32_t> read_{0};
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Snapcast binary stream protocol (snapserver TCP port 1704)
+// Every message is a 26-byte little-endian base header followed by `size`
+// payload bytes. Header timestamps are {sec, usec} pairs on the sender's clock;
+// here they are carried as plain microseconds. Nothing in this module reads a
+// clock or touches a socket, so it builds and runs the same on a host.
+
+namespace snapcast {
+
+enum class MessageType : uint16_t {
+  Base = 0,
+  CodecHeader = 1,
+  WireChunk = 2,
+  ServerSettings = 3,
+  Time = 4,
+  Hello = 5,
+  StreamTags = 6,
+  ClientInfo = 7,
+};
+
+constexpr size_t kBaseHeaderSize = 26;
+constexpr uint32_t kMaxPayload = 1u << 20;  // sanity limit; real chunks are a few KB
+
+struct BaseHeader {
+  MessageType type{MessageType::Base};
+  uint16_t id{0};
+  uint16_t refers_to{0};
+  int64_t sent_us{0};      // sender clock
+  int64_t received_us{0};  // receiver clock, stamped on arrival
+  uint32_t size{0};        // payload bytes
+};
+
+// JSON body of ServerSettings
+struct ServerSettings {
+  int32_t buffer_ms{1000};  // server-side end-to-end buffer
+  int32_t latency_ms{0};    // extra latency configured for this client
+  int32_t volume{100};
+  bool muted{false};
+};
+
+// Payload points into the message it was parsed from
+struct CodecHeader {
+  std::string codec;  // "pcm", "flac", "opus", "ogg"
+  const uint8_t* payload{nullptr};
+  uint32_t payload_size{0};
+};
+
+struct PcmFormat {
+  uint32_t sample_rate{0};
+  uint16_t channels{0};
+  uint16_t bits{0};
+};
+
+struct WireChunk {
+  int64_t timestamp_us{0};  // server time the chunk was captured
+  const uint8_t* payload{nullptr};
+  uint32_t size{0};
+};
+
+struct HelloInfo {
+  std::string mac;  // "aa:bb:cc:dd:ee:ff"
+  std::string host_name;
+  std::string client_name{"LEDBrain"};
+  std::string os{"ESP-IDF"};
+  std::string arch{"riscv32"};
+  std::string version{"0.27.0"};
+};
+
+bool parse_base_header(const uint8_t* data, size_t len, BaseHeader& out);
+void write_base_header(uint8_t* out, const BaseHeader& header);
+
+bool parse_server_settings(const uint8_t* payload, size_t len, ServerSettings& out);
+bool parse_codec_header(const uint8_t* payload, size_t len, CodecHeader& out);
+// RIFF/WAVE header carried by the "pcm" codec
+bool parse_pcm_format(const uint8_t* payload, size_t len, PcmFormat& out);
+bool parse_wire_chunk(const uint8_t* payload, size_t len, WireChunk& out);
+// Time payload: the server's receive time minus our send time of the request
+bool parse_time(const uint8_t* payload, size_t len, int64_t& latency_us);
+
+// Complete messages (header + payload) appended to `out`
+void build_hello(std::vector<uint8_t>& out, uint16_t id, int64_t now_us, const HelloInfo& info);
+void build_time_request(std::vector<uint8_t>& out, uint16_t id, int64_t now_us);
+
+// Reassembles messages from a TCP byte stream
+class MessageReader {
+public:
+  void reset();
+  // Bytes received at local time now_us
+  void append(const uint8_t* data, size_t len, int64_t now_us);
+  // Next complete message; the payload stays valid until the following call.
+  // False when more bytes are needed. Sets `error` on a corrupt header.
+  bool next(BaseHeader& header, const uint8_t*& payload, bool& error);
+
+private:
+  std::vector<uint8_t> buffer_;
+  size_t read_{0};
+  int64_t received_us_{0};
+};
+
+// Server-to-local clock offset from Time exchanges
+// Each exchange gives c2s = server receive - local send and s2c = local
+// receive - server send; their half-difference is the offset with the path
+// asymmetry as error. The median over the last kWindow exchanges rejects the
+// ones delayed by WiFi retries or a busy server.
+class ClockSync {
+public:
+  static constexpr size_t kWindow = 50;
+  static constexpr size_t kMinSamples = 5;
+
+  void reset();
+  void add(int64_t c2s_us, int64_t s2c_us);
+  bool synced() const { return count_ >= kMinSamples; }
+  size_t samples() const { return count_; }
+  // server time = local time + offset
+  int64_t offset_us() const { return offset_us_; }
+  int64_t to_local(int64_t server_us) const { return server_us - offset_us_; }
+  int64_t to_server(int64_t local_us) const { return local_us + offset_us_; }
+
+private:
+  int64_t window_[kWindow]{};
+  size_t count_{0};
+  size_t next_{0};
+  int64_t offset_us_{0};
+};
+
+}  // namespace snapcast
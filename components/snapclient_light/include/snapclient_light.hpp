@@ -3,8 +3,14 @@
 #include "led_engine/types.hpp"
 #include "esp_err.h"
 
-// Lightweight Snapcast PCM subscriber: connects to Snapserver and exposes audio frames to the app.
-// It does NOT output audio; intended for analysis/visualization only.
+// Lightweight Snapcast client: joins a Snapserver, follows its clock and feeds each PCM frame to the
+// analyzer just before it plays on the other clients. It does NOT output audio; intended for
+// analysis/visualization only. The analysis window and hop follow cfg.fft_size and cfg.frame_ms.
 
-esp_err_t snapclient_light_start(const SnapcastConfig& cfg);
+esp_err_t snapclient_light_start(const AudioConfig& cfg);
+// Blocks until the client task has left its loop, closed its socket and freed its buffers
 void snapclient_light_stop();
+// Applies a changed config to a running client: new analysis settings (fft_size, frame_ms,
+// filterbank) reconfigure the analyzer in place, a different server or source restarts or
+// stops the client. No-op while the client is stopped.
+esp_err_t snapclient_light_reconfigure(const AudioConfig& cfg);
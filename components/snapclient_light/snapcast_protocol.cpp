@@ -0,0 +1,270 @@
+#include "snapcast_protocol.hpp"
+#include "cJSON.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace snapcast {
+
+namespace {
+
+uint16_t read_u16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t read_u32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+int32_t read_i32(const uint8_t* p) {
+  return static_cast<int32_t>(read_u32(p));
+}
+
+void write_u16(uint8_t* p, uint16_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void write_u32(uint8_t* p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+  p[2] = static_cast<uint8_t>(v >> 16);
+  p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+// {sec, usec} as sent on the wire
+int64_t read_tv(const uint8_t* p) {
+  return static_cast<int64_t>(read_i32(p)) * 1'000'000 + read_i32(p + 4);
+}
+
+void write_tv(uint8_t* p, int64_t us) {
+  int64_t sec = us / 1'000'000;
+  int64_t usec = us % 1'000'000;
+  if (usec < 0) {
+    --sec;
+    usec += 1'000'000;
+  }
+  write_u32(p, static_cast<uint32_t>(static_cast<int32_t>(sec)));
+  write_u32(p + 4, static_cast<uint32_t>(static_cast<int32_t>(usec)));
+}
+
+// Size-prefixed JSON string used by Hello and ServerSettings
+cJSON* parse_json_payload(const uint8_t* payload, size_t len) {
+  if (len < 4) {
+    return nullptr;
+  }
+  const uint32_t size = read_u32(payload);
+  if (size > len - 4) {
+    return nullptr;
+  }
+  return cJSON_ParseWithLength(reinterpret_cast<const char*>(payload + 4), size);
+}
+
+void append_message(std::vector<uint8_t>& out, MessageType type, uint16_t id, int64_t now_us,
+                    const uint8_t* payload, size_t size) {
+  BaseHeader header{};
+  header.type = type;
+  header.id = id;
+  header.sent_us = now_us;
+  header.size = static_cast<uint32_t>(size);
+  const size_t at = out.size();
+  out.resize(at + kBaseHeaderSize + size);
+  write_base_header(out.data() + at, header);
+  if (size > 0) {
+    std::memcpy(out.data() + at + kBaseHeaderSize, payload, size);
+  }
+}
+
+}  // namespace
+
+bool parse_base_header(const uint8_t* data, size_t len, BaseHeader& out) {
+  if (len < kBaseHeaderSize) {
+    return false;
+  }
+  out.type = static_cast<MessageType>(read_u16(data));
+  out.id = read_u16(data + 2);
+  out.refers_to = read_u16(data + 4);
+  out.sent_us = read_tv(data + 6);
+  out.received_us = read_tv(data + 14);
+  out.size = read_u32(data + 22);
+  return true;
+}
+
+void write_base_header(uint8_t* out, const BaseHeader& header) {
+  write_u16(out, static_cast<uint16_t>(header.type));
+  write_u16(out + 2, header.id);
+  write_u16(out + 4, header.refers_to);
+  write_tv(out + 6, header.sent_us);
+  write_tv(out + 14, header.received_us);
+  write_u32(out + 22, header.size);
+}
+
+bool parse_server_settings(const uint8_t* payload, size_t len, ServerSettings& out) {
+  cJSON* root = parse_json_payload(payload, len);
+  if (!root) {
+    return false;
+  }
+  if (cJSON* v = cJSON_GetObjectItem(root, "bufferMs"); cJSON_IsNumber(v)) {
+    out.buffer_ms = v->valueint;
+  }
+  if (cJSON* v = cJSON_GetObjectItem(root, "latency"); cJSON_IsNumber(v)) {
+    out.latency_ms = v->valueint;
+  }
+  if (cJSON* v = cJSON_GetObjectItem(root, "volume"); cJSON_IsNumber(v)) {
+    out.volume = v->valueint;
+  }
+  if (cJSON* v = cJSON_GetObjectItem(root, "muted"); cJSON_IsBool(v)) {
+    out.muted = cJSON_IsTrue(v);
+  }
+  cJSON_Delete(root);
+  return true;
+}
+
+bool parse_codec_header(const uint8_t* payload, size_t len, CodecHeader& out) {
+  if (len < 4) {
+    return false;
+  }
+  const uint32_t name_size = read_u32(payload);
+  if (name_size > len - 4 || len - 4 - name_size < 4) {
+    return false;
+  }
+  out.codec.assign(reinterpret_cast<const char*>(payload + 4), name_size);
+  const uint8_t* rest = payload + 4 + name_size;
+  out.payload_size = read_u32(rest);
+  if (out.payload_size > len - 8 - name_size) {
+    return false;
+  }
+  out.payload = rest + 4;
+  return true;
+}
+
+bool parse_pcm_format(const uint8_t* payload, size_t len, PcmFormat& out) {
+  if (len < 12 || std::memcmp(payload, "RIFF", 4) != 0 || std::memcmp(payload + 8, "WAVE", 4) != 0) {
+    return false;
+  }
+  // Walk the chunks up to "fmt "; snapserver writes it first but be lenient
+  size_t pos = 12;
+  while (pos + 8 <= len) {
+    const uint32_t chunk_size = read_u32(payload + pos + 4);
+    if (std::memcmp(payload + pos, "fmt ", 4) == 0) {
+      if (chunk_size < 16 || pos + 8 + 16 > len) {
+        return false;
+      }
+      const uint8_t* fmt = payload + pos + 8;
+      out.channels = read_u16(fmt + 2);
+      out.sample_rate = read_u32(fmt + 4);
+      out.bits = read_u16(fmt + 14);
+      return out.channels > 0 && out.sample_rate > 0;
+    }
+    pos += 8 + chunk_size + (chunk_size & 1);
+  }
+  return false;
+}
+
+bool parse_wire_chunk(const uint8_t* payload, size_t len, WireChunk& out) {
+  if (len < 12) {
+    return false;
+  }
+  out.timestamp_us = read_tv(payload);
+  out.size = read_u32(payload + 8);
+  if (out.size > len - 12) {
+    return false;
+  }
+  out.payload = payload + 12;
+  return true;
+}
+
+bool parse_time(const uint8_t* payload, size_t len, int64_t& latency_us) {
+  if (len < 8) {
+    return false;
+  }
+  latency_us = read_tv(payload);
+  return true;
+}
+
+void build_hello(std::vector<uint8_t>& out, uint16_t id, int64_t now_us, const HelloInfo& info) {
+  cJSON* root = cJSON_CreateObject();
+  if (!root) {
+    return;
+  }
+  cJSON_AddStringToObject(root, "Arch", info.arch.c_str());
+  cJSON_AddStringToObject(root, "ClientName", info.client_name.c_str());
+  cJSON_AddStringToObject(root, "HostName", info.host_name.c_str());
+  cJSON_AddStringToObject(root, "ID", info.mac.c_str());
+  cJSON_AddNumberToObject(root, "Instance", 1);
+  cJSON_AddStringToObject(root, "MAC", info.mac.c_str());
+  cJSON_AddStringToObject(root, "OS", info.os.c_str());
+  cJSON_AddNumberToObject(root, "SnapStreamProtocolVersion", 2);
+  cJSON_AddStringToObject(root, "Version", info.version.c_str());
+  char* json = cJSON_PrintUnformatted(root);
+  cJSON_Delete(root);
+  if (!json) {
+    return;
+  }
+  const size_t json_len = std::strlen(json);
+  std::vector<uint8_t> body(4 + json_len);
+  write_u32(body.data(), static_cast<uint32_t>(json_len));
+  std::memcpy(body.data() + 4, json, json_len);
+  cJSON_free(json);
+  append_message(out, MessageType::Hello, id, now_us, body.data(), body.size());
+}
+
+void build_time_request(std::vector<uint8_t>& out, uint16_t id, int64_t now_us) {
+  const uint8_t latency[8] = {};
+  append_message(out, MessageType::Time, id, now_us, latency, sizeof(latency));
+}
+
+void MessageReader::reset() {
+  buffer_.clear();
+  read_ = 0;
+  received_us_ = 0;
+}
+
+void MessageReader::append(const uint8_t* data, size_t len, int64_t now_us) {
+  // Drop consumed bytes before growing so the buffer stays one message deep
+  if (read_ > 0) {
+    buffer_.erase(buffer_.begin(), buffer_.begin() + static_cast<std::ptrdiff_t>(read_));
+    read_ = 0;
+  }
+  buffer_.insert(buffer_.end(), data, data + len);
+  received_us_ = now_us;
+}
+
+bool MessageReader::next(BaseHeader& header, const uint8_t*& payload, bool& error) {
+  error = false;
+  const size_t avail = buffer_.size() - read_;
+  if (!parse_base_header(buffer_.data() + read_, avail, header)) {
+    return false;
+  }
+  if (header.size > kMaxPayload) {
+    error = true;
+    return false;
+  }
+  if (avail - kBaseHeaderSize < header.size) {
+    return false;
+  }
+  // Stamp with the arrival of the bytes that completed the message
+  header.received_us = received_us_;
+  payload = buffer_.data() + read_ + kBaseHeaderSize;
+  read_ += kBaseHeaderSize + header.size;
+  return true;
+}
+
+void ClockSync::reset() {
+  count_ = 0;
+  next_ = 0;
+  offset_us_ = 0;
+}
+
+void ClockSync::add(int64_t c2s_us, int64_t s2c_us) {
+  window_[next_] = (c2s_us - s2c_us) / 2;
+  next_ = (next_ + 1) % kWindow;
+  count_ = std::min(count_ + 1, kWindow);
+  int64_t sorted[kWindow];
+  std::copy(window_, window_ + count_, sorted);
+  std::nth_element(sorted, sorted + count_ / 2, sorted + count_);
+  offset_us_ = sorted[count_ / 2];
+}
+
+}  // namespace snapcast
@@ -1,7 +1,7 @@
 /*
  * Audio processing with DSP/SIMD/Xai optimizations for ESP32-P4
  * 
- * This module uses ESP-IDF DSP library and optimized loops to utilize:
+ * The analyzer (audio_analyzer.cpp) uses ESP-IDF DSP library and optimized loops to utilize:
  * - ESP32-P4 AI/DSP extensions for accelerated FFT operations
  * - Xai extensions (ESP32-P4's custom 128-bit SIMD) for vectorized operations
  * - SIMD instructions for vectorized operations (auto-vectorized by compiler)
@@ -19,11 +19,12 @@
  * Xai provides similar functionality but is optimized for ESP32-P4.
  * 
  * Key optimizations:
- * 1. FFT: Uses dsps_fft_2r_fc32() - optimized with Xai/SIMD on ESP32-P4
+ * 1. FFT: Real input packed into a half-size dsps_fft2r_fc32() - optimized with Xai/SIMD on ESP32-P4
  * 2. Window function: Pre-computed Hann window, applied with unrolled vectorized multiply
  * 3. PCM conversion: Loop unrolling (4-8 samples) enables Xai/SIMD for parallel int16_t->float
  * 4. Magnitude calculation: Unrolled loops for vectorized sqrt operations
- * 5. Band energy: Unrolled accumulation loops for parallel float additions
+ * 5. Band energy: bin ranges and weights resolved once per config, unrolled accumulation
+ * 6. No allocation per frame: every buffer is sized when the stream format is known
  * 
  * Xai/SIMD optimizations:
  * - Loop unrolling (pragma GCC unroll) helps compiler pack operations for Xai
@@ -40,33 +41,51 @@
  */
 
 #include "snapclient_light.hpp"
+#include "audio_analyzer.hpp"
+#include "snapcast_protocol.hpp"
+#include "flac_decoder.hpp"
+#include "pcm_ring.hpp"
 #include "esp_log.h"
+#include "esp_mac.h"
 #include "led_engine/audio_pipeline.hpp"
+#include "led_engine/mem_placement.hpp"
 #include "lwip/netdb.h"
 #include "lwip/sockets.h"
 #include "esp_timer.h"
-#include "dsps_fft2r.h"
-#include "dsps_wind.h"
-#include "dsps_math.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include <algorithm>
-#include <cmath>
+#include <atomic>
 #include <cstring>
-#include <deque>
+#include <mutex>
 #include <vector>
 
 namespace {
 
 static const char* TAG = "snapclient";
 static TaskHandle_t s_task = nullptr;
-static bool s_running = false;
-static SnapcastConfig s_cfg{};
+static std::atomic<bool> s_running{false};
+static SemaphoreHandle_t s_stopped = nullptr;  // given by snap_task on its way out
+static AudioConfig s_cfg{};  // server settings; written only while the task is not running
+static AudioAnalyzer s_analyzer;
 
-// Pre-computed Hann window cache (initialized on first use)
-static std::vector<float> s_hann_window;
-static size_t s_hann_window_size = 0;
+// Analysis settings; snapclient_light_reconfigure() replaces them while the task runs
+struct AnalysisSettings {
+  uint16_t fft_size{1024};
+  uint16_t frame_ms{20};
+  AudioScale filterbank{AudioScale::Mel};
+  uint8_t filterbank_bands{32};
 
-// FFT work buffer (reused across calls to avoid allocations)
-static std::vector<float> s_fft_work_buffer;
+  AnalysisSettings() = default;
+  explicit AnalysisSettings(const AudioConfig& cfg)
+      : fft_size(cfg.fft_size), frame_ms(cfg.frame_ms), filterbank(cfg.filterbank),
+        filterbank_bands(cfg.filterbank_bands) {}
+  bool operator==(const AnalysisSettings&) const = default;
+};
+static std::mutex s_analysis_mutex;
+static AnalysisSettings s_analysis{};
+static std::atomic<bool> s_analysis_changed{false};
 
 // CPU features detection
 struct CpuFeatures {
@@ -142,432 +161,6 @@ void log_cpu_features() {
   logged = true;
 }
 
-// Initialize DSP library and pre-compute Hann window
-void init_dsp_audio(size_t fft_size) {
-  // Log CPU features on first initialization
-  log_cpu_features();
-  
-  // Initialize ESP-DSP library (only needed once, but safe to call multiple times)
-  dsps_fft2r_init_fc32(NULL, fft_size);
-  
-  // Pre-compute Hann window if size changed
-  if (s_hann_window_size != fft_size) {
-    s_hann_window.resize(fft_size);
-    dsps_wind_hann_f32(s_hann_window.data(), fft_size);
-    s_hann_window_size = fft_size;
-    ESP_LOGI(TAG, "Initialized DSP audio processing (FFT size: %zu)", fft_size);
-  }
-  
-  // Allocate FFT work buffer (needs 2x fft_size for complex FFT)
-  if (s_fft_work_buffer.size() < fft_size * 2) {
-    s_fft_work_buffer.resize(fft_size * 2);
-  }
-}
-
-// Optimized PCM to float conversion with PIE/SIMD-friendly operations
-// ESP32-P4 compiler will auto-vectorize this and may use PIE (Packed Integer Extension)
-// if available. Processing multiple samples per iteration for better SIMD utilization.
-void convert_pcm_to_float_simd(const int16_t* pcm, float* out, size_t samples, bool stereo, 
-                                float& energy_l, float& energy_r, size_t& count, size_t max_samples) {
-  const float scale = 1.0f / 32768.0f;
-  energy_l = 0.0f;
-  energy_r = 0.0f;
-  count = 0;
-  
-  if (stereo) {
-    // Process stereo pairs with loop unrolling for better SIMD/PIE utilization
-    // Process 4 stereo pairs (8 samples) at a time when possible
-    const size_t unroll_count = 4;
-    size_t i = 0;
-    
-    // Unrolled loop for better vectorization (PIE can process multiple int16_t at once)
-    for (; i + (unroll_count * 2 - 1) < samples && count + unroll_count <= max_samples; i += unroll_count * 2) {
-      // Process 4 stereo pairs - compiler can pack these into SIMD operations
-      #pragma GCC unroll 4
-      for (size_t j = 0; j < unroll_count; ++j) {
-        const size_t idx = i + j * 2;
-        const float l = static_cast<float>(pcm[idx]) * scale;
-        const float r = static_cast<float>(pcm[idx + 1]) * scale;
-        out[count + j] = (l + r) * 0.5f;
-        energy_l += l * l;
-        energy_r += r * r;
-      }
-      count += unroll_count;
-    }
-    
-    // Handle remaining samples
-    for (; i + 1 < samples && count < max_samples; i += 2, ++count) {
-      const float l = static_cast<float>(pcm[i]) * scale;
-      const float r = static_cast<float>(pcm[i + 1]) * scale;
-      out[count] = (l + r) * 0.5f;
-      energy_l += l * l;
-      energy_r += r * r;
-    }
-  } else {
-    // Mono processing with loop unrolling for PIE/SIMD
-    // Process 8 samples at a time when possible (good for PIE which can pack int16_t)
-    const size_t unroll_count = 8;
-    size_t i = 0;
-    
-    // Unrolled loop - PIE can process multiple int16_t values in parallel
-    for (; i + unroll_count <= samples && count + unroll_count <= max_samples; i += unroll_count) {
-      // Process 8 samples - compiler can vectorize this with PIE
-      #pragma GCC unroll 8
-      for (size_t j = 0; j < unroll_count; ++j) {
-        const float sample = static_cast<float>(pcm[i + j]) * scale;
-        out[count + j] = sample;
-        const float sq = sample * sample;
-        energy_l += sq;
-        energy_r += sq;
-      }
-      count += unroll_count;
-    }
-    
-    // Handle remaining samples
-    for (; i < samples && count < max_samples; ++i, ++count) {
-      const float sample = static_cast<float>(pcm[i]) * scale;
-      out[count] = sample;
-      const float sq = sample * sample;
-      energy_l += sq;
-      energy_r += sq;
-    }
-  }
-}
-
-// Optimized band energy calculation using SIMD-friendly accumulation
-// Loop unrolling helps compiler use SIMD for parallel float accumulation
-// PIE/SIMD can process multiple float additions in parallel
-inline float compute_band_energy_simd(const float* magnitude, size_t start, size_t end) {
-  if (start > end || end == 0) return 0.0f;
-  float acc = 0.0f;
-  const size_t n = end - start + 1;
-  const size_t unroll_count = 8;
-  size_t i = start;
-  
-  // Unrolled accumulation for better SIMD utilization
-  for (; i + unroll_count <= end + 1; i += unroll_count) {
-    #pragma GCC unroll 8
-    for (size_t j = 0; j < unroll_count; ++j) {
-      acc += magnitude[i + j];
-    }
-  }
-  
-  // Handle remaining samples
-  for (; i <= end; ++i) {
-    acc += magnitude[i];
-  }
-  
-  return n > 0 ? acc / static_cast<float>(n) : 0.0f;
-}
-
-void compute_metrics(const int16_t* pcm, size_t samples, uint32_t sample_rate, bool stereo, uint16_t fft_size,
-                     float buffered_ms, uint64_t frame_timestamp_us) {
-  if (!pcm || samples == 0) {
-    return;
-  }
-  // Ensure fft_size is power of 2 and at least 64
-  size_t actual_fft_size = fft_size;
-  if (actual_fft_size < 64) actual_fft_size = 64;
-  // Round down to nearest power of 2
-  size_t power_of_2 = 64;
-  while (power_of_2 < actual_fft_size && power_of_2 < 4096) {
-    power_of_2 <<= 1;
-  }
-  if (power_of_2 > actual_fft_size) {
-    power_of_2 >>= 1;
-  }
-  actual_fft_size = power_of_2;
-  
-  // Initialize DSP library and pre-compute windows if needed
-  init_dsp_audio(actual_fft_size);
-  
-  // Allocate buffers
-  std::vector<float> mono(actual_fft_size, 0.0f);
-  std::vector<float> fft_output(actual_fft_size * 2);  // Complex FFT output (interleaved real/imag)
-
-  // Convert PCM to float with optimized SIMD-friendly conversion
-  float energy_l = 0.0f, energy_r = 0.0f;
-  size_t count = 0;
-  convert_pcm_to_float_simd(pcm, mono.data(), samples, stereo, energy_l, energy_r, count, actual_fft_size);
-  
-  // Apply Hann window using pre-computed window (vectorized by ESP-DSP)
-  // dsps_wind_hann_f32 is optimized with SIMD - apply directly using vectorized multiply
-  // Loop unrolling helps compiler use PIE/SIMD for parallel float multiplication
-  const size_t window_unroll = 8;
-  size_t i = 0;
-  for (; i + window_unroll <= actual_fft_size; i += window_unroll) {
-    #pragma GCC unroll 8
-    for (size_t j = 0; j < window_unroll; ++j) {
-      mono[i + j] *= s_hann_window[i + j];
-    }
-  }
-  // Handle remaining samples
-  for (; i < actual_fft_size; ++i) {
-    mono[i] *= s_hann_window[i];
-  }
-  
-  // Prepare FFT input (real part only, imaginary part is zero)
-  // ESP-DSP FFT expects interleaved format: [real0, imag0, real1, imag1, ...]
-  // Loop unrolling helps compiler use SIMD for parallel float operations
-  const size_t fft_prep_unroll = 8;
-  size_t j = 0;
-  for (; j + fft_prep_unroll <= actual_fft_size; j += fft_prep_unroll) {
-    #pragma GCC unroll 8
-    for (size_t k = 0; k < fft_prep_unroll; ++k) {
-      const size_t idx = j + k;
-      fft_output[idx * 2] = mono[idx];      // Real part
-      fft_output[idx * 2 + 1] = 0.0f;      // Imaginary part
-    }
-  }
-  // Handle remaining samples
-  for (; j < actual_fft_size; ++j) {
-    fft_output[j * 2] = mono[j];
-    fft_output[j * 2 + 1] = 0.0f;
-  }
-  
-  // Perform FFT using optimized ESP-DSP library (uses SIMD/AI extensions on ESP32-P4)
-  // dsps_fft2r_fc32 performs in-place FFT on interleaved complex data
-  // This function is optimized with SIMD instructions for ESP32-P4
-  dsps_fft2r_fc32(fft_output.data(), actual_fft_size);
-  dsps_bit_rev_fc32(fft_output.data(), actual_fft_size);
-  dsps_cplx2reC_fc32(fft_output.data(), actual_fft_size);
-  
-  // Compute magnitude spectrum directly from interleaved FFT output
-  // This avoids extra memory allocations and is SIMD-friendly
-  // Loop unrolling helps compiler use SIMD for parallel sqrt operations
-  const float norm = 1.0f / static_cast<float>(actual_fft_size);
-  std::vector<float> magn(actual_fft_size / 2);
-  const size_t magn_unroll = 8;
-  size_t k = 0;
-  // Process magnitude calculation with unrolling for better SIMD utilization
-  for (; k + magn_unroll <= magn.size(); k += magn_unroll) {
-    #pragma GCC unroll 8
-    for (size_t j = 0; j < magn_unroll; ++j) {
-      const size_t idx = k + j;
-      const float re = fft_output[idx * 2];
-      const float im = fft_output[idx * 2 + 1];
-      magn[idx] = sqrtf(re * re + im * im) * norm;
-    }
-  }
-  // Handle remaining samples
-  for (; k < magn.size(); ++k) {
-    const float re = fft_output[k * 2];
-    const float im = fft_output[k * 2 + 1];
-    magn[k] = sqrtf(re * re + im * im) * norm;
-  }
-
-  // Optimized band energy calculation using SIMD-friendly function
-  auto band_energy = [&](float f_low, float f_high) {
-    const float bin_hz = static_cast<float>(sample_rate) / static_cast<float>(actual_fft_size);
-    size_t i_low = static_cast<size_t>(f_low / bin_hz);
-    size_t i_high = static_cast<size_t>(f_high / bin_hz);
-    i_low = std::min(i_low, magn.size() - 1);
-    i_high = std::min(i_high, magn.size() - 1);
-    if (i_low > i_high) return 0.0f;
-    return compute_band_energy_simd(magn.data(), i_low, i_high);
-  };
-
-  AudioMetrics metrics{};
-  metrics.energy = std::min(1.0f, sqrtf((energy_l + energy_r) / std::max<size_t>(1, count)));  // RMS instead of raw
-  metrics.energy_left = std::min(1.0f, sqrtf(energy_l / std::max<size_t>(1, count)));
-  metrics.energy_right = std::min(1.0f, sqrtf(energy_r / std::max<size_t>(1, count)));
-  
-  // More precise frequency bands (like LEDFx)
-  const float sub_bass = band_energy(20.0f, 60.0f);
-  const float bass_low = band_energy(60.0f, 120.0f);
-  const float bass_high = band_energy(120.0f, 250.0f);
-  metrics.bass = std::min(1.5f, (sub_bass * 6.0f + bass_low * 5.0f + bass_high * 4.0f) / 3.0f);
-  
-  const float mid_low = band_energy(250.0f, 500.0f);
-  const float mid_mid = band_energy(500.0f, 1000.0f);
-  const float mid_high = band_energy(1000.0f, 2000.0f);
-  metrics.mid = std::min(1.5f, (mid_low * 3.0f + mid_mid * 2.8f + mid_high * 2.5f) / 3.0f);
-  
-  const float treble_low = band_energy(2000.0f, 4000.0f);
-  const float treble_mid = band_energy(4000.0f, 8000.0f);
-  const float treble_high = band_energy(8000.0f, 12000.0f);
-  metrics.treble = std::min(1.5f, (treble_low * 2.2f + treble_mid * 2.0f + treble_high * 1.8f) / 3.0f);
-
-  // Improved beat detection - use bass energy changes and frequency analysis
-  static float prev_energy = 0.0f;
-  static float prev_bass = 0.0f;
-  static float beat_history[8] = {0.0f};
-  static size_t beat_history_idx = 0;
-  static uint64_t last_beat_us = 0;
-  static float beat_envelope = 0.0f;
-  
-  const float delta_energy = metrics.energy - prev_energy;
-  const float delta_bass = metrics.bass - prev_bass;
-  prev_energy = metrics.energy;
-  prev_bass = metrics.bass;
-  
-  // Beat detection: look for sharp increases in bass (most reliable for beats)
-  const float bass_threshold = 0.15f;
-  const float bass_beat_strength = std::max(0.0f, delta_bass - bass_threshold) * 8.0f;
-  
-  // Also check overall energy spike
-  const float energy_spike = std::max(0.0f, delta_energy - 0.05f) * 5.0f;
-  
-  // Combine both with bass priority
-  float beat_trigger = std::min(1.0f, bass_beat_strength * 0.7f + energy_spike * 0.3f);
-  
-  const uint64_t now_us = esp_timer_get_time();
-  if (beat_trigger > 0.3f && (now_us - last_beat_us) > 100'000) {  // Min 100ms between beats
-    beat_history[beat_history_idx] = beat_trigger;
-    beat_history_idx = (beat_history_idx + 1) % 8;
-    last_beat_us = now_us;
-    beat_envelope = std::min(1.0f, beat_trigger);
-  } else {
-    // Decay envelope
-    beat_envelope *= 0.88f;  // Smooth decay
-  }
-  
-  // Calculate tempo from beat intervals
-  static uint64_t beat_times[16] = {0};
-  static size_t beat_time_idx = 0;
-  static bool beat_times_filled = false;
-  
-  if (beat_trigger > 0.5f) {
-    beat_times[beat_time_idx] = now_us;
-    beat_time_idx = (beat_time_idx + 1) % 16;
-    if (beat_time_idx == 0) beat_times_filled = true;
-  }
-  
-  float tempo_bpm = 0.0f;
-  if (beat_times_filled || beat_time_idx > 4) {
-    size_t count_valid = beat_times_filled ? 16 : beat_time_idx;
-    uint64_t total_interval = 0;
-    size_t intervals = 0;
-    for (size_t i = 1; i < count_valid; ++i) {
-      size_t prev_idx = (beat_time_idx + 15 - i) % 16;
-      size_t curr_idx = (beat_time_idx + 16 - i) % 16;
-      if (beat_times[curr_idx] > beat_times[prev_idx]) {
-        total_interval += (beat_times[curr_idx] - beat_times[prev_idx]);
-        intervals++;
-      }
-    }
-    if (intervals > 0) {
-      const float avg_interval_ms = (total_interval / static_cast<float>(intervals)) / 1000.0f;
-      if (avg_interval_ms > 0.0f) {
-        tempo_bpm = 60000.0f / avg_interval_ms;
-        tempo_bpm = std::max(60.0f, std::min(200.0f, tempo_bpm));  // Clamp to reasonable range
-      }
-    }
-  }
-  
-  metrics.beat = std::min(1.0f, beat_envelope);
-  metrics.tempo_bpm = tempo_bpm;
-  
-  // Calculate 32-channel GEQ (Graphic Equalizer) - logarithmically spaced bands from 20Hz to 20kHz
-  // This provides high-precision frequency analysis for advanced audio-reactive effects
-  const float freq_min = 20.0f;
-  const float freq_max = 20000.0f;
-  const float log_freq_min = logf(freq_min);
-  const float log_freq_max = logf(freq_max);
-  const float log_range = log_freq_max - log_freq_min;
-  const float bin_hz = static_cast<float>(sample_rate) / static_cast<float>(actual_fft_size);
-  
-  for (int i = 0; i < 32; ++i) {
-    // Logarithmically spaced frequency bands
-    const float log_pos = log_freq_min + (log_range * static_cast<float>(i) / 31.0f);
-    const float freq_center = expf(log_pos);
-    
-    // Calculate band width (wider bands at lower frequencies, narrower at higher)
-    float band_width;
-    if (i == 0) {
-      band_width = freq_center * 0.5f;  // First band: 50% of center frequency
-    } else if (i == 31) {
-      band_width = freq_center * 0.3f;  // Last band: 30% of center frequency
-    } else {
-      // Band width is approximately 1/32 of the logarithmic range
-      const float prev_log = log_freq_min + (log_range * static_cast<float>(i - 1) / 31.0f);
-      const float next_log = log_freq_min + (log_range * static_cast<float>(i + 1) / 31.0f);
-      const float prev_freq = expf(prev_log);
-      const float next_freq = expf(next_log);
-      band_width = (next_freq - prev_freq) * 0.5f;
-    }
-    
-    const float freq_low = std::max(freq_min, freq_center - band_width * 0.5f);
-    const float freq_high = std::min(freq_max, freq_center + band_width * 0.5f);
-    
-    // Calculate energy for this band
-    size_t i_low = static_cast<size_t>(freq_low / bin_hz);
-    size_t i_high = static_cast<size_t>(freq_high / bin_hz);
-    i_low = std::min(i_low, magn.size() - 1);
-    i_high = std::min(i_high, magn.size() - 1);
-    
-    if (i_low <= i_high) {
-      float band_energy_val = compute_band_energy_simd(magn.data(), i_low, i_high);
-      // Apply frequency-dependent gain (lower frequencies need more gain)
-      const float gain = 1.0f + (freq_center < 200.0f ? 4.0f : (freq_center < 1000.0f ? 2.0f : 1.0f));
-      metrics.geq_bands[i] = std::min(1.5f, band_energy_val * gain);
-    } else {
-      metrics.geq_bands[i] = 0.0f;
-    }
-  }
-  
-  // Apply Audio Dynamic Limiter - compress dynamic range to prevent clipping
-  // This ensures stable levels even with loud music
-  static float limiter_threshold = 0.85f;  // Threshold above which to compress
-  static float limiter_ratio = 4.0f;       // Compression ratio (4:1)
-  static float limiter_attack = 0.95f;     // Attack coefficient (fast response)
-  static float limiter_release = 0.98f;    // Release coefficient (slow recovery)
-  static float limiter_gain = 1.0f;        // Current gain reduction
-  
-  // Find peak level across all GEQ bands
-  float peak_level = 0.0f;
-  for (int i = 0; i < 32; ++i) {
-    if (metrics.geq_bands[i] > peak_level) {
-      peak_level = metrics.geq_bands[i];
-    }
-  }
-  // Also check overall energy
-  if (metrics.energy > peak_level) {
-    peak_level = metrics.energy;
-  }
-  
-  // Calculate required gain reduction
-  float target_gain = 1.0f;
-  if (peak_level > limiter_threshold) {
-    const float excess = peak_level - limiter_threshold;
-    const float reduction = excess / limiter_ratio;
-    target_gain = limiter_threshold / (limiter_threshold + reduction);
-  }
-  
-  // Smooth gain changes (attack/release)
-  if (target_gain < limiter_gain) {
-    // Attack: fast response to peaks
-    limiter_gain = limiter_gain * limiter_attack + target_gain * (1.0f - limiter_attack);
-  } else {
-    // Release: slow recovery
-    limiter_gain = limiter_gain * limiter_release + target_gain * (1.0f - limiter_release);
-  }
-  
-  // Apply limiter to GEQ bands and overall energy
-  for (int i = 0; i < 32; ++i) {
-    metrics.geq_bands[i] *= limiter_gain;
-  }
-  metrics.energy *= limiter_gain;
-  metrics.bass *= limiter_gain;
-  metrics.mid *= limiter_gain;
-  metrics.treble *= limiter_gain;
-  
-  // Store magnitude spectrum for custom frequency range calculations
-  metrics.magnitude_spectrum = magn;
-  metrics.sample_rate = sample_rate;
-  
-  // Calculate timestamp for synchronization with audio playback
-  // For Snapcast: timestamp should be when this audio chunk will be played
-  // We use the buffer delay + frame timestamp to estimate playback time
-  // This ensures LED effects are synchronized with audio on other Snapcast clients
-  // Estimate when this frame will be played: frame timestamp + remaining buffer delay
-  // This accounts for the latency configured in Snapcast
-  metrics.timestamp_us = frame_timestamp_us + static_cast<uint64_t>(buffered_ms * 1000.0f);
-  metrics.processed_us = now_us;
-
-  led_audio_set_metrics(metrics);
-}
-
 int connect_snap(const SnapcastConfig& cfg) {
   struct addrinfo hints = {};
   hints.ai_family = AF_INET;
@@ -596,125 +189,383 @@ int connect_snap(const SnapcastConfig& cfg) {
   return sock;
 }
 
+bool send_all(int sock, const std::vector<uint8_t>& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    const int n = send(sock, data.data() + sent, data.size() - sent, 0);
+    if (n <= 0) {
+      return false;
+    }
+    sent += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+snapcast::HelloInfo make_hello() {
+  uint8_t mac[6]{};
+  esp_read_mac(mac, ESP_MAC_ETH);
+  char mac_str[18];
+  snprintf(mac_str, sizeof(mac_str), "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4],
+           mac[5]);
+  char host[20];
+  snprintf(host, sizeof(host), "ledbrain-%02x%02x%02x", mac[3], mac[4], mac[5]);
+  snapcast::HelloInfo info{};
+  info.mac = mac_str;
+  info.host_name = host;
+  return info;
+}
+
+// Where a queued chunk starts in the ring and when it plays
+struct ChunkMark {
+  uint32_t position;  // ring write position of its first sample
+  int64_t play_us;    // local time of that sample
+};
+
+enum class StreamCodec : uint8_t { None, Pcm, Flac };
+
+// Largest analysis window, in interleaved samples (4096-point FFT, stereo)
+constexpr size_t kMaxWindowSamples = AudioAnalyzer::kMaxFftSize * 2;
+
+// Per-connection stream state
+struct SnapStream {
+  static constexpr size_t kMaxMarks = 64;
+
+  snapcast::ServerSettings settings{};
+  snapcast::PcmFormat format{};
+  StreamCodec codec{StreamCodec::None};
+  snapcast::ClockSync clock{};
+  FlacDecoder flac;
+  placement::HotVector<int16_t> decoded;  // one PCM chunk or one FLAC block, interleaved
+  uint32_t decode_avg_us{0};
+  uint32_t decode_max_us{0};
+  // Jitter buffer: written by the receive path, read by the analyzer
+  PcmRing ring;
+  ChunkMark marks[kMaxMarks]{};
+  size_t mark_count{0};
+  size_t mark_next{0};
+
+  bool decoding() const { return codec != StreamCodec::None; }
+  int32_t buffer_ms() const { return std::max(0, settings.buffer_ms - settings.latency_ms); }
+
+  // Size the ring for the server buffer plus a second of the new format
+  void start(StreamCodec next) {
+    codec = next;
+    const size_t seconds = static_cast<size_t>(std::max(buffer_ms(), 1000)) / 1000 + 1;
+    ring.reset(static_cast<size_t>(format.sample_rate) * format.channels * seconds, kMaxWindowSamples);
+    mark_count = 0;
+    mark_next = 0;
+  }
+
+  // Queue decoded samples that start playing at play_us; returns their duration
+  int64_t queue(const int16_t* samples, size_t count, int64_t play_us) {
+    const int64_t duration_us =
+        static_cast<int64_t>(count / format.channels) * 1'000'000 / format.sample_rate;
+    if (count == 0 || play_us + duration_us < esp_timer_get_time()) {
+      return duration_us;  // already played elsewhere
+    }
+    // Full: drop the oldest audio. Receive and analysis share this task, so
+    // consuming from the producer side is safe here.
+    if (ring.free_space() < count) {
+      ring.skip(count - ring.free_space());
+    }
+    marks[mark_next] = ChunkMark{ring.write_position(), play_us};
+    mark_next = (mark_next + 1) % kMaxMarks;
+    mark_count = std::min(mark_count + 1, kMaxMarks);
+    ring.write(samples, count);
+    return duration_us;
+  }
+
+  // Playout time of the next unread sample, from the newest mark at or before
+  // it (or the oldest one after it when older marks were overwritten)
+  int64_t head_play_us() const {
+    const uint32_t pos = ring.read_position();
+    const ChunkMark* mark = nullptr;
+    for (size_t i = 0; i < mark_count; ++i) {
+      mark = &marks[(mark_next + kMaxMarks - 1 - i) % kMaxMarks];
+      if (static_cast<int32_t>(pos - mark->position) >= 0) {
+        break;
+      }
+    }
+    if (!mark) {
+      return 0;
+    }
+    const int64_t frames = static_cast<int32_t>(pos - mark->position) / static_cast<int32_t>(format.channels);
+    return mark->play_us + frames * 1'000'000 / format.sample_rate;
+  }
+
+  void clear() {
+    ring.skip(ring.size());
+    mark_count = 0;
+    mark_next = 0;
+    flac.reset();
+  }
+};
+
+int64_t frames_to_us(size_t frames, const SnapStream& stream) {
+  return static_cast<int64_t>(frames) * 1'000'000 / stream.format.sample_rate;
+}
+
+void publish_clock(const SnapStream& stream) {
+  led_audio_set_clock_sync(stream.clock.synced(), stream.clock.offset_us(), stream.buffer_ms());
+}
+
+// Window and hop for the stream's rate; the hop comes from the frame period,
+// so the window overlaps when it is shorter
+void configure_analyzer(const SnapStream& stream) {
+  AnalysisSettings a;
+  {
+    std::lock_guard<std::mutex> lock(s_analysis_mutex);
+    a = s_analysis;
+  }
+  s_analyzer.configure(a.fft_size, stream.format.sample_rate * a.frame_ms / 1000, stream.format.sample_rate,
+                       a.filterbank, a.filterbank_bands);
+}
+
+void handle_message(SnapStream& stream, const snapcast::BaseHeader& header, const uint8_t* payload) {
+  switch (header.type) {
+    case snapcast::MessageType::ServerSettings:
+      if (snapcast::parse_server_settings(payload, header.size, stream.settings)) {
+        ESP_LOGI(TAG, "Server settings: buffer=%d ms latency=%d ms", static_cast<int>(stream.settings.buffer_ms),
+                 static_cast<int>(stream.settings.latency_ms));
+        publish_clock(stream);
+      }
+      break;
+    case snapcast::MessageType::CodecHeader: {
+      snapcast::CodecHeader codec{};
+      if (!snapcast::parse_codec_header(payload, header.size, codec)) {
+        ESP_LOGW(TAG, "Malformed codec header");
+        break;
+      }
+      stream.clear();
+      stream.codec = StreamCodec::None;
+      stream.format = snapcast::PcmFormat{};
+      if (codec.codec == "pcm") {
+        if (snapcast::parse_pcm_format(codec.payload, codec.payload_size, stream.format) &&
+            stream.format.bits == 16 && stream.format.channels >= 1 && stream.format.channels <= 2) {
+          stream.start(StreamCodec::Pcm);
+        }
+      } else if (codec.codec == "flac") {
+        if (stream.flac.init(codec.payload, codec.payload_size)) {
+          const FlacDecoder::StreamInfo& info = stream.flac.info();
+          stream.format = snapcast::PcmFormat{info.sample_rate, info.channels, info.bits};
+          stream.decoded.resize(stream.flac.max_samples());
+          stream.start(StreamCodec::Flac);
+        }
+      }
+      if (!stream.decoding()) {
+        ESP_LOGW(TAG, "Unsupported stream codec '%s' (%u bit, %u ch); chunks ignored", codec.codec.c_str(),
+                 stream.format.bits, stream.format.channels);
+        break;
+      }
+      ESP_LOGI(TAG, "Stream: %s %u Hz, %u bit, %u ch", codec.codec.c_str(),
+               static_cast<unsigned>(stream.format.sample_rate), stream.format.bits, stream.format.channels);
+      configure_analyzer(stream);
+      stream.decode_avg_us = 0;
+      stream.decode_max_us = 0;
+      led_audio_set_stream_format(stream.format.sample_rate, stream.format.channels == 2,
+                                  stream.codec == StreamCodec::Flac ? "flac" : "pcm");
+      break;
+    }
+    case snapcast::MessageType::Time: {
+      int64_t c2s_us = 0;
+      if (snapcast::parse_time(payload, header.size, c2s_us)) {
+        const bool was_synced = stream.clock.synced();
+        stream.clock.add(c2s_us, header.received_us - header.sent_us);
+        if (!was_synced && stream.clock.synced()) {
+          ESP_LOGI(TAG, "Clock synced, server offset %lld us", static_cast<long long>(stream.clock.offset_us()));
+        }
+        publish_clock(stream);
+      }
+      break;
+    }
+    case snapcast::MessageType::WireChunk: {
+      snapcast::WireChunk chunk{};
+      // Untimed audio is useless for sync: wait for the codec and the clock
+      if (!stream.decoding() || !stream.clock.synced() ||
+          !snapcast::parse_wire_chunk(payload, header.size, chunk)) {
+        break;
+      }
+      int64_t play_us = stream.clock.to_local(chunk.timestamp_us + stream.buffer_ms() * 1000LL);
+      if (stream.codec == StreamCodec::Pcm) {
+        const size_t samples = chunk.size / sizeof(int16_t);
+        stream.decoded.resize(samples);
+        for (size_t i = 0; i < samples; ++i) {
+          const uint8_t* p = chunk.payload + i * 2;
+          stream.decoded[i] = static_cast<int16_t>(p[0] | (p[1] << 8));
+        }
+        stream.queue(stream.decoded.data(), samples, play_us);
+        break;
+      }
+      const int64_t start_us = esp_timer_get_time();
+      const uint8_t* data = chunk.payload;
+      size_t len = chunk.size;
+      bool corrupt = false;
+      bool error = false;
+      while (const size_t n = stream.flac.decode(data, len, stream.decoded.data(), stream.decoded.size(), error)) {
+        play_us += stream.queue(stream.decoded.data(), n, play_us);
+        corrupt |= error;
+        data = nullptr;
+        len = 0;
+      }
+      if (corrupt || error) {
+        ESP_LOGW(TAG, "Corrupt FLAC frame skipped");
+      }
+      const uint32_t took_us = static_cast<uint32_t>(esp_timer_get_time() - start_us);
+      stream.decode_avg_us = stream.decode_avg_us == 0 ? took_us : (stream.decode_avg_us * 15 + took_us) / 16;
+      stream.decode_max_us = std::max(stream.decode_max_us, took_us);
+      led_audio_set_decode_time(stream.decode_avg_us, stream.decode_max_us);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
 void snap_task(void*) {
-  ESP_LOGI(TAG, "Snapclient light starting -> %s:%u", s_cfg.host.c_str(), s_cfg.port);
+  const SnapcastConfig& snap = s_cfg.snapcast;
+  ESP_LOGI(TAG, "Snapclient light starting -> %s:%u", snap.host.c_str(), snap.port);
+  const snapcast::HelloInfo hello = make_hello();
+  // Frames are published this far ahead of playout so the renderer can wait
+  // for the exact moment (it waits at most 50 ms)
+  const int64_t lead_us = std::clamp<int64_t>(snap.latency_ms, 10, 50) * 1000;
+  log_cpu_features();
   while (s_running) {
-    const int sock = connect_snap(s_cfg);
+    const int sock = connect_snap(snap);
     if (sock < 0) {
-      vTaskDelay(pdMS_TO_TICKS(1500));
+      // Back-off; snapclient_light_stop() cuts it short with a notification
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1500));
       continue;
     }
-    ESP_LOGI(TAG, "Snapclient connected (raw PCM expected)");
-    const uint32_t sample_rate = 48000;
-    const bool stereo = true;
-    const size_t frame_samples = 2048;
-    std::vector<int16_t> buffer(frame_samples);
-    std::deque<int16_t> pcm_buffer;
-    const uint32_t target_delay_ms = s_cfg.latency_ms > 0 ? s_cfg.latency_ms : 60;
-    const uint32_t min_delay_ms = target_delay_ms > 12 ? target_delay_ms - 12 : target_delay_ms;
-    const uint32_t max_delay_ms = target_delay_ms + 12;
-    const size_t max_buffer_samples = sample_rate * 2;  // ~1s safety
-    uint64_t last_adjust_us = esp_timer_get_time();
-    uint64_t last_tick_us = esp_timer_get_time();
-    uint64_t samples_seen = 0;
-
-    while (s_running) {
-      const int to_read = buffer.size() * sizeof(int16_t);
-      int r = recv(sock, reinterpret_cast<char*>(buffer.data()), to_read, 0);
-      if (r <= 0) {
-        ESP_LOGW(TAG, "Snap recv ended");
-        break;
+    ESP_LOGI(TAG, "Snapclient connected");
+    SnapStream stream;
+    snapcast::MessageReader reader;
+    std::vector<uint8_t> out;
+    uint8_t rx[1460];
+    uint16_t next_id = 1;
+    int64_t next_sync_us = 0;
+    led_audio_set_clock_sync(false, 0, 0);
+
+    snapcast::build_hello(out, next_id++, esp_timer_get_time(), hello);
+    bool ok = send_all(sock, out);
+
+    while (s_running && ok) {
+      // New analysis settings from the web UI; before the codec header they
+      // are picked up by its configure_analyzer() anyway
+      if (s_analysis_changed.exchange(false) && stream.decoding()) {
+        configure_analyzer(stream);
       }
-      const size_t samples = r / sizeof(int16_t);
-      for (size_t i = 0; i < samples; ++i) {
-        if (pcm_buffer.size() >= max_buffer_samples) {
-          pcm_buffer.pop_front();
+      int64_t now_us = esp_timer_get_time();
+      // Time exchanges: a quick burst until the filter has enough samples, then 1 Hz
+      if (now_us >= next_sync_us) {
+        out.clear();
+        snapcast::build_time_request(out, next_id++, now_us);
+        if (!send_all(sock, out)) {
+          break;
         }
-        pcm_buffer.push_back(buffer[i]);
-        samples_seen++;
+        next_sync_us = now_us + (stream.clock.synced() ? 1'000'000 : 100'000);
       }
 
-      const float buffered_ms = (pcm_buffer.size() / static_cast<float>(stereo ? 2 : 1)) * 1000.0f / sample_rate;
-      if (buffered_ms < min_delay_ms) {
-        continue;
-      }
-
-      // Lightweight jitter/latency control: trim or pad towards target window
-      const uint64_t now_us = esp_timer_get_time();
-      if (now_us - last_adjust_us > 10'000) {
-        // Estimate effective sample clock vs wall time to nudge buffer
-        const uint64_t elapsed_us = now_us - last_tick_us;
-        if (elapsed_us > 0) {
-          const float expected_samples = (elapsed_us / 1e6f) * sample_rate * (stereo ? 2 : 1);
-          const float drift = (samples_seen - expected_samples) / std::max(1.0f, expected_samples);
-          // Small PLL: if drift positive, trim buffer slightly; if negative, avoid trimming
-          if (drift > 0.02f && pcm_buffer.size() > frame_samples * 2) {
-            pcm_buffer.pop_front();
-          }
-          samples_seen = 0;
-          last_tick_us = now_us;
-        }
-        if (buffered_ms > max_delay_ms) {
-          const float excess_ms = buffered_ms - target_delay_ms;
-          size_t drop_samples =
-              std::min(static_cast<size_t>((excess_ms / 1000.0f) * sample_rate * (stereo ? 2 : 1)),
-                       pcm_buffer.size() / 4);
-          for (size_t i = 0; i < drop_samples && !pcm_buffer.empty(); ++i) {
-            pcm_buffer.pop_front();
+      // Analyze every window that is due, skipping ones we fell behind on.
+      // A window is stamped with the playout time of its newest hop.
+      const bool analyzing = stream.decoding() && s_analyzer.configured();
+      const size_t channels = stream.format.channels;
+      const size_t window_samples = s_analyzer.fft_size() * channels;
+      const int64_t newest_us = analyzing ? frames_to_us(s_analyzer.fft_size() - s_analyzer.hop(), stream) : 0;
+      if (analyzing) {
+        const size_t hop_samples = s_analyzer.hop() * channels;
+        const int64_t hop_us = frames_to_us(s_analyzer.hop(), stream);
+        while (stream.ring.size() >= window_samples) {
+          const int64_t play_us = stream.head_play_us() + newest_us;
+          if (play_us - lead_us > now_us) {
+            break;
           }
-        } else if (buffered_ms < min_delay_ms) {
-          // Light padding: duplicate last samples to reach window (only if buffer very low)
-          const float missing_ms = target_delay_ms - buffered_ms;
-          const size_t add = static_cast<size_t>((missing_ms / 1000.0f) * sample_rate * (stereo ? 2 : 1));
-          int16_t tail = pcm_buffer.empty() ? 0 : pcm_buffer.back();
-          for (size_t i = 0; i < add && pcm_buffer.size() < max_buffer_samples; ++i) {
-            pcm_buffer.push_back(tail);
+          if (play_us + hop_us < now_us) {
+            stream.ring.skip(hop_samples);
+            continue;
           }
+          s_analyzer.process(stream.ring.peek(0, window_samples), window_samples, channels == 2,
+                             static_cast<uint64_t>(play_us));
+          stream.ring.skip(hop_samples);
+          now_us = esp_timer_get_time();
         }
-        last_adjust_us = now_us;
       }
 
-      const size_t chunk = std::min(pcm_buffer.size(), frame_samples);
-      if (chunk >= frame_samples) {
-        // Calculate timestamp BEFORE processing (for accurate sync)
-        const uint64_t frame_timestamp_us = esp_timer_get_time();
-        const float buffered_ms = (pcm_buffer.size() / static_cast<float>(stereo ? 2 : 1)) * 1000.0f / sample_rate;
-        
-        std::vector<int16_t> chunk_buf(frame_samples);
-        for (size_t i = 0; i < frame_samples; ++i) {
-          chunk_buf[i] = pcm_buffer.front();
-          pcm_buffer.pop_front();
-        }
-        // Get FFT size from audio config - use default 1024 for now
-        // TODO: Pass fft_size from AudioConfig when available
-        uint16_t fft_size = 1024;
-        compute_metrics(chunk_buf.data(), frame_samples, sample_rate, stereo, fft_size, 
-                       buffered_ms, frame_timestamp_us);
+      // Sleep on the socket until data arrives or the next frame / sync is due
+      int64_t wake_us = next_sync_us;
+      if (analyzing && stream.ring.size() >= window_samples) {
+        wake_us = std::min(wake_us, stream.head_play_us() + newest_us - lead_us);
+      }
+      const int64_t wait_us = std::clamp<int64_t>(wake_us - now_us, 1000, 50'000);
+      fd_set rfds;
+      FD_ZERO(&rfds);
+      FD_SET(sock, &rfds);
+      timeval tv{};
+      tv.tv_sec = 0;
+      tv.tv_usec = static_cast<suseconds_t>(wait_us);
+      const int ready = select(sock + 1, &rfds, nullptr, nullptr, &tv);
+      if (ready < 0) {
+        ESP_LOGW(TAG, "Snap select failed");
+        break;
+      }
+      if (ready == 0) {
+        continue;
+      }
+      const int r = recv(sock, reinterpret_cast<char*>(rx), sizeof(rx), 0);
+      if (r <= 0) {
+        ESP_LOGW(TAG, "Snap recv ended");
+        break;
+      }
+      reader.append(rx, static_cast<size_t>(r), esp_timer_get_time());
+      snapcast::BaseHeader header{};
+      const uint8_t* payload = nullptr;
+      bool corrupt = false;
+      while (reader.next(header, payload, corrupt)) {
+        handle_message(stream, header, payload);
+      }
+      if (corrupt) {
+        ESP_LOGW(TAG, "Corrupt Snapcast message (size %u), reconnecting", static_cast<unsigned>(header.size));
+        break;
       }
     }
     close(sock);
-    vTaskDelay(pdMS_TO_TICKS(500));
+    led_audio_set_clock_sync(false, 0, 0);
+    if (s_running) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(500));
+    }
   }
+  // The stream (ring, decoder buffers) went out of scope with its connection,
+  // and no SeqLock store or diagnostics lock is in progress out here
   ESP_LOGI(TAG, "Snapclient light stopped");
-  s_task = nullptr;
+  xSemaphoreGive(s_stopped);
+  vTaskDelete(nullptr);
 }
 
 }  // namespace
 
-esp_err_t snapclient_light_start(const SnapcastConfig& cfg) {
+esp_err_t snapclient_light_start(const AudioConfig& cfg) {
+  if (s_task) {
+    return ESP_OK;
+  }
   s_cfg = cfg;
-  if (!s_cfg.enabled || s_cfg.host.empty()) {
+  {
+    std::lock_guard<std::mutex> lock(s_analysis_mutex);
+    s_analysis = AnalysisSettings(cfg);
+  }
+  if (!s_cfg.snapcast.enabled || s_cfg.snapcast.host.empty()) {
     ESP_LOGW(TAG, "Snapclient not started (disabled or host empty)");
     return ESP_ERR_INVALID_STATE;
   }
-  if (s_task) {
-    return ESP_OK;
+  if (s_stopped == nullptr) {
+    s_stopped = xSemaphoreCreateBinary();
+    if (s_stopped == nullptr) {
+      return ESP_ERR_NO_MEM;
+    }
   }
   s_running = true;
   // Pin to Core 1 for real-time audio processing (isolated from network/system tasks)
   // High priority (9) - audio processing must complete before LED rendering
   // Higher than LED effects (8) to ensure audio metrics are ready for effects
-  const BaseType_t res = xTaskCreatePinnedToCore(snap_task, "snapclient", 4096, nullptr, 9, &s_task, 1);
+  const BaseType_t res = xTaskCreatePinnedToCore(snap_task, "snapclient", 6144, nullptr, 9, &s_task, 1);
   if (res != pdPASS) {
     s_running = false;
     s_task = nullptr;
@@ -724,10 +575,42 @@ esp_err_t snapclient_light_start(const SnapcastConfig& cfg) {
 }
 
 void snapclient_light_stop() {
+  if (!s_task) {
+    return;
+  }
+  // The task finishes its current step (a select is at most 50 ms, a connect
+  // or lookup can take longer), closes its socket, frees its buffers and
+  // deletes itself; deleting it from here could stop it inside a SeqLock
+  // store or while it holds the diagnostics lock
   s_running = false;
-  if (s_task) {
-    vTaskDelay(pdMS_TO_TICKS(50));
-    vTaskDelete(s_task);
-    s_task = nullptr;
+  xTaskNotifyGive(s_task);
+  while (xSemaphoreTake(s_stopped, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    ESP_LOGW(TAG, "Waiting for the snapclient task to stop");
+  }
+  s_task = nullptr;
+}
+
+esp_err_t snapclient_light_reconfigure(const AudioConfig& cfg) {
+  if (!s_task) {
+    return ESP_OK;  // the next start() takes cfg as a whole
+  }
+  const SnapcastConfig& now = s_cfg.snapcast;
+  const bool same_server = cfg.source == AudioSourceType::Snapcast && cfg.snapcast.enabled &&
+                           cfg.snapcast.host == now.host && cfg.snapcast.port == now.port &&
+                           cfg.snapcast.latency_ms == now.latency_ms;
+  if (!same_server) {
+    ESP_LOGI(TAG, "Snapcast settings changed, restarting the client");
+    snapclient_light_stop();
+    if (cfg.source != AudioSourceType::Snapcast) {
+      return ESP_OK;
+    }
+    return snapclient_light_start(cfg);
+  }
+  const AnalysisSettings next(cfg);
+  std::lock_guard<std::mutex> lock(s_analysis_mutex);
+  if (!(next == s_analysis)) {
+    s_analysis = next;
+    s_analysis_changed = true;
   }
+  return ESP_OK;
 }
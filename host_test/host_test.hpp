@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal checks for the host tests: a failed check is reported and counted,
+// the test keeps going, and main() returns the failure count.
+
+namespace host_test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline void fail(const char* file, int line, const char* expr) {
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    ++failures();
+}
+
+inline int finish(const char* suite) {
+    if (failures() == 0) {
+        std::printf("%s: all checks passed\n", suite);
+    } else {
+        std::printf("%s: %d check(s) failed\n", suite, failures());
+    }
+    return failures() == 0 ? 0 : 1;
+}
+
+}  // namespace host_test
+
+#define CHECK(expr)                                          \
+    do {                                                     \
+        if (!(expr)) {                                       \
+            host_test::fail(__FILE__, __LINE__, #expr);      \
+        }                                                    \
+    } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
@@ -0,0 +1,385 @@
+#include "cJSON.h"
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <strings.h>
+
+namespace {
+
+char* dup_string(const char* s, size_t len) {
+    char* out = static_cast<char*>(std::malloc(len + 1));
+    std::memcpy(out, s, len);
+    out[len] = '\0';
+    return out;
+}
+
+cJSON* new_item(int type) {
+    cJSON* item = static_cast<cJSON*>(std::calloc(1, sizeof(cJSON)));
+    item->type = type;
+    return item;
+}
+
+void set_number(cJSON* item, double number) {
+    item->valuedouble = number;
+    if (number >= INT_MAX) {
+        item->valueint = INT_MAX;
+    } else if (number <= static_cast<double>(INT_MIN)) {
+        item->valueint = INT_MIN;
+    } else {
+        item->valueint = static_cast<int>(number);
+    }
+}
+
+void append_child(cJSON* parent, cJSON* item) {
+    if (parent->child == nullptr) {
+        parent->child = item;
+        item->prev = item;  // cJSON keeps the tail in child->prev
+        return;
+    }
+    cJSON* tail = parent->child->prev;
+    tail->next = item;
+    item->prev = tail;
+    parent->child->prev = item;
+}
+
+struct Parser {
+    const char* p;
+    const char* end;
+
+    void skip_ws() {
+        while (p < end && std::isspace(static_cast<unsigned char>(*p))) {
+            ++p;
+        }
+    }
+
+    bool literal(const char* word) {
+        const size_t n = std::strlen(word);
+        if (static_cast<size_t>(end - p) < n || std::strncmp(p, word, n) != 0) {
+            return false;
+        }
+        p += n;
+        return true;
+    }
+
+    bool string(std::string& out) {
+        if (p >= end || *p != '"') {
+            return false;
+        }
+        ++p;
+        while (p < end && *p != '"') {
+            if (*p != '\\') {
+                out.push_back(*p++);
+                continue;
+            }
+            if (++p >= end) {
+                return false;
+            }
+            switch (*p++) {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '/': out.push_back('/'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    if (end - p < 4) {
+                        return false;
+                    }
+                    const unsigned code = static_cast<unsigned>(std::strtoul(std::string(p, 4).c_str(), nullptr, 16));
+                    p += 4;
+                    // Basic plane only, encoded as UTF-8
+                    if (code < 0x80) {
+                        out.push_back(static_cast<char>(code));
+                    } else if (code < 0x800) {
+                        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+                        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                    } else {
+                        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+                        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                    }
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        if (p >= end) {
+            return false;
+        }
+        ++p;  // closing quote
+        return true;
+    }
+
+    cJSON* value() {
+        skip_ws();
+        if (p >= end) {
+            return nullptr;
+        }
+        if (*p == '{' || *p == '[') {
+            const bool object = *p == '{';
+            const char close = object ? '}' : ']';
+            ++p;
+            cJSON* item = new_item(object ? cJSON_Object : cJSON_Array);
+            skip_ws();
+            if (p < end && *p == close) {
+                ++p;
+                return item;
+            }
+            while (true) {
+                std::string key;
+                if (object) {
+                    skip_ws();
+                    if (!string(key)) {
+                        cJSON_Delete(item);
+                        return nullptr;
+                    }
+                    skip_ws();
+                    if (p >= end || *p != ':') {
+                        cJSON_Delete(item);
+                        return nullptr;
+                    }
+                    ++p;
+                }
+                cJSON* child = value();
+                if (child == nullptr) {
+                    cJSON_Delete(item);
+                    return nullptr;
+                }
+                if (object) {
+                    child->string = dup_string(key.data(), key.size());
+                }
+                append_child(item, child);
+                skip_ws();
+                if (p < end && *p == ',') {
+                    ++p;
+                    continue;
+                }
+                if (p < end && *p == close) {
+                    ++p;
+                    return item;
+                }
+                cJSON_Delete(item);
+                return nullptr;
+            }
+        }
+        if (*p == '"') {
+            std::string s;
+            if (!string(s)) {
+                return nullptr;
+            }
+            cJSON* item = new_item(cJSON_String);
+            item->valuestring = dup_string(s.data(), s.size());
+            return item;
+        }
+        if (literal("true")) {
+            cJSON* item = new_item(cJSON_True);
+            item->valueint = 1;
+            return item;
+        }
+        if (literal("false")) {
+            return new_item(cJSON_False);
+        }
+        if (literal("null")) {
+            return new_item(cJSON_NULL);
+        }
+        const std::string digits(p, static_cast<size_t>(end - p));
+        char* stop = nullptr;
+        const double number = std::strtod(digits.c_str(), &stop);
+        if (stop == digits.c_str()) {
+            return nullptr;
+        }
+        p += stop - digits.c_str();
+        cJSON* item = new_item(cJSON_Number);
+        set_number(item, number);
+        return item;
+    }
+};
+
+void print_string(std::string& out, const char* s) {
+    out.push_back('"');
+    for (; *s; ++s) {
+        const unsigned char c = static_cast<unsigned char>(*s);
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char esc[8];
+                    std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+                    out += esc;
+                } else {
+                    out.push_back(static_cast<char>(c));
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+void print_item(std::string& out, const cJSON* item) {
+    switch (item->type) {
+        case cJSON_False: out += "false"; break;
+        case cJSON_True: out += "true"; break;
+        case cJSON_NULL: out += "null"; break;
+        case cJSON_String: print_string(out, item->valuestring ? item->valuestring : ""); break;
+        case cJSON_Number: {
+            char num[32];
+            const double d = item->valuedouble;
+            if (std::fabs(d - static_cast<double>(item->valueint)) < 1e-9) {
+                std::snprintf(num, sizeof(num), "%d", item->valueint);
+            } else {
+                std::snprintf(num, sizeof(num), "%.17g", d);
+            }
+            out += num;
+            break;
+        }
+        case cJSON_Array:
+        case cJSON_Object: {
+            const bool object = item->type == cJSON_Object;
+            out.push_back(object ? '{' : '[');
+            for (const cJSON* c = item->child; c; c = c->next) {
+                if (c != item->child) {
+                    out.push_back(',');
+                }
+                if (object) {
+                    print_string(out, c->string ? c->string : "");
+                    out.push_back(':');
+                }
+                print_item(out, c);
+            }
+            out.push_back(object ? '}' : ']');
+            break;
+        }
+    }
+}
+
+cJSON* add_item(cJSON* object, const char* name, cJSON* item) {
+    if (object == nullptr || name == nullptr) {
+        cJSON_Delete(item);
+        return nullptr;
+    }
+    item->string = dup_string(name, std::strlen(name));
+    append_child(object, item);
+    return item;
+}
+
+}  // namespace
+
+cJSON* cJSON_Parse(const char* value) {
+    return value ? cJSON_ParseWithLength(value, std::strlen(value)) : nullptr;
+}
+
+cJSON* cJSON_ParseWithLength(const char* value, size_t buffer_length) {
+    if (value == nullptr) {
+        return nullptr;
+    }
+    Parser parser{value, value + buffer_length};
+    cJSON* item = parser.value();
+    if (item == nullptr) {
+        return nullptr;
+    }
+    parser.skip_ws();
+    // cJSON stops at a terminating NUL inside the buffer
+    if (parser.p < parser.end && *parser.p != '\0') {
+        cJSON_Delete(item);
+        return nullptr;
+    }
+    return item;
+}
+
+void cJSON_Delete(cJSON* item) {
+    while (item) {
+        cJSON* next = item->next;
+        cJSON_Delete(item->child);
+        std::free(item->valuestring);
+        std::free(item->string);
+        std::free(item);
+        item = next;
+    }
+}
+
+char* cJSON_PrintUnformatted(const cJSON* item) {
+    if (item == nullptr) {
+        return nullptr;
+    }
+    std::string out;
+    print_item(out, item);
+    return dup_string(out.data(), out.size());
+}
+
+void cJSON_free(void* object) {
+    std::free(object);
+}
+
+cJSON* cJSON_GetObjectItem(const cJSON* object, const char* string) {
+    if (object == nullptr || string == nullptr) {
+        return nullptr;
+    }
+    // Case-insensitive, like cJSON
+    for (cJSON* c = object->child; c; c = c->next) {
+        if (c->string && strcasecmp(c->string, string) == 0) {
+            return c;
+        }
+    }
+    return nullptr;
+}
+
+int cJSON_GetArraySize(const cJSON* array) {
+    int n = 0;
+    for (const cJSON* c = array ? array->child : nullptr; c; c = c->next) {
+        ++n;
+    }
+    return n;
+}
+
+cJSON* cJSON_GetArrayItem(const cJSON* array, int index) {
+    cJSON* c = array ? array->child : nullptr;
+    while (c && index-- > 0) {
+        c = c->next;
+    }
+    return c;
+}
+
+char* cJSON_GetStringValue(const cJSON* item) {
+    return cJSON_IsString(item) ? item->valuestring : nullptr;
+}
+
+cJSON_bool cJSON_IsFalse(const cJSON* item) { return item && item->type == cJSON_False; }
+cJSON_bool cJSON_IsTrue(const cJSON* item) { return item && item->type == cJSON_True; }
+cJSON_bool cJSON_IsBool(const cJSON* item) { return item && (item->type & (cJSON_True | cJSON_False)) != 0; }
+cJSON_bool cJSON_IsNull(const cJSON* item) { return item && item->type == cJSON_NULL; }
+cJSON_bool cJSON_IsNumber(const cJSON* item) { return item && item->type == cJSON_Number; }
+cJSON_bool cJSON_IsString(const cJSON* item) { return item && item->type == cJSON_String; }
+cJSON_bool cJSON_IsArray(const cJSON* item) { return item && item->type == cJSON_Array; }
+cJSON_bool cJSON_IsObject(const cJSON* item) { return item && item->type == cJSON_Object; }
+
+cJSON* cJSON_CreateObject(void) {
+    return new_item(cJSON_Object);
+}
+
+cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string) {
+    cJSON* item = new_item(cJSON_String);
+    item->valuestring = dup_string(string ? string : "", string ? std::strlen(string) : 0);
+    return add_item(object, name, item);
+}
+
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number) {
+    cJSON* item = new_item(cJSON_Number);
+    set_number(item, number);
+    return add_item(object, name, item);
+}
+
+cJSON* cJSON_AddBoolToObject(cJSON* object, const char* name, cJSON_bool boolean) {
+    cJSON* item = new_item(boolean ? cJSON_True : cJSON_False);
+    item->valueint = boolean ? 1 : 0;
+    return add_item(object, name, item);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdio>
+
+// Host stand-in for ESP-IDF esp_log.h: warnings and errors go to stderr,
+// info and debug are dropped to keep test output readable
+
+#define ESP_LOGE(tag, fmt, ...) std::fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) std::fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ((void)(tag))
+#define ESP_LOGD(tag, fmt, ...) ((void)(tag))
+#define ESP_LOGV(tag, fmt, ...) ((void)(tag))
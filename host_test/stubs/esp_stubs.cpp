@@ -0,0 +1,32 @@
+#include "esp_err.h"
+#include "esp_timer.h"
+#include <chrono>
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:
+            return "ESP_OK";
+        case ESP_FAIL:
+            return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:
+            return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:
+            return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:
+            return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:
+            return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:
+            return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:
+            return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:
+            return "ESP_ERR_TIMEOUT";
+    }
+    return "UNKNOWN ERROR";
+}
+
+int64_t esp_timer_get_time() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
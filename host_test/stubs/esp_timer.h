@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+// Host stand-in for ESP-IDF esp_timer.h: microseconds on the steady clock
+int64_t esp_timer_get_time();
@@ -0,0 +1,477 @@
+#include "beat_tracker.hpp"
+#include "host_test.hpp"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// BeatTracker on labelled audio: a WAV file plus a .beats file with one
+// annotated beat time (seconds) per line. The fixtures in fixtures/beats.txt
+// are drum patterns synthesized to such pairs at test time; any other pair
+// can be scored with
+//   test_beat_tracker song.wav song.beats [more.wav more.beats ...]
+// The front end mirrors AudioAnalyzer: mono mix, 1024-point Hann window every
+// 960 samples, single-sided magnitudes scaled by 2/N.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kFftSize = 1024;
+constexpr size_t kHop = 960;
+constexpr uint32_t kSampleRate = 48000;
+constexpr double kFixtureSeconds = 30.0;
+constexpr double kFirstBar = 0.5;
+constexpr double kWarmupSeconds = 10.0;  // scoring starts once the tempo had time to lock
+constexpr double kTolerance = 0.07;      // seconds either side of an annotated beat
+constexpr float kMinF1 = 0.6f;
+constexpr float kTempoTolerance = 0.04f; // relative, after folding octave errors
+
+struct Wav {
+  uint32_t sample_rate{0};
+  uint16_t channels{0};
+  std::vector<int16_t> pcm;  // interleaved
+};
+
+uint32_t get_u32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint16_t get_u16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+void put_u32(std::string& out, uint32_t v) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back(static_cast<char>((v >> (i * 8)) & 0xFF));
+  }
+}
+
+void put_u16(std::string& out, uint16_t v) {
+  out.push_back(static_cast<char>(v & 0xFF));
+  out.push_back(static_cast<char>(v >> 8));
+}
+
+// 16-bit PCM only, which is all the firmware decodes to
+bool read_wav(const fs::path& path, Wav& wav) {
+  std::ifstream in(path, std::ios::binary);
+  const std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  const auto* data = reinterpret_cast<const uint8_t*>(bytes.data());
+  if (bytes.size() < 12 || bytes.compare(0, 4, "RIFF") != 0 || bytes.compare(8, 4, "WAVE") != 0) {
+    return false;
+  }
+  bool have_format = false;
+  size_t pos = 12;
+  while (pos + 8 <= bytes.size()) {
+    const uint32_t size = get_u32(data + pos + 4);
+    const size_t body = pos + 8;
+    const size_t len = std::min<size_t>(size, bytes.size() - body);
+    if (bytes.compare(pos, 4, "fmt ") == 0 && len >= 16) {
+      const uint16_t format = get_u16(data + body);
+      wav.channels = get_u16(data + body + 2);
+      wav.sample_rate = get_u32(data + body + 4);
+      const uint16_t bits = get_u16(data + body + 14);
+      if (format != 1 || bits != 16 || wav.channels == 0 || wav.channels > 2) {
+        return false;
+      }
+      have_format = true;
+    } else if (bytes.compare(pos, 4, "data") == 0 && have_format) {
+      wav.pcm.resize(len / 2);
+      for (size_t i = 0; i < wav.pcm.size(); ++i) {
+        wav.pcm[i] = static_cast<int16_t>(get_u16(data + body + i * 2));
+      }
+      return true;
+    }
+    pos = body + size + (size & 1);
+  }
+  return false;
+}
+
+bool write_wav(const fs::path& path, const std::vector<int16_t>& pcm, uint32_t sample_rate) {
+  std::string out = "RIFF";
+  put_u32(out, static_cast<uint32_t>(36 + pcm.size() * 2));
+  out += "WAVEfmt ";
+  put_u32(out, 16);
+  put_u16(out, 1);  // PCM
+  put_u16(out, 1);  // mono
+  put_u32(out, sample_rate);
+  put_u32(out, sample_rate * 2);
+  put_u16(out, 2);
+  put_u16(out, 16);
+  out += "data";
+  put_u32(out, static_cast<uint32_t>(pcm.size() * 2));
+  for (const int16_t s : pcm) {
+    put_u16(out, static_cast<uint16_t>(s));
+  }
+  std::ofstream file(path, std::ios::binary);
+  file.write(out.data(), static_cast<std::streamsize>(out.size()));
+  return static_cast<bool>(file);
+}
+
+std::vector<double> read_beats(const fs::path& path) {
+  std::vector<double> beats;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    double t = 0.0;
+    if (line.empty() || line[0] == '#' || !(fields >> t)) {
+      continue;
+    }
+    beats.push_back(t);
+  }
+  return beats;
+}
+
+bool write_beats(const fs::path& path, const std::vector<double>& beats) {
+  std::ofstream out(path);
+  for (const double t : beats) {
+    char line[32];
+    std::snprintf(line, sizeof(line), "%.6f\n", t);
+    out << line;
+  }
+  return static_cast<bool>(out);
+}
+
+// ---- Fixture synthesis ----------------------------------------------------
+
+enum class Drum { Kick, Snare, Hat };
+
+struct Hit {
+  double t;
+  Drum drum;
+};
+
+struct Fixture {
+  std::string name;
+  double bpm{0.0};
+  int meter{4};
+  bool bassline{false};
+  unsigned seed{0};
+  std::vector<std::pair<double, Drum>> bar;  // beat offset in the bar, drum
+};
+
+bool parse_hits(const std::string& field, const char* key, Drum drum, Fixture& fixture) {
+  const std::string prefix = std::string(key) + "=";
+  if (field.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  std::istringstream list(field.substr(prefix.size()));
+  std::string item;
+  while (std::getline(list, item, ',')) {
+    if (item != "-") {
+      fixture.bar.emplace_back(std::strtod(item.c_str(), nullptr), drum);
+    }
+  }
+  return true;
+}
+
+std::vector<Fixture> read_fixtures(const fs::path& path) {
+  std::vector<Fixture> fixtures;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    Fixture f;
+    std::string bass;
+    if (!(fields >> f.name >> f.bpm >> f.meter >> bass >> f.seed)) {
+      std::fprintf(stderr, "bad fixture line: %s\n", line.c_str());
+      continue;
+    }
+    f.bassline = bass == "bass";
+    std::string field;
+    while (fields >> field) {
+      if (!parse_hits(field, "kick", Drum::Kick, f) && !parse_hits(field, "snare", Drum::Snare, f) &&
+          !parse_hits(field, "hat", Drum::Hat, f)) {
+        std::fprintf(stderr, "bad fixture field: %s\n", field.c_str());
+      }
+    }
+    fixtures.push_back(std::move(f));
+  }
+  return fixtures;
+}
+
+// Kick (pitch-swept sine), snare (noise plus tone), hat (short differentiated
+// noise) over a sustained pad, an optional bass line changing notes off the
+// beat, and a noise floor
+std::vector<int16_t> render(const Fixture& f, const std::vector<Hit>& hits, double seconds) {
+  const double sr = kSampleRate;
+  const double pi = 3.14159265358979323846;
+  std::vector<float> x(static_cast<size_t>(seconds * sr), 0.0f);
+  std::mt19937 rng(f.seed);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  for (const auto& hit : hits) {
+    const size_t s0 = static_cast<size_t>(hit.t * sr);
+    float previous = 0.0f;
+    double phase = 0.0;
+    const double length = hit.drum == Drum::Kick ? 0.25 : hit.drum == Drum::Snare ? 0.2 : 0.05;
+    for (size_t i = 0; i < static_cast<size_t>(length * sr) && s0 + i < x.size(); ++i) {
+      const double t = static_cast<double>(i) / sr;
+      if (hit.drum == Drum::Kick) {
+        phase += 2.0 * pi * (50.0 + 100.0 * std::exp(-t * 30.0)) / sr;
+        x[s0 + i] += static_cast<float>(0.8 * std::sin(phase) * std::exp(-t * 12.0));
+      } else if (hit.drum == Drum::Snare) {
+        const float v = noise(rng);
+        const float hp = v - 0.5f * previous;
+        previous = v;
+        x[s0 + i] += static_cast<float>((0.35 * hp + 0.3 * std::sin(2.0 * pi * 190.0 * t)) * std::exp(-t * 18.0));
+      } else {
+        const float v = noise(rng);
+        const float hp = v - previous;
+        previous = v;
+        x[s0 + i] += static_cast<float>(0.12 * hp * std::exp(-t * 80.0));
+      }
+    }
+  }
+  const double beat = 60.0 / f.bpm;
+  const double notes[] = {55.0, 73.4, 65.4, 49.0};
+  for (size_t i = 0; i < x.size(); ++i) {
+    const double t = static_cast<double>(i) / sr;
+    const double pad = std::sin(2.0 * pi * 220.0 * t) + std::sin(2.0 * pi * 277.0 * t) + std::sin(2.0 * pi * 330.0 * t);
+    x[i] += static_cast<float>(0.05 * pad * (0.6 + 0.4 * std::sin(t * 0.7)));
+    if (f.bassline) {
+      const int note = static_cast<int>((t + beat * 0.5) / (beat * 2.0)) % 4;
+      x[i] += static_cast<float>(0.3 * std::sin(2.0 * pi * notes[note] * t));
+    }
+    x[i] += 0.003f * noise(rng);
+  }
+  std::vector<int16_t> pcm(x.size());
+  for (size_t i = 0; i < x.size(); ++i) {
+    pcm[i] = static_cast<int16_t>(std::clamp(x[i] * 16000.0f, -32767.0f, 32767.0f));
+  }
+  return pcm;
+}
+
+// Writes <out>/<name>.wav and <out>/<name>.beats
+bool synthesize(const Fixture& f, const fs::path& out, fs::path& wav_path, fs::path& beats_path) {
+  const double beat = 60.0 / f.bpm;
+  std::vector<Hit> hits;
+  std::vector<double> truth;
+  for (double bar = kFirstBar; bar < kFixtureSeconds; bar += beat * f.meter) {
+    for (const auto& [offset, drum] : f.bar) {
+      hits.push_back({bar + offset * beat, drum});
+    }
+    for (int b = 0; b < f.meter; ++b) {
+      truth.push_back(bar + b * beat);
+    }
+  }
+  wav_path = out / (f.name + ".wav");
+  beats_path = out / (f.name + ".beats");
+  return write_wav(wav_path, render(f, hits, kFixtureSeconds), kSampleRate) && write_beats(beats_path, truth);
+}
+
+// ---- Evaluation ------------------------------------------------------------
+
+void fft(std::vector<std::complex<float>>& a) {
+  const size_t n = a.size();
+  for (size_t i = 1, j = 0; i < n; ++i) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(a[i], a[j]);
+    }
+  }
+  for (size_t len = 2; len <= n; len <<= 1) {
+    const float angle = -2.0f * 3.14159265f / static_cast<float>(len);
+    const std::complex<float> step(std::cos(angle), std::sin(angle));
+    for (size_t i = 0; i < n; i += len) {
+      std::complex<float> w(1.0f, 0.0f);
+      for (size_t k = 0; k < len / 2; ++k) {
+        const std::complex<float> u = a[i + k];
+        const std::complex<float> v = a[i + k + len / 2] * w;
+        a[i + k] = u + v;
+        a[i + k + len / 2] = u - v;
+        w *= step;
+      }
+    }
+  }
+}
+
+struct Score {
+  double f1{0.0};
+  double tempo_bpm{0.0};     // tracker's estimate at the end of the file
+  double labelled_bpm{0.0};  // median annotated inter-beat interval
+  double confidence{0.0};
+};
+
+// Detected beats are the rising edges of the beat envelope, attributed to the
+// middle of the newest hop
+Score evaluate(const Wav& wav, const std::vector<double>& truth) {
+  Score score;
+  if (wav.pcm.empty() || truth.size() < 2) {
+    return score;
+  }
+  const size_t channels = wav.channels;
+  const size_t frames = wav.pcm.size() / channels;
+  const double duration = static_cast<double>(frames) / wav.sample_rate;
+  std::vector<float> window(kFftSize);
+  for (size_t i = 0; i < kFftSize; ++i) {
+    window[i] = 0.5f - 0.5f * std::cos(2.0f * 3.14159265f * static_cast<float>(i) / static_cast<float>(kFftSize - 1));
+  }
+
+  BeatTracker tracker;
+  tracker.configure(kFftSize / 2, wav.sample_rate, kHop);
+  std::vector<std::complex<float>> spectrum(kFftSize);
+  std::vector<float> magnitude(kFftSize / 2);
+  std::vector<double> detected;
+  float previous_beat = 0.0f;
+  AudioMetrics metrics{};
+  for (size_t start = 0; start + kFftSize <= frames; start += kHop) {
+    for (size_t i = 0; i < kFftSize; ++i) {
+      float mono = 0.0f;
+      for (size_t c = 0; c < channels; ++c) {
+        mono += static_cast<float>(wav.pcm[(start + i) * channels + c]);
+      }
+      spectrum[i] = {mono / (32768.0f * static_cast<float>(channels)) * window[i], 0.0f};
+    }
+    fft(spectrum);
+    for (size_t k = 0; k < magnitude.size(); ++k) {
+      magnitude[k] = std::abs(spectrum[k]) * 2.0f / static_cast<float>(kFftSize);
+    }
+    const double t_end = static_cast<double>(start + kFftSize) / wav.sample_rate;
+    metrics = AudioMetrics{};
+    tracker.process(magnitude.data(), static_cast<uint64_t>(t_end * 1e6), metrics);
+    if (metrics.beat >= 0.7f && metrics.beat > previous_beat + 0.2f) {
+      detected.push_back(t_end - static_cast<double>(kHop) / wav.sample_rate * 0.5);
+    }
+    previous_beat = metrics.beat;
+  }
+  score.tempo_bpm = metrics.tempo_bpm;
+  score.confidence = metrics.tempo_confidence;
+
+  std::vector<double> intervals;
+  for (size_t i = 1; i < truth.size(); ++i) {
+    intervals.push_back(truth[i] - truth[i - 1]);
+  }
+  std::nth_element(intervals.begin(), intervals.begin() + intervals.size() / 2, intervals.end());
+  score.labelled_bpm = 60.0 / intervals[intervals.size() / 2];
+
+  // Greedy one-to-one matching inside the tolerance, after the warm-up
+  std::vector<bool> used(truth.size(), false);
+  size_t hits = 0;
+  size_t scored = 0;
+  for (const double d : detected) {
+    if (d < kWarmupSeconds) {
+      continue;
+    }
+    ++scored;
+    for (size_t i = 0; i < truth.size(); ++i) {
+      if (!used[i] && std::fabs(truth[i] - d) < kTolerance) {
+        used[i] = true;
+        ++hits;
+        break;
+      }
+    }
+  }
+  size_t expected = 0;
+  for (const double t : truth) {
+    if (t >= kWarmupSeconds && t < duration - 0.1) {
+      ++expected;
+    }
+  }
+  const double precision = scored ? static_cast<double>(hits) / scored : 0.0;
+  const double recall = expected ? static_cast<double>(hits) / expected : 0.0;
+  score.f1 = precision + recall > 0.0 ? 2.0 * precision * recall / (precision + recall) : 0.0;
+  return score;
+}
+
+// Half and double tempo count: the beat grid is still right, only the level
+// of the metrical hierarchy differs
+bool tempo_matches(double estimate, double labelled) {
+  for (const double factor : {1.0, 0.5, 2.0}) {
+    if (std::fabs(estimate - labelled * factor) <= labelled * factor * kTempoTolerance) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool score_pair(const std::string& name, const fs::path& wav_path, const fs::path& beats_path, Score& score) {
+  Wav wav;
+  if (!read_wav(wav_path, wav)) {
+    std::fprintf(stderr, "%s: cannot read %s (16-bit PCM WAV expected)\n", name.c_str(), wav_path.c_str());
+    return false;
+  }
+  const std::vector<double> truth = read_beats(beats_path);
+  if (truth.size() < 2) {
+    std::fprintf(stderr, "%s: no beat labels in %s\n", name.c_str(), beats_path.c_str());
+    return false;
+  }
+  score = evaluate(wav, truth);
+  std::printf("%-16s labelled %6.1f  est %6.1f (conf %.2f)  F1 %.2f\n", name.c_str(), score.labelled_bpm,
+              score.tempo_bpm, score.confidence, score.f1);
+  return true;
+}
+
+void test_wav_round_trip(const fs::path& out) {
+  const std::vector<int16_t> pcm = {0, 1, -1, 32767, -32768, 1234};
+  const fs::path path = out / "round_trip.wav";
+  CHECK(write_wav(path, pcm, 44100));
+  Wav wav;
+  CHECK(read_wav(path, wav));
+  CHECK_EQ(wav.sample_rate, 44100u);
+  CHECK_EQ(wav.channels, 1u);
+  CHECK(wav.pcm == pcm);
+
+  const fs::path beats = out / "round_trip.beats";
+  CHECK(write_beats(beats, {0.5, 1.25}));
+  CHECK((read_beats(beats) == std::vector<double>{0.5, 1.25}));
+}
+
+void test_fixtures(const fs::path& spec, const fs::path& out) {
+  const std::vector<Fixture> fixtures = read_fixtures(spec);
+  CHECK(!fixtures.empty());
+  for (const Fixture& f : fixtures) {
+    fs::path wav_path;
+    fs::path beats_path;
+    CHECK(synthesize(f, out, wav_path, beats_path));
+    Score score;
+    if (!score_pair(f.name, wav_path, beats_path, score)) {
+      CHECK(!"fixture did not round-trip through WAV");
+      continue;
+    }
+    CHECK(score.f1 >= kMinF1);
+    CHECK(tempo_matches(score.tempo_bpm, score.labelled_bpm));
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // External pairs are scored and reported, not judged
+  if (argc > 1) {
+    if (argc % 2 != 1) {
+      std::fprintf(stderr, "usage: %s [file.wav file.beats ...]\n", argv[0]);
+      return 2;
+    }
+    for (int i = 1; i + 1 < argc; i += 2) {
+      Score score;
+      if (!score_pair(fs::path(argv[i]).stem().string(), argv[i], argv[i + 1], score)) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  const char* env = std::getenv("BEAT_FIXTURE_DIR");
+  const fs::path out = env ? fs::path(env) : fs::temp_directory_path() / "ledbrain_beat_fixtures";
+  fs::create_directories(out);
+  test_wav_round_trip(out);
+  test_fixtures("fixtures/beats.txt", out);
+  return host_test::finish("beat_tracker");
+}
@@ -0,0 +1,525 @@
+#include "host_test.hpp"
+#include "flac_decoder.hpp"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// FlacDecoder against frames encoded here, one subframe type at a time, so
+// each case pins down the exact bits the decoder has to undo. The encoder
+// side follows the FLAC format spec; the checks compare decoded samples with
+// the signal that went in.
+
+namespace {
+
+constexpr uint32_t kRate = 48000;
+
+class BitWriter {
+public:
+  void put(uint64_t v, unsigned n) {
+    for (unsigned i = n; i-- > 0;) {
+      bit((v >> i) & 1);
+    }
+  }
+
+  void put_signed(int64_t v, unsigned n) { put(static_cast<uint64_t>(v), n); }
+
+  void put_unary(uint32_t zeros) {
+    for (uint32_t i = 0; i < zeros; ++i) {
+      bit(0);
+    }
+    bit(1);
+  }
+
+  void put_rice(int32_t v, unsigned k) {
+    const uint32_t u = v >= 0 ? static_cast<uint32_t>(v) << 1 : (static_cast<uint32_t>(-(v + 1)) << 1) | 1;
+    put_unary(u >> k);
+    put(u & ((1u << k) - 1), k);
+  }
+
+  void align() {
+    while (used_ != 0) {
+      bit(0);
+    }
+  }
+
+  std::vector<uint8_t>& bytes() { return bytes_; }
+
+private:
+  void bit(uint64_t b) {
+    if (used_ == 0) {
+      bytes_.push_back(0);
+    }
+    bytes_.back() |= static_cast<uint8_t>(b << (7 - used_));
+    used_ = (used_ + 1) & 7;
+  }
+
+  std::vector<uint8_t> bytes_;
+  unsigned used_{0};
+};
+
+uint8_t crc8(const std::vector<uint8_t>& d) {
+  uint8_t crc = 0;
+  for (uint8_t byte : d) {
+    crc ^= byte;
+    for (int b = 0; b < 8; ++b) {
+      crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+    }
+  }
+  return crc;
+}
+
+uint16_t crc16(const std::vector<uint8_t>& d) {
+  uint16_t crc = 0;
+  for (uint8_t byte : d) {
+    crc ^= static_cast<uint16_t>(byte << 8);
+    for (int b = 0; b < 8; ++b) {
+      crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1);
+    }
+  }
+  return crc;
+}
+
+// "fLaC" + STREAMINFO, the codec header snapserver sends
+std::vector<uint8_t> stream_header(uint16_t channels, uint16_t bits, uint16_t max_block = 4096) {
+  BitWriter w;
+  w.put('f', 8);
+  w.put('L', 8);
+  w.put('a', 8);
+  w.put('C', 8);
+  w.put(0x80, 8);  // last metadata block, STREAMINFO
+  w.put(34, 24);
+  w.put(16, 16);
+  w.put(max_block, 16);
+  w.put(0, 24);
+  w.put(0, 24);
+  w.put(kRate, 20);
+  w.put(channels - 1u, 3);
+  w.put(bits - 1u, 5);
+  w.put(0, 36);
+  w.put(0, 64);
+  w.put(0, 64);
+  return w.bytes();
+}
+
+enum class Kind { Constant, Verbatim, Fixed, Lpc };
+
+struct Subframe {
+  Kind kind{Kind::Verbatim};
+  unsigned order{0};
+  std::vector<int32_t> coefs{};  // LPC, newest sample first
+  unsigned precision{15};
+  int shift{0};
+  unsigned wasted{0};
+  unsigned rice{4};
+  unsigned partition_order{0};
+  bool escape{false};  // residual as raw 20-bit values instead of Rice codes
+};
+
+int64_t predict(const Subframe& sf, const std::vector<int64_t>& x, size_t i) {
+  if (sf.kind == Kind::Fixed) {
+    switch (sf.order) {
+      case 1: return x[i - 1];
+      case 2: return 2 * x[i - 1] - x[i - 2];
+      case 3: return 3 * x[i - 1] - 3 * x[i - 2] + x[i - 3];
+      case 4: return 4 * x[i - 1] - 6 * x[i - 2] + 4 * x[i - 3] - x[i - 4];
+      default: return 0;
+    }
+  }
+  int64_t sum = 0;
+  for (unsigned j = 0; j < sf.order; ++j) {
+    sum += static_cast<int64_t>(sf.coefs[j]) * x[i - 1 - j];
+  }
+  return sum >> sf.shift;
+}
+
+void put_subframe(BitWriter& w, const std::vector<int64_t>& signal, unsigned bps, const Subframe& sf) {
+  w.put(0, 1);
+  switch (sf.kind) {
+    case Kind::Constant: w.put(0, 6); break;
+    case Kind::Verbatim: w.put(1, 6); break;
+    case Kind::Fixed: w.put(8 + sf.order, 6); break;
+    case Kind::Lpc: w.put(31 + sf.order, 6); break;
+  }
+  std::vector<int64_t> x = signal;
+  if (sf.wasted > 0) {
+    w.put(1, 1);
+    w.put_unary(sf.wasted - 1);
+    for (auto& v : x) {
+      v >>= sf.wasted;
+    }
+    bps -= sf.wasted;
+  } else {
+    w.put(0, 1);
+  }
+  if (sf.kind == Kind::Constant) {
+    w.put_signed(x[0], bps);
+    return;
+  }
+  if (sf.kind == Kind::Verbatim) {
+    for (int64_t v : x) {
+      w.put_signed(v, bps);
+    }
+    return;
+  }
+  for (unsigned i = 0; i < sf.order; ++i) {
+    w.put_signed(x[i], bps);
+  }
+  if (sf.kind == Kind::Lpc) {
+    w.put(sf.precision - 1, 4);
+    w.put_signed(sf.shift, 5);
+    for (int32_t c : sf.coefs) {
+      w.put_signed(c, sf.precision);
+    }
+  }
+  w.put(0, 2);  // 4-bit Rice parameters
+  w.put(sf.partition_order, 4);
+  const size_t per_partition = x.size() >> sf.partition_order;
+  size_t i = sf.order;
+  for (size_t p = 0; p < (size_t{1} << sf.partition_order); ++p) {
+    if (sf.escape) {
+      w.put(0xF, 4);
+      w.put(20, 5);
+    } else {
+      w.put(sf.rice, 4);
+    }
+    for (; i < (p + 1) * per_partition; ++i) {
+      const int32_t residual = static_cast<int32_t>(x[i] - predict(sf, x, i));
+      if (sf.escape) {
+        w.put_signed(residual, 20);
+      } else {
+        w.put_rice(residual, sf.rice);
+      }
+    }
+  }
+}
+
+struct Frame {
+  std::vector<std::vector<int64_t>> channels;  // left/right (or mono) samples
+  unsigned assignment{0};  // 0-7 independent, 8 left/side, 9 side/right, 10 mid/side
+  unsigned size_code{0};   // 0: bits from STREAMINFO
+  unsigned bps{16};
+  std::vector<Subframe> subframes;
+  std::vector<uint8_t> frame_number{0};  // UTF-8 coded
+};
+
+std::vector<uint8_t> encode(const Frame& f) {
+  const size_t n = f.channels[0].size();
+  BitWriter w;
+  w.put(0xFFF8, 16);  // sync, fixed block size
+  w.put(7, 4);        // 16-bit block size at the end of the header
+  w.put(0, 4);        // sample rate from STREAMINFO
+  w.put(f.assignment, 4);
+  w.put(f.size_code, 3);
+  w.put(0, 1);
+  for (uint8_t b : f.frame_number) {
+    w.put(b, 8);
+  }
+  w.put(n - 1, 16);
+  w.put(crc8(w.bytes()), 8);
+
+  std::vector<std::vector<int64_t>> coded = f.channels;
+  if (f.assignment >= 8) {
+    const auto& l = f.channels[0];
+    const auto& r = f.channels[1];
+    std::vector<int64_t> side(n);
+    std::vector<int64_t> mid(n);
+    for (size_t i = 0; i < n; ++i) {
+      side[i] = l[i] - r[i];
+      mid[i] = (l[i] + r[i]) >> 1;
+    }
+    if (f.assignment == 8) {
+      coded = {l, side};
+    } else if (f.assignment == 9) {
+      coded = {side, r};
+    } else {
+      coded = {mid, side};
+    }
+  }
+  for (size_t c = 0; c < coded.size(); ++c) {
+    const bool side = (f.assignment == 8 && c == 1) || (f.assignment == 9 && c == 0) ||
+                      (f.assignment == 10 && c == 1);
+    put_subframe(w, coded[c], f.bps + (side ? 1 : 0), f.subframes[c]);
+  }
+  w.align();
+  const uint16_t crc = crc16(w.bytes());
+  w.put(crc, 16);
+  return w.bytes();
+}
+
+// Smooth enough for the predictors to matter, noisy enough to need residuals
+std::vector<int64_t> tone(size_t n, double amplitude, double period, uint32_t seed) {
+  std::vector<int64_t> out(n);
+  uint32_t state = seed;
+  for (size_t i = 0; i < n; ++i) {
+    state = state * 1664525u + 1013904223u;
+    const int64_t noise = static_cast<int64_t>(state >> 28) - 8;
+    out[i] = static_cast<int64_t>(std::lround(amplitude * std::sin(6.2831853 * i / period))) + noise;
+  }
+  return out;
+}
+
+struct Decoded {
+  std::vector<int16_t> samples;
+  bool error{false};
+};
+
+// Feeds `data` in chunks of `chunk` bytes and drains the decoder after each
+Decoded decode_all(FlacDecoder& dec, const std::vector<uint8_t>& data, size_t chunk) {
+  Decoded d;
+  std::vector<int16_t> out(dec.max_samples() * 2);
+  for (size_t pos = 0; pos < data.size(); pos += chunk) {
+    const size_t len = std::min(chunk, data.size() - pos);
+    bool error = false;
+    size_t got = dec.decode(data.data() + pos, len, out.data(), out.size(), error);
+    d.error = d.error || error;
+    while (got > 0) {
+      d.samples.insert(d.samples.end(), out.begin(), out.begin() + static_cast<std::ptrdiff_t>(got));
+      got = dec.decode(nullptr, 0, out.data(), out.size(), error);
+      d.error = d.error || error;
+    }
+  }
+  return d;
+}
+
+// Interleaved 16-bit output the decoder produces for `channels` at `bps`
+std::vector<int16_t> expected(const std::vector<std::vector<int64_t>>& channels, unsigned bps) {
+  std::vector<int16_t> out;
+  for (size_t i = 0; i < channels[0].size(); ++i) {
+    for (const auto& ch : channels) {
+      const int64_t v = bps > 16 ? ch[i] >> (bps - 16) : ch[i] * (int64_t{1} << (16 - bps));
+      out.push_back(static_cast<int16_t>(v));
+    }
+  }
+  return out;
+}
+
+void test_stream_header() {
+  FlacDecoder dec;
+  CHECK(dec.init(stream_header(2, 16).data(), stream_header(2, 16).size()));
+  CHECK_EQ(dec.info().sample_rate, kRate);
+  CHECK_EQ(dec.info().channels, 2u);
+  CHECK_EQ(dec.info().bits, 16u);
+
+  std::vector<uint8_t> bad = stream_header(2, 16);
+  bad[0] = 'x';
+  CHECK(!dec.init(bad.data(), bad.size()));
+  const std::vector<uint8_t> surround = stream_header(6, 16);
+  CHECK(!dec.init(surround.data(), surround.size()));
+  const std::vector<uint8_t> huge_blocks = stream_header(2, 16, 8192);
+  CHECK(!dec.init(huge_blocks.data(), huge_blocks.size()));
+  CHECK(!dec.init(bad.data(), 20));
+}
+
+void test_mono_subframe_types() {
+  const std::vector<uint8_t> header = stream_header(1, 16);
+  FlacDecoder dec;
+  CHECK(dec.init(header.data(), header.size()));
+
+  const std::vector<int64_t> sig = tone(1024, 9000.0, 97.0, 1);
+  std::vector<Subframe> kinds;
+  kinds.push_back({Kind::Verbatim});
+  for (unsigned order = 0; order <= 4; ++order) {
+    Subframe fixed{Kind::Fixed, order};
+    fixed.rice = order == 0 ? 12 : 5;
+    kinds.push_back(fixed);
+  }
+  // Second-order LPC in 1/4 steps, with partitions and an escaped partition
+  Subframe lpc{Kind::Lpc, 2, {7, -3}, 5, 2};
+  lpc.partition_order = 2;
+  kinds.push_back(lpc);
+  Subframe escaped = lpc;
+  escaped.escape = true;
+  kinds.push_back(escaped);
+  // Order 8, a coarse smoothing filter: large residuals, still exact
+  kinds.push_back({Kind::Lpc, 8, {900, 300, -200, 100, 50, -40, 20, -10}, 12, 10, 0, 9});
+
+  std::vector<uint8_t> stream;
+  std::vector<std::vector<int64_t>> all(1);
+  for (size_t k = 0; k < kinds.size(); ++k) {
+    Frame f{{sig}, 0, 0, 16, {kinds[k]}, {static_cast<uint8_t>(k)}};
+    const std::vector<uint8_t> bytes = encode(f);
+    stream.insert(stream.end(), bytes.begin(), bytes.end());
+    all[0].insert(all[0].end(), sig.begin(), sig.end());
+  }
+  // A constant block
+  const std::vector<int64_t> dc(256, -1234);
+  const std::vector<uint8_t> constant = encode({{dc}, 0, 0, 16, {{Kind::Constant}}, {9}});
+  stream.insert(stream.end(), constant.begin(), constant.end());
+  all[0].insert(all[0].end(), dc.begin(), dc.end());
+
+  const Decoded d = decode_all(dec, stream, stream.size());
+  CHECK(!d.error);
+  CHECK(d.samples == expected(all, 16));
+}
+
+void test_wasted_bits_and_sample_sizes() {
+  // Every sample a multiple of 8: three wasted bits in the subframe
+  std::vector<int64_t> sig = tone(512, 3000.0, 61.0, 2);
+  for (auto& v : sig) {
+    v *= 8;
+  }
+  const std::vector<uint8_t> header = stream_header(1, 16);
+  FlacDecoder dec;
+  CHECK(dec.init(header.data(), header.size()));
+  Subframe wasted{Kind::Fixed, 2};
+  wasted.wasted = 3;
+  Decoded d = decode_all(dec, encode({{sig}, 0, 0, 16, {wasted}}), 4096);
+  CHECK(!d.error);
+  CHECK(d.samples == expected({sig}, 16));
+
+  // 8-bit frames are scaled up, 24-bit frames down, to 16-bit output
+  const std::vector<int64_t> small = tone(256, 100.0, 31.0, 3);
+  d = decode_all(dec, encode({{small}, 0, 1, 8, {{Kind::Fixed, 1}}}), 4096);
+  CHECK(!d.error);
+  CHECK(d.samples == expected({small}, 8));
+
+  const std::vector<uint8_t> header24 = stream_header(1, 24);
+  CHECK(dec.init(header24.data(), header24.size()));
+  std::vector<int64_t> wide = tone(256, 6'000'000.0, 53.0, 4);
+  Subframe wide_fixed{Kind::Fixed, 3};
+  wide_fixed.rice = 8;
+  d = decode_all(dec, encode({{wide}, 0, 0, 24, {wide_fixed}}), 4096);
+  CHECK(!d.error);
+  CHECK(d.samples == expected({wide}, 24));
+}
+
+void test_stereo_decorrelation() {
+  const std::vector<int64_t> left = tone(1152, 12000.0, 80.0, 5);
+  std::vector<int64_t> right = tone(1152, 11000.0, 83.0, 6);
+  right[7] = -32768;  // extremes: the side channel needs its extra bit
+  std::vector<int64_t> l = left;
+  l[7] = 32767;
+  Subframe fixed{Kind::Fixed, 2};
+  fixed.rice = 7;
+  for (unsigned assignment : {1u, 8u, 9u, 10u}) {
+    const std::vector<uint8_t> header = stream_header(2, 16);
+    FlacDecoder dec;
+    CHECK(dec.init(header.data(), header.size()));
+    Frame f{{l, right}, assignment, 0, 16, {fixed, fixed}};
+    // The extreme sample costs a long Rice code in both channels; harmless
+    const Decoded d = decode_all(dec, encode(f), 512);
+    CHECK(!d.error);
+    CHECK(d.samples == expected({l, right}, 16));
+  }
+
+  // Mid/side at 24 bits: the side channel is 25 bits wide
+  const std::vector<uint8_t> header = stream_header(2, 24);
+  FlacDecoder dec;
+  CHECK(dec.init(header.data(), header.size()));
+  std::vector<int64_t> wl = tone(576, 8'000'000.0, 40.0, 7);
+  std::vector<int64_t> wr = wl;
+  for (auto& v : wr) {
+    v = -v;
+  }
+  const Decoded d = decode_all(dec, encode({{wl, wr}, 10, 0, 24, {{Kind::Verbatim}, {Kind::Verbatim}}}), 4096);
+  CHECK(!d.error);
+  CHECK(d.samples == expected({wl, wr}, 24));
+}
+
+void test_frame_number_lead_byte() {
+  const std::vector<uint8_t> header = stream_header(1, 16);
+  const std::vector<int64_t> sig = tone(192, 1000.0, 20.0, 8);
+  FlacDecoder dec;
+  CHECK(dec.init(header.data(), header.size()));
+
+  // Longest form: 0xFE and six continuation bytes
+  Frame f{{sig}, 0, 0, 16, {{Kind::Verbatim}}, {0xFE, 0x80, 0x80, 0x80, 0x81, 0x82, 0x83}};
+  Decoded d = decode_all(dec, encode(f), 4096);
+  CHECK(!d.error);
+  CHECK_EQ(d.samples.size(), sig.size());
+
+  // 0xFF never starts a frame number, even with a matching header CRC
+  f.frame_number = {0xFF, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80};
+  d = decode_all(dec, encode(f), 4096);
+  CHECK(d.error);
+  CHECK(d.samples.empty());
+
+  // A two-byte form with a bad continuation byte
+  f.frame_number = {0xC2, 0x41};
+  d = decode_all(dec, encode(f), 4096);
+  CHECK(d.error);
+  CHECK(d.samples.empty());
+}
+
+void test_split_truncated_and_corrupt_frames() {
+  const std::vector<uint8_t> header = stream_header(2, 16);
+  Subframe fixed{Kind::Fixed, 1};
+  fixed.rice = 6;
+  std::vector<std::vector<uint8_t>> frames;
+  std::vector<std::vector<int64_t>> signals;
+  for (uint8_t i = 0; i < 3; ++i) {
+    const std::vector<int64_t> l = tone(1024, 7000.0, 50.0 + i, 10u + i);
+    const std::vector<int64_t> r = tone(1024, 5000.0, 70.0 + i, 20u + i);
+    frames.push_back(encode({{l, r}, 8, 0, 16, {fixed, fixed}, {i}}));
+    signals.push_back(l);
+    signals.push_back(r);
+  }
+  std::vector<uint8_t> stream;
+  for (const auto& f : frames) {
+    stream.insert(stream.end(), f.begin(), f.end());
+  }
+
+  // Chunks cut mid-frame: the tail waits for the next chunk
+  {
+    FlacDecoder dec;
+    CHECK(dec.init(header.data(), header.size()));
+    const Decoded d = decode_all(dec, stream, 37);
+    CHECK(!d.error);
+    std::vector<int16_t> want;
+    for (size_t i = 0; i < 3; ++i) {
+      const std::vector<int16_t> part = expected({signals[2 * i], signals[2 * i + 1]}, 16);
+      want.insert(want.end(), part.begin(), part.end());
+    }
+    CHECK(d.samples == want);
+  }
+
+  // A truncated frame is incomplete, not corrupt, until the rest arrives
+  {
+    FlacDecoder dec;
+    CHECK(dec.init(header.data(), header.size()));
+    std::vector<int16_t> out(dec.max_samples() * 2);
+    bool error = false;
+    CHECK_EQ(dec.decode(frames[0].data(), frames[0].size() - 3, out.data(), out.size(), error), 0u);
+    CHECK(!error);
+    const size_t got = dec.decode(frames[0].data() + frames[0].size() - 3, 3, out.data(), out.size(), error);
+    CHECK(!error);
+    CHECK_EQ(got, 2048u);
+  }
+
+  // A flipped bit in the middle frame: its CRC fails, its neighbours decode
+  {
+    FlacDecoder dec;
+    CHECK(dec.init(header.data(), header.size()));
+    std::vector<uint8_t> corrupt = stream;
+    corrupt[frames[0].size() + frames[1].size() / 2] ^= 0x10;
+    const Decoded d = decode_all(dec, corrupt, corrupt.size());
+    CHECK(d.error);
+    std::vector<int16_t> want = expected({signals[0], signals[1]}, 16);
+    const std::vector<int16_t> last = expected({signals[4], signals[5]}, 16);
+    want.insert(want.end(), last.begin(), last.end());
+    CHECK(d.samples == want);
+  }
+
+  // Garbage before a frame is skipped up to the next sync code
+  {
+    FlacDecoder dec;
+    CHECK(dec.init(header.data(), header.size()));
+    std::vector<uint8_t> noisy = {0x12, 0xFF, 0x00, 0x34};
+    noisy.insert(noisy.end(), frames[2].begin(), frames[2].end());
+    const Decoded d = decode_all(dec, noisy, noisy.size());
+    CHECK(d.error);
+    CHECK(d.samples == expected({signals[4], signals[5]}, 16));
+  }
+}
+
+}  // namespace
+
+int main() {
+  test_stream_header();
+  test_mono_subframe_types();
+  test_wasted_bits_and_sample_sizes();
+  test_stereo_decorrelation();
+  test_frame_number_lead_byte();
+  test_split_truncated_and_corrupt_frames();
+  return host_test::finish("flac_decoder");
+}
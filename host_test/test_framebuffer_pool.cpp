@@ -0,0 +1,250 @@
+#include "host_test.hpp"
+#include "led_engine/framebuffer_pool.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// FramebufferPool against a mock backend: every allocation is recorded, so
+// the tests see exactly when the pool goes to the heap and when it reuses.
+
+using namespace framebuffer;
+
+namespace {
+
+struct MockAllocation {
+    void* ptr;
+    size_t bytes;
+    bool psram;
+};
+
+struct MockBackend {
+    std::vector<MockAllocation> live;
+    uint32_t allocs{0};
+    uint32_t frees{0};
+    bool fail_next{false};
+    size_t last_alignment{0};
+};
+
+MockBackend s_mock;
+
+void* mock_alloc(size_t bytes, size_t alignment, bool prefer_psram, bool* placed_in_psram) {
+    s_mock.last_alignment = alignment;
+    if (s_mock.fail_next) {
+        s_mock.fail_next = false;
+        return nullptr;
+    }
+    void* mem = std::aligned_alloc(alignment, (bytes + alignment - 1) / alignment * alignment);
+    // Poison so the zeroing on acquire is observable
+    std::memset(mem, 0xA5, bytes);
+    *placed_in_psram = prefer_psram;
+    s_mock.live.push_back({mem, bytes, prefer_psram});
+    s_mock.allocs++;
+    return mem;
+}
+
+void mock_free(void* ptr, size_t bytes) {
+    for (auto it = s_mock.live.begin(); it != s_mock.live.end(); ++it) {
+        if (it->ptr == ptr) {
+            CHECK_EQ(it->bytes, bytes);
+            s_mock.live.erase(it);
+            s_mock.frees++;
+            std::free(ptr);
+            return;
+        }
+    }
+    CHECK(!"free of a pointer the backend never handed out");
+}
+
+// Fresh pool on a fresh mock; cached buffers go back to the mock at scope exit
+struct TestPool : FramebufferPool {
+    TestPool() {
+        s_mock = MockBackend{};
+        CHECK(set_backend(PoolBackend{mock_alloc, mock_free}));
+    }
+    ~TestPool() { trim(); }
+};
+
+bool all_zero(const uint8_t* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (p[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_acquire_rounds_to_size_class() {
+    TestPool pool;
+    const PoolHandle h = pool.acquire(1000);
+    CHECK(h != kInvalidPoolHandle);
+    CHECK_EQ(pool.size(h), 1000u);
+    CHECK_EQ(pool.capacity(h), kPoolSizeClasses[0]);
+    CHECK(pool.data(h) != nullptr);
+    CHECK(all_zero(pool.data(h), 1000));
+    CHECK_EQ(reinterpret_cast<uintptr_t>(pool.data(h)) % FramebufferPool::alignment(), 0u);
+    CHECK_EQ(s_mock.last_alignment, FramebufferPool::alignment());
+    CHECK_EQ(s_mock.live.size(), 1u);
+    CHECK_EQ(s_mock.live[0].bytes, kPoolSizeClasses[0]);
+
+    const PoolStats st = pool.stats();
+    CHECK_EQ(st.classes[0].in_use, 1u);
+    CHECK_EQ(st.requested_bytes, 1000u);
+    CHECK_EQ(st.reserved_bytes, kPoolSizeClasses[0]);
+    CHECK(st.fragmentation > 0.0f && st.fragmentation < 0.05f);
+    pool.release(h);
+}
+
+void test_release_caches_and_reuses() {
+    TestPool pool;
+    const PoolHandle a = pool.acquire(3000);
+    uint8_t* mem = pool.data(a);
+    std::memset(mem, 0xFF, 3000);
+    pool.release(a);
+    CHECK_EQ(s_mock.frees, 0u);  // cached, not freed
+
+    PoolStats st = pool.stats();
+    CHECK_EQ(st.classes[1].in_use, 0u);
+    CHECK_EQ(st.classes[1].cached, 1u);
+    CHECK_EQ(st.cached_bytes, kPoolSizeClasses[1]);
+    CHECK_EQ(st.reserved_bytes, 0u);
+
+    // Same class: the cached buffer comes back, zeroed, without a heap call
+    const PoolHandle b = pool.acquire(4096);
+    CHECK_EQ(pool.data(b), mem);
+    CHECK(all_zero(pool.data(b), 4096));
+    CHECK_EQ(s_mock.allocs, 1u);
+    st = pool.stats();
+    CHECK_EQ(st.allocations, 1u);
+    CHECK_EQ(st.reuses, 1u);
+
+    // Other class: a new allocation
+    const PoolHandle c = pool.acquire(100);
+    CHECK(pool.data(c) != mem);
+    CHECK_EQ(s_mock.allocs, 2u);
+    pool.release(b);
+    pool.release(c);
+}
+
+void test_generation_rejects_stale_handles() {
+    TestPool pool;
+    const PoolHandle old_handle = pool.acquire(512);
+    pool.release(old_handle);
+    CHECK(pool.data(old_handle) == nullptr);
+    CHECK_EQ(pool.size(old_handle), 0u);
+
+    // The slot is reused under a new generation; the old handle stays dead
+    const PoolHandle fresh = pool.acquire(512);
+    CHECK(fresh != old_handle);
+    CHECK_EQ(fresh & 0xFFFF, old_handle & 0xFFFF);
+    CHECK(pool.data(old_handle) == nullptr);
+    CHECK(pool.data(fresh) != nullptr);
+
+    // Releasing the stale handle must not free the live buffer
+    pool.release(old_handle);
+    CHECK(pool.data(fresh) != nullptr);
+    CHECK_EQ(pool.stats().classes[0].in_use, 1u);
+
+    // Double release is ignored as well
+    pool.release(fresh);
+    pool.release(fresh);
+    CHECK_EQ(pool.stats().classes[0].cached, 1u);
+
+    CHECK(pool.data(kInvalidPoolHandle) == nullptr);
+    CHECK(pool.data(0x0001FFFF) == nullptr);  // index past the slot table
+}
+
+void test_oversize_is_dedicated() {
+    TestPool pool;
+    const size_t big = kPoolSizeClasses[kPoolSizeClassCount - 1] + 1;
+    const PoolHandle h = pool.acquire(big);
+    CHECK(h != kInvalidPoolHandle);
+    CHECK_EQ(pool.stats().oversize_in_use, 1u);
+    CHECK_EQ(s_mock.live.size(), 1u);
+    CHECK_EQ(s_mock.live[0].bytes % FramebufferPool::alignment(), 0u);
+    CHECK(s_mock.live[0].bytes >= big);
+    // Not cached: goes straight back to the backend
+    pool.release(h);
+    CHECK_EQ(s_mock.frees, 1u);
+    CHECK_EQ(pool.stats().cached_bytes, 0u);
+}
+
+void test_placement_by_size() {
+    TestPool pool;
+    // Placement follows the class capacity, not the requested size
+    const PoolHandle small = pool.acquire(kPoolSizeClasses[1]);
+    const PoolHandle large = pool.acquire(kPoolSizeClasses[1] + 1);
+    static_assert(kPoolSizeClasses[1] < kPoolPsramThreshold && kPoolSizeClasses[2] >= kPoolPsramThreshold);
+    const PoolStats st = pool.stats();
+    CHECK_EQ(st.internal_bytes, kPoolSizeClasses[1]);
+    CHECK_EQ(st.psram_bytes, kPoolSizeClasses[2]);
+    pool.release(small);
+    pool.release(large);
+}
+
+void test_trim_and_peak() {
+    TestPool pool;
+    const PoolHandle a = pool.acquire(1024);
+    const PoolHandle b = pool.acquire(65536);
+    const PoolHandle c = pool.acquire(65536);
+    pool.release(b);
+    pool.release(c);
+    PoolStats st = pool.stats();
+    CHECK_EQ(st.peak_reserved_bytes, 1024u + 2u * 65536u);
+    CHECK_EQ(st.classes[3].cached, 2u);
+
+    pool.trim();
+    CHECK_EQ(s_mock.frees, 2u);
+    st = pool.stats();
+    CHECK_EQ(st.cached_bytes, 0u);
+    CHECK_EQ(st.classes[3].cached, 0u);
+    CHECK_EQ(st.classes[0].in_use, 1u);  // live buffers survive a trim
+    CHECK(pool.data(a) != nullptr);
+    CHECK_EQ(st.peak_reserved_bytes, 1024u + 2u * 65536u);
+
+    // Trimmed slots are refilled from the heap
+    const PoolHandle d = pool.acquire(65536);
+    CHECK_EQ(s_mock.allocs, 4u);
+    pool.release(a);
+    pool.release(d);
+}
+
+void test_allocation_failure() {
+    TestPool pool;
+    s_mock.fail_next = true;
+    CHECK_EQ(pool.acquire(2048), kInvalidPoolHandle);
+    CHECK_EQ(pool.stats().failures, 1u);
+    CHECK_EQ(pool.acquire(0), kInvalidPoolHandle);
+    const PoolHandle h = pool.acquire(2048);
+    CHECK(h != kInvalidPoolHandle);
+    pool.release(h);
+}
+
+void test_backend_swap() {
+    TestPool pool;
+    const PoolHandle h = pool.acquire(100);
+    CHECK(!pool.set_backend(PoolBackend{mock_alloc, mock_free}));  // buffer live
+    CHECK(!pool.set_backend(PoolBackend{nullptr, mock_free}));
+    pool.release(h);
+    // Cached buffers belong to the old backend and are handed back to it
+    CHECK(pool.set_backend(PoolBackend{mock_alloc, mock_free}));
+    CHECK(s_mock.live.empty());
+    const PoolStats st = pool.stats();
+    CHECK_EQ(st.cached_bytes, 0u);
+    CHECK_EQ(st.internal_bytes + st.psram_bytes, 0u);
+}
+
+}  // namespace
+
+int main() {
+    test_acquire_rounds_to_size_class();
+    test_release_caches_and_reuses();
+    test_generation_rejects_stale_handles();
+    test_oversize_is_dedicated();
+    test_placement_by_size();
+    test_trim_and_peak();
+    test_allocation_failure();
+    test_backend_swap();
+    CHECK(s_mock.live.empty());
+    return host_test::finish("framebuffer_pool");
+}
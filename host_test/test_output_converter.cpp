@@ -0,0 +1,116 @@
+#include "host_test.hpp"
+#include "led_engine/color_processing.hpp"
+#include <cstdint>
+#include <vector>
+
+// OutputConverter and the incremental plan the RMT outputs build on it: a
+// static frame only costs a conversion while dithering still has a residue
+// to move, and never without dithering.
+
+namespace {
+
+constexpr size_t kLeds = 32;
+
+std::vector<uint8_t> gradient() {
+    std::vector<uint8_t> px(kLeds * 3);
+    for (size_t i = 0; i < px.size(); ++i) {
+        px[i] = static_cast<uint8_t>(i * 7 + 3);
+    }
+    return px;
+}
+
+OutputConverter make_converter(bool dither, uint8_t level = 255) {
+    OutputConverter c;
+    c.configure("GRB", 3, 2.2f, 2.2f, true, level, dither);
+    return c;
+}
+
+void test_static_frame_without_dither_is_not_reconverted() {
+    const OutputConverter conv = make_converter(false);
+    const std::vector<uint8_t> px = gradient();
+    std::vector<uint8_t> first(kLeds * 3);
+    std::vector<uint8_t> second(kLeds * 3);
+    DirtyRegion residue;
+    conv.convert_span(PixelFormat::Rgb888, px.data(), first.data(), nullptr, kLeds, &residue, 0);
+    CHECK(residue.empty());
+
+    // The next frame is the same: the effect reports nothing dirty and the
+    // plan is empty, so the output keeps its encoded bytes
+    const DirtyRegion unchanged;
+    CHECK(pending_conversion(unchanged, residue).empty());
+
+    // And converting anyway would have produced the same bytes
+    conv.convert_span(PixelFormat::Rgb888, px.data(), second.data(), nullptr, kLeds, &residue, 0);
+    CHECK(first == second);
+    CHECK(residue.empty());
+}
+
+void test_whole_byte_levels_settle_under_dither() {
+    const OutputConverter conv = make_converter(true);
+    // Black and full scale map to whole table values at full level
+    std::vector<uint8_t> px(kLeds * 3, 0);
+    for (size_t i = kLeds / 2; i < kLeds; ++i) {
+        px[i * 3] = px[i * 3 + 1] = px[i * 3 + 2] = 255;
+    }
+    std::vector<uint8_t> out(kLeds * 3);
+    std::vector<uint8_t> err(kLeds * 3, 0);
+    DirtyRegion residue;
+    conv.convert_span(PixelFormat::Rgb888, px.data(), out.data(), err.data(), kLeds, &residue, 0);
+    CHECK(residue.empty());
+    CHECK_EQ(out[0], 0u);
+    CHECK_EQ(out[kLeds * 3 - 1], 255u);
+    CHECK(pending_conversion(DirtyRegion{}, residue).empty());
+}
+
+void test_residue_marks_only_moving_pixels() {
+    const OutputConverter conv = make_converter(true);
+    std::vector<uint8_t> px(kLeds * 3, 0);
+    // Two separate dim pixels between black ones
+    px[5 * 3] = 40;
+    px[20 * 3 + 2] = 40;
+    CHECK((conv.color_lut[40] & 0xFF) != 0);
+    std::vector<uint8_t> out(kLeds * 3);
+    std::vector<uint8_t> err(kLeds * 3, 0);
+    DirtyRegion residue;
+    // base offsets the residue into the output's LED numbering
+    conv.convert_span(PixelFormat::Rgb888, px.data(), out.data(), err.data(), kLeds, &residue, 100);
+    CHECK_EQ(residue.size(), 2u);
+    if (residue.size() == 2) {
+        CHECK_EQ(residue.begin()[0].start, 105u);
+        CHECK_EQ(residue.begin()[0].length, 1u);
+        CHECK_EQ(residue.begin()[1].start, 120u);
+    }
+
+    // The next frame converts what changed plus the residue pixels, nothing else
+    DirtyRegion changed;
+    changed.add(113, 2);
+    const DirtyRegion plan = pending_conversion(changed, residue);
+    CHECK_EQ(plan.pixel_count(kLeds), 4u);
+    CHECK(!pending_conversion(DirtyRegion{}, residue).empty());
+}
+
+void test_dither_averages_to_table_value() {
+    const OutputConverter conv = make_converter(true, 128);
+    const uint8_t px[3] = {90, 90, 90};
+    uint8_t err[3] = {0, 0, 0};
+    uint32_t sum = 0;
+    bool moving = false;
+    for (int frame = 0; frame < 256; ++frame) {
+        uint8_t out[3];
+        moving = conv.convert(PixelFormat::Rgb888, px, out, err);
+        sum += out[0];
+    }
+    CHECK(moving);
+    // 256 frames carry the fraction exactly: the mean is the 8.8 table value
+    CHECK_EQ(sum, static_cast<uint32_t>(conv.color_lut[90]));
+}
+
+}  // namespace
+
+int main() {
+    test_static_frame_without_dither_is_not_reconverted();
+    test_whole_byte_levels_settle_under_dither();
+    test_residue_marks_only_moving_pixels();
+    test_dither_averages_to_table_value();
+    return host_test::finish("output_converter");
+}
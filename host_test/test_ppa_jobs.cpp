@@ -0,0 +1,240 @@
+#include "host_test.hpp"
+#include "led_engine/framebuffer_pool.hpp"
+#include "led_engine/pixel_ops.hpp"
+#include "led_engine/ppa_accelerator.hpp"
+#include <cstdint>
+#include <vector>
+
+// PPA job queue on the software backend (the only one without a PPA): jobs
+// run on the CPU when the caller polls or waits, oldest first, so chained
+// jobs see each other's output exactly as they would on the hardware queue.
+
+using namespace ppa_accel;
+
+namespace {
+
+struct CallbackLog {
+    std::vector<JobId> ids;
+    std::vector<esp_err_t> results;
+    std::vector<void*> contexts;
+};
+
+CallbackLog s_log;
+
+void record(JobId id, esp_err_t result, void* ctx) {
+    s_log.ids.push_back(id);
+    s_log.results.push_back(result);
+    s_log.contexts.push_back(ctx);
+}
+
+bool pixel_is(const std::vector<uint8_t>& px, size_t i, uint8_t r, uint8_t g, uint8_t b) {
+    return px[i * 3] == r && px[i * 3 + 1] == g && px[i * 3 + 2] == b;
+}
+
+void test_backend_falls_back_to_software() {
+    CHECK_EQ(jobs_init(JobBackend::Hardware), ESP_OK);
+    CHECK(jobs_backend() == JobBackend::Software);
+    CHECK(!is_available());
+    std::vector<uint8_t> px(16 * 3, 0);
+    CHECK(!prefer_hardware(Op::Fill, 16, px.data(), px.size()));
+}
+
+void test_unaligned_outputs_are_routed_to_cpu() {
+    constexpr uint16_t kW = 10;  // 30 bytes: not a whole cache line
+    const size_t bytes = kW * 3;
+    framebuffer::FramebufferPool pool;
+    const framebuffer::PoolHandle h = pool.acquire(bytes);
+    uint8_t* aligned = pool.data(h);
+    const size_t capacity = pool.capacity(h);
+    CHECK(aligned != nullptr);
+    CHECK_EQ(capacity % buffer_alignment(), 0u);
+
+    // Pool buffers with their padded capacity are PPA targets; the same
+    // address without the padding, or an address off the line, is not
+    CHECK(hardware_target(aligned, capacity, bytes));
+    CHECK(!hardware_target(aligned, 0, bytes));
+    CHECK(!hardware_target(aligned + 1, capacity - buffer_alignment(), bytes));
+    CHECK(!hardware_target(aligned, bytes, bytes));
+    CHECK(!hardware_target(nullptr, capacity, bytes));
+
+    // Routing is decided at submission, and the job still produces its result
+    std::vector<uint8_t> unaligned(bytes + 1, 0);
+    JobStats before = job_stats();
+    const JobId a = submit_fill(unaligned.data() + 1, kW, 1, 4, 5, 6);
+    CHECK(a != kInvalidJob);
+    JobStats after = job_stats();
+    CHECK_EQ(after.cpu_routed - before.cpu_routed, 1u);
+    CHECK_EQ(wait_job(a, 10), ESP_OK);
+    CHECK_EQ(unaligned[1], 4u);
+    CHECK_EQ(unaligned[bytes], 6u);
+    CHECK_EQ(job_stats().failed, before.failed);
+
+    before = job_stats();
+    const JobId b = submit_fill(aligned, kW, 1, 7, 8, 9, nullptr, nullptr, capacity);
+    CHECK(b != kInvalidJob);
+    after = job_stats();
+    CHECK_EQ(after.cpu_routed, before.cpu_routed);
+    CHECK_EQ(wait_job(b, 10), ESP_OK);
+    CHECK_EQ(aligned[bytes - 1], 9u);
+    pool.release(h);
+    pool.trim();
+}
+
+void test_jobs_run_in_submission_order() {
+    s_log = CallbackLog{};
+    std::vector<uint8_t> px(16 * 3, 0);
+    const JobStats before = job_stats();
+    const JobId a = submit_fill(px.data(), 16, 1, 1, 1, 1, record);
+    const JobId b = submit_fill(px.data(), 16, 1, 2, 2, 2, record);
+    const JobId c = submit_fill(px.data(), 16, 1, 3, 3, 3, record);
+    CHECK(a != kInvalidJob && b != kInvalidJob && c != kInvalidJob);
+    // Queued, not run: submission never blocks on the work
+    CHECK(!job_done(a) && !job_done(b) && !job_done(c));
+    CHECK(pixel_is(px, 0, 0, 0, 0));
+
+    poll_jobs();  // one job, the oldest
+    CHECK(job_done(a));
+    CHECK(!job_done(b));
+    CHECK(pixel_is(px, 15, 1, 1, 1));
+
+    // Waiting on the last runs everything queued before it, in order
+    CHECK_EQ(wait_job(c, 10), ESP_OK);
+    CHECK(job_done(b) && job_done(c));
+    CHECK(pixel_is(px, 0, 3, 3, 3));
+    CHECK((s_log.ids == std::vector<JobId>{a, b, c}));
+
+    const JobStats after = job_stats();
+    CHECK_EQ(after.submitted - before.submitted, 3u);
+    CHECK_EQ(after.completed - before.completed, 3u);
+    CHECK_EQ(after.software_runs - before.software_runs, 3u);
+    CHECK_EQ(after.failed, before.failed);
+}
+
+void test_chained_jobs_see_earlier_output() {
+    constexpr uint16_t kW = 4;
+    constexpr uint16_t kH = 2;
+    std::vector<uint8_t> fg(kW * kH * 3, 0);
+    for (size_t i = 0; i < fg.size(); ++i) {
+        fg[i] = static_cast<uint8_t>(40 + i);
+    }
+    std::vector<uint8_t> frame(kW * kH * 3, 0);
+    std::vector<uint8_t> rotated(kW * kH * 3, 0);
+
+    // Background fill, blend over it in place, then rotate the result
+    const JobId fill = submit_fill(frame.data(), kW, kH, 200, 100, 0);
+    const JobId blend = submit_blend(fg.data(), frame.data(), frame.data(), kW, kH, 128);
+    const JobId srm = submit_srm(frame.data(), kW, kH, rotated.data(), kH, kW, 90, false, true);
+    CHECK(fill != kInvalidJob && blend != kInvalidJob && srm != kInvalidJob);
+    CHECK_EQ(wait_job(srm, 10), ESP_OK);
+    CHECK(job_done(fill) && job_done(blend));
+
+    // Same pipeline straight through the CPU kernels
+    std::vector<uint8_t> bg(kW * kH * 3, 0);
+    pixel_ops::fill_rgb(bg.data(), kW * kH, 200, 100, 0);
+    std::vector<uint8_t> expect_blend(bg.size(), 0);
+    pixel_ops::blend_rgb(fg.data(), bg.data(), expect_blend.data(), kW * kH, 128);
+    std::vector<uint8_t> expect_rot(bg.size(), 0);
+    pixel_ops::scale_rotate_mirror_rgb(expect_blend.data(), kW, kH, expect_rot.data(), kH, kW, 90, false, true);
+    CHECK(frame == expect_blend);
+    CHECK(rotated == expect_rot);
+    CHECK(frame != bg);  // the blend really ran on the filled background
+}
+
+void test_callbacks_carry_id_result_and_context() {
+    s_log = CallbackLog{};
+    std::vector<uint8_t> px(8 * 3, 0);
+    int ctx_a = 0;
+    int ctx_b = 0;
+    const JobId a = submit_fill(px.data(), 8, 1, 9, 9, 9, record, &ctx_a);
+    const JobId b = submit_blend(px.data(), px.data(), px.data(), 8, 1, 255, record, &ctx_b);
+    const JobId silent = submit_fill(px.data(), 8, 1, 0, 0, 0);  // no callback
+    CHECK_EQ(wait_all_jobs(10), ESP_OK);
+    CHECK(job_done(silent));
+    CHECK_EQ(s_log.ids.size(), 2u);
+    if (s_log.ids.size() == 2) {
+        CHECK_EQ(s_log.ids[0], a);
+        CHECK_EQ(s_log.ids[1], b);
+        CHECK(s_log.contexts[0] == &ctx_a);
+        CHECK(s_log.contexts[1] == &ctx_b);
+        CHECK_EQ(s_log.results[0], ESP_OK);
+        CHECK_EQ(s_log.results[1], ESP_OK);
+    }
+}
+
+void test_wait_job_edges() {
+    CHECK_EQ(wait_job(kInvalidJob, 10), ESP_ERR_INVALID_ARG);
+    CHECK(job_done(kInvalidJob));
+
+    // A zero timeout does not abandon queued software work: the waiter runs it
+    std::vector<uint8_t> px(4 * 3, 0);
+    const JobId a = submit_fill(px.data(), 4, 1, 7, 8, 9);
+    const JobId b = submit_fill(px.data(), 4, 1, 1, 2, 3);
+    CHECK_EQ(wait_job(a, 0), ESP_OK);
+    CHECK(job_done(a));
+    CHECK(!job_done(b));  // only what the waited job depends on
+    CHECK(pixel_is(px, 3, 7, 8, 9));
+    CHECK_EQ(settle_job(b, 0), ESP_OK);
+    CHECK(pixel_is(px, 3, 1, 2, 3));
+
+    // Waiting again on a finished job is immediate
+    CHECK_EQ(wait_job(a, 0), ESP_OK);
+}
+
+void test_queue_full_rejects_without_blocking() {
+    std::vector<uint8_t> px(4 * 3, 0);
+    CHECK_EQ(wait_all_jobs(10), ESP_OK);
+    const JobStats before = job_stats();
+    std::vector<JobId> ids;
+    for (int i = 0; i < 16; ++i) {
+        const JobId id = submit_fill(px.data(), 4, 1, static_cast<uint8_t>(i), 0, 0);
+        CHECK(id != kInvalidJob);
+        ids.push_back(id);
+    }
+    // Every slot holds a queued job now
+    CHECK_EQ(submit_fill(px.data(), 4, 1, 99, 0, 0), kInvalidJob);
+    CHECK_EQ(submit_blend(px.data(), px.data(), px.data(), 4, 1, 10), kInvalidJob);
+    JobStats st = job_stats();
+    CHECK_EQ(st.queue_full - before.queue_full, 2u);
+    CHECK_EQ(st.submitted - before.submitted, 16u);
+
+    // Finishing the oldest frees exactly its slot
+    poll_jobs();
+    CHECK(job_done(ids.front()));
+    const JobId next = submit_fill(px.data(), 4, 1, 50, 0, 0);
+    CHECK(next != kInvalidJob);
+    CHECK_EQ(submit_fill(px.data(), 4, 1, 51, 0, 0), kInvalidJob);
+
+    CHECK_EQ(wait_all_jobs(10), ESP_OK);
+    for (const JobId id : ids) {
+        CHECK(job_done(id));
+    }
+    CHECK(pixel_is(px, 0, 50, 0, 0));  // the last accepted job ran last
+    st = job_stats();
+    CHECK_EQ(st.completed - before.completed, 17u);
+}
+
+void test_invalid_submissions() {
+    const JobStats before = job_stats();
+    std::vector<uint8_t> px(4 * 3, 0);
+    CHECK_EQ(submit_fill(nullptr, 4, 1, 0, 0, 0), kInvalidJob);
+    CHECK_EQ(submit_fill(px.data(), 0, 1, 0, 0, 0), kInvalidJob);
+    CHECK_EQ(submit_blend(px.data(), nullptr, px.data(), 4, 1, 0), kInvalidJob);
+    CHECK_EQ(submit_srm(px.data(), 4, 1, px.data(), 0, 4, 0, false, false), kInvalidJob);
+    const JobStats after = job_stats();
+    CHECK_EQ(after.submitted, before.submitted);
+    CHECK_EQ(after.queue_full, before.queue_full);
+}
+
+}  // namespace
+
+int main() {
+    test_backend_falls_back_to_software();
+    test_unaligned_outputs_are_routed_to_cpu();
+    test_jobs_run_in_submission_order();
+    test_chained_jobs_see_earlier_output();
+    test_callbacks_carry_id_result_and_context();
+    test_wait_job_edges();
+    test_queue_full_rejects_without_blocking();
+    test_invalid_submissions();
+    return host_test::finish("ppa_jobs");
+}
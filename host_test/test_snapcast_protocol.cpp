@@ -0,0 +1,447 @@
+#include "host_test.hpp"
+#include "cJSON.h"
+#include "snapcast_protocol.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Snapcast protocol against a fake server. The server side encodes messages
+// the way snapserver does (base header + payload, little endian, {sec, usec}
+// timestamps) and the client side is the firmware's parser, fed through a
+// simulated TCP stream that splits messages at arbitrary points.
+
+using namespace snapcast;
+
+namespace {
+
+// Deterministic pseudo-random numbers so failures reproduce
+struct Lcg {
+  uint32_t state;
+  uint32_t next() {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+  }
+  // [lo, hi]
+  int64_t range(int64_t lo, int64_t hi) { return lo + static_cast<int64_t>(next() % static_cast<uint32_t>(hi - lo + 1)); }
+};
+
+void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+  }
+}
+
+void put_u16(std::vector<uint8_t>& out, uint16_t v) {
+  out.push_back(static_cast<uint8_t>(v));
+  out.push_back(static_cast<uint8_t>(v >> 8));
+}
+
+void put_tv(std::vector<uint8_t>& out, int64_t us) {
+  int64_t sec = us / 1'000'000;
+  int64_t usec = us % 1'000'000;
+  if (usec < 0) {
+    --sec;
+    usec += 1'000'000;
+  }
+  put_u32(out, static_cast<uint32_t>(sec));
+  put_u32(out, static_cast<uint32_t>(usec));
+}
+
+// 44-byte RIFF/WAVE header as snapserver sends it for the pcm codec
+std::vector<uint8_t> wav_header(uint32_t rate, uint16_t channels, uint16_t bits, bool list_chunk_first) {
+  std::vector<uint8_t> out;
+  out.insert(out.end(), {'R', 'I', 'F', 'F'});
+  put_u32(out, 36);
+  out.insert(out.end(), {'W', 'A', 'V', 'E'});
+  if (list_chunk_first) {
+    out.insert(out.end(), {'L', 'I', 'S', 'T'});
+    put_u32(out, 5);  // odd size: padded to 6
+    out.insert(out.end(), {'I', 'N', 'F', 'O', 'x', 0});
+  }
+  out.insert(out.end(), {'f', 'm', 't', ' '});
+  put_u32(out, 16);
+  put_u16(out, 1);  // PCM
+  put_u16(out, channels);
+  put_u32(out, rate);
+  put_u32(out, rate * channels * bits / 8);
+  put_u16(out, static_cast<uint16_t>(channels * bits / 8));
+  put_u16(out, bits);
+  out.insert(out.end(), {'d', 'a', 't', 'a'});
+  put_u32(out, 0);
+  return out;
+}
+
+struct ServerMessage {
+  MessageType type;
+  uint16_t id;
+  uint16_t refers_to;
+  int64_t sent_us;
+  std::vector<uint8_t> payload;
+};
+
+// Server half of the protocol: encodes messages and answers requests
+class FakeServer {
+public:
+  explicit FakeServer(int64_t clock_offset_us) : offset_us_(clock_offset_us) {}
+
+  int64_t server_time(int64_t local_us) const { return local_us + offset_us_; }
+  int64_t local_time(int64_t server_us) const { return server_us - offset_us_; }
+
+  void send(const ServerMessage& m) {
+    sent_.push_back(m);
+    put_u16(stream_, static_cast<uint16_t>(m.type));
+    put_u16(stream_, m.id);
+    put_u16(stream_, m.refers_to);
+    put_tv(stream_, m.sent_us);
+    put_tv(stream_, 0);  // received: filled in by the receiver
+    put_u32(stream_, static_cast<uint32_t>(m.payload.size()));
+    stream_.insert(stream_.end(), m.payload.begin(), m.payload.end());
+  }
+
+  void send_server_settings(int64_t now_server_us, const std::string& json) {
+    std::vector<uint8_t> body;
+    put_u32(body, static_cast<uint32_t>(json.size()));
+    body.insert(body.end(), json.begin(), json.end());
+    send({MessageType::ServerSettings, next_id_++, 0, now_server_us, body});
+  }
+
+  void send_codec_header(int64_t now_server_us, const std::string& codec, const std::vector<uint8_t>& header) {
+    std::vector<uint8_t> body;
+    put_u32(body, static_cast<uint32_t>(codec.size()));
+    body.insert(body.end(), codec.begin(), codec.end());
+    put_u32(body, static_cast<uint32_t>(header.size()));
+    body.insert(body.end(), header.begin(), header.end());
+    send({MessageType::CodecHeader, next_id_++, 0, now_server_us, body});
+  }
+
+  void send_wire_chunk(int64_t now_server_us, int64_t timestamp_us, const std::vector<uint8_t>& audio) {
+    std::vector<uint8_t> body;
+    put_tv(body, timestamp_us);
+    put_u32(body, static_cast<uint32_t>(audio.size()));
+    body.insert(body.end(), audio.begin(), audio.end());
+    send({MessageType::WireChunk, next_id_++, 0, now_server_us, body});
+  }
+
+  // Answer a Time request that arrived at server time recv_server_us
+  void answer_time(const BaseHeader& request, int64_t recv_server_us, int64_t reply_server_us) {
+    std::vector<uint8_t> body;
+    put_tv(body, recv_server_us - request.sent_us);  // c2s, mixed clocks on purpose
+    send({MessageType::Time, next_id_++, request.id, reply_server_us, body});
+  }
+
+  std::vector<uint8_t> take_stream() {
+    std::vector<uint8_t> out;
+    out.swap(stream_);
+    return out;
+  }
+  const std::vector<ServerMessage>& sent() const { return sent_; }
+
+private:
+  int64_t offset_us_;
+  uint16_t next_id_{1};
+  std::vector<uint8_t> stream_;
+  std::vector<ServerMessage> sent_;
+};
+
+void test_base_header_round_trip() {
+  const int64_t times[] = {0, 1, 999'999, 1'000'000, 1'700'000'123'456, -1, -1'500'000};
+  for (const int64_t t : times) {
+    BaseHeader h{};
+    h.type = MessageType::WireChunk;
+    h.id = 0xBEEF;
+    h.refers_to = 7;
+    h.sent_us = t;
+    h.received_us = -t;
+    h.size = 0x01020304;
+    uint8_t raw[kBaseHeaderSize];
+    write_base_header(raw, h);
+    BaseHeader back{};
+    CHECK(parse_base_header(raw, sizeof(raw), back));
+    CHECK(back.type == h.type);
+    CHECK_EQ(back.id, h.id);
+    CHECK_EQ(back.refers_to, h.refers_to);
+    CHECK_EQ(back.sent_us, t);
+    CHECK_EQ(back.received_us, -t);
+    CHECK_EQ(back.size, h.size);
+    CHECK(!parse_base_header(raw, kBaseHeaderSize - 1, back));
+  }
+}
+
+void test_hello_and_time_request() {
+  HelloInfo info;
+  info.mac = "aa:bb:cc:dd:ee:ff";
+  info.host_name = "ledbrain-test";
+  std::vector<uint8_t> out;
+  build_hello(out, 3, 12'345'678, info);
+  BaseHeader h{};
+  CHECK(parse_base_header(out.data(), out.size(), h));
+  CHECK(h.type == MessageType::Hello);
+  CHECK_EQ(h.id, 3);
+  CHECK_EQ(h.sent_us, 12'345'678);
+  CHECK_EQ(out.size(), kBaseHeaderSize + h.size);
+
+  // The server reads a size-prefixed JSON document
+  const uint8_t* body = out.data() + kBaseHeaderSize;
+  const uint32_t json_len = body[0] | (body[1] << 8) | (body[2] << 16) | (static_cast<uint32_t>(body[3]) << 24);
+  CHECK_EQ(json_len + 4, h.size);
+  cJSON* root = cJSON_ParseWithLength(reinterpret_cast<const char*>(body + 4), json_len);
+  CHECK(root != nullptr);
+  if (root) {
+    auto str = [&](const char* key) {
+      cJSON* v = cJSON_GetObjectItem(root, key);
+      return cJSON_IsString(v) ? std::string(v->valuestring) : std::string();
+    };
+    CHECK_EQ(str("MAC"), info.mac);
+    CHECK_EQ(str("ID"), info.mac);
+    CHECK_EQ(str("HostName"), info.host_name);
+    CHECK_EQ(str("ClientName"), info.client_name);
+    CHECK_EQ(str("OS"), info.os);
+    CHECK_EQ(str("Arch"), info.arch);
+    CHECK_EQ(str("Version"), info.version);
+    cJSON* proto = cJSON_GetObjectItem(root, "SnapStreamProtocolVersion");
+    CHECK(cJSON_IsNumber(proto) && proto->valueint == 2);
+    cJSON* instance = cJSON_GetObjectItem(root, "Instance");
+    CHECK(cJSON_IsNumber(instance) && instance->valueint == 1);
+    cJSON_Delete(root);
+  }
+
+  // Time request: appended after the hello, zero latency payload
+  build_time_request(out, 4, 99);
+  BaseHeader t{};
+  const uint8_t* second = out.data() + kBaseHeaderSize + h.size;
+  CHECK(parse_base_header(second, out.size() - kBaseHeaderSize - h.size, t));
+  CHECK(t.type == MessageType::Time);
+  CHECK_EQ(t.id, 4);
+  CHECK_EQ(t.sent_us, 99);
+  int64_t latency = -1;
+  CHECK(parse_time(second + kBaseHeaderSize, t.size, latency));
+  CHECK_EQ(latency, 0);
+}
+
+void test_payload_parsers() {
+  FakeServer server(0);
+  server.send_server_settings(1, R"({"bufferMs":800,"latency":25,"volume":55,"muted":true})");
+  server.send_server_settings(2, R"({"volume":10})");
+  server.send_server_settings(3, R"({"bufferMs":)");
+  server.send_codec_header(4, "pcm", wav_header(48000, 2, 16, false));
+  server.send_codec_header(5, "pcm", wav_header(44100, 1, 24, true));
+  const std::vector<ServerMessage>& m = server.sent();
+
+  ServerSettings s{};
+  CHECK(parse_server_settings(m[0].payload.data(), m[0].payload.size(), s));
+  CHECK_EQ(s.buffer_ms, 800);
+  CHECK_EQ(s.latency_ms, 25);
+  CHECK_EQ(s.volume, 55);
+  CHECK(s.muted);
+  ServerSettings partial{};
+  CHECK(parse_server_settings(m[1].payload.data(), m[1].payload.size(), partial));
+  CHECK_EQ(partial.volume, 10);
+  CHECK_EQ(partial.buffer_ms, ServerSettings{}.buffer_ms);  // missing fields keep defaults
+  ServerSettings broken{};
+  CHECK(!parse_server_settings(m[2].payload.data(), m[2].payload.size(), broken));
+  CHECK(!parse_server_settings(m[0].payload.data(), 3, broken));
+  // Declared JSON size past the payload
+  CHECK(!parse_server_settings(m[0].payload.data(), m[0].payload.size() - 1, broken));
+
+  CodecHeader codec{};
+  CHECK(parse_codec_header(m[3].payload.data(), m[3].payload.size(), codec));
+  CHECK_EQ(codec.codec, std::string("pcm"));
+  CHECK_EQ(codec.payload_size, 44u);
+  PcmFormat fmt{};
+  CHECK(parse_pcm_format(codec.payload, codec.payload_size, fmt));
+  CHECK_EQ(fmt.sample_rate, 48000u);
+  CHECK_EQ(fmt.channels, 2);
+  CHECK_EQ(fmt.bits, 16);
+  // Chunks before "fmt " are skipped, odd sizes padded
+  CHECK(parse_codec_header(m[4].payload.data(), m[4].payload.size(), codec));
+  CHECK(parse_pcm_format(codec.payload, codec.payload_size, fmt));
+  CHECK_EQ(fmt.sample_rate, 44100u);
+  CHECK_EQ(fmt.channels, 1);
+  CHECK_EQ(fmt.bits, 24);
+  CHECK(!parse_codec_header(m[3].payload.data(), m[3].payload.size() - 1, codec));
+  CHECK(!parse_pcm_format(codec.payload, 12, fmt));
+  const uint8_t not_riff[16] = {'R', 'I', 'F', 'X'};
+  CHECK(!parse_pcm_format(not_riff, sizeof(not_riff), fmt));
+
+  FakeServer audio(0);
+  const std::vector<uint8_t> pcm = {1, 2, 3, 4, 5, 6};
+  audio.send_wire_chunk(0, -2'250'000, pcm);
+  const std::vector<uint8_t>& body = audio.sent()[0].payload;
+  WireChunk chunk{};
+  CHECK(parse_wire_chunk(body.data(), body.size(), chunk));
+  CHECK_EQ(chunk.timestamp_us, -2'250'000);
+  CHECK_EQ(chunk.size, pcm.size());
+  CHECK(chunk.payload != nullptr && std::memcmp(chunk.payload, pcm.data(), pcm.size()) == 0);
+  CHECK(!parse_wire_chunk(body.data(), body.size() - 1, chunk));
+  CHECK(!parse_wire_chunk(body.data(), 11, chunk));
+  int64_t latency = 0;
+  CHECK(!parse_time(body.data(), 7, latency));
+}
+
+// Deliver `stream` in pieces and check every message comes out intact
+void check_reassembly(const std::vector<uint8_t>& stream, const std::vector<ServerMessage>& expected,
+                      Lcg& rng, size_t max_piece) {
+  MessageReader reader;
+  size_t pos = 0;
+  size_t got = 0;
+  int64_t now = 1000;
+  while (pos < stream.size()) {
+    const size_t piece = std::min(stream.size() - pos, static_cast<size_t>(rng.range(1, static_cast<int64_t>(max_piece))));
+    ++now;
+    reader.append(stream.data() + pos, piece, now);
+    pos += piece;
+    BaseHeader h{};
+    const uint8_t* payload = nullptr;
+    bool error = false;
+    while (reader.next(h, payload, error)) {
+      CHECK(got < expected.size());
+      if (got >= expected.size()) {
+        return;
+      }
+      const ServerMessage& m = expected[got++];
+      CHECK(h.type == m.type);
+      CHECK_EQ(h.id, m.id);
+      CHECK_EQ(h.refers_to, m.refers_to);
+      CHECK_EQ(h.sent_us, m.sent_us);
+      CHECK_EQ(h.size, m.payload.size());
+      CHECK(m.payload.empty() || std::memcmp(payload, m.payload.data(), m.payload.size()) == 0);
+      // Stamped with the arrival of the bytes that completed it
+      CHECK_EQ(h.received_us, now);
+    }
+    CHECK(!error);
+  }
+  CHECK_EQ(got, expected.size());
+}
+
+void test_stream_framing() {
+  FakeServer server(0);
+  Lcg rng{42};
+  server.send_server_settings(10, R"({"bufferMs":1000,"latency":0,"volume":100,"muted":false})");
+  server.send_codec_header(20, "pcm", wav_header(48000, 2, 16, false));
+  for (int i = 0; i < 40; ++i) {
+    std::vector<uint8_t> audio(static_cast<size_t>(rng.range(0, 3000)));
+    for (auto& b : audio) {
+      b = static_cast<uint8_t>(rng.next());
+    }
+    server.send_wire_chunk(30 + i, 1'000'000 + i * 20'000, audio);
+  }
+  BaseHeader request{};
+  request.id = 9;
+  request.sent_us = 500;
+  server.answer_time(request, 1500, 1600);
+  const std::vector<uint8_t> stream = server.take_stream();
+
+  check_reassembly(stream, server.sent(), rng, 1);     // byte by byte
+  check_reassembly(stream, server.sent(), rng, 7);
+  check_reassembly(stream, server.sent(), rng, 1460);  // TCP segments
+  check_reassembly(stream, server.sent(), rng, stream.size());
+}
+
+void test_corrupt_header() {
+  MessageReader reader;
+  uint8_t raw[kBaseHeaderSize];
+  BaseHeader h{};
+  h.type = MessageType::WireChunk;
+  h.size = kMaxPayload + 1;
+  write_base_header(raw, h);
+  reader.append(raw, sizeof(raw), 1);
+  BaseHeader out{};
+  const uint8_t* payload = nullptr;
+  bool error = false;
+  CHECK(!reader.next(out, payload, error));
+  CHECK(error);
+
+  // A short read is not an error, just incomplete
+  reader.reset();
+  reader.append(raw, 10, 2);
+  CHECK(!reader.next(out, payload, error));
+  CHECK(!error);
+}
+
+// One Time exchange through the fake server; the reply is handled like
+// snapclient_light does
+void time_exchange(FakeServer& server, ClockSync& clock, int64_t local_send_us, int64_t c2s_delay_us,
+                   int64_t s2c_delay_us) {
+  std::vector<uint8_t> request;
+  build_time_request(request, 1, local_send_us);
+  BaseHeader req{};
+  parse_base_header(request.data(), request.size(), req);
+  const int64_t recv_server = server.server_time(local_send_us + c2s_delay_us);
+  const int64_t reply_server = recv_server + 150;  // server processing
+  server.answer_time(req, recv_server, reply_server);
+  const std::vector<uint8_t> reply = server.take_stream();
+
+  MessageReader reader;
+  const int64_t local_recv = server.local_time(reply_server) + s2c_delay_us;
+  reader.append(reply.data(), reply.size(), local_recv);
+  BaseHeader h{};
+  const uint8_t* payload = nullptr;
+  bool error = false;
+  CHECK(reader.next(h, payload, error));
+  CHECK(h.type == MessageType::Time);
+  int64_t c2s = 0;
+  CHECK(parse_time(payload, h.size, c2s));
+  clock.add(c2s, h.received_us - h.sent_us);
+}
+
+void test_clock_sync() {
+  const int64_t offset = 1'700'000'000'000'000LL - 5'000'000;  // server epoch vs local uptime
+  FakeServer server(offset);
+  ClockSync clock;
+  Lcg rng{7};
+  int64_t now = 5'000'000;
+
+  for (size_t i = 0; i < ClockSync::kMinSamples; ++i) {
+    CHECK(!clock.synced());
+    time_exchange(server, clock, now, rng.range(800, 1200), rng.range(800, 1200));
+    now += 100'000;
+  }
+  CHECK(clock.synced());
+  CHECK(std::llabs(clock.offset_us() - offset) < 500);
+
+  // Every fourth exchange is held up by a WiFi retry in one direction; the
+  // median ignores them where a mean would drift by several milliseconds
+  for (int i = 0; i < 200; ++i) {
+    int64_t up = rng.range(500, 1500);
+    int64_t down = rng.range(500, 1500);
+    if (i % 4 == 0) {
+      (i % 8 == 0 ? up : down) += rng.range(20'000, 80'000);
+    }
+    time_exchange(server, clock, now, up, down);
+    now += 1'000'000;
+  }
+  CHECK_EQ(clock.samples(), ClockSync::kWindow);
+  CHECK(std::llabs(clock.offset_us() - offset) < 500);
+
+  const int64_t server_us = clock.to_server(now);
+  CHECK_EQ(clock.to_local(server_us), now);
+  CHECK(std::llabs(server_us - server.server_time(now)) < 500);
+
+  // A server clock step is followed once it owns the window's majority
+  FakeServer stepped(offset + 250'000);
+  for (size_t i = 0; i < ClockSync::kWindow / 2 + 1; ++i) {
+    time_exchange(stepped, clock, now, 1000, 1000);
+    now += 1'000'000;
+  }
+  CHECK(std::llabs(clock.offset_us() - (offset + 250'000)) < 500);
+
+  clock.reset();
+  CHECK(!clock.synced());
+  CHECK_EQ(clock.samples(), 0u);
+  CHECK_EQ(clock.offset_us(), 0);
+}
+
+}  // namespace
+
+int main() {
+  test_base_header_round_trip();
+  test_hello_and_time_request();
+  test_payload_parsers();
+  test_stream_framing();
+  test_corrupt_header();
+  test_clock_sync();
+  return host_test::finish("snapcast_protocol");
+}
@@ -1,9 +1,12 @@
 #include "config.hpp"
+#include "led_engine/audio_filterbank.hpp"
+#include "led_engine/audio_pipeline.hpp"
 #include "cJSON.h"
 #include "esp_log.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 #include <algorithm>
+#include <cctype>
 #include <string>
 #include <utility>
 
@@ -23,6 +26,7 @@ void decode_wled_effects(AppConfig& cfg, cJSON* root);
 void encode_wled_effects(const AppConfig& cfg, cJSON* root);
 void decode_virtual_segments(AppConfig& cfg, cJSON* root);
 void encode_virtual_segments(const AppConfig& cfg, cJSON* root);
+void compile_audio_selections(AppConfig& cfg);
 
 void prune_legacy_defaults(AppConfig& cfg) {
   // Drop the old default "Biurko"/"Desk" segment that was bundled in config.json
@@ -291,6 +295,8 @@ bool decode_json(AppConfig& cfg, const char* json, size_t len) {
   dedupe_wled_config(cfg);
   prune_wled_effect_bindings(cfg);
   dedupe_wled_effects(cfg);
+  // After every section: band ranges depend on the audio filterbank
+  compile_audio_selections(cfg);
 
   cJSON_Delete(root);
   return true;
@@ -380,6 +386,28 @@ AudioSourceType audio_source_from_string(const char* value) {
   return AudioSourceType::None;
 }
 
+const char* audio_scale_to_string(AudioScale scale) {
+  switch (scale) {
+    case AudioScale::Mel:
+      return "mel";
+    case AudioScale::Bark:
+      return "bark";
+    case AudioScale::ConstantQ:
+      return "cq";
+  }
+  return "mel";
+}
+
+AudioScale audio_scale_from_string(const char* value) {
+  if (!value) {
+    return AudioScale::Mel;
+  }
+  std::string v = value;
+  if (v == "bark") return AudioScale::Bark;
+  if (v == "cq" || v == "constant_q") return AudioScale::ConstantQ;
+  return AudioScale::Mel;
+}
+
 void decode_matrix(LedMatrixConfig& cfg, cJSON* obj) {
   if (!cJSON_IsObject(obj)) {
     return;
@@ -396,6 +424,23 @@ void decode_matrix(LedMatrixConfig& cfg, cJSON* obj) {
   if (cJSON* vert = cJSON_GetObjectItem(obj, "vertical"); cJSON_IsBool(vert)) {
     cfg.vertical = cJSON_IsTrue(vert);
   }
+  if (cJSON* rw = cJSON_GetObjectItem(obj, "render_width"); cJSON_IsNumber(rw)) {
+    cfg.render_width = static_cast<uint16_t>(std::max(0, static_cast<int>(rw->valuedouble)));
+  }
+  if (cJSON* rh = cJSON_GetObjectItem(obj, "render_height"); cJSON_IsNumber(rh)) {
+    cfg.render_height = static_cast<uint16_t>(std::max(0, static_cast<int>(rh->valuedouble)));
+  }
+  if (cJSON* rot = cJSON_GetObjectItem(obj, "rotation"); cJSON_IsNumber(rot)) {
+    // Snap to quarter turns
+    const int quarters = ((static_cast<int>(rot->valuedouble) / 90) % 4 + 4) % 4;
+    cfg.rotation = static_cast<uint16_t>(quarters * 90);
+  }
+  if (cJSON* mx = cJSON_GetObjectItem(obj, "mirror_x"); cJSON_IsBool(mx)) {
+    cfg.mirror_x = cJSON_IsTrue(mx);
+  }
+  if (cJSON* my = cJSON_GetObjectItem(obj, "mirror_y"); cJSON_IsBool(my)) {
+    cfg.mirror_y = cJSON_IsTrue(my);
+  }
 }
 
 cJSON* encode_matrix(const LedMatrixConfig& cfg) {
@@ -407,6 +452,11 @@ cJSON* encode_matrix(const LedMatrixConfig& cfg) {
   cJSON_AddNumberToObject(obj, "height", cfg.height);
   cJSON_AddBoolToObject(obj, "serpentine", cfg.serpentine);
   cJSON_AddBoolToObject(obj, "vertical", cfg.vertical);
+  cJSON_AddNumberToObject(obj, "render_width", cfg.render_width);
+  cJSON_AddNumberToObject(obj, "render_height", cfg.render_height);
+  cJSON_AddNumberToObject(obj, "rotation", cfg.rotation);
+  cJSON_AddBoolToObject(obj, "mirror_x", cfg.mirror_x);
+  cJSON_AddBoolToObject(obj, "mirror_y", cfg.mirror_y);
   return obj;
 }
 
@@ -535,12 +585,40 @@ void decode_led_segments(LedHardwareConfig& hw, cJSON* obj) {
       }
       if (cJSON* chipset = cJSON_GetObjectItem(entry, "chipset"); cJSON_IsString(chipset)) seg.chipset = chipset->valuestring;
       if (cJSON* order = cJSON_GetObjectItem(entry, "color_order"); cJSON_IsString(order)) seg.color_order = order->valuestring;
+      if (cJSON* enc = cJSON_GetObjectItem(entry, "rmt_encoding"); cJSON_IsString(enc)) seg.rmt_encoding = enc->valuestring;
+      if (cJSON* outputs = cJSON_GetObjectItem(entry, "outputs"); cJSON_IsArray(outputs)) {
+        cJSON* out = nullptr;
+        cJSON_ArrayForEach(out, outputs) {
+          if (!cJSON_IsObject(out)) {
+            continue;
+          }
+          LedOutputChunk chunk{};
+          if (cJSON* gpio = cJSON_GetObjectItem(out, "gpio"); cJSON_IsNumber(gpio)) {
+            chunk.gpio = static_cast<int>(gpio->valuedouble);
+          }
+          if (cJSON* ch = cJSON_GetObjectItem(out, "rmt_channel"); cJSON_IsNumber(ch)) {
+            chunk.rmt_channel = static_cast<uint8_t>(std::max(0, static_cast<int>(ch->valuedouble)));
+          }
+          if (cJSON* cnt = cJSON_GetObjectItem(out, "led_count"); cJSON_IsNumber(cnt)) {
+            chunk.led_count = static_cast<uint16_t>(std::max(0, static_cast<int>(cnt->valuedouble)));
+          }
+          if (chunk.gpio >= 0) {
+            seg.outputs.push_back(chunk);
+          }
+        }
+      }
       if (cJSON* src = cJSON_GetObjectItem(entry, "effect_source"); cJSON_IsString(src)) {
         seg.effect_source = src->valuestring;
       }
       if (cJSON* ena = cJSON_GetObjectItem(entry, "enabled"); cJSON_IsBool(ena)) seg.enabled = cJSON_IsTrue(ena);
       if (cJSON* rev = cJSON_GetObjectItem(entry, "reverse"); cJSON_IsBool(rev)) seg.reverse = cJSON_IsTrue(rev);
       if (cJSON* mir = cJSON_GetObjectItem(entry, "mirror"); cJSON_IsBool(mir)) seg.mirror = cJSON_IsTrue(mir);
+      if (cJSON* grp = cJSON_GetObjectItem(entry, "grouping"); cJSON_IsNumber(grp)) {
+        seg.grouping = static_cast<uint16_t>(std::max(1, static_cast<int>(grp->valuedouble)));
+      }
+      if (cJSON* spc = cJSON_GetObjectItem(entry, "spacing"); cJSON_IsNumber(spc)) {
+        seg.spacing = static_cast<uint16_t>(std::max(0, static_cast<int>(spc->valuedouble)));
+      }
       if (cJSON* gamma_col = cJSON_GetObjectItem(entry, "gamma_color"); cJSON_IsNumber(gamma_col)) {
         seg.gamma_color = static_cast<float>(gamma_col->valuedouble);
       }
@@ -550,6 +628,12 @@ void decode_led_segments(LedHardwareConfig& hw, cJSON* obj) {
       if (cJSON* apply_gamma = cJSON_GetObjectItem(entry, "apply_gamma"); cJSON_IsBool(apply_gamma)) {
         seg.apply_gamma = cJSON_IsTrue(apply_gamma);
       }
+      if (cJSON* dither = cJSON_GetObjectItem(entry, "dither"); cJSON_IsBool(dither)) {
+        seg.dither = cJSON_IsTrue(dither);
+      }
+      if (cJSON* fmt = cJSON_GetObjectItem(entry, "pixel_format"); cJSON_IsString(fmt) && fmt->valuestring) {
+        seg.pixel_format = fmt->valuestring;
+      }
       if (cJSON* matrix_en = cJSON_GetObjectItem(entry, "matrix_enabled"); cJSON_IsBool(matrix_en)) {
         seg.matrix_enabled = cJSON_IsTrue(matrix_en);
       }
@@ -606,10 +690,27 @@ void encode_led_segments(const LedHardwareConfig& hw, cJSON* obj) {
     cJSON_AddNumberToObject(s, "rmt_channel", seg.rmt_channel);
     cJSON_AddStringToObject(s, "chipset", seg.chipset.c_str());
     cJSON_AddStringToObject(s, "color_order", seg.color_order.c_str());
+    cJSON_AddStringToObject(s, "rmt_encoding", seg.rmt_encoding.c_str());
+    if (!seg.outputs.empty()) {
+      if (cJSON* outputs = cJSON_AddArrayToObject(s, "outputs")) {
+        for (const auto& chunk : seg.outputs) {
+          cJSON* out = cJSON_CreateObject();
+          if (!out) {
+            continue;
+          }
+          cJSON_AddNumberToObject(out, "gpio", chunk.gpio);
+          cJSON_AddNumberToObject(out, "rmt_channel", chunk.rmt_channel);
+          cJSON_AddNumberToObject(out, "led_count", chunk.led_count);
+          cJSON_AddItemToArray(outputs, out);
+        }
+      }
+    }
     cJSON_AddStringToObject(s, "effect_source", seg.effect_source.c_str());
     cJSON_AddBoolToObject(s, "enabled", seg.enabled);
     cJSON_AddBoolToObject(s, "reverse", seg.reverse);
     cJSON_AddBoolToObject(s, "mirror", seg.mirror);
+    cJSON_AddNumberToObject(s, "grouping", seg.grouping);
+    cJSON_AddNumberToObject(s, "spacing", seg.spacing);
     cJSON_AddBoolToObject(s, "matrix_enabled", seg.matrix_enabled);
     if (cJSON* matrix = encode_matrix(seg.matrix)) {
       cJSON_AddItemToObject(s, "matrix", matrix);
@@ -618,6 +719,8 @@ void encode_led_segments(const LedHardwareConfig& hw, cJSON* obj) {
     cJSON_AddNumberToObject(s, "gamma_color", seg.gamma_color);
     cJSON_AddNumberToObject(s, "gamma_brightness", seg.gamma_brightness);
     cJSON_AddBoolToObject(s, "apply_gamma", seg.apply_gamma);
+    cJSON_AddBoolToObject(s, "dither", seg.dither);
+    cJSON_AddStringToObject(s, "pixel_format", seg.pixel_format.c_str());
     if (cJSON* audio = encode_segment_audio(seg.audio)) {
       cJSON_AddItemToObject(s, "audio", audio);
     }
@@ -639,7 +742,14 @@ void decode_audio_config(AudioConfig& audio, cJSON* obj) {
     audio.frame_ms = static_cast<uint16_t>(std::max(5, static_cast<int>(frame->valuedouble)));
   }
   if (cJSON* fft = cJSON_GetObjectItem(obj, "fft_size"); cJSON_IsNumber(fft)) {
-    audio.fft_size = static_cast<uint16_t>(std::max(64, static_cast<int>(fft->valuedouble)));
+    audio.fft_size = static_cast<uint16_t>(std::clamp(static_cast<int>(fft->valuedouble), 256, 4096));
+  }
+  if (cJSON* scale = cJSON_GetObjectItem(obj, "filterbank"); cJSON_IsString(scale)) {
+    audio.filterbank = audio_scale_from_string(scale->valuestring);
+  }
+  if (cJSON* bands = cJSON_GetObjectItem(obj, "filterbank_bands"); cJSON_IsNumber(bands)) {
+    audio.filterbank_bands =
+        static_cast<uint8_t>(audio_filterbank_bands(static_cast<size_t>(std::max(0.0, bands->valuedouble))));
   }
   if (cJSON* stereo = cJSON_GetObjectItem(obj, "stereo"); cJSON_IsBool(stereo)) {
     audio.stereo = cJSON_IsTrue(stereo);
@@ -676,6 +786,8 @@ void encode_audio_config(const AudioConfig& audio, cJSON* obj) {
   cJSON_AddNumberToObject(obj, "sample_rate", audio.sample_rate);
   cJSON_AddNumberToObject(obj, "frame_ms", audio.frame_ms);
   cJSON_AddNumberToObject(obj, "fft_size", audio.fft_size);
+  cJSON_AddStringToObject(obj, "filterbank", audio_scale_to_string(audio.filterbank));
+  cJSON_AddNumberToObject(obj, "filterbank_bands", audio.filterbank_bands);
   cJSON_AddBoolToObject(obj, "stereo", audio.stereo);
   cJSON_AddNumberToObject(obj, "sensitivity", audio.sensitivity);
   cJSON* snap = cJSON_AddObjectToObject(obj, "snapcast");
@@ -688,6 +800,109 @@ void encode_audio_config(const AudioConfig& audio, cJSON* obj) {
   }
 }
 
+std::string lower_ascii(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return value;
+}
+
+// Resolve the audio fields of an assignment to band IDs and enums once, when
+// the config changes, so effects never compare names while rendering
+void compile_audio_selection(EffectAssignment& assign, const AudioConfig& audio_cfg) {
+  const size_t bands = audio_filterbank_bands(audio_cfg.filterbank_bands);
+  AudioSelection audio{};
+  const std::string mode = lower_ascii(assign.reactive_mode);
+  if (mode == "kick") {
+    audio.mode = AudioReactiveMode::Kick;
+  } else if (mode == "bass") {
+    audio.mode = AudioReactiveMode::Bass;
+  } else if (mode == "mids") {
+    audio.mode = AudioReactiveMode::Mids;
+  } else if (mode == "treble") {
+    audio.mode = AudioReactiveMode::Treble;
+  }
+  for (const auto& name : assign.selected_bands) {
+    AudioBand band{};
+    if (!led_audio_band_from_name(name, band)) {
+      ESP_LOGW(TAG, "Unknown audio band '%s' ignored", name.c_str());
+    } else if (static_cast<size_t>(band) >= static_cast<size_t>(AudioBand::Geq0) + bands) {
+      ESP_LOGW(TAG, "Audio band '%s' ignored: filterbank has %u bands", name.c_str(),
+               static_cast<unsigned>(bands));
+    } else if (audio.band_count < AudioSelection::kMaxBands) {
+      audio.bands[audio.band_count++] = band;
+    }
+  }
+  if (assign.freq_min > 0.0f && assign.freq_max > 0.0f) {
+    size_t first = 0;
+    size_t count = 0;
+    audio_filterbank_range(audio_cfg.filterbank, bands, std::min(assign.freq_min, assign.freq_max),
+                           std::max(assign.freq_min, assign.freq_max), first, count);
+    audio.range_first = static_cast<uint8_t>(first);
+    audio.range_count = static_cast<uint8_t>(count);
+  }
+  audio.gain_low = assign.band_gain_low;
+  audio.gain_mid = assign.band_gain_mid;
+  audio.gain_high = assign.band_gain_high;
+  audio.profile_gain = assign.audio_profile == "ledfx_energy" ? 1.1f
+                     : assign.audio_profile == "ledfx_tempo"  ? 1.05f
+                                                              : 1.0f;
+  assign.audio = audio;
+}
+
+// Give an audio-linked assignment with attack/release a slot in the
+// analyzer's envelopes, shared with every other one following the same input
+void assign_audio_envelope(EffectAssignment& assign, std::vector<AudioEnvelopeSpec>& envelopes) {
+  if (!assign.audio_link || (assign.attack_ms == 0 && assign.release_ms == 0)) {
+    return;
+  }
+  AudioEnvelopeSpec spec{};
+  spec.input = assign.audio;
+  spec.attack_ms = assign.attack_ms;
+  spec.release_ms = assign.release_ms;
+  auto it = std::find_if(envelopes.begin(), envelopes.end(), [&](const AudioEnvelopeSpec& other) {
+    return other.input == spec.input && other.attack_ms == spec.attack_ms && other.release_ms == spec.release_ms;
+  });
+  if (it == envelopes.end()) {
+    if (envelopes.size() >= kAudioMaxEnvelopes) {
+      ESP_LOGW(TAG, "Effect '%s': all %u audio envelopes in use, attack/release ignored", assign.effect.c_str(),
+               static_cast<unsigned>(kAudioMaxEnvelopes));
+      return;
+    }
+    it = envelopes.insert(envelopes.end(), spec);
+  }
+  assign.audio.envelope = static_cast<uint8_t>(it - envelopes.begin());
+}
+
+void compile_audio_selections(AppConfig& cfg) {
+  const AudioConfig& audio = cfg.led_engine.audio;
+  auto& envelopes = cfg.led_engine.audio_envelopes;
+  envelopes.clear();
+  for (auto& assign : cfg.led_engine.effects.assignments) {
+    compile_audio_selection(assign, audio);
+    assign_audio_envelope(assign, envelopes);
+  }
+  for (auto& bind : cfg.wled_effects.bindings) {
+    compile_audio_selection(bind.effect, audio);
+    bind.effect.audio.channel = bind.channel;
+    assign_audio_envelope(bind.effect, envelopes);
+  }
+  for (auto& seg : cfg.virtual_segments) {
+    compile_audio_selection(seg.effect, audio);
+    assign_audio_envelope(seg.effect, envelopes);
+  }
+}
+
+AudioChannel audio_channel_from_string(const std::string& value) {
+  const std::string channel = lower_ascii(value);
+  if (channel == "left") {
+    return AudioChannel::Left;
+  }
+  if (channel == "right") {
+    return AudioChannel::Right;
+  }
+  return AudioChannel::Mix;
+}
+
 bool decode_effect_assignment(EffectAssignment& assign, cJSON* entry, bool allow_segment_id) {
   if (!cJSON_IsObject(entry)) {
     return false;
@@ -947,6 +1162,7 @@ void decode_wled_effects(AppConfig& cfg, cJSON* root) {
       if (cJSON* ch = cJSON_GetObjectItem(entry, "audio_channel"); cJSON_IsString(ch)) {
         bind.audio_channel = ch->valuestring;
       }
+      bind.channel = audio_channel_from_string(bind.audio_channel);
       if (cJSON* fps = cJSON_GetObjectItem(entry, "fps"); cJSON_IsNumber(fps)) {
         bind.fps = static_cast<uint16_t>(std::clamp(static_cast<int>(fps->valuedouble), 1, 120));
       }
@@ -1058,6 +1274,15 @@ void decode_virtual_segments(AppConfig& cfg, cJSON* root) {
         if (cJSON* len = cJSON_GetObjectItem(m, "length"); cJSON_IsNumber(len)) {
           mem.length = static_cast<uint16_t>(std::max(0, static_cast<int>(len->valuedouble)));
         }
+        if (cJSON* offset = cJSON_GetObjectItem(m, "offset"); cJSON_IsNumber(offset)) {
+          mem.offset = std::max(-1, static_cast<int>(offset->valuedouble));
+        }
+        if (cJSON* stride = cJSON_GetObjectItem(m, "stride"); cJSON_IsNumber(stride)) {
+          mem.stride = static_cast<uint16_t>(std::max(1, static_cast<int>(stride->valuedouble)));
+        }
+        if (cJSON* reverse = cJSON_GetObjectItem(m, "reverse"); cJSON_IsBool(reverse)) {
+          mem.reverse = cJSON_IsTrue(reverse);
+        }
         seg.members.push_back(mem);
       }
     }
@@ -1091,6 +1316,9 @@ void encode_virtual_segments(const AppConfig& cfg, cJSON* root) {
         cJSON_AddNumberToObject(m, "segment_index", mem.segment_index);
         cJSON_AddNumberToObject(m, "start", mem.start);
         cJSON_AddNumberToObject(m, "length", mem.length);
+        cJSON_AddNumberToObject(m, "offset", mem.offset);
+        cJSON_AddNumberToObject(m, "stride", mem.stride);
+        cJSON_AddBoolToObject(m, "reverse", mem.reverse);
         cJSON_AddItemToArray(members, m);
       }
     }
@@ -62,6 +62,7 @@ struct WledEffectBinding {
   bool enabled{true};
   bool ddp{true};
   std::string audio_channel{"mix"};  // mix | left | right
+  AudioChannel channel{AudioChannel::Mix};  // decoded from audio_channel
   uint16_t fps{60};  // Per-device FPS (1-120, default 60)
   EffectAssignment effect{};
 };
@@ -6,6 +6,9 @@
 #include "esp_netif.h"
 #include "lwip/netif.h"
 #include "eth_init.hpp"  // For extern esp_netif_t* netif
+#include "led_engine/mem_placement.hpp"
+#include "led_engine/color_processing.hpp"
+#include "led_engine/pixel_ops.hpp"
 #include <cmath>
 #include <unistd.h>
 #include <fcntl.h>
@@ -14,6 +17,7 @@
 #include <vector>
 #include <unordered_map>
 #include <cerrno>
+#include <mutex>
 
 static const char* TAG = "ddp";
 
@@ -42,15 +46,24 @@ namespace {
 // Static socket for reuse - avoid creating new socket for each frame
 static int s_ddp_sock = -1;
 
-bool ddp_send_frame_internal(const struct sockaddr* addr,
-                              socklen_t addr_len,
-                              uint16_t port,
-                              const uint8_t* payload,
-                              size_t bytes,
-                              uint32_t channel,
-                              uint32_t data_offset,
-                              uint8_t seq,
-                              bool push_flag) {
+// DDP maximum payload size: 1440 bytes (480 RGB pixels × 3 bytes)
+constexpr size_t DDP_MAX_PAYLOAD = 1440;
+
+// Packet assembly buffer, reused for every packet; touched per frame so it stays in internal RAM
+static placement::HotVector<uint8_t> s_packet;
+static std::mutex s_packet_mutex;
+
+// Assemble one packet in s_packet and send it; fill(dst) writes the `bytes` of payload
+template <typename Fill>
+bool ddp_send_packet(const struct sockaddr* addr,
+                     socklen_t addr_len,
+                     uint16_t port,
+                     size_t bytes,
+                     uint32_t channel,
+                     uint32_t data_offset,
+                     uint8_t seq,
+                     bool push_flag,
+                     Fill&& fill) {
     // Reuse socket if possible (much faster than creating new socket each frame)
     if (s_ddp_sock < 0) {
         s_ddp_sock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -75,7 +88,12 @@ bool ddp_send_frame_internal(const struct sockaddr* addr,
     }
     const struct sockaddr* final_addr = reinterpret_cast<const struct sockaddr*>(&addr_with_port);
 
-    std::vector<uint8_t> buf(sizeof(DDPHeader) + bytes);
+    std::lock_guard<std::mutex> lock(s_packet_mutex);
+    auto& buf = s_packet;
+    if (buf.capacity() < sizeof(DDPHeader) + DDP_MAX_PAYLOAD) {
+        buf.reserve(sizeof(DDPHeader) + DDP_MAX_PAYLOAD);
+    }
+    buf.resize(sizeof(DDPHeader) + bytes);
     auto* h = reinterpret_cast<DDPHeader*>(buf.data());
     
     // Set DDP header fields (10-byte WLED format)
@@ -88,10 +106,9 @@ bool ddp_send_frame_internal(const struct sockaddr* addr,
     h->data_offset = htonl(data_offset);  // Offset in bytes (big-endian)
     h->data_len = htons(static_cast<uint16_t>(bytes));  // Payload length (big-endian)
 
-    if (bytes > 0 && payload) {
-        // Copy RGB data from render buffer to DDP payload
+    if (bytes > 0) {
         // Payload format: RGB bytes (R, G, B, R, G, B, ...)
-        memcpy(buf.data() + sizeof(DDPHeader), payload, bytes);
+        fill(buf.data() + sizeof(DDPHeader));
     }
 
     // Send DDP packet with proper port set (use persistent socket)
@@ -129,15 +146,69 @@ bool ddp_send_frame_internal(const struct sockaddr* addr,
     return sent == static_cast<int>(buf.size());
 }
 
-}  // namespace
+bool ddp_send_frame_internal(const struct sockaddr* addr,
+                              socklen_t addr_len,
+                              uint16_t port,
+                              const uint8_t* payload,
+                              size_t bytes,
+                              uint32_t channel,
+                              uint32_t data_offset,
+                              uint8_t seq,
+                              bool push_flag) {
+    if (payload == nullptr) {
+        bytes = 0;
+    }
+    return ddp_send_packet(addr, addr_len, port, bytes, channel, data_offset, seq, push_flag,
+                           [&](uint8_t* dst) { std::memcpy(dst, payload, bytes); });
+}
 
-bool ddp_send_frame(const std::string& host,
-                    uint16_t port,
-                    const std::vector<uint8_t>& payload,
-                    uint32_t channel,
-                    uint32_t data_offset,
-                    uint8_t seq,
-                    bool push_flag) {
+// Send a pixel view as consecutive packets, gathering (and dimming) the pixels
+// straight into each packet
+bool ddp_send_view_internal(const struct sockaddr* addr,
+                            socklen_t addr_len,
+                            uint16_t port,
+                            const PixelView& view,
+                            uint8_t level,
+                            uint32_t channel,
+                            uint8_t seq) {
+    constexpr size_t kBytesPerPixel = 3;
+    constexpr size_t kPixelsPerPacket = DDP_MAX_PAYLOAD / kBytesPerPixel;
+    bool all_ok = true;
+    uint8_t current_seq = seq;
+    for (size_t first = 0; first < view.length; first += kPixelsPerPacket) {
+        const size_t count = std::min(kPixelsPerPacket, view.length - first);
+        const bool is_last = first + count >= view.length;
+        const bool ok = ddp_send_packet(
+            addr, addr_len, port, count * kBytesPerPixel, channel, static_cast<uint32_t>(first * kBytesPerPixel),
+            current_seq++, is_last, [&](uint8_t* dst) {
+                if (view.is_contiguous() && view.format == PixelFormat::Rgb888) {
+                    std::memcpy(dst, view.data() + first * kBytesPerPixel, count * kBytesPerPixel);
+                } else {
+                    for (size_t i = 0; i < count; ++i) {
+                        convert_pixels(view.pixel(first + i), view.format, dst + i * kBytesPerPixel,
+                                       PixelFormat::Rgb888, 1);
+                    }
+                }
+                if (level < 255) {
+                    pixel_ops::scale_rgb(dst, count, level);
+                }
+            });
+        if (!ok) {
+            all_ok = false;
+            ESP_LOGW(TAG, "DDP packet send failed at pixel %lu", static_cast<unsigned long>(first));
+        }
+    }
+    return all_ok;
+}
+
+bool ddp_send_host(const std::string& host,
+                   uint16_t port,
+                   const uint8_t* payload,
+                   size_t bytes,
+                   uint32_t channel,
+                   uint32_t data_offset,
+                   uint8_t seq,
+                   bool push_flag) {
     // Resolve hostname
     struct addrinfo hints = {};
     hints.ai_family = AF_INET;
@@ -153,11 +224,23 @@ bool ddp_send_frame(const std::string& host,
         return false;
     }
 
-    bool ok = ddp_send_frame_internal(res->ai_addr, res->ai_addrlen, port, payload.data(), payload.size(), channel, data_offset, seq, push_flag);
+    bool ok = ddp_send_frame_internal(res->ai_addr, res->ai_addrlen, port, payload, bytes, channel, data_offset, seq, push_flag);
     freeaddrinfo(res);
     return ok;
 }
 
+}  // namespace
+
+bool ddp_send_frame(const std::string& host,
+                    uint16_t port,
+                    const std::vector<uint8_t>& payload,
+                    uint32_t channel,
+                    uint32_t data_offset,
+                    uint8_t seq,
+                    bool push_flag) {
+    return ddp_send_host(host, port, payload.data(), payload.size(), channel, data_offset, seq, push_flag);
+}
+
 bool ddp_send_frame_cached(const struct sockaddr_storage* addr,
                            socklen_t addr_len,
                            uint16_t port,
@@ -170,9 +253,6 @@ bool ddp_send_frame_cached(const struct sockaddr_storage* addr,
                                    payload.data(), payload.size(), channel, data_offset, seq, push_flag);
 }
 
-// DDP maximum payload size: 1440 bytes (480 RGB pixels × 3 bytes)
-constexpr size_t DDP_MAX_PAYLOAD = 1440;
-
 bool ddp_send_complete_frame(const std::string& host,
                              uint16_t port,
                              const std::vector<uint8_t>& payload,
@@ -195,11 +275,11 @@ bool ddp_send_complete_frame(const std::string& host,
     
     while (offset < total_bytes) {
         const size_t chunk_size = std::min<size_t>(DDP_MAX_PAYLOAD, total_bytes - offset);
-        std::vector<uint8_t> chunk(payload.begin() + offset, payload.begin() + offset + chunk_size);
         
         // Push flag only on last packet
         const bool is_last = (offset + chunk_size >= total_bytes);
-        const bool ok = ddp_send_frame(host, port, chunk, channel, offset, current_seq++, is_last);
+        const bool ok = ddp_send_host(host, port, payload.data() + offset, chunk_size, channel, offset,
+                                      current_seq++, is_last);
         
         if (!ok) {
             all_ok = false;
@@ -235,11 +315,12 @@ bool ddp_send_complete_frame_cached(const struct sockaddr_storage* addr,
     
     while (offset < total_bytes) {
         const size_t chunk_size = std::min<size_t>(DDP_MAX_PAYLOAD, total_bytes - offset);
-        std::vector<uint8_t> chunk(payload.begin() + offset, payload.begin() + offset + chunk_size);
         
         // Push flag only on last packet
         const bool is_last = (offset + chunk_size >= total_bytes);
-        const bool ok = ddp_send_frame_cached(addr, addr_len, port, chunk, channel, offset, current_seq++, is_last);
+        const bool ok = ddp_send_frame_internal(reinterpret_cast<const struct sockaddr*>(addr), addr_len, port,
+                                                payload.data() + offset, chunk_size, channel, offset,
+                                                current_seq++, is_last);
         
         if (!ok) {
             all_ok = false;
@@ -252,6 +333,70 @@ bool ddp_send_complete_frame_cached(const struct sockaddr_storage* addr,
     return all_ok;
 }
 
+bool ddp_send_spans_cached(const struct sockaddr_storage* addr,
+                           socklen_t addr_len,
+                           uint16_t port,
+                           const std::vector<uint8_t>& payload,
+                           const DirtyRegion& changed,
+                           uint32_t channel,
+                           uint8_t seq) {
+    constexpr size_t kBytesPerPixel = 3;
+    const size_t total_bytes = payload.size();
+    if (total_bytes == 0) {
+        return false;
+    }
+    if (changed.all()) {
+        return ddp_send_complete_frame_cached(addr, addr_len, port, payload, channel, seq);
+    }
+    // Count the packets first so the push flag lands on the last one
+    size_t packets = 0;
+    for (const PixelSpan& span : changed) {
+        const size_t from = std::min(total_bytes, span.start * kBytesPerPixel);
+        const size_t to = std::min(total_bytes, (span.start + span.length) * kBytesPerPixel);
+        packets += (to - from + DDP_MAX_PAYLOAD - 1) / DDP_MAX_PAYLOAD;
+    }
+    bool all_ok = true;
+    uint8_t current_seq = seq;
+    size_t sent = 0;
+    for (const PixelSpan& span : changed) {
+        size_t offset = std::min(total_bytes, span.start * kBytesPerPixel);
+        const size_t end = std::min(total_bytes, (span.start + span.length) * kBytesPerPixel);
+        while (offset < end) {
+            const size_t chunk_size = std::min<size_t>(DDP_MAX_PAYLOAD, end - offset);
+            const bool is_last = ++sent == packets;
+            const bool ok = ddp_send_frame_internal(reinterpret_cast<const struct sockaddr*>(addr), addr_len, port,
+                                                    payload.data() + offset, chunk_size, channel, offset,
+                                                    current_seq++, is_last);
+            if (!ok) {
+                all_ok = false;
+                ESP_LOGW(TAG, "DDP packet send failed at offset %lu", static_cast<unsigned long>(offset));
+            }
+            offset += chunk_size;
+        }
+    }
+    return all_ok;
+}
+
+bool ddp_send_view(const std::string& host,
+                   uint16_t port,
+                   const PixelView& view,
+                   uint8_t level,
+                   uint32_t channel,
+                   uint8_t seq) {
+    if (view.length == 0) {
+        return false;
+    }
+    // Resolve once for all packets of the view
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    if (!ddp_cache_resolve(host, port, &addr, &addr_len)) {
+        ESP_LOGE(TAG, "Failed to resolve %s", host.c_str());
+        return false;
+    }
+    return ddp_send_view_internal(reinterpret_cast<const struct sockaddr*>(&addr), addr_len, port, view, level,
+                                  channel, seq);
+}
+
 bool ddp_cache_resolve(const std::string& host, uint16_t port, struct sockaddr_storage* out_addr, socklen_t* out_addr_len) {
     struct addrinfo hints = {};
     hints.ai_family = AF_INET;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "config.hpp"
+#include "led_engine/dirty_region.hpp"
+#include "led_engine/pixel_view.hpp"
 #include <vector>
 #include <cstdint>
 #include "lwip/sockets.h"
@@ -37,6 +39,23 @@ bool ddp_send_complete_frame_cached(const struct sockaddr_storage* addr,
                                     const std::vector<uint8_t>& payload,
                                     uint32_t channel = 1,
                                     uint8_t seq = 0);
+// Send only the changed pixel spans of an RGB frame, each at its DDP byte offset;
+// the push flag goes out with the last packet. An "all" region sends the whole frame.
+bool ddp_send_spans_cached(const struct sockaddr_storage* addr,
+                           socklen_t addr_len,
+                           uint16_t port,
+                           const std::vector<uint8_t>& payload,
+                           const DirtyRegion& changed,
+                           uint32_t channel = 1,
+                           uint8_t seq = 0);
+// Send a (possibly strided or reversed) view of a composed frame as RGB,
+// dimmed to level, without copying it out of the frame first
+bool ddp_send_view(const std::string& host,
+                   uint16_t port,
+                   const PixelView& view,
+                   uint8_t level = 255,
+                   uint32_t channel = 1,
+                   uint8_t seq = 0);
 // Cache DNS resolution (returns true if cached, false if needs resolution)
 bool ddp_cache_resolve(const std::string& host, uint16_t port, struct sockaddr_storage* out_addr, socklen_t* out_addr_len);// Get network statistics (bytes sent via DDP)
 void ddp_get_stats(uint64_t* tx_bytes, uint64_t* rx_bytes);
@@ -1,11 +1,14 @@
 #include "ledfx_effects.hpp"
 #include "led_engine/audio_pipeline.hpp"
 #include "led_engine/ppa_accelerator.hpp"  // PPA hardware acceleration
+#include "led_engine/framebuffer.hpp"
+#include "led_engine/mem_placement.hpp"
 #include "esp_log.h"
 #include "esp_random.h"
 #include <algorithm>
 #include <cmath>
 #include <cctype>
+#include <cstring>
 #include <unordered_map>
 
 namespace ledfx_effects {
@@ -61,9 +64,10 @@ std::vector<std::string> split_colors(const std::string& text) {
 }
 
 // Per-effect state storage (keyed by effect name + segment)
-static std::unordered_map<std::string, std::vector<float>> s_effect_state;
+// Read and written every frame, so kept in internal RAM
+static std::unordered_map<std::string, placement::HotVector<float>> s_effect_state;
 
-std::vector<float>& get_state(const std::string& key, size_t size) {
+placement::HotVector<float>& get_state(const std::string& key, size_t size) {
   auto& state = s_effect_state[key];
   if (state.size() != size) {
     state.resize(size, 0.0f);
@@ -339,48 +343,70 @@ std::vector<uint8_t> render_effect(const std::string& effect_name,
     const float mag_level = energy * intensity;
     const uint16_t lit_leds = static_cast<uint16_t>(mag_level * pixels);
     
-    // For large segments (1000+ LEDs), use PPA fill for background, then blend lit portion
-    if (pixels >= 1000 && ppa_accel::is_available()) {
-      // Fill background with black using PPA
-      esp_err_t err = ppa_accel::fill_rgb(frame.data(), pixels, 1, 0, 0, 0);
-      if (err == ESP_OK) {
-        // Create foreground buffer for lit LEDs
-        std::vector<uint8_t> fg_buffer(pixels * 3, 0);
-        for (uint16_t i = 0; i < pixels; ++i) {
-          const uint16_t idx = direction > 0 ? i : (pixels - 1 - i);
-          float level = 0.0f;
-          
-          if (idx < lit_leds) {
-            level = 1.0f;
-          } else if (idx < lit_leds + 3 && lit_leds > 0) {
-            level = 1.0f - (static_cast<float>(idx - lit_leds) / 3.0f);
+    // For large segments (1000+ LEDs), use PPA fill for background, then blend lit portion.
+    // The PPA only writes whole cache lines, so it renders into a pool buffer
+    // that is copied into the frame once the jobs are done
+    if (ppa_accel::is_available()) {
+      framebuffer::Framebuffer canvas(pixels, 1);
+      const size_t frame_bytes = std::min<size_t>(frame.size(), canvas.size_bytes);
+      if (ppa_accel::prefer_hardware(ppa_accel::Op::Fill, pixels, canvas.data(), canvas.capacity())) {
+        // Queue the black background fill; the lit portion is built meanwhile
+        const ppa_accel::JobId fill_job = ppa_accel::submit_fill(canvas.data(), pixels, 1, 0, 0, 0, nullptr, nullptr,
+                                                                 canvas.capacity());
+        if (fill_job != ppa_accel::kInvalidJob) {
+          // Create foreground buffer for lit LEDs
+          std::vector<uint8_t> fg_buffer(pixels * 3, 0);
+          for (uint16_t i = 0; i < pixels; ++i) {
+            const uint16_t idx = direction > 0 ? i : (pixels - 1 - i);
+            float level = 0.0f;
+            
+            if (idx < lit_leds) {
+              level = 1.0f;
+            } else if (idx < lit_leds + 3 && lit_leds > 0) {
+              level = 1.0f - (static_cast<float>(idx - lit_leds) / 3.0f);
+            }
+            
+            if (level > 0.0f) {
+              const float grad_pos = static_cast<float>(i) / static_cast<float>(pixels);
+              const Rgb col = gradient.empty() ? hsv_to_rgb(grad_pos * 0.3f, 1.0f, 1.0f) : sample_gradient(gradient, grad_pos);
+              fg_buffer[i * 3 + 0] = to_byte(col.r * brightness * level);
+              fg_buffer[i * 3 + 1] = to_byte(col.g * brightness * level);
+              fg_buffer[i * 3 + 2] = to_byte(col.b * brightness * level);
+            }
           }
           
-          if (level > 0.0f) {
-            const float grad_pos = static_cast<float>(i) / static_cast<float>(pixels);
-            const Rgb col = gradient.empty() ? hsv_to_rgb(grad_pos * 0.3f, 1.0f, 1.0f) : sample_gradient(gradient, grad_pos);
-            fg_buffer[i * 3 + 0] = to_byte(col.r * brightness * level);
-            fg_buffer[i * 3 + 1] = to_byte(col.g * brightness * level);
-            fg_buffer[i * 3 + 2] = to_byte(col.b * brightness * level);
-          }
-        }
-        
-        // Blend foreground over background using PPA
-        if (pixels >= 200) {
-          ppa_accel::blend_rgb(fg_buffer.data(), frame.data(), frame.data(), pixels, 1, 1.0f);
-        } else {
-          // Software blend for smaller segments
-          for (uint16_t i = 0; i < pixels; ++i) {
-            if (fg_buffer[i * 3] > 0 || fg_buffer[i * 3 + 1] > 0 || fg_buffer[i * 3 + 2] > 0) {
-              frame[i * 3 + 0] = fg_buffer[i * 3 + 0];
-              frame[i * 3 + 1] = fg_buffer[i * 3 + 1];
-              frame[i * 3 + 2] = fg_buffer[i * 3 + 2];
+          // Blend foreground over background using PPA, chained behind the fill
+          const ppa_accel::JobId blend_job =
+              ppa_accel::prefer_hardware(ppa_accel::Op::Blend, pixels, canvas.data(), canvas.capacity())
+                  ? ppa_accel::submit_blend(fg_buffer.data(), canvas.data(), canvas.data(), pixels, 1, 255,
+                                            nullptr, nullptr, canvas.capacity())
+                  : ppa_accel::kInvalidJob;
+          // fg_buffer and canvas stay in use until the PPA is done with them
+          bool ppa_ok = false;
+          if (blend_job != ppa_accel::kInvalidJob) {
+            // The blend reads the filled background, so both jobs have to succeed
+            ppa_ok = ppa_accel::settle_job(blend_job, 20) == ESP_OK && ppa_accel::settle_job(fill_job, 20) == ESP_OK;
+            if (ppa_ok) {
+              std::memcpy(frame.data(), canvas.data(), frame_bytes);
+            }
+          } else if (ppa_accel::settle_job(fill_job, 20) == ESP_OK) {
+            // Software blend for smaller segments
+            std::memcpy(frame.data(), canvas.data(), frame_bytes);
+            for (uint16_t i = 0; i < pixels; ++i) {
+              if (fg_buffer[i * 3] > 0 || fg_buffer[i * 3 + 1] > 0 || fg_buffer[i * 3 + 2] > 0) {
+                frame[i * 3 + 0] = fg_buffer[i * 3 + 0];
+                frame[i * 3 + 1] = fg_buffer[i * 3 + 1];
+                frame[i * 3 + 2] = fg_buffer[i * 3 + 2];
+              }
             }
+            ppa_ok = true;
+          }
+          if (ppa_ok) {
+            return frame;
           }
         }
-        return frame;
+        // Fall through to software if a PPA job fails
       }
-      // Fall through to software if PPA fails
     }
     
     // Software rendering (for small segments or if PPA unavailable)
@@ -742,13 +768,13 @@ std::vector<uint8_t> render_effect(const std::string& effect_name,
                        pixels > 200;  // Heuristic: large LED count might be matrix
     
     if (is_2d && effect.audio_link) {
-      // 3D GEQ for 2D matrices: map 32 GEQ bands to height/depth
+      // 3D GEQ for 2D matrices: map GEQ bands to height/depth
       // Each column represents a frequency band, height represents amplitude
-      const int geq_bands = 32;
+      const int geq_bands = std::max(1, static_cast<int>(metrics.geq_count));
       const int columns = std::min(geq_bands, static_cast<int>(pixels));
       const int rows = pixels / columns;  // Approximate rows (for 2D)
       
-      // Get 32-channel GEQ data from current metrics
+      // Get GEQ data (configured filterbank) from current metrics
       const float* geq_data = metrics.geq_bands;  // metrics is already retrieved at function start
       
       for (uint16_t i = 0; i < pixels; ++i) {
@@ -775,18 +801,20 @@ std::vector<uint8_t> render_effect(const std::string& effect_name,
           level *= perspective;
         }
         
-        // Color based on frequency band (low = red, mid = green, high = blue)
+        // Color based on frequency band (low = red, mid = green, high = blue),
+        // split at 8/32 and 20/32 of the band count
+        const float band_pos = static_cast<float>(band_idx) / static_cast<float>(geq_bands);
         Rgb col;
-        if (band_idx < 8) {
+        if (band_pos < 0.25f) {
           // Bass: red to orange
-          col = {1.0f, band_idx / 8.0f * 0.5f, 0.0f};
-        } else if (band_idx < 20) {
+          col = {1.0f, band_pos / 0.25f * 0.5f, 0.0f};
+        } else if (band_pos < 0.625f) {
           // Mid: yellow to green
-          const float mid_pos = (band_idx - 8) / 12.0f;
+          const float mid_pos = (band_pos - 0.25f) / 0.375f;
           col = {1.0f - mid_pos, 1.0f, 0.0f};
         } else {
           // Treble: cyan to blue
-          const float treble_pos = (band_idx - 20) / 12.0f;
+          const float treble_pos = (band_pos - 0.625f) / 0.375f;
           col = {0.0f, 1.0f - treble_pos * 0.5f, treble_pos};
         }
         
@@ -801,9 +829,9 @@ std::vector<uint8_t> render_effect(const std::string& effect_name,
         *dst++ = to_byte(col.b * brightness * level);
       }
     } else {
-      // 1D GEQ visualization: map 32 bands to LED strip
+      // 1D GEQ visualization: map GEQ bands to LED strip
       if (effect.audio_link) {
-        const int geq_bands = 32;
+        const int geq_bands = std::max(1, static_cast<int>(metrics.geq_count));
         const float bands_per_led = static_cast<float>(geq_bands) / static_cast<float>(pixels);
         
         for (uint16_t i = 0; i < pixels; ++i) {
@@ -123,7 +123,7 @@ extern "C" void app_main(void) {
 
   wled_discovery_start(s_cfg);
   if (s_cfg.led_engine.audio.source == AudioSourceType::Snapcast && s_cfg.led_engine.audio.snapcast.enabled) {
-    snapclient_light_start(s_cfg.led_engine.audio.snapcast);
+    snapclient_light_start(s_cfg.led_engine.audio);
   }
   s_wled_fx.start(&s_cfg, &s_led_engine);
   // Web server already started above (before WiFi C6 init)
@@ -500,6 +500,8 @@ function renderLang() {
     lblAudioSource: "audio_source",
     lblAudioSampleRate: "audio_sample_rate",
     lblAudioFft: "audio_fft",
+    lblAudioFilterbank: "audio_filterbank",
+    lblAudioBands: "audio_bands",
     lblAudioFrame: "audio_frame",
     lblAudioSensitivity: "audio_sensitivity",
     lblAudioStereo: "audio_stereo",
@@ -3725,6 +3727,8 @@ function defaultAudioConfig() {
     source: "none",
     sample_rate: 48000,
     fft_size: 1024,
+    filterbank: "mel",
+    filterbank_bands: 32,
     frame_ms: 20,
     stereo: true,
     sensitivity: 1,
@@ -3905,6 +3909,9 @@ function ensureVirtualSegments() {
       m.segment_index = Number.isFinite(m.segment_index) ? m.segment_index : 0;
       m.start = Number.isFinite(m.start) ? m.start : 0;
       m.length = Number.isFinite(m.length) ? m.length : 0;
+      m.offset = Number.isFinite(m.offset) ? m.offset : -1;
+      m.stride = Number.isFinite(m.stride) && m.stride > 0 ? m.stride : 1;
+      m.reverse = m.reverse === true;
     });
     seg.effect =
       seg.effect ||
@@ -4536,6 +4543,20 @@ function renderVirtualSegments() {
               <input type="number" min="0" max="${maxLength}" class="virtual-member-length" value="${m.length || 0}" placeholder="${ledCount > 0 ? ledCount : '0'}">
               <small class="muted">${t("virtual_length_hint") || "Number of LEDs to use (0 = all remaining from start)"}</small>
             </label>
+            <label class="virtual-member-offset-label">
+              <span>${t("virtual_offset")}</span>
+              <input type="number" min="0" class="virtual-member-offset" value="${m.offset >= 0 ? m.offset : ""}" placeholder="${t("virtual_offset_auto")}">
+              <small class="muted">${t("virtual_offset_hint")}</small>
+            </label>
+            <label class="virtual-member-stride-label">
+              <span>${t("virtual_stride")}</span>
+              <input type="number" min="1" class="virtual-member-stride" value="${m.stride || 1}" placeholder="1">
+              <small class="muted">${t("virtual_stride_hint")}</small>
+            </label>
+            <label class="virtual-member-reverse-label">
+              <input type="checkbox" class="virtual-member-reverse" ${m.reverse ? "checked" : ""}>
+              <span>${t("virtual_reverse")}</span>
+            </label>
           </div>
           ${ledCount > 0 ? `
           <div class="virtual-member-preview">
@@ -4606,7 +4627,7 @@ function addVirtualMember(segIdx) {
   const seg = state.config.virtual_segments[segIdx];
   if (!seg) return;
   if (!seg.members) seg.members = [];
-  seg.members.push({ type: "physical", id: "", segment_index: 0, start: 0, length: 0 });
+  seg.members.push({ type: "physical", id: "", segment_index: 0, start: 0, length: 0, offset: -1, stride: 1, reverse: false });
   renderVirtualSegments();
   // Scroll to the new member
   setTimeout(() => {
@@ -4696,6 +4717,36 @@ function handleVirtualListInput(event) {
     }
     return;
   }
+  if (event.target.classList.contains("virtual-member-offset")) {
+    const memberIdx = parseInt(event.target.closest(".virtual-member")?.dataset.member || "0", 10);
+    const mem = seg.members[memberIdx];
+    if (mem) {
+      // Empty keeps the member right after the previous one
+      const val = parseInt(event.target.value, 10);
+      mem.offset = Number.isFinite(val) && val >= 0 ? val : -1;
+      event.target.value = mem.offset >= 0 ? mem.offset : "";
+    }
+    return;
+  }
+  if (event.target.classList.contains("virtual-member-stride")) {
+    const memberIdx = parseInt(event.target.closest(".virtual-member")?.dataset.member || "0", 10);
+    const mem = seg.members[memberIdx];
+    if (mem) {
+      let val = parseInt(event.target.value, 10);
+      if (!Number.isFinite(val) || val < 1) val = 1;
+      mem.stride = val;
+      event.target.value = val;
+    }
+    return;
+  }
+  if (event.target.classList.contains("virtual-member-reverse")) {
+    const memberIdx = parseInt(event.target.closest(".virtual-member")?.dataset.member || "0", 10);
+    const mem = seg.members[memberIdx];
+    if (mem) {
+      mem.reverse = event.target.checked;
+    }
+    return;
+  }
   if (event.target.classList.contains("virtual-member-length")) {
     const memberIdx = parseInt(event.target.closest(".virtual-member")?.dataset.member || "0", 10);
     const mem = seg.members[memberIdx];
@@ -4979,6 +5030,8 @@ function populateAudioForm(led) {
     ["audioSource", audio.source || "none"],
     ["audioSampleRate", audio.sample_rate ?? 48000],
     ["audioFft", audio.fft_size ?? 1024],
+    ["audioFilterbank", audio.filterbank || "mel"],
+    ["audioBands", audio.filterbank_bands ?? 32],
     ["audioFrame", audio.frame_ms ?? 20],
     ["audioSensitivity", audio.sensitivity ?? 1],
     ["audioStereo", audio.stereo ?? true],
@@ -5214,6 +5267,8 @@ function handleAudioFormChange() {
   audio.source = qs("audioSource")?.value || "none";
   audio.sample_rate = parseInt(qs("audioSampleRate")?.value, 10) || 48000;
   audio.fft_size = parseInt(qs("audioFft")?.value, 10) || 1024;
+  audio.filterbank = qs("audioFilterbank")?.value || "mel";
+  audio.filterbank_bands = parseInt(qs("audioBands")?.value, 10) || 32;
   audio.frame_ms = parseInt(qs("audioFrame")?.value, 10) || 20;
   audio.sensitivity = parseFloat(qs("audioSensitivity")?.value) || 1;
   audio.stereo = qs("audioStereo")?.checked ?? true;
@@ -6282,6 +6337,8 @@ function initEvents() {
     "audioSource",
     "audioSampleRate",
     "audioFft",
+    "audioFilterbank",
+    "audioBands",
     "audioFrame",
     "audioSensitivity",
     "audioStereo",
@@ -10,6 +10,10 @@
 #include "led_engine.hpp"
 #include "led_engine/pinout.hpp"
 #include "led_engine/audio_pipeline.hpp"
+#include "led_engine/rmt_driver.hpp"
+#include "led_engine/framebuffer_pool.hpp"
+#include "led_engine/ppa_accelerator.hpp"
+#include "led_engine/mem_placement.hpp"
 #include "wled_effects.hpp"
 #include "esp_app_format.h"
 #include "esp_ota_ops.h"
@@ -58,7 +62,7 @@ namespace {
     char message[MAX_LOG_LINE_LENGTH];
   };
   
-  std::deque<LogEntry> log_buffer;
+  placement::ColdDeque<LogEntry> log_buffer;
   std::mutex log_buffer_mutex;
   vprintf_like_t original_vprintf = nullptr;
   
@@ -723,6 +727,27 @@ static esp_err_t api_info(httpd_req_t* req){
     }
   }
   
+  // Memory placement: usage per allocation tag
+  cJSON* memory = cJSON_AddObjectToObject(root, "memory");
+  if (memory) {
+    cJSON_AddNumberToObject(memory, "free_internal", static_cast<double>(placement::free_internal_bytes()));
+    cJSON_AddNumberToObject(memory, "free_psram", static_cast<double>(placement::free_psram_bytes()));
+    cJSON* tags = cJSON_AddObjectToObject(memory, "tags");
+    for (size_t i = 0; tags && i < placement::kMemTagCount; ++i) {
+      const auto tag = static_cast<placement::MemTag>(i);
+      const placement::TagStats ts = placement::stats(tag);
+      cJSON* t = cJSON_AddObjectToObject(tags, placement::tag_name(tag));
+      if (!t) {
+        continue;
+      }
+      cJSON_AddNumberToObject(t, "bytes", static_cast<double>(ts.bytes_in_use));
+      cJSON_AddNumberToObject(t, "peak_bytes", static_cast<double>(ts.peak_bytes));
+      cJSON_AddNumberToObject(t, "allocations", ts.allocations);
+      cJSON_AddNumberToObject(t, "failures", ts.failures);
+      cJSON_AddNumberToObject(t, "fallbacks", ts.fallbacks);
+    }
+  }
+
   // uptime
   uint64_t us = esp_timer_get_time();
   cJSON_AddNumberToObject(root,"uptime_s", (int)(us/1000000ULL));
@@ -735,6 +760,7 @@ static esp_err_t api_info(httpd_req_t* req){
     if (led) {
       cJSON_AddBoolToObject(led, "initialized", st.initialized);
       cJSON_AddBoolToObject(led, "enabled", st.enabled);
+      cJSON_AddBoolToObject(led, "blackout", st.blackout);
       cJSON_AddNumberToObject(led, "target_fps", st.target_fps);
       cJSON_AddNumberToObject(led, "segments", static_cast<double>(st.segment_count));
       cJSON_AddNumberToObject(led, "current_ma", st.global_current_ma);
@@ -745,12 +771,80 @@ static esp_err_t api_info(httpd_req_t* req){
         cJSON_AddBoolToObject(audio, "running", diag.running);
         cJSON_AddBoolToObject(audio, "stereo", diag.stereo);
         cJSON_AddNumberToObject(audio, "sample_rate", diag.sample_rate);
+        cJSON_AddBoolToObject(audio, "clock_synced", diag.clock_synced);
+        cJSON_AddNumberToObject(audio, "clock_offset_us", static_cast<double>(diag.clock_offset_us));
+        cJSON_AddNumberToObject(audio, "buffer_ms", diag.stream_buffer_ms);
+        cJSON_AddStringToObject(audio, "codec", diag.codec);
+        cJSON_AddNumberToObject(audio, "decode_us", diag.decode_us);
+        cJSON_AddNumberToObject(audio, "decode_max_us", diag.decode_max_us);
         cJSON_AddStringToObject(audio,
                                 "source",
                                 diag.source == AudioSourceType::Snapcast
                                     ? "snapcast"
                                     : (diag.source == AudioSourceType::LineInput ? "line_in" : "none"));
       }
+      std::vector<RmtDriverStats> rmt_stats;
+      rmt_driver_get_stats(rmt_stats);
+      cJSON* outputs = cJSON_AddArrayToObject(led, "outputs");
+      if (outputs) {
+        for (const auto& out : rmt_stats) {
+          cJSON* o = cJSON_CreateObject();
+          if (!o) {
+            continue;
+          }
+          cJSON_AddNumberToObject(o, "gpio", out.gpio);
+          cJSON_AddNumberToObject(o, "rmt_channel", out.rmt_channel);
+          cJSON_AddStringToObject(o, "encoding", out.symbol_lut ? "lut" : "bytes");
+          cJSON_AddNumberToObject(o, "frames", out.frames);
+          cJSON_AddNumberToObject(o, "symbols", static_cast<double>(out.symbols));
+          cJSON_AddNumberToObject(o, "isr_encode_us", static_cast<double>(out.isr_encode_us));
+          cJSON_AddNumberToObject(o, "preencode_us", static_cast<double>(out.preencode_us));
+          cJSON_AddNumberToObject(o, "isr_saved_us", static_cast<double>(out.isr_saved_us));
+          cJSON_AddNumberToObject(o, "busy_skips", out.busy_skips);
+          cJSON_AddItemToArray(outputs, o);
+        }
+      }
+      const ppa_accel::Calibration cal = ppa_accel::calibration();
+      cJSON* ppa = cJSON_AddObjectToObject(led, "ppa");
+      if (ppa) {
+        cJSON_AddBoolToObject(ppa, "available", ppa_accel::is_available());
+        cJSON_AddBoolToObject(ppa, "calibrated", cal.calibrated);
+        // -1 = CPU always faster
+        cJSON_AddNumberToObject(ppa, "fill_crossover_px",
+                                cal.fill_crossover == UINT32_MAX ? -1.0 : static_cast<double>(cal.fill_crossover));
+        cJSON_AddNumberToObject(ppa, "blend_crossover_px",
+                                cal.blend_crossover == UINT32_MAX ? -1.0 : static_cast<double>(cal.blend_crossover));
+        cJSON_AddNumberToObject(ppa, "fill_cpu_us", cal.fill_cpu_us);
+        cJSON_AddNumberToObject(ppa, "fill_ppa_us", cal.fill_ppa_us);
+        cJSON_AddNumberToObject(ppa, "blend_cpu_us", cal.blend_cpu_us);
+        cJSON_AddNumberToObject(ppa, "blend_ppa_us", cal.blend_ppa_us);
+      }
+      const framebuffer::PoolStats pool = framebuffer::get_pool().stats();
+      cJSON* fb = cJSON_AddObjectToObject(led, "framebuffer_pool");
+      if (fb) {
+        cJSON_AddNumberToObject(fb, "requested_bytes", static_cast<double>(pool.requested_bytes));
+        cJSON_AddNumberToObject(fb, "reserved_bytes", static_cast<double>(pool.reserved_bytes));
+        cJSON_AddNumberToObject(fb, "cached_bytes", static_cast<double>(pool.cached_bytes));
+        cJSON_AddNumberToObject(fb, "internal_bytes", static_cast<double>(pool.internal_bytes));
+        cJSON_AddNumberToObject(fb, "psram_bytes", static_cast<double>(pool.psram_bytes));
+        cJSON_AddNumberToObject(fb, "peak_reserved_bytes", static_cast<double>(pool.peak_reserved_bytes));
+        cJSON_AddNumberToObject(fb, "allocations", pool.allocations);
+        cJSON_AddNumberToObject(fb, "reuses", pool.reuses);
+        cJSON_AddNumberToObject(fb, "failures", pool.failures);
+        cJSON_AddNumberToObject(fb, "fragmentation", pool.fragmentation);
+        cJSON* classes = cJSON_AddArrayToObject(fb, "classes");
+        for (size_t i = 0; classes && i < framebuffer::kPoolSizeClassCount; ++i) {
+          cJSON* c = cJSON_CreateObject();
+          if (!c) {
+            continue;
+          }
+          cJSON_AddNumberToObject(c, "bytes", static_cast<double>(pool.classes[i].class_bytes));
+          cJSON_AddNumberToObject(c, "in_use", pool.classes[i].in_use);
+          cJSON_AddNumberToObject(c, "cached", pool.classes[i].cached);
+          cJSON_AddItemToArray(classes, c);
+        }
+        cJSON_AddNumberToObject(fb, "oversize_in_use", pool.oversize_in_use);
+      }
     }
   }
   char* txt = cJSON_PrintUnformatted(root);
@@ -1008,6 +1102,8 @@ static esp_err_t api_save_led(httpd_req_t* req) {
   if (s_wled_fx_runtime) {
     s_wled_fx_runtime->update_config(*s_cfg);
   }
+  // The analyzer is only configured on a codec header; push audio changes now
+  snapclient_light_reconfigure(s_cfg->led_engine.audio);
   httpd_resp_sendstr(req, "OK");
   return ESP_OK;
 }
@@ -1025,6 +1121,28 @@ static esp_err_t api_led_state_get(httpd_req_t* req) {
   cJSON_AddBoolToObject(root, "enabled", enabled);
   cJSON_AddBoolToObject(root, "autostart", s_cfg ? s_cfg->autostart : false);
   cJSON_AddNumberToObject(root, "brightness", brightness);
+  if (s_led_runtime) {
+    cJSON_AddBoolToObject(root, "blackout", s_led_runtime->blackout());
+    cJSON* segments = cJSON_AddArrayToObject(root, "segments");
+    if (segments) {
+      for (const auto& refresh : s_led_runtime->segment_refresh()) {
+        cJSON* seg = cJSON_CreateObject();
+        if (!seg) {
+          continue;
+        }
+        cJSON_AddStringToObject(seg, "id", refresh.id.c_str());
+        cJSON_AddNumberToObject(seg, "frame_time_us", refresh.frame_time_us);
+        cJSON_AddNumberToObject(seg, "max_fps", refresh.max_fps);
+        cJSON_AddNumberToObject(seg, "effective_fps", refresh.effective_fps);
+        cJSON_AddNumberToObject(seg, "frames", refresh.frames);
+        cJSON_AddNumberToObject(seg, "skipped_busy", refresh.skipped);
+        cJSON_AddNumberToObject(seg, "not_due", refresh.not_due);
+        cJSON_AddNumberToObject(seg, "brightness", refresh.brightness);
+        cJSON_AddBoolToObject(seg, "enabled", refresh.enabled);
+        cJSON_AddItemToArray(segments, seg);
+      }
+    }
+  }
   char* txt = cJSON_PrintUnformatted(root);
   if (!txt) {
     cJSON_Delete(root);
@@ -1075,6 +1193,7 @@ static esp_err_t api_wled_effects_save(httpd_req_t* req) {
   } else {
     ESP_LOGW(TAG, "api_wled_effects_save: s_wled_fx_runtime is NULL!");
   }
+  snapclient_light_reconfigure(s_cfg->led_engine.audio);
   httpd_resp_sendstr(req, "OK");
   return ESP_OK;
 }
@@ -1107,13 +1226,55 @@ static esp_err_t api_led_state_post(httpd_req_t* req) {
         if (!value) {
           snapclient_light_stop();
         } else if (s_cfg->led_engine.audio.snapcast.enabled) {
-          snapclient_light_start(s_cfg->led_engine.audio.snapcast);
+          snapclient_light_start(s_cfg->led_engine.audio);
         }
       }
     }
     if (has_brightness) {
       s_led_runtime->set_brightness(brightness);
     }
+    if (cJSON* blackout = cJSON_GetObjectItem(root, "blackout"); cJSON_IsBool(blackout)) {
+      s_led_runtime->set_blackout(cJSON_IsTrue(blackout));
+    }
+  }
+  // Live per-segment controls: [{"id": "...", "brightness": 0-255, "enabled": bool}]
+  bool segments_changed = false;
+  if (cJSON* segments = cJSON_GetObjectItem(root, "segments"); cJSON_IsArray(segments)) {
+    cJSON* entry = nullptr;
+    cJSON_ArrayForEach(entry, segments) {
+      cJSON* id = cJSON_GetObjectItem(entry, "id");
+      if (!cJSON_IsString(id) || !id->valuestring) {
+        continue;
+      }
+      LedSegmentConfig* seg = nullptr;
+      if (s_cfg) {
+        for (auto& candidate : s_cfg->led_engine.segments) {
+          if (candidate.id == id->valuestring) {
+            seg = &candidate;
+            break;
+          }
+        }
+      }
+      if (cJSON* bri = cJSON_GetObjectItem(entry, "brightness"); cJSON_IsNumber(bri)) {
+        const uint8_t value = static_cast<uint8_t>(std::clamp(static_cast<int>(bri->valuedouble), 0, 255));
+        if (s_led_runtime) {
+          s_led_runtime->set_segment_brightness(id->valuestring, value);
+        }
+        if (seg) {
+          seg->segment_brightness = value;
+          segments_changed = true;
+        }
+      }
+      if (cJSON* ena = cJSON_GetObjectItem(entry, "enabled"); cJSON_IsBool(ena)) {
+        if (s_led_runtime) {
+          s_led_runtime->set_segment_enabled(id->valuestring, cJSON_IsTrue(ena));
+        }
+        if (seg) {
+          seg->enabled = cJSON_IsTrue(ena);
+          segments_changed = true;
+        }
+      }
+    }
   }
   bool remember = false;
   if (cJSON* rem = cJSON_GetObjectItem(root, "remember"); cJSON_IsBool(rem)) {
@@ -1127,7 +1288,7 @@ static esp_err_t api_led_state_post(httpd_req_t* req) {
     if (remember) {
       s_cfg->autostart = has_enabled ? value : s_cfg->autostart;
     }
-    if (remember || has_brightness) {
+    if (remember || has_brightness || segments_changed) {
       if (config_save(*s_cfg) != ESP_OK) {
         return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "failed to store led state");
       }
@@ -1163,7 +1324,7 @@ static esp_err_t api_audio_state(httpd_req_t* req) {
     if (!enabled) {
       snapclient_light_stop();
     } else if (s_cfg->led_engine.audio.snapcast.enabled) {
-      snapclient_light_start(s_cfg->led_engine.audio.snapcast);
+      snapclient_light_start(s_cfg->led_engine.audio);
     }
   }
   
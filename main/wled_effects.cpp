@@ -7,7 +7,10 @@
 #include "freertos/task.h"
 #include "led_engine/audio_pipeline.hpp"
 #include "led_engine/ppa_accelerator.hpp"  // PPA hardware acceleration
+#include "led_engine/pixel_ops.hpp"
 #include "led_engine/framebuffer.hpp"  // Framebuffer for multi-pass effects
+#include "led_engine/segment_layout.hpp"
+#include "led_engine/matrix_utils.hpp"
 #include "wled_discovery.hpp"
 #include "esp_random.h"
 #include "esp_timer.h"
@@ -27,35 +30,19 @@ namespace {
 constexpr uint16_t kDefaultDdpPort = 4048;
 static const char* TAG = "wled_fx";
 
-// PPA optimization thresholds
-// PPA overhead is significant for small segments, so we only use it for larger ones
-constexpr uint16_t PPA_FILL_THRESHOLD = 300;  // Use PPA fill for 300+ LEDs
-constexpr uint16_t PPA_BLEND_THRESHOLD = 200;  // Use PPA blend for 200+ LEDs
-constexpr uint16_t PPA_MATRIX_THRESHOLD = 32;  // Use PPA for matrices 32x32 or larger (1024+ pixels)
-
-// Helper: Check if PPA should be used for fill operation
-inline bool should_use_ppa_fill(uint16_t pixel_count, bool is_matrix, uint16_t width, uint16_t height) {
-  if (!ppa_accel::is_available()) {
-    return false;
-  }
-  // For matrices, use PPA if total pixels >= threshold
-  if (is_matrix && width > 0 && height > 0) {
-    return (width * height) >= PPA_MATRIX_THRESHOLD * PPA_MATRIX_THRESHOLD;
-  }
-  // For strips, use PPA if pixel count >= threshold
-  return pixel_count >= PPA_FILL_THRESHOLD;
+// Helper: Check if PPA should be used for fill operation writing to `out`
+// The crossover comes from the boot-time calibration in ppa_accel::calibrate()
+inline bool should_use_ppa_fill(uint16_t pixel_count, bool is_matrix, uint16_t width, uint16_t height,
+                                const uint8_t* out, size_t out_capacity) {
+  const size_t pixels = (is_matrix && width > 0 && height > 0) ? static_cast<size_t>(width) * height : pixel_count;
+  return ppa_accel::prefer_hardware(ppa_accel::Op::Fill, pixels, out, out_capacity);
 }
 
-// Helper: Check if PPA should be used for blend operation
-inline bool should_use_ppa_blend(uint16_t pixel_count, bool is_matrix, uint16_t width, uint16_t height) {
-  if (!ppa_accel::is_available()) {
-    return false;
-  }
-  // Blend has lower threshold due to higher CPU cost
-  if (is_matrix && width > 0 && height > 0) {
-    return (width * height) >= PPA_BLEND_THRESHOLD;
-  }
-  return pixel_count >= PPA_BLEND_THRESHOLD;
+// Helper: Check if PPA should be used for blend operation writing to `out`
+inline bool should_use_ppa_blend(uint16_t pixel_count, bool is_matrix, uint16_t width, uint16_t height,
+                                 const uint8_t* out, size_t out_capacity) {
+  const size_t pixels = (is_matrix && width > 0 && height > 0) ? static_cast<size_t>(width) * height : pixel_count;
+  return ppa_accel::prefer_hardware(ppa_accel::Op::Blend, pixels, out, out_capacity);
 }
 
 // Cache to track which devices have DDP mode enabled (to avoid spamming API)
@@ -365,6 +352,7 @@ struct Rgb {
   float r{1.0f};
   float g{1.0f};
   float b{1.0f};
+  float w{0.0f};  // explicit white from #RRGGBBWW; only native-format effects use it
 };
 
 struct GradientStop {
@@ -428,7 +416,15 @@ Rgb parse_hex_color(const std::string& text, const Rgb& fallback) {
   const float r = (static_cast<float>((r1 << 4) + r2)) / 255.0f;
   const float g = (static_cast<float>((g1 << 4) + g2)) / 255.0f;
   const float b = (static_cast<float>((b1 << 4) + b2)) / 255.0f;
-  return Rgb{r, g, b};
+  float w = 0.0f;
+  if (text.size() - start >= 8) {
+    const int w1 = from_hex(text[start + 6]);
+    const int w2 = from_hex(text[start + 7]);
+    if (w1 >= 0 && w2 >= 0) {
+      w = (static_cast<float>((w1 << 4) + w2)) / 255.0f;
+    }
+  }
+  return Rgb{r, g, b, w};
 }
 
 std::vector<std::string> split_colors(const std::string& text) {
@@ -519,9 +515,83 @@ Rgb sample_gradient(const std::vector<GradientStop>& stops, float t) {
   out.r = a.color.r + (b.color.r - a.color.r) * local;
   out.g = a.color.g + (b.color.g - a.color.g) * local;
   out.b = a.color.b + (b.color.b - a.color.b) * local;
+  out.w = a.color.w + (b.color.w - a.color.w) * local;
   return out;
 }
 
+uint32_t effect_look(const Rgb& a, const Rgb& b, float brightness, uint8_t intensity, uint16_t pixels, bool reverse) {
+  uint32_t h = 2166136261u;
+  auto mix = [&h](uint32_t v) { h = (h ^ v) * 16777619u; };
+  mix(to_byte(a.r));
+  mix(to_byte(a.g));
+  mix(to_byte(a.b));
+  mix(to_byte(b.r));
+  mix(to_byte(b.g));
+  mix(to_byte(b.b));
+  mix(static_cast<uint32_t>(brightness * 65535.0f));
+  mix(intensity);
+  mix(pixels);
+  mix(reverse ? 1u : 0u);
+  return h;
+}
+
+// True when this frame directly follows the tracked one with the same look
+bool sparse_continues(WledEffectsRuntime::SparseTrack& track, uint32_t frame_idx, uint32_t look) {
+  const bool ok = track.valid && track.frame_idx + 1 == frame_idx && track.look == look;
+  track.valid = true;
+  track.frame_idx = frame_idx;
+  track.look = look;
+  return ok;
+}
+
+// Native-format pixels for effects that render straight into the segment's
+// own format. A color is split into RGB + white once (explicit W, otherwise
+// min extraction) and every pixel only scales it; RGB16 keeps the fraction
+// that to_byte() would drop.
+struct NativeColor {
+  float r;
+  float g;
+  float b;
+  float w;
+};
+
+NativeColor native_color(const Rgb& c, PixelFormat format) {
+  if (format != PixelFormat::Rgbw8888 || c.w > 0.0f) {
+    return {c.r, c.g, c.b, c.w};
+  }
+  const float w = std::min(c.r, std::min(c.g, c.b));
+  return {c.r - w, c.g - w, c.b - w, w};
+}
+
+uint16_t to_word(float v) {
+  return static_cast<uint16_t>(clamp01(v) * 65535.0f + 0.5f);
+}
+
+uint8_t* put_native(uint8_t* dst, const NativeColor& c, float scale, PixelFormat format) {
+  switch (format) {
+    case PixelFormat::Rgbw8888:
+      *dst++ = to_byte(c.r * scale);
+      *dst++ = to_byte(c.g * scale);
+      *dst++ = to_byte(c.b * scale);
+      *dst++ = to_byte(c.w * scale);
+      break;
+    case PixelFormat::Rgb16:
+      for (const float ch : {c.r, c.g, c.b}) {
+        const uint16_t v = to_word((ch + c.w) * scale);
+        *dst++ = static_cast<uint8_t>(v);
+        *dst++ = static_cast<uint8_t>(v >> 8);
+      }
+      break;
+    case PixelFormat::Rgb888:
+    default:
+      *dst++ = to_byte((c.r + c.w) * scale);
+      *dst++ = to_byte((c.g + c.w) * scale);
+      *dst++ = to_byte((c.b + c.w) * scale);
+      break;
+  }
+  return dst;
+}
+
 }  // namespace
 
 // Get next DDP sequence number (1-15, cycling)
@@ -534,8 +604,13 @@ uint8_t WledEffectsRuntime::next_seq() {
 esp_err_t WledEffectsRuntime::start(AppConfig* cfg, LedEngineRuntime* led_runtime) {
   // Initialize PPA (Pixel Processing Accelerator) for hardware-accelerated pixel operations
   // This is optional - if PPA is not available, effects will fall back to software rendering
-  if (ppa_accel::is_available() || ppa_accel::init_fill_client() == ESP_OK) {
+  ppa_accel::jobs_init(ppa_accel::JobBackend::Hardware);
+  if (ppa_accel::jobs_backend() == ppa_accel::JobBackend::Hardware) {
     ESP_LOGI(TAG, "PPA (Pixel Processing Accelerator) initialized for hardware acceleration");
+    // Pick the CPU/PPA crossover per operation for this board
+    if (!ppa_accel::calibration().calibrated) {
+      ppa_accel::calibrate();
+    }
   } else {
     ESP_LOGD(TAG, "PPA not available, using software rendering");
   }
@@ -570,6 +645,7 @@ void WledEffectsRuntime::stop() {
       disable_wled_ddp_mode(ip);
     }
     active_ddp_devices_.clear();
+    ddp_last_frame_.clear();
   }
   
   // Deinitialize PPA (optional cleanup)
@@ -589,6 +665,12 @@ void WledEffectsRuntime::update_config(const AppConfig& cfg) {
   std::lock_guard<std::mutex> lock(mutex_);
   effects_ = cfg.wled_effects;
   devices_ = cfg.wled_devices;
+  // Envelope slots were assigned to bindings, segments and virtual segments
+  // when the config was decoded
+  const auto& envelopes = cfg.led_engine.audio_envelopes;
+  led_audio_set_envelopes(envelopes.data(), envelopes.size());
+  // Bindings may now name other targets; the effects task drops the tracks
+  sparse_tracks_stale_ = true;
 }
 
 void WledEffectsRuntime::task_entry(void* arg) {
@@ -653,9 +735,19 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
                                                       uint32_t frame_idx,
                                                       uint8_t global_brightness,
                                                       uint16_t fps,
-                                                      const LedLayoutConfig& layout) {
+                                                      const LedLayoutConfig& layout,
+                                                      PixelFormat preferred,
+                                                      PixelFormat* produced,
+                                                      DirtyRegion* dirty) {
   const uint16_t pixels = led_count == 0 ? 60 : led_count;
   std::vector<uint8_t> frame(pixels * 3, 0);
+  if (produced != nullptr) {
+    *produced = PixelFormat::Rgb888;
+  }
+  if (dirty != nullptr) {
+    dirty->mark_all();
+    dirty->sequence = frame_idx;
+  }
   
   // Track render start time for audio sync compensation (PPA operations may add latency)
   const uint64_t render_start_us = esp_timer_get_time();
@@ -726,72 +818,29 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
   if (binding.effect.audio_link && (is_ledfx || effect_is_audio_reactive(binding.effect.effect))) {
     // Get audio metrics with timestamp for synchronization
     AudioMetrics metrics = led_audio_get_metrics();
-    float energy = metrics.energy;
-    const std::string channel = lower_copy(binding.audio_channel);
-    if (channel == "left") {
-      energy = metrics.energy_left > 0.0f ? metrics.energy_left : metrics.energy * 0.8f;
-    } else if (channel == "right") {
-      energy = metrics.energy_right > 0.0f ? metrics.energy_right : metrics.energy * 0.8f;
-    }
-    if (energy <= 0.0001f) {
-      const float time_approx = static_cast<float>(frame_idx) / 60.0f;  // Approximate time from frame_idx
-      energy = 0.35f + 0.35f * (sinf(time_approx * 0.15f) * 0.5f + 0.5f);
-    }
-    const float time_approx = static_cast<float>(frame_idx) / 60.0f;
-    const float beat = metrics.beat > 0.0f ? metrics.beat : (sinf(time_approx * 0.12f) * 0.5f + 0.5f);
-    
+    const AudioSelection& audio = binding.effect.audio;
+    const float time_approx = static_cast<float>(frame_idx) / 60.0f;  // Approximate time from frame_idx
+    const bool live = metrics.energy > 0.0001f;
+    if (!live) {
+      // No audio: a slow synthetic level keeps reactive effects moving
+      metrics.energy = 0.35f + 0.35f * (sinf(time_approx * 0.15f) * 0.5f + 0.5f);
+      metrics.energy_left = metrics.energy;
+      metrics.energy_right = metrics.energy;
+    }
+    if (metrics.beat <= 0.0f) {
+      metrics.beat = sinf(time_approx * 0.12f) * 0.5f + 0.5f;
+    }
+    const float beat = metrics.beat;
+
+    // The analyzer follows this input with the attack/release envelope at
+    // analysis rate; without one (or without audio) read it directly
     float weighted = 0.0f;
-    // Check if selected bands are configured
-    if (!binding.effect.selected_bands.empty()) {
-      // Use selected bands - average all selected band values
-      float sum = 0.0f;
-      size_t count = 0;
-      for (const auto& band_name : binding.effect.selected_bands) {
-        float band_val = led_audio_get_band_value(band_name);
-        if (band_val > 0.0f) {
-          sum += band_val;
-          ++count;
-        }
-      }
-      weighted = count > 0 ? sum / static_cast<float>(count) : energy * 0.7f;
-    } else if (binding.effect.freq_min > 0.0f && binding.effect.freq_max > 0.0f) {
-      // Use custom frequency range
-      weighted = led_audio_get_custom_energy(binding.effect.freq_min, binding.effect.freq_max);
-      if (weighted <= 0.0001f) {
-        weighted = energy * 0.7f;  // Fallback to overall energy
-      }
+    if (live && audio.envelope < metrics.envelope_count) {
+      weighted = metrics.envelopes[audio.envelope];
     } else {
-      // Use default frequency bands (bass, mid, treble) based on reactive_mode
-      float bass = metrics.bass > 0.0f ? metrics.bass : energy * 0.8f;
-      float treble = metrics.treble > 0.0f ? metrics.treble : energy * 0.6f;
-      float mid = metrics.mid > 0.0f ? metrics.mid : energy * 0.7f;
-
-      // Apply band gains
-      bass *= binding.effect.band_gain_low;
-      mid *= binding.effect.band_gain_mid;
-      treble *= binding.effect.band_gain_high;
-
-      const std::string reactive = lower_copy(binding.effect.reactive_mode);
-      if (reactive == "kick") {
-        // Kick: focus on very low frequencies (sub-bass) and beat detection
-        // Use bass with emphasis on beat detection for kick drum response
-        weighted = (bass * 1.2f * 0.7f + beat * 0.3f);  // Emphasize bass and beat
-      } else if (reactive == "bass") {
-        weighted = bass;
-      } else if (reactive == "mids") {
-        weighted = mid;
-      } else if (reactive == "treble") {
-        weighted = treble;
-      } else {
-        // Full spectrum (default)
-        weighted = (energy * 0.4f + mid * 0.25f + bass * 0.2f + treble * 0.15f);
-      }
+      weighted = led_audio_selection_level(metrics, audio);
     }
-    weighted *= (0.6f + beat * 0.4f);
-    const float profile_gain = binding.effect.audio_profile == "ledfx_energy" ? 1.1f
-                             : binding.effect.audio_profile == "ledfx_tempo" ? 1.05f
-                             : 1.0f;
-    audio_mod = clamp01(0.4f + weighted * 0.8f * profile_gain);
+    audio_mod = clamp01(0.4f + weighted * 0.8f * audio.profile_gain);
     audio_mod *= binding.effect.amplitude_scale > 0.0f ? binding.effect.amplitude_scale : 1.0f;
     if (binding.effect.brightness_compress > 0.0f) {
       const float gamma = 1.0f + binding.effect.brightness_compress;
@@ -802,12 +851,6 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
     }
   }
 
-  // Attack/release envelope to smooth out audio reactivity (for LEDFx and WLED audio-reactive effects)
-  if (binding.effect.audio_link && (is_ledfx || effect_is_audio_reactive(binding.effect.effect)) && 
-      (binding.effect.attack_ms > 0 || binding.effect.release_ms > 0) && fps > 0) {
-    audio_mod = apply_envelope(envelope_key(binding), audio_mod, fps, binding.effect.attack_ms, binding.effect.release_ms);
-  }
-
   // Check if this is a LEDFx effect
   if (is_ledfx) {
     // Convert gradient to LEDFx format
@@ -867,6 +910,29 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
     }
   };
 
+  // Dirty-span hint for sparse effects; null when the frame has to be diffed
+  auto sparse_hint = [&](SparseEffect effect) -> std::pair<SparseTrack*, DirtyRegion*> {
+    SparseTrack& track = sparse_tracks_[binding.device_id][static_cast<size_t>(effect)];
+    const uint32_t look = effect_look(c1, c2, brightness, intensity_val, pixels, reverse);
+    if (dirty == nullptr || !sparse_continues(track, frame_idx, look)) {
+      return {&track, nullptr};
+    }
+    dirty->clear();
+    return {&track, dirty};
+  };
+
+  // Solid, Breathe, Twinkle and Gradient can render in the segment's own
+  // format (native white, 16-bit); everything else stays RGB888 and the output
+  // conversion handles it
+  const bool native = preferred != PixelFormat::Rgb888;
+  auto begin_native = [&]() -> uint8_t* {
+    frame.assign(static_cast<size_t>(pixels) * pixel_format_bytes(preferred), 0);
+    if (produced != nullptr) {
+      *produced = preferred;
+    }
+    return frame.data();
+  };
+
   // ==================== WLED EFFECTS (frame_idx based) ====================
   
   // Rainbow - WLED style: counter-based hue rotation
@@ -885,43 +951,44 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
 
   // Solid - static color
   if (effect_name.find("solid") != std::string::npos) {
-    // Use PPA for large segments/matrices (optimized threshold)
-    // Note: PPA uses blocking mode, but operations are fast enough (<1ms for typical sizes)
-    // to not cause audio sync issues. For very large segments, consider timeout.
-    if (should_use_ppa_fill(pixels, is_matrix, matrix_width, matrix_height)) {
+    if (native) {
+      uint8_t* out = begin_native();
+      const NativeColor nc = native_color(c1, preferred);
+      const size_t bpp = pixel_format_bytes(preferred);
+      put_native(out, nc, brightness, preferred);
+      for (uint16_t i = 1; i < pixels; ++i) {
+        std::memcpy(out + i * bpp, out, bpp);
+      }
+      return frame;
+    }
+    // Use PPA for large segments/matrices (optimized threshold). Only when the
+    // frame itself is a valid PPA output: a copy would cost as much as the fill
+    if (should_use_ppa_fill(pixels, is_matrix, matrix_width, matrix_height, frame.data(), frame.size())) {
       const uint8_t r = to_byte(c1.r * brightness);
       const uint8_t g = to_byte(c1.g * brightness);
       const uint8_t b = to_byte(c1.b * brightness);
       // PPA works on 2D buffers - use actual matrix dimensions if available
-      // PPA fill is typically <1ms even for 1000+ LEDs, so blocking is acceptable
-      esp_err_t err = ppa_accel::fill_rgb(frame.data(), matrix_width, matrix_height, r, g, b);
+      esp_err_t err = ppa_accel::fill_rgb(frame.data(), matrix_width, matrix_height, r, g, b, frame.size());
       if (err == ESP_OK) {
         return frame;  // PPA fill succeeded
       }
       // Fall through to software fill if PPA fails (should be rare)
     }
     // Software fallback (for small segments or if PPA unavailable)
-    for (uint16_t i = 0; i < pixels; ++i) {
-      *dst++ = to_byte(c1.r * brightness);
-      *dst++ = to_byte(c1.g * brightness);
-      *dst++ = to_byte(c1.b * brightness);
-    }
+    pixel_ops::fill_rgb(frame.data(), pixels, to_byte(c1.r * brightness), to_byte(c1.g * brightness),
+                        to_byte(c1.b * brightness));
     return frame;
   }
 
   // Blink - WLED style: on/off based on counter
   if (effect_name.find("blink") != std::string::npos) {
     const bool on = ((counter >> 8) & 1) == 0;
-    for (uint16_t i = 0; i < pixels; ++i) {
-      if (on) {
-        *dst++ = to_byte(c1.r * brightness);
-        *dst++ = to_byte(c1.g * brightness);
-        *dst++ = to_byte(c1.b * brightness);
-      } else {
-        *dst++ = to_byte(c2.r * brightness * 0.1f);
-        *dst++ = to_byte(c2.g * brightness * 0.1f);
-        *dst++ = to_byte(c2.b * brightness * 0.1f);
-      }
+    if (on) {
+      pixel_ops::fill_rgb(frame.data(), pixels, to_byte(c1.r * brightness), to_byte(c1.g * brightness),
+                          to_byte(c1.b * brightness));
+    } else {
+      pixel_ops::fill_rgb(frame.data(), pixels, to_byte(c2.r * brightness * 0.1f),
+                          to_byte(c2.g * brightness * 0.1f), to_byte(c2.b * brightness * 0.1f));
     }
     return frame;
   }
@@ -932,6 +999,16 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
     const float phase = static_cast<float>(counter & 0xFFFF) / 65536.0f * 6.2831f;
     const float breath = (sinf(phase) + 1.0f) * 0.5f;
     const float level = breath * breath;  // Gamma for natural look
+    if (native) {
+      uint8_t* out = begin_native();
+      const NativeColor nc = native_color(c1, preferred);
+      const size_t bpp = pixel_format_bytes(preferred);
+      put_native(out, nc, brightness * level, preferred);
+      for (uint16_t i = 1; i < pixels; ++i) {
+        std::memcpy(out + i * bpp, out, bpp);
+      }
+      return frame;
+    }
     for (uint16_t i = 0; i < pixels; ++i) {
       *dst++ = to_byte(c1.r * brightness * level);
       *dst++ = to_byte(c1.g * brightness * level);
@@ -946,69 +1023,94 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
     const uint16_t pos_in_cycle = (counter / 2) % cycle_frames;
     const uint16_t fill_led = pos_in_cycle < pixels ? pos_in_cycle : (cycle_frames - pos_in_cycle - 1);
     
-    // For large segments, use PPA: fill background first, then blend foreground
-    if (should_use_ppa_fill(pixels, is_matrix, matrix_width, matrix_height)) {
-      const uint8_t bg_r = to_byte(c2.r * brightness * 0.05f);
-      const uint8_t bg_g = to_byte(c2.g * brightness * 0.05f);
-      const uint8_t bg_b = to_byte(c2.b * brightness * 0.05f);
-      
-      // Fill entire buffer with background color using PPA
-      esp_err_t err = ppa_accel::fill_rgb(frame.data(), matrix_width, matrix_height, bg_r, bg_g, bg_b);
-      if (err == ESP_OK) {
-        // Now blend foreground color for filled portion
-        // Calculate fill region based on matrix or strip layout
-        if (is_matrix) {
-          // For matrices, calculate fill region in 2D
-          const uint16_t fill_row = fill_led / matrix_width;
-          const uint16_t fill_col = fill_led % matrix_width;
-          // Create temporary buffer for foreground
-          std::vector<uint8_t> fg_buffer(pixels * 3, 0);
-          const uint8_t fg_r = to_byte(c1.r * brightness);
-          const uint8_t fg_g = to_byte(c1.g * brightness);
-          const uint8_t fg_b = to_byte(c1.b * brightness);
-          
-          // Fill foreground region
-          for (uint16_t row = 0; row <= fill_row && row < matrix_height; ++row) {
-            const uint16_t max_col = (row == fill_row) ? fill_col : matrix_width;
-            for (uint16_t col = 0; col < max_col; ++col) {
-              const uint16_t idx = row * matrix_width + col;
-              fg_buffer[idx * 3 + 0] = fg_r;
-              fg_buffer[idx * 3 + 1] = fg_g;
-              fg_buffer[idx * 3 + 2] = fg_b;
+    // For large segments, use PPA: fill background first, then blend foreground.
+    // The PPA only writes whole cache lines, so it renders into a pool buffer
+    // that is copied into the frame once the jobs are done
+    if (ppa_accel::is_available()) {
+      framebuffer::Framebuffer canvas(matrix_width, matrix_height);
+      const size_t frame_bytes = std::min<size_t>(frame.size(), canvas.size_bytes);
+      if (should_use_ppa_fill(pixels, is_matrix, matrix_width, matrix_height, canvas.data(), canvas.capacity())) {
+        const uint8_t bg_r = to_byte(c2.r * brightness * 0.05f);
+        const uint8_t bg_g = to_byte(c2.g * brightness * 0.05f);
+        const uint8_t bg_b = to_byte(c2.b * brightness * 0.05f);
+        
+        // Queue the background fill; the foreground is built while the PPA runs
+        const ppa_accel::JobId fill_job =
+            ppa_accel::submit_fill(canvas.data(), matrix_width, matrix_height, bg_r, bg_g, bg_b,
+                                   nullptr, nullptr, canvas.capacity());
+        if (fill_job != ppa_accel::kInvalidJob) {
+          // Now blend foreground color for filled portion
+          // Calculate fill region based on matrix or strip layout
+          bool ppa_ok = false;
+          if (is_matrix) {
+            // For matrices, calculate fill region in 2D
+            const uint16_t fill_row = fill_led / matrix_width;
+            const uint16_t fill_col = fill_led % matrix_width;
+            // Create temporary buffer for foreground
+            std::vector<uint8_t> fg_buffer(pixels * 3, 0);
+            const uint8_t fg_r = to_byte(c1.r * brightness);
+            const uint8_t fg_g = to_byte(c1.g * brightness);
+            const uint8_t fg_b = to_byte(c1.b * brightness);
+            
+            // Fill foreground region
+            for (uint16_t row = 0; row <= fill_row && row < matrix_height; ++row) {
+              const uint16_t max_col = (row == fill_row) ? fill_col : matrix_width;
+              for (uint16_t col = 0; col < max_col; ++col) {
+                const uint16_t idx = row * matrix_width + col;
+                fg_buffer[idx * 3 + 0] = fg_r;
+                fg_buffer[idx * 3 + 1] = fg_g;
+                fg_buffer[idx * 3 + 2] = fg_b;
+              }
             }
-          }
-          
-          // Blend foreground over background using PPA
-          if (should_use_ppa_blend(pixels, is_matrix, matrix_width, matrix_height)) {
-            ppa_accel::blend_rgb(fg_buffer.data(), frame.data(), frame.data(), 
-                                 matrix_width, matrix_height, 1.0f);
-          } else {
-            // Software blend for smaller regions
-            for (uint16_t i = 0; i < pixels; ++i) {
-              if (fg_buffer[i * 3] > 0 || fg_buffer[i * 3 + 1] > 0 || fg_buffer[i * 3 + 2] > 0) {
-                frame[i * 3 + 0] = fg_buffer[i * 3 + 0];
-                frame[i * 3 + 1] = fg_buffer[i * 3 + 1];
-                frame[i * 3 + 2] = fg_buffer[i * 3 + 2];
+            
+            // Blend foreground over background using PPA, chained behind the fill
+            const ppa_accel::JobId blend_job =
+                should_use_ppa_blend(pixels, is_matrix, matrix_width, matrix_height, canvas.data(), canvas.capacity())
+                    ? ppa_accel::submit_blend(fg_buffer.data(), canvas.data(), canvas.data(),
+                                              matrix_width, matrix_height, 255,
+                                              nullptr, nullptr, canvas.capacity())
+                    : ppa_accel::kInvalidJob;
+            // fg_buffer and canvas stay in use until the PPA is done with them
+            if (blend_job != ppa_accel::kInvalidJob) {
+              // The blend reads the filled background, so both jobs have to succeed
+              ppa_ok = ppa_accel::settle_job(blend_job, 20) == ESP_OK && ppa_accel::settle_job(fill_job, 20) == ESP_OK;
+              if (ppa_ok) {
+                std::memcpy(frame.data(), canvas.data(), frame_bytes);
+              }
+            } else if (ppa_accel::settle_job(fill_job, 20) == ESP_OK) {
+              // Software blend for smaller regions
+              std::memcpy(frame.data(), canvas.data(), frame_bytes);
+              for (uint16_t i = 0; i < pixels; ++i) {
+                if (fg_buffer[i * 3] > 0 || fg_buffer[i * 3 + 1] > 0 || fg_buffer[i * 3 + 2] > 0) {
+                  frame[i * 3 + 0] = fg_buffer[i * 3 + 0];
+                  frame[i * 3 + 1] = fg_buffer[i * 3 + 1];
+                  frame[i * 3 + 2] = fg_buffer[i * 3 + 2];
+                }
               }
+              ppa_ok = true;
             }
-          }
-        } else {
-          // For strips, simpler approach: fill foreground region directly
-          const uint8_t fg_r = to_byte(c1.r * brightness);
-          const uint8_t fg_g = to_byte(c1.g * brightness);
-          const uint8_t fg_b = to_byte(c1.b * brightness);
-          for (uint16_t i = 0; i <= fill_led && i < pixels; ++i) {
-            const uint16_t idx = reverse ? (pixels - 1 - i) : i;
-            if (idx <= fill_led) {
-              frame[idx * 3 + 0] = fg_r;
-              frame[idx * 3 + 1] = fg_g;
-              frame[idx * 3 + 2] = fg_b;
+          } else if (ppa_accel::settle_job(fill_job, 20) == ESP_OK) {
+            // For strips, simpler approach: fill foreground region directly
+            std::memcpy(frame.data(), canvas.data(), frame_bytes);
+            const uint8_t fg_r = to_byte(c1.r * brightness);
+            const uint8_t fg_g = to_byte(c1.g * brightness);
+            const uint8_t fg_b = to_byte(c1.b * brightness);
+            for (uint16_t i = 0; i <= fill_led && i < pixels; ++i) {
+              const uint16_t idx = reverse ? (pixels - 1 - i) : i;
+              if (idx <= fill_led) {
+                frame[idx * 3 + 0] = fg_r;
+                frame[idx * 3 + 1] = fg_g;
+                frame[idx * 3 + 2] = fg_b;
+              }
             }
+            ppa_ok = true;
+          }
+          if (ppa_ok) {
+            return frame;
           }
         }
-        return frame;
+        // Fall through to software if a PPA job fails
       }
-      // Fall through to software if PPA fill fails
     }
     
     // Software fallback (for small segments or if PPA unavailable)
@@ -1079,7 +1181,8 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
 
     // Step 4: Convert heat to LED colors
     // For large segments, use PPA fill for background, then blend fire colors
-    if (should_use_ppa_fill(pixels, is_matrix, matrix_width, matrix_height) && heat_fb) {
+    if (heat_fb && should_use_ppa_fill(pixels, is_matrix, matrix_width, matrix_height, heat_fb->data(),
+                                       heat_fb->capacity())) {
       // Clear framebuffer with black background
       heat_fb->clear();
       
@@ -1147,12 +1250,16 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
     const uint8_t meteor_size = 1 + (intensity_val >> 5);
     const uint8_t decay = 128 + (intensity_val >> 1);
     const int meteor_pos = (counter >> 3) % (pixels + meteor_size * 2);
+    DirtyRegion* hint = sparse_hint(SparseEffect::Meteor).second;
     
     // Decay trail randomly
     for (uint16_t i = 0; i < pixels; ++i) {
-      if ((esp_random() & 0x0F) > 5) {
+      if (trail[i] != 0 && (esp_random() & 0x0F) > 5) {
         const uint8_t fade = 255 - decay;
         trail[i] = (trail[i] > fade) ? trail[i] - fade : 0;
+        if (hint != nullptr) {
+          hint->add(i, 1);
+        }
       }
     }
     
@@ -1161,6 +1268,9 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
       int idx = reverse ? (pixels - 1 - meteor_pos + j) : (meteor_pos - j);
       if (idx >= 0 && idx < static_cast<int>(pixels)) {
         trail[idx] = 255;
+        if (hint != nullptr) {
+          hint->add(idx, 1);
+        }
       }
     }
     
@@ -1180,6 +1290,18 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
     const uint16_t pos_in_cycle = (counter >> 2) % cycle_len;
     const uint16_t scan_led = pos_in_cycle < pixels ? pos_in_cycle : (cycle_len - pos_in_cycle - 1);
     const uint8_t width = 1 + (intensity_val >> 5);
+    const auto [track, hint] = sparse_hint(SparseEffect::Scanner);
+    if (hint != nullptr) {
+      // Old and new window: pixels closer than `width` to the scan position are lit
+      for (const int center : {static_cast<int>(track->last), static_cast<int>(scan_led)}) {
+        const int from = std::max(0, center - width + 1);
+        const int to = std::min(static_cast<int>(pixels), center + width);
+        if (from < to) {
+          hint->add(from, to - from);
+        }
+      }
+    }
+    track->last = scan_led;
     
     for (uint16_t i = 0; i < pixels; ++i) {
       const int dist = std::abs(static_cast<int>(i) - static_cast<int>(scan_led));
@@ -1231,6 +1353,14 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
       }
     }
     
+    if (native) {
+      uint8_t* out = begin_native();
+      const NativeColor nc = native_color(c1, preferred);
+      for (uint16_t i = 0; i < pixels; ++i) {
+        out = put_native(out, nc, brightness * (twinkle_state[i] / 255.0f), preferred);
+      }
+      return frame;
+    }
     for (uint16_t i = 0; i < pixels; ++i) {
       const float level = twinkle_state[i] / 255.0f;
       *dst++ = to_byte(c1.r * brightness * level);
@@ -1250,6 +1380,15 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
     }
     // One random sparkle
     const uint16_t sparkle_idx = esp_random() % pixels;
+    const auto [track, hint] = sparse_hint(SparseEffect::Sparkle);
+    if (hint != nullptr) {
+      // Background is unchanged: the old sparkle goes out, the new one lights up
+      if (track->last >= 0 && track->last < pixels) {
+        hint->add(track->last, 1);
+      }
+      hint->add(sparkle_idx, 1);
+    }
+    track->last = sparkle_idx;
     uint8_t* p = frame.data() + sparkle_idx * 3;
     p[0] = to_byte(c1.r * brightness);
     p[1] = to_byte(c1.g * brightness);
@@ -1279,6 +1418,19 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
   // Gradient - smooth scrolling gradient
   if (effect_name.find("gradient") != std::string::npos) {
     const uint8_t offset = static_cast<uint8_t>((counter >> 3) & 0xFF);
+    if (native) {
+      uint8_t* out = begin_native();
+      for (uint16_t i = 0; i < pixels; ++i) {
+        const uint8_t pos = offset + static_cast<uint8_t>((i * 256) / pixels);
+        const float t = (reverse ? (255 - pos) : pos) / 255.0f;
+        const Rgb col = gradient.empty() ?
+          Rgb{c1.r * (1.0f - t) + c2.r * t, c1.g * (1.0f - t) + c2.g * t, c1.b * (1.0f - t) + c2.b * t,
+              c1.w * (1.0f - t) + c2.w * t} :
+          sample_gradient(gradient, t);
+        out = put_native(out, native_color(col, preferred), brightness, preferred);
+      }
+      return frame;
+    }
     for (uint16_t i = 0; i < pixels; ++i) {
       const uint8_t pos = offset + static_cast<uint8_t>((i * 256) / pixels);
       const uint8_t final_pos = reverse ? (255 - pos) : pos;
@@ -1319,16 +1471,25 @@ std::vector<uint8_t> WledEffectsRuntime::render_frame(const WledEffectBinding& b
     
     const uint8_t tail_len = 5 + (intensity_val >> 4);
     const int head_pos = (counter >> 3) % (pixels + tail_len);
+    DirtyRegion* hint = sparse_hint(SparseEffect::Comet).second;
     
     // Fade trail
     for (uint16_t i = 0; i < pixels; ++i) {
-      comet_trail[i] = (comet_trail[i] > 20) ? comet_trail[i] - 20 : 0;
+      if (comet_trail[i] != 0) {
+        comet_trail[i] = (comet_trail[i] > 20) ? comet_trail[i] - 20 : 0;
+        if (hint != nullptr) {
+          hint->add(i, 1);
+        }
+      }
     }
     
     // Draw head
     const int idx = reverse ? (pixels - 1 - head_pos) : head_pos;
     if (idx >= 0 && idx < static_cast<int>(pixels)) {
       comet_trail[idx] = 255;
+      if (hint != nullptr) {
+        hint->add(idx, 1);
+      }
     }
     
     for (uint16_t i = 0; i < pixels; ++i) {
@@ -1662,12 +1823,12 @@ bool WledEffectsRuntime::render_and_send(const WledEffectBinding& binding,
   // Frame cache: reuse frame if same effect + same LED count + same frame_idx (for caching only)
   // Note: frame_idx is used for cache key but animation uses time_s for consistent speed
   const uint16_t leds = device.leds == 0 ? 60 : device.leds;
-  FrameCacheKey cache_key{binding.effect.effect, leds, frame_idx};
+  FrameCacheKey cache_key{binding.effect.effect, leds, frame_idx, PixelFormat::Rgb888};
   std::vector<uint8_t> frame;
   
   auto cache_it = frame_cache_.find(cache_key);
   if (cache_it != frame_cache_.end()) {
-    frame = cache_it->second;  // Reuse cached frame
+    frame.assign(cache_it->second.pixels.begin(), cache_it->second.pixels.end());  // Reuse cached frame
   } else {
     // Render new frame and cache it (using frame_idx for animation like WLED)
     frame = render_frame(binding, leds, frame_idx, global_brightness, fps, device.layout);
@@ -1690,7 +1851,7 @@ bool WledEffectsRuntime::render_and_send(const WledEffectBinding& binding,
     
     // Only cache if cache is not too large (limit to 10 entries to avoid memory issues)
     if (frame_cache_.size() < 10) {
-      frame_cache_[cache_key] = frame;
+      frame_cache_[cache_key].pixels.assign(frame.begin(), frame.end());
     }
   }
   
@@ -1720,8 +1881,33 @@ bool WledEffectsRuntime::render_and_send(const WledEffectBinding& binding,
   bool ok = false;
   if (use_cache) {
     // Use cached address (much faster - no DNS resolution)
-    // Use complete frame function to handle packet splitting automatically
-    ok = ddp_send_complete_frame_cached(&addr_it->second.addr, addr_it->second.addr_len, port, frame, channel, next_seq());
+    // Only the changed ranges go out, at their DDP offsets. A complete frame
+    // follows every second so lost datagrams and receiver timeouts heal.
+    DdpTargetFrame& last = ddp_last_frame_[ip];
+    DirtyRegion changed;
+    const uint32_t keyframe_interval = fps > 0 ? fps : 30;
+    if (last.pixels.size() != frame.size() || ++last.since_full >= keyframe_interval) {
+      changed.mark_all();
+    } else {
+      diff_pixels(last.pixels.data(), frame.data(), frame.size() / 3, 3, 0, changed);
+      if (changed.pixel_count(leds) * 2 > leds) {
+        changed.mark_all();  // mostly changed: one contiguous send is cheaper
+      }
+    }
+    if (changed.empty()) {
+      ok = true;
+    } else {
+      ok = ddp_send_spans_cached(&addr_it->second.addr, addr_it->second.addr_len, port, frame, changed, channel,
+                                 next_seq());
+    }
+    if (ok) {
+      if (changed.all()) {
+        last.since_full = 0;
+      }
+      last.pixels.assign(frame.begin(), frame.end());
+    } else {
+      ddp_last_frame_.erase(ip);
+    }
   } else {
     // First time or cache expired - resolve and cache
     // Use complete frame function to handle packet splitting automatically
@@ -1748,6 +1934,7 @@ bool WledEffectsRuntime::render_and_send(const WledEffectBinding& binding,
              binding.enabled ? 1 : 0, binding.ddp ? 1 : 0, device.active ? 1 : 0, static_cast<unsigned>(leds));
     // Invalidate cache on failure
     ddp_addr_cache_.erase(ip);
+    ddp_last_frame_.erase(ip);
   } else if (frame_idx % 60 == 0) {  // Log success every 1 second for debugging
     // Check if frame has any non-zero data
     bool has_data = false;
@@ -1794,6 +1981,10 @@ void WledEffectsRuntime::task_loop() {
       if (led_runtime_) {
         global_brightness = led_runtime_->brightness();
       }
+      if (sparse_tracks_stale_) {
+        sparse_tracks_.clear();
+        sparse_tracks_stale_ = false;
+      }
     }
 
     const uint16_t fps = fx.target_fps == 0 ? 60 : std::clamp<uint16_t>(fx.target_fps, 1, 240);
@@ -1887,6 +2078,7 @@ void WledEffectsRuntime::task_loop() {
           disable_wled_ddp_mode(ip);
         }
         active_ddp_devices_.clear();
+        ddp_last_frame_.clear();
       }
     }
     had_enabled_bindings = has_enabled_bindings;
@@ -1993,6 +2185,7 @@ void WledEffectsRuntime::task_loop() {
         if (current_active_ips.find(*it) == current_active_ips.end()) {
           ESP_LOGI(TAG, "Device %s no longer in active bindings - disabling DDP mode", it->c_str());
           disable_wled_ddp_mode(*it);
+          ddp_last_frame_.erase(*it);
           it = active_ddp_devices_.erase(it);
         } else {
           ++it;
@@ -2000,6 +2193,17 @@ void WledEffectsRuntime::task_loop() {
       }
     }
 
+    // Segments above their effective fps (or still waiting on a busy wire) are
+    // not rendered this tick; asked once per segment since an answer claims the frame
+    std::vector<int8_t> segment_due(segments.size(), -1);
+    auto frame_due = [&](const LedSegmentConfig& seg) {
+      int8_t& due = segment_due[static_cast<size_t>(&seg - segments.data())];
+      if (due < 0) {
+        due = led_runtime_->segment_frame_due(seg.id) ? 1 : 0;
+      }
+      return due == 1;
+    };
+
     // Render effects for local physical segments
     // Physical LEDs can use WLED effects (for visual consistency with WLED devices) or LEDFx effects (audio-reactive)
     // When audio is enabled (audio_link=true), effects react to music from Snapcast
@@ -2019,17 +2223,31 @@ void WledEffectsRuntime::task_loop() {
         if (it == assignments.end()) {
           continue;
         }
-        // Create cache key for grouping (effect + LED count + audio state)
-        std::string effect_key = it->effect + "_" + std::to_string(seg.led_count) + "_" + 
-                                 (it->audio_link ? "audio" : "noaudio");
+        // Create cache key for grouping (effect + LED count + audio state + pixel format)
+        std::string effect_key = it->effect + "_" + std::to_string(segment_logical_count(seg)) + "_" + 
+                                 (it->audio_link ? "audio" : "noaudio") + "_" +
+                                 std::to_string(static_cast<int>(segment_pixel_format(seg)));
+        if (segment_uses_matrix_transform(seg)) {
+          // Same pixel count, different canvas shape renders differently
+          uint16_t canvas_w = 0;
+          uint16_t canvas_h = 0;
+          matrix_canvas_size(seg.matrix, &canvas_w, &canvas_h);
+          effect_key += "_" + std::to_string(canvas_w) + "x" + std::to_string(canvas_h);
+        }
         segments_by_effect[effect_key].push_back(&seg);
       }
       
       // Render each group (reuse frame for segments with same effect)
       for (const auto& [effect_key, seg_group] : segments_by_effect) {
-        if (seg_group.empty()) continue;
+        std::vector<const LedSegmentConfig*> due_group;
+        for (const auto* seg_ptr : seg_group) {
+          if (frame_due(*seg_ptr)) {
+            due_group.push_back(seg_ptr);
+          }
+        }
+        if (due_group.empty()) continue;
         
-        const auto& first_seg = *seg_group[0];
+        const auto& first_seg = *due_group[0];
         auto it = std::find_if(assignments.begin(), assignments.end(),
                                [&](const EffectAssignment& a) { return a.segment_id == first_seg.id; });
         if (it == assignments.end()) continue;
@@ -2044,24 +2262,41 @@ void WledEffectsRuntime::task_loop() {
         local_binding.effect = *it;
         
         // Render frame once (reuse for all segments in group if same LED count)
-        const uint16_t common_led_count = first_seg.led_count;
-        FrameCacheKey cache_key{it->effect, common_led_count, frame_idx};
+        const uint16_t common_led_count = segment_logical_count(first_seg);
+        const PixelFormat seg_format = segment_pixel_format(first_seg);
+        FrameCacheKey cache_key{it->effect, common_led_count, frame_idx, seg_format};
         std::vector<uint8_t> frame;
+        PixelFormat frame_format = PixelFormat::Rgb888;
+        DirtyRegion dirty;
+        const DirtyRegion* hint = nullptr;  // only fresh renders know what they touched
         
         auto cache_it = frame_cache_.find(cache_key);
         if (cache_it != frame_cache_.end()) {
-          frame = cache_it->second;
+          frame.assign(cache_it->second.pixels.begin(), cache_it->second.pixels.end());
+          frame_format = cache_it->second.format;
         } else {
-          frame = render_frame(local_binding, common_led_count, frame_idx, global_brightness, fps);
+          // Transformed matrices render a row-major 2D canvas
+          LedLayoutConfig canvas_layout{};
+          if (segment_uses_matrix_transform(first_seg)) {
+            canvas_layout.type = LedLayoutType::Matrix;
+            matrix_canvas_size(first_seg.matrix, &canvas_layout.width, &canvas_layout.height);
+          }
+          // Full level: the LED engine applies global and segment brightness at the output
+          frame = render_frame(local_binding, common_led_count, frame_idx, 255, fps, canvas_layout, seg_format,
+                               &frame_format, &dirty);
+          hint = &dirty;
           if (frame_cache_.size() < 10) {
-            frame_cache_[cache_key] = frame;
+            CachedFrame& cached = frame_cache_[cache_key];
+            cached.format = frame_format;
+            cached.pixels.assign(frame.begin(), frame.end());
           }
         }
         
         // Render to all segments in group
-        for (const auto* seg_ptr : seg_group) {
+        for (const auto* seg_ptr : due_group) {
           if (!frame.empty()) {
-            const esp_err_t res = led_runtime_->render_frame(frame, *seg_ptr, 0, seg_ptr->led_count);
+            const esp_err_t res =
+                led_runtime_->render_frame(frame, *seg_ptr, 0, common_led_count, frame_format, hint);
             if (res != ESP_OK) {
               ESP_LOGD(TAG, "Local render error %s for segment %s", esp_err_to_name(res), seg_ptr->id.c_str());
             }
@@ -2090,103 +2325,100 @@ void WledEffectsRuntime::task_loop() {
       if (vseg.id.empty() || vseg.enabled == false) {
         continue;
       }
-      // Sum total length; for WLED member with length 0, default to device LEDs
+      // Lay the members out over one composed frame; each member then reads its
+      // part through a view (offset, length, stride, reverse) instead of a copy
+      struct MemberView {
+        const VirtualSegmentMember* member;
+        const LedSegmentConfig* seg;  // physical members
+        uint16_t start;               // first pixel on the physical segment
+        PixelView view;
+      };
+      std::vector<MemberView> member_views;
+      member_views.reserve(vseg.members.size());
+      size_t cursor = 0;
       size_t total_leds = 0;
+      bool any_due = false;
       for (const auto& m : vseg.members) {
+        const LedSegmentConfig* seg = nullptr;
+        uint16_t start = 0;
+        uint16_t length = m.length;
         if (m.type == "physical") {
-          const auto* seg = find_segment(m);
-          if (!seg) {
+          seg = find_segment(m);
+          if (!seg || !led_runtime_) {
+            ESP_LOGW(TAG,
+                     "Virtual segment %s physical member %s skipped (runtime=%d, seg_found=%d)",
+                     vseg.id.c_str(),
+                     m.id.c_str(),
+                     led_runtime_ != nullptr ? 1 : 0,
+                     seg ? 1 : 0);
             continue;
           }
-          const uint16_t available = seg->led_count;
-          const uint16_t start = std::min<uint16_t>(m.start, available);
-          const uint16_t len = m.length > 0 ? std::min<uint16_t>(m.length, static_cast<uint16_t>(available - start))
-                                            : static_cast<uint16_t>(available - start);
-          total_leds += len;
+          const uint16_t available = segment_logical_count(*seg);
+          start = std::min<uint16_t>(m.start, available);
+          const uint16_t fallback_len = static_cast<uint16_t>(available - start);
+          length = length > 0 ? std::min<uint16_t>(length, fallback_len) : fallback_len;
+          if (!frame_due(*seg)) {
+            seg = nullptr;  // still lays out its span, nothing is sent
+          }
         } else if (m.type == "wled") {
-          const auto dev_it = std::find_if(devices_snapshot.begin(), devices_snapshot.end(), [&](const WledDeviceConfig& d) { return d.id == m.id; });
-          total_leds += (dev_it != devices_snapshot.end() && dev_it->leds > 0) ? dev_it->leds : 0;
-        }
-      }
-      if (total_leds == 0) {
-        continue;
-        }
-        WledEffectBinding fake{};
-        fake.device_id = vseg.id;
-        fake.effect = vseg.effect;
-        fake.audio_channel = "mix";
-        const auto frame = render_frame(fake, static_cast<uint16_t>(total_leds), frame_idx, global_brightness, fps);
-        size_t cursor = 0;
-        for (const auto& m : vseg.members) {
-          uint16_t length = m.length;
-          uint16_t start = m.start;
-          if (m.type == "wled") {
-            if (length == 0) {
-              const auto dev_it = std::find_if(devices_snapshot.begin(), devices_snapshot.end(), [&](const WledDeviceConfig& d) { return d.id == m.id; });
-              if (dev_it != devices_snapshot.end() && dev_it->leds > 0) {
-                length = dev_it->leds;
-              }
-            }
-          } else if (m.type == "physical") {
-            const auto* seg = find_segment(m);
-            if (seg) {
-              const uint16_t available = seg->led_count;
-              start = std::min<uint16_t>(start, available);
-              const uint16_t fallback_len = static_cast<uint16_t>(available - start);
-              length = length > 0 ? std::min<uint16_t>(length, fallback_len) : fallback_len;
-            } else {
-              length = 0;
+          if (length == 0) {
+            const auto dev_it = std::find_if(devices_snapshot.begin(), devices_snapshot.end(), [&](const WledDeviceConfig& d) { return d.id == m.id; });
+            if (dev_it != devices_snapshot.end() && dev_it->leds > 0) {
+              length = dev_it->leds;
             }
           }
-          if (length == 0) continue;
-          if (cursor + length * 3 > frame.size()) {
-            length = static_cast<uint16_t>((frame.size() - cursor) / 3);
-          }
-          if (length == 0) break;
-          if (m.type == "wled") {
-            WledDeviceConfig dev{};
-            std::string ip;
-            if (!resolve_device(m.id, devices_snapshot, status, dev, ip)) {
-              cursor += length * 3;
+        } else {
+          ESP_LOGW(TAG, "Virtual segment %s member type %s not rendered (unsupported)", vseg.id.c_str(), m.type.c_str());
+          continue;
+        }
+        if (length == 0) {
+          continue;
+        }
+        PixelView view;
+        view.offset = m.offset >= 0 ? static_cast<size_t>(m.offset) : cursor;
+        view.length = length;
+        view.stride = std::max<uint16_t>(1, m.stride);
+        view.reverse = m.reverse;
+        cursor = view.offset + view.extent();
+        total_leds = std::max(total_leds, cursor);
+        member_views.push_back(MemberView{&m, seg, start, view});
+        any_due = any_due || m.type == "wled" || seg != nullptr;
+      }
+      if (!any_due || total_leds == 0 || total_leds > UINT16_MAX) {
+        continue;
+      }
+      WledEffectBinding fake{};
+      fake.device_id = vseg.id;
+      fake.effect = vseg.effect;
+      fake.audio_channel = "mix";
+      // Full level: physical members are dimmed by the LED engine, WLED members while packing
+      const auto frame = render_frame(fake, static_cast<uint16_t>(total_leds), frame_idx, 255, fps);
+      for (auto& mv : member_views) {
+        mv.view.base = frame.data();
+        const VirtualSegmentMember& m = *mv.member;
+        if (m.type == "wled") {
+          WledDeviceConfig dev{};
+          std::string ip;
+          if (!resolve_device(m.id, devices_snapshot, status, dev, ip)) {
             continue;
           }
           const uint16_t port = cfg_ref_ && cfg_ref_->mqtt.ddp_port > 0 ? cfg_ref_->mqtt.ddp_port : kDefaultDdpPort;
           const uint32_t channel = 0;  // WLED DDP: use channel 0 for compatibility
-            const std::vector<uint8_t> slice(frame.begin() + cursor, frame.begin() + cursor + length * 3);
-            const bool ok = ddp_send_complete_frame(ip, port, slice, channel, next_seq());
-            if (!ok) {
-              ESP_LOGW(TAG, "DDP send failed (virtual %s) -> %s:%u", vseg.id.c_str(), ip.c_str(), port);
-            }
-          } else if (m.type == "physical") {
-            const auto* seg = find_segment(m);
-            const bool has_runtime = led_runtime_ != nullptr;
-            if (!seg || !has_runtime) {
-              ESP_LOGW(TAG,
-                       "Virtual segment %s physical member %s skipped (runtime=%d, seg_found=%d)",
-                       vseg.id.c_str(),
-                       m.id.c_str(),
-                       has_runtime ? 1 : 0,
-                       seg ? 1 : 0);
-              cursor += length * 3;
-              continue;
-            }
-            const std::vector<uint8_t> slice(frame.begin() + cursor, frame.begin() + cursor + length * 3);
-            const esp_err_t res = led_runtime_->render_frame(slice, *seg, start, length);
-            if (res != ESP_OK) {
-              ESP_LOGW(TAG,
-                       "Render hook error %s for virtual %s member %s (start=%u len=%u)",
-                       esp_err_to_name(res),
-                       vseg.id.c_str(),
-                       m.id.c_str(),
-                       static_cast<unsigned>(start),
-                       static_cast<unsigned>(length));
-            }
-          } else {
-            ESP_LOGW(TAG, "Virtual segment %s member type %s not rendered (unsupported)", vseg.id.c_str(), m.type.c_str());
+          const bool ok = ddp_send_view(ip, port, mv.view, global_brightness, channel, next_seq());
+          if (!ok) {
+            ESP_LOGW(TAG, "DDP send failed (virtual %s) -> %s:%u", vseg.id.c_str(), ip.c_str(), port);
+          }
+        } else if (mv.seg != nullptr) {
+          const esp_err_t res = led_runtime_->render_view(mv.view, *mv.seg, mv.start);
+          if (res != ESP_OK) {
+            ESP_LOGW(TAG,
+                     "Render hook error %s for virtual %s member %s (start=%u len=%u)",
+                     esp_err_to_name(res),
+                     vseg.id.c_str(),
+                     m.id.c_str(),
+                     static_cast<unsigned>(mv.start),
+                     static_cast<unsigned>(mv.view.length));
           }
-          cursor += length * 3;
-        if (cursor >= frame.size()) {
-          break;
         }
       }
     }
@@ -2195,32 +2427,3 @@ void WledEffectsRuntime::task_loop() {
     vTaskDelay(delay);
   }
 }
-
-std::string WledEffectsRuntime::envelope_key(const WledEffectBinding& binding) const {
-  return binding.device_id + ":" + std::to_string(binding.segment_index) + ":" + binding.effect.effect;
-}
-
-float WledEffectsRuntime::apply_envelope(const std::string& key,
-                                         float input,
-                                         uint16_t fps,
-                                         uint16_t attack_ms,
-                                         uint16_t release_ms) {
-  if (fps == 0 || (attack_ms == 0 && release_ms == 0)) {
-    return clamp01(input);
-  }
-  const float dt_ms = 1000.0f / static_cast<float>(fps);
-  const float alpha_attack = std::min(1.0f, dt_ms / std::max(1.0f, static_cast<float>(attack_ms)));
-  const float alpha_release = std::min(1.0f, dt_ms / std::max(1.0f, static_cast<float>(release_ms)));
-  float level = 0.0f;
-  if (auto it = envelope_state_.find(key); it != envelope_state_.end()) {
-    level = it->second;
-  }
-  if (input > level) {
-    level += (input - level) * alpha_attack;
-  } else {
-    level += (input - level) * alpha_release;
-  }
-  level = clamp01(level);
-  envelope_state_[key] = level;
-  return level;
-}
@@ -2,9 +2,11 @@
 
 #include "config.hpp"
 #include "led_engine.hpp"
+#include "led_engine/mem_placement.hpp"
 #include "wled_discovery.hpp"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include <array>
 #include <cstdint>
 #include <mutex>
 #include <unordered_map>
@@ -19,6 +21,17 @@ class WledEffectsRuntime {
   void update_config(const AppConfig& cfg);
   void stop();
 
+  // Sparse effects (Scanner, Meteor, Comet, Sparkle) describe what changed since
+  // their previous frame. The hint is only given for the frame right after the
+  // last one rendered with the same look; otherwise the region stays "all" and
+  // the LED engine diffs the frame itself.
+  struct SparseTrack {
+    uint32_t frame_idx{0};
+    uint32_t look{0};
+    int32_t last{-1};  // effect-specific position in the previous frame
+    bool valid{false};
+  };
+
  private:
   static void task_entry(void* arg);
   void task_loop();
@@ -40,9 +53,10 @@ class WledEffectsRuntime {
                                     uint32_t frame_idx,
                                     uint8_t global_brightness,
                                     uint16_t fps,
-                                    const LedLayoutConfig& layout = LedLayoutConfig{});
-  float apply_envelope(const std::string& key, float input, uint16_t fps, uint16_t attack_ms, uint16_t release_ms);
-  std::string envelope_key(const WledEffectBinding& binding) const;
+                                    const LedLayoutConfig& layout = LedLayoutConfig{},
+                                    PixelFormat preferred = PixelFormat::Rgb888,
+                                    PixelFormat* produced = nullptr,
+                                    DirtyRegion* dirty = nullptr);
   uint8_t next_seq();  // Get next DDP sequence (1-15, cycling)
 
   AppConfig* cfg_ref_{nullptr};
@@ -53,7 +67,6 @@ class WledEffectsRuntime {
   TaskHandle_t task_{nullptr};
   bool running_{false};
   uint8_t seq_{1};  // DDP sequence must be 1-15 (0 is reserved)
-  std::unordered_map<std::string, float> envelope_state_;
   std::unordered_set<std::string> active_ddp_devices_;  // Track devices with active DDP mode
   
   // Performance optimizations for multiple devices/segments
@@ -64,6 +77,12 @@ class WledEffectsRuntime {
     bool valid;
   };
   std::unordered_map<std::string, CachedAddrInfo> ddp_addr_cache_;  // IP -> cached addrinfo
+  // Last frame each DDP target received, so unchanged pixels are not sent again
+  struct DdpTargetFrame {
+    placement::BulkVector<uint8_t> pixels;
+    uint32_t since_full{0};  // sends since the last complete frame
+  };
+  std::unordered_map<std::string, DdpTargetFrame> ddp_last_frame_;  // IP -> frame on the device
   static constexpr uint64_t DNS_CACHE_TTL_US = 30'000'000ULL;  // 30 seconds
   
   // Frame cache for same effect (same effect + same LED count = reuse frame)
@@ -71,14 +90,33 @@ class WledEffectsRuntime {
     std::string effect_name;
     uint16_t led_count;
     uint32_t frame_idx;
+    PixelFormat format;  // requested format
     bool operator==(const FrameCacheKey& other) const {
-      return effect_name == other.effect_name && led_count == other.led_count && frame_idx == other.frame_idx;
+      return effect_name == other.effect_name && led_count == other.led_count && frame_idx == other.frame_idx &&
+             format == other.format;
     }
   };
   struct FrameCacheKeyHash {
     size_t operator()(const FrameCacheKey& k) const {
-      return std::hash<std::string>{}(k.effect_name) ^ (std::hash<uint16_t>{}(k.led_count) << 1) ^ (std::hash<uint32_t>{}(k.frame_idx) << 2);
+      return std::hash<std::string>{}(k.effect_name) ^ (std::hash<uint16_t>{}(k.led_count) << 1) ^
+             (std::hash<uint32_t>{}(k.frame_idx) << 2) ^ (static_cast<size_t>(k.format) << 3);
     }
   };
-  std::unordered_map<FrameCacheKey, std::vector<uint8_t>, FrameCacheKeyHash> frame_cache_;
+  struct CachedFrame {
+    PixelFormat format{PixelFormat::Rgb888};  // format the effect actually produced
+    placement::BulkVector<uint8_t> pixels;
+  };
+  std::unordered_map<FrameCacheKey, CachedFrame, FrameCacheKeyHash> frame_cache_;
+
+  enum class SparseEffect : uint8_t {
+    Meteor,
+    Scanner,
+    Sparkle,
+    Comet,
+    Count,
+  };
+  using SparseTracks = std::array<SparseTrack, static_cast<size_t>(SparseEffect::Count)>;
+  // Effects task only: binding target (device_id) -> track per sparse effect
+  std::unordered_map<std::string, SparseTracks> sparse_tracks_;
+  bool sparse_tracks_stale_{false};  // set by update_config, guarded by mutex_
 };